@@ -27,6 +27,7 @@
 #include <graphene/app/api_access.hpp>
 #include <graphene/app/application.hpp>
 #include <graphene/app/impacted.hpp>
+#include <graphene/account_history/account_history_plugin.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/get_config.hpp>
 #include <graphene/utilities/key_conversion.hpp>
@@ -38,7 +39,10 @@
 #include <graphene/chain/worker_object.hpp>
 #include <graphene/chain/tournament_object.hpp>
 
+#include <graphene/time/time.hpp>
+
 #include <fc/crypto/hex.hpp>
+#include <fc/log/logger.hpp>
 #include <fc/smart_ref_impl.hpp>
 
 namespace graphene { namespace app {
@@ -78,11 +82,14 @@ namespace graphene { namespace app {
     {
        if( api_name == "database_api" )
        {
-          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ) );
+          _database_api = std::make_shared< database_api >( std::ref( *_app.chain_database() ),
+             std::dynamic_pointer_cast< market_history_plugin >( _app.get_plugin( "market_history" ) ).get() );
        }
        else if( api_name == "network_broadcast_api" )
        {
-          _network_broadcast_api = std::make_shared< network_broadcast_api >( std::ref( _app ) );
+          // a read-only follower is not connected to the p2p network
+          if( _app.p2p_node() )
+             _network_broadcast_api = std::make_shared< network_broadcast_api >( std::ref( _app ) );
        }
        else if( api_name == "history_api" )
        {
@@ -90,7 +97,8 @@ namespace graphene { namespace app {
        }
        else if( api_name == "network_node_api" )
        {
-          _network_node_api = std::make_shared< network_node_api >( std::ref(_app) );
+          if( _app.p2p_node() )
+             _network_node_api = std::make_shared< network_node_api >( std::ref(_app) );
        }
        else if( api_name == "crypto_api" )
        {
@@ -102,6 +110,16 @@ namespace graphene { namespace app {
           if( _app.get_plugin( "debug_witness" ) )
              _debug_api = std::make_shared< graphene::debug_witness::debug_api >( std::ref(_app) );
        }
+       else if( api_name == "witness_api" )
+       {
+          // can only enable this API if the plugin was loaded
+          if( _app.get_plugin( "witness" ) )
+             _witness_api = std::make_shared< graphene::witness_plugin::witness_api >( std::ref(_app) );
+       }
+       else if( api_name == "node_admin_api" )
+       {
+          _node_admin_api = std::make_shared< node_admin_api >( std::ref(_app) );
+       }
        return;
     }
 
@@ -188,6 +206,106 @@ namespace graphene { namespace app {
        return _app.p2p_node()->set_advanced_node_parameters(params);
     }
 
+    node_admin_api::node_admin_api( application& a ) : _app( a )
+    {
+    }
+
+    node_health node_admin_api::get_health()const
+    {
+       chain::database& db = *_app.chain_database();
+       node_health result;
+       result.head_block_num   = db.head_block_num();
+       result.head_block_id    = db.head_block_id();
+       result.head_block_time  = db.head_block_time();
+       result.head_block_age   = ( graphene::time::now() - fc::time_point( db.head_block_time() ) ).to_seconds();
+       result.last_irreversible_block_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+       result.syncing          = !_app.is_finished_syncing();
+       if( _app.p2p_node() )
+          result.peer_count    = _app.p2p_node()->get_connection_count();
+       result.pending_transactions = db.get_pending_transactions().size();
+       result.block_event_queues   = db.block_events().get_statistics();
+       return result;
+    }
+
+    void node_admin_api::set_logging_level( const string& logger, const string& level )
+    {
+       fc::logger::get( logger ).set_log_level( fc::variant( level ).as<fc::log_level>() );
+       ilog( "Set the level of logger ${l} to ${v}", ("l", logger)("v", level) );
+    }
+
+    string node_admin_api::get_logging_level( const string& logger )const
+    {
+       return fc::variant( fc::logger::get( logger ).get_log_level() ).as_string();
+    }
+
+    void node_admin_api::set_peer_limits( uint32_t desired, uint32_t maximum )
+    {
+       FC_ASSERT( _app.p2p_node(), "The node is not connected to the p2p network" );
+       FC_ASSERT( desired > 0 && desired <= maximum, "The desired number of peers must be between 1 and the maximum" );
+       fc::mutable_variant_object params;
+       params["desired_number_of_connections"] = desired;
+       params["maximum_number_of_connections"] = maximum;
+       _app.p2p_node()->set_advanced_node_parameters( params );
+    }
+
+    void node_admin_api::set_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second )
+    {
+       FC_ASSERT( _app.p2p_node(), "The node is not connected to the p2p network" );
+       _app.p2p_node()->set_total_bandwidth_limit( upload_bytes_per_second, download_bytes_per_second );
+    }
+
+    optional<api_access_info> node_admin_api::get_api_access( const string& username )const
+    {
+       return _app.get_api_access_info( username );
+    }
+
+    void node_admin_api::set_api_access( const string& username, const api_access_info& permissions )
+    {
+       FC_ASSERT( !username.empty() );
+       api_access_info info = permissions;
+       _app.set_api_access_info( username, std::move( info ) );
+       ilog( "Set the API access of ${u} to ${a}", ("u", username)("a", permissions.allowed_apis) );
+    }
+
+    void node_admin_api::remove_api_access( const string& username )
+    {
+       _app.remove_api_access_info( username );
+       ilog( "Removed the API access of ${u}", ("u", username) );
+    }
+
+    void node_admin_api::add_checkpoints( const flat_map<uint32_t,block_id_type>& checkpoints )
+    {
+       chain::database& db = *_app.chain_database();
+       for( const auto& cp : checkpoints )
+       {
+          FC_ASSERT( cp.first > 0 && block_header::num_from_id( cp.second ) == cp.first,
+                     "The id of checkpoint ${n} belongs to another block number", ("n", cp.first) );
+          if( cp.first <= db.head_block_num() )
+             FC_ASSERT( db.get_block_id_for_num( cp.first ) == cp.second,
+                        "Checkpoint ${n} does not match the block of the chain", ("n", cp.first) );
+       }
+       db.add_checkpoints( checkpoints );
+    }
+
+    flat_map<uint32_t,block_id_type> node_admin_api::get_checkpoints()const
+    {
+       return _app.chain_database()->get_checkpoints();
+    }
+
+    void node_admin_api::set_tracked_accounts( const flat_set<account_id_type>& accounts )
+    {
+       auto plugin = _app.get_plugin< graphene::account_history::account_history_plugin >( "account_history" );
+       FC_ASSERT( plugin, "The account history plugin is not enabled on this node" );
+       plugin->set_tracked_accounts( accounts );
+    }
+
+    flat_set<account_id_type> node_admin_api::get_tracked_accounts()const
+    {
+       auto plugin = _app.get_plugin< graphene::account_history::account_history_plugin >( "account_history" );
+       FC_ASSERT( plugin, "The account history plugin is not enabled on this node" );
+       return plugin->tracked_accounts();
+    }
+
     fc::api<network_broadcast_api> login_api::network_broadcast()const
     {
        FC_ASSERT(_network_broadcast_api);
@@ -224,6 +342,18 @@ namespace graphene { namespace app {
        return *_debug_api;
     }
 
+    fc::api<graphene::witness_plugin::witness_api> login_api::witness() const
+    {
+       FC_ASSERT(_witness_api);
+       return *_witness_api;
+    }
+
+    fc::api<node_admin_api> login_api::node_admin() const
+    {
+       FC_ASSERT(_node_admin_api);
+       return *_node_admin_api;
+    }
+
 #if 0
     vector<account_id_type> get_relevant_accounts( const object* obj )
     {
@@ -380,27 +510,28 @@ namespace graphene { namespace app {
 
     vector<order_history_object> history_api::get_fill_order_history( asset_id_type a, asset_id_type b, uint32_t limit  )const
     {
-       FC_ASSERT(_app.chain_database());
-       const auto& db = *_app.chain_database();
+       auto hist = _app.get_plugin<market_history_plugin>( "market_history" );
+       FC_ASSERT( hist );
        if( a > b ) std::swap(a,b);
-       const auto& history_idx = db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
-       history_key hkey;
-       hkey.base = a;
-       hkey.quote = b;
-       hkey.sequence = std::numeric_limits<int64_t>::min();
-
-       uint32_t count = 0;
-       auto itr = history_idx.lower_bound( hkey );
-       vector<order_history_object> result;
-       while( itr != history_idx.end() && count < limit)
-       {
-          if( itr->key.base != a || itr->key.quote != b ) break;
-          result.push_back( *itr );
-          ++itr;
-          ++count;
-       }
-
-       return result;
+       return hist->read( [&]() -> vector<order_history_object> {
+          const auto& history_idx = hist->fill_history().get<by_key>();
+          history_key hkey;
+          hkey.base = a;
+          hkey.quote = b;
+          hkey.sequence = std::numeric_limits<int64_t>::min();
+
+          uint32_t count = 0;
+          auto itr = history_idx.lower_bound( hkey );
+          vector<order_history_object> result;
+          while( itr != history_idx.end() && count < limit)
+          {
+             if( itr->key.base != a || itr->key.quote != b ) break;
+             result.push_back( *itr );
+             ++itr;
+             ++count;
+          }
+          return result;
+       });
     }
 
     vector<operation_history_object> history_api::get_account_history( account_id_type account, 
@@ -468,27 +599,9 @@ namespace graphene { namespace app {
     vector<bucket_object> history_api::get_market_history( asset_id_type a, asset_id_type b,
                                                            uint32_t bucket_seconds, fc::time_point_sec start, fc::time_point_sec end )const
     { try {
-       FC_ASSERT(_app.chain_database());
-       const auto& db = *_app.chain_database();
-       vector<bucket_object> result;
-       result.reserve(200);
-
-       if( a > b ) std::swap(a,b);
-
-       const auto& bidx = db.get_index_type<bucket_index>();
-       const auto& by_key_idx = bidx.indices().get<by_key>();
-
-       auto itr = by_key_idx.lower_bound( bucket_key( a, b, bucket_seconds, start ) );
-       while( itr != by_key_idx.end() && itr->key.open <= end && result.size() < 200 )
-       {
-          if( !(itr->key.base == a && itr->key.quote == b && itr->key.seconds == bucket_seconds) )
-          {
-            return result;
-          }
-          result.push_back(*itr);
-          ++itr;
-       }
-       return result;
+       auto hist = _app.get_plugin<market_history_plugin>( "market_history" );
+       FC_ASSERT( hist );
+       return hist->get_market_history( a, b, bucket_seconds, start, end, 200 );
     } FC_CAPTURE_AND_RETHROW( (a)(b)(bucket_seconds)(start)(end) ) }
     
     crypto_api::crypto_api(){};
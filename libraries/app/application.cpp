@@ -266,7 +266,9 @@ namespace detail {
          _websocket_server->on_connection([&]( const fc::http::websocket_connection_ptr& c ){
             auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
             auto login = std::make_shared<graphene::app::login_api>( std::ref(*_self) );
-            auto db_api = std::make_shared<graphene::app::database_api>( std::ref(*_self->chain_database()) );
+            auto db_api = std::make_shared<graphene::app::database_api>( std::ref(*_self->chain_database()),
+               std::dynamic_pointer_cast<graphene::market_history::market_history_plugin>(
+                  _self->get_plugin("market_history") ).get() );
             wsc->register_api(fc::api<graphene::app::database_api>(db_api));
             wsc->register_api(fc::api<graphene::app::login_api>(login));
             c->set_session_data( wsc );
@@ -294,7 +296,9 @@ namespace detail {
          _websocket_tls_server->on_connection([&]( const fc::http::websocket_connection_ptr& c ){
             auto wsc = std::make_shared<fc::rpc::websocket_api_connection>(*c);
             auto login = std::make_shared<graphene::app::login_api>( std::ref(*_self) );
-            auto db_api = std::make_shared<graphene::app::database_api>( std::ref(*_self->chain_database()) );
+            auto db_api = std::make_shared<graphene::app::database_api>( std::ref(*_self->chain_database()),
+               std::dynamic_pointer_cast<graphene::market_history::market_history_plugin>(
+                  _self->get_plugin("market_history") ).get() );
             wsc->register_api(fc::api<graphene::app::database_api>(db_api));
             wsc->register_api(fc::api<graphene::app::login_api>(login));
             c->set_session_data( wsc );
@@ -312,7 +316,9 @@ namespace detail {
 
       ~application_impl()
       {
-         fc::remove_all(_data_dir / "blockchain/dblock");
+         // an inconsistent object graph is replayed like after an unclean shutdown
+         if( !_chain_db || !_chain_db->replay_required() )
+            fc::remove_all(_data_dir / "blockchain/dblock");
       }
 
       void set_dbg_init_key( genesis_state_type& genesis, const std::string& init_key )
@@ -324,6 +330,16 @@ namespace detail {
          return;
       }
 
+      void set_block_log_retention()
+      {
+         if( !_options->count("block-log-retention") )
+            return;
+         uint32_t blocks = _options->at("block-log-retention").as<uint32_t>();
+         uint32_t interval = _options->count("state-snapshot-interval") ? _options->at("state-snapshot-interval").as<uint32_t>() : 0;
+         ilog( "Keeping the last ${n} blocks in the block log", ("n", blocks) );
+         _chain_db->set_block_log_retention( blocks, interval );
+      }
+
       void startup()
       { try {
          bool clean = !fc::exists(_data_dir / "blockchain/dblock");
@@ -377,6 +393,22 @@ namespace detail {
          if( _options->count("resync-blockchain") )
             _chain_db->wipe(_data_dir / "blockchain", true);
 
+         if( _options->count("migrate-block-log") )
+         {
+            std::string format = _options->at("migrate-block-log").as<std::string>();
+            FC_ASSERT( format == "compressed" || format == "raw", "migrate-block-log must be 'compressed' or 'raw'" );
+            chain::block_database::migrate( _data_dir / "blockchain" / "database" / "block_num_to_block", format == "compressed" );
+         }
+         if( _options->count("repair-block-log") )
+         {
+            const fc::path blocks_dir = _data_dir / "blockchain" / "database" / "block_num_to_block";
+            if( fc::exists( blocks_dir / "blocks" ) )
+               chain::block_database::repair( blocks_dir );
+         }
+         _chain_db->set_block_log_compression( _options->count("compress-block-log") > 0 );
+         _chain_db->set_block_log_flush( _options->count("serve-followers") > 0 );
+         set_block_log_retention();
+
          flat_map<uint32_t,block_id_type> loaded_checkpoints;
          if( _options->count("checkpoint") )
          {
@@ -390,7 +422,23 @@ namespace detail {
          }
          _chain_db->add_checkpoints( loaded_checkpoints );
 
-         if( _options->count("replay-blockchain") )
+         if( _options->count("follow-data-dir") )
+         {
+            fc::path primary_dir = _options->at("follow-data-dir").as<boost::filesystem::path>();
+            ilog( "Following the node in ${d}", ("d", primary_dir) );
+            try
+            {
+               _chain_db->open_read_only( _self->blockchain_dir(), initial_state );
+            }
+            catch( const fc::exception& e )
+            {
+               wlog( "Unable to load the saved state of the followed node, applying its block log from genesis: ${e}",
+                     ("e", e.to_detail_string()) );
+               _chain_db = std::make_shared<chain::database>();
+               _chain_db->add_checkpoints( loaded_checkpoints );
+               _chain_db->open_read_only( _self->blockchain_dir(), initial_state, false );
+            }
+         } else if( _options->count("replay-blockchain") || _options->count("repair-block-log") )
          {
             ilog("Replaying blockchain on user request.");
             _chain_db->reindex(_data_dir/"blockchain", initial_state());
@@ -455,22 +503,42 @@ namespace detail {
             _chain_db->reindex(_data_dir / "blockchain", initial_state());
          }
 
-         if (!_options->count("genesis-json") &&
+         if (!_options->count("genesis-json") && !_chain_db->is_read_only() &&
              _chain_db->get_chain_id() != graphene::egenesis::get_egenesis_chain_id()) {
             elog("Detected old database. Nuking and starting over.");
             _chain_db->wipe(_data_dir / "blockchain", true);
             _chain_db.reset();
             _chain_db = std::make_shared<chain::database>();
+            _chain_db->set_block_log_compression( _options->count("compress-block-log") > 0 );
+            _chain_db->set_block_log_flush( _options->count("serve-followers") > 0 );
+            set_block_log_retention();
             _chain_db->add_checkpoints(loaded_checkpoints);
             _chain_db->open(_data_dir / "blockchain", initial_state);
          }
 
+         if( _options->count("enable-account-name-search") )
+         {
+            ilog( "Indexing account names for search" );
+            _chain_db->enable_account_name_search();
+         }
+
+         if( _options->count("state-digest-history") )
+         {
+            uint32_t blocks = _options->at("state-digest-history").as<uint32_t>();
+            ilog( "Keeping the state digest of the last ${n} blocks", ("n", blocks) );
+            _chain_db->set_state_digest_history( blocks );
+         }
+
          if( _options->count("force-validate") )
          {
             ilog( "All transaction signatures will be validated" );
             _force_validate = true;
          }
 
+         // the node is not connected to anything, the statistics describe the state as it was loaded
+         if( _options->count("dump-index-statistics") )
+            return;
+
          graphene::time::now();
 
          if( _options->count("api-access") )
@@ -491,11 +559,43 @@ namespace detail {
             _apiaccess.permission_map["*"] = wild_access;
          }
 
-         reset_p2p_node(_data_dir);
+         // a follower gets its blocks from the block log of the followed node instead of the p2p network
+         if( _chain_db->is_read_only() )
+            schedule_follow_loop();
+         else
+            reset_p2p_node(_data_dir);
          reset_websocket_server();
          reset_websocket_tls_server();
       } FC_LOG_AND_RETHROW() }
 
+      void schedule_follow_loop()
+      {
+         _follow_task = fc::schedule( [this]{ follow_loop(); },
+                                      fc::time_point::now() + fc::milliseconds( 250 ), "Follow block log" );
+      }
+
+      void follow_loop()
+      {
+         try
+         {
+            uint32_t applied = _chain_db->sync_from_block_log();
+            if( applied > 0 && !_is_finished_syncing && _chain_db->head_block_time() + fc::minutes(1) > graphene::time::now() )
+            {
+               _is_finished_syncing = true;
+               _self->syncing_finished();
+            }
+         }
+         catch( const fc::canceled_exception& )
+         {
+            throw;
+         }
+         catch( const fc::exception& e )
+         {
+            elog( "Error while following the block log: ${e}", ("e", e.to_detail_string()) );
+         }
+         schedule_follow_loop();
+      }
+
       optional< api_access_info > get_api_access_info(const string& username)const
       {
          optional< api_access_info > result;
@@ -511,7 +611,12 @@ namespace detail {
 
       void set_api_access_info(const string& username, api_access_info&& permissions)
       {
-         _apiaccess.permission_map.insert(std::make_pair(username, std::move(permissions)));
+         _apiaccess.permission_map[username] = std::move(permissions);
+      }
+
+      void remove_api_access_info(const string& username)
+      {
+         _apiaccess.permission_map.erase(username);
       }
 
       /**
@@ -658,7 +763,9 @@ namespace detail {
            bool found_a_block_in_synopsis = false;
            for (const item_hash_t& block_id_in_synopsis : boost::adaptors::reverse(blockchain_synopsis))
              if (block_id_in_synopsis == block_id_type() ||
-                 (_chain_db->is_known_block(block_id_in_synopsis) && is_included_block(block_id_in_synopsis)))
+                 ((_chain_db->is_known_block(block_id_in_synopsis) ||
+                   block_header::num_from_id(block_id_in_synopsis) < _chain_db->first_retained_block_num()) &&
+                  is_included_block(block_id_in_synopsis)))
              {
                last_known_block_id = block_id_in_synopsis;
                found_a_block_in_synopsis = true;
@@ -667,6 +774,12 @@ namespace detail {
            if (!found_a_block_in_synopsis)
              FC_THROW_EXCEPTION(graphene::net::peer_is_on_an_unreachable_fork, "Unable to provide a list of blocks starting at any of the blocks in peer's synopsis");
          }
+         // a pruned node can't serve the blocks the peer needs next, it will sync from someone else but
+         // stays connected for new blocks
+         if( block_header::num_from_id(last_known_block_id) + 1 < _chain_db->first_retained_block_num() )
+            FC_THROW_EXCEPTION(graphene::net::peer_is_on_an_unreachable_fork,
+                               "Blocks before ${n} were pruned from our block log",
+                               ("n", _chain_db->first_retained_block_num()));
          for( uint32_t num = block_header::num_from_id(last_known_block_id);
               num <= _chain_db->head_block_num() && result.size() < limit;
               ++num )
@@ -688,6 +801,8 @@ namespace detail {
          if( id.item_type == graphene::net::block_message_type )
          {
             auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
+            if( !opt_block && block_header::num_from_id(id.item_hash) < _chain_db->first_retained_block_num() )
+               FC_THROW_EXCEPTION( fc::key_not_found_exception, "Block ${id} was pruned from our block log", ("id", id.item_hash) );
             if( !opt_block )
                elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
                     ("id", id.item_hash)("id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
@@ -956,6 +1071,7 @@ namespace detail {
       std::map<string, std::shared_ptr<abstract_plugin>> _plugins;
 
       bool _is_finished_syncing = false;
+      fc::future<void> _follow_task;
    };
 
 }
@@ -966,6 +1082,8 @@ application::application()
 
 application::~application()
 {
+   if( my->_follow_task.valid() )
+      my->_follow_task.cancel_and_wait( __FUNCTION__ );
    if( my->_p2p_network )
    {
       my->_p2p_network->close();
@@ -992,8 +1110,19 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("server-pem,p", bpo::value<string>()->implicit_value("server.pem"), "The TLS certificate file for this server")
          ("server-pem-password,P", bpo::value<string>()->implicit_value(""), "Password for this certificate")
          ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read Genesis State from")
+         ("dump-index-statistics", "Print object counts and memory usage of every index after opening the database, then "
+                                   "exit without connecting to the network")
          ("dbg-init-key", bpo::value<string>(), "Block signing key to use for init witnesses, overrides genesis file")
          ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
+         ("serve-followers", "Write every block through to the block log right away, for nodes started with --follow-data-dir "
+          "on this data directory")
+         ("compress-block-log", "Store new blocks compressed with zlib, existing blocks are only converted by --migrate-block-log")
+         ("block-log-retention", bpo::value<uint32_t>(), "Keep only the last N blocks in the block log, older blocks can not be served to peers (default: keep every block)")
+         ("state-snapshot-interval", bpo::value<uint32_t>(), "Number of blocks between the state snapshots a pruned node replays from (default: block-log-retention)")
+         ("enable-account-name-search", "Index the parts of account names for search_accounts_by_name, which costs "
+                                        "memory for every account (disabled by default)")
+         ("state-digest-history", bpo::value<uint32_t>(), "Maintain an order independent digest of the state and keep it for this many blocks, "
+                                                         "so that it can be compared with other nodes (disabled by default)")
          ;
    command_line_options.add(configuration_file_options);
    command_line_options.add_options()
@@ -1003,6 +1132,11 @@ void application::set_program_options(boost::program_options::options_descriptio
           "invalid file is found, it will be replaced with an example Genesis State.")
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
+         ("follow-data-dir", bpo::value<boost::filesystem::path>(), "Serve the APIs read-only from the state of the node "
+          "whose data directory is given, applying the blocks it writes without joining the p2p network.  That node "
+          "should run with --serve-followers")
+         ("migrate-block-log", bpo::value<string>(), "Rewrite the block log before opening it, storing every block 'compressed' or 'raw'")
+         ("repair-block-log", "Verify the block log, rebuild its index or cut it before the first damaged block, and replay it")
          ("force-validate", "Force validation of all transactions")
          ("genesis-timestamp", bpo::value<uint32_t>(), "Replace timestamp from genesis.json with current time plus this many seconds (experts only!)")
          ;
@@ -1056,7 +1190,11 @@ void application::startup()
 
 std::shared_ptr<abstract_plugin> application::get_plugin(const string& name) const
 {
-   return my->_plugins[name];
+   // looking up a plugin that was not registered must not add an empty entry to the plugin map
+   auto itr = my->_plugins.find( name );
+   if( itr == my->_plugins.end() )
+      return std::shared_ptr<abstract_plugin>();
+   return itr->second;
 }
 
 net::node_ptr application::p2p_node()
@@ -1064,11 +1202,23 @@ net::node_ptr application::p2p_node()
    return my->_p2p_network;
 }
 
+net::node_delegate* application::p2p_delegate()
+{
+   return my.get();
+}
+
 std::shared_ptr<chain::database> application::chain_database() const
 {
    return my->_chain_db;
 }
 
+fc::path application::blockchain_dir()const
+{
+   if( my->_options && my->_options->count("follow-data-dir") )
+      return my->_options->at("follow-data-dir").as<boost::filesystem::path>() / "blockchain";
+   return my->_data_dir / "blockchain";
+}
+
 void application::set_block_production(bool producing_blocks)
 {
    my->_is_block_producer = producing_blocks;
@@ -1084,6 +1234,11 @@ void application::set_api_access_info(const string& username, api_access_info&&
    my->set_api_access_info(username, std::move(permissions));
 }
 
+void application::remove_api_access_info(const string& username)
+{
+   my->remove_api_access_info(username);
+}
+
 bool application::is_finished_syncing() const
 {
    return my->_is_finished_syncing;
@@ -1102,6 +1257,8 @@ void application::shutdown_plugins()
 }
 void application::shutdown()
 {
+   if( my->_follow_task.valid() )
+      my->_follow_task.cancel_and_wait( __FUNCTION__ );
    if( my->_p2p_network )
       my->_p2p_network->close();
    if( my->_chain_db )
@@ -32,6 +32,7 @@
 
 #include <fc/crypto/hex.hpp>
 
+#include <boost/algorithm/string/case_conv.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <boost/rational.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -51,7 +52,7 @@ class database_api_impl;
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 {
    public:
-      database_api_impl( graphene::chain::database& db );
+      database_api_impl( graphene::chain::database& db, const market_history_plugin* market_history );
       ~database_api_impl();
 
       // Objects
@@ -74,23 +75,32 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       fc::variant_object get_config()const;
       chain_id_type get_chain_id()const;
       dynamic_global_property_object get_dynamic_global_properties()const;
+      database_statistics get_database_statistics( uint32_t max_samples )const;
+      optional<state_digest_record> get_state_digest( uint32_t block_num )const;
 
       // Keys
       vector<vector<account_id_type>> get_key_references( vector<public_key_type> key )const;
+      vector<authority_reference> list_key_references( public_key_type key, account_id_type start, uint32_t limit )const;
+      const authority_reference_index& get_authority_references()const;
 
       // Accounts
       vector<optional<account_object>> get_accounts(const vector<account_id_type>& account_ids)const;
       std::map<string,full_account> get_full_accounts( const vector<string>& names_or_ids, bool subscribe );
       optional<account_object> get_account_by_name( string name )const;
       vector<account_id_type> get_account_references( account_id_type account_id )const;
+      vector<authority_reference> list_account_references( account_id_type account_id, account_id_type start, uint32_t limit )const;
       vector<optional<account_object>> lookup_account_names(const vector<string>& account_names)const;
       map<string,account_id_type> lookup_accounts(const string& lower_bound_name, uint32_t limit)const;
+      map<string,account_id_type> lookup_accounts_by_prefix(const string& prefix, const string& after_name, uint32_t limit)const;
+      account_name_search_result search_accounts_by_name(const string& part, account_id_type start, uint32_t limit)const;
       uint64_t get_account_count()const;
+      vector<account_listing_object> get_account_listings( account_id_type authorizing_account, account_id_type start, uint32_t limit )const;
 
       // Balances
       vector<asset> get_account_balances(account_id_type id, const flat_set<asset_id_type>& assets)const;
       vector<asset> get_named_account_balances(const std::string& name, const flat_set<asset_id_type>& assets)const;
       vector<balance_object> get_balance_objects( const vector<address>& addrs )const;
+      vector<vector<balance_object>> get_balance_objects_by_keys( const vector<public_key_type>& keys )const;
       vector<asset> get_vested_balances( const vector<balance_id_type>& objs )const;
       vector<vesting_balance_object> get_vesting_balances( account_id_type account_id )const;
 
@@ -98,6 +108,9 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       vector<optional<asset_object>> get_assets(const vector<asset_id_type>& asset_ids)const;
       vector<asset_object>           list_assets(const string& lower_bound_symbol, uint32_t limit)const;
       vector<optional<asset_object>> lookup_asset_symbols(const vector<string>& symbols_or_ids)const;
+      vector<optional<asset_metadata>> get_asset_metadata(const vector<string>& symbols_or_ids)const;
+      vector<asset_metadata>         search_assets(const string& symbol_prefix, uint32_t limit)const;
+      asset_metadata                 make_asset_metadata(const asset_object& a)const;
 
       // Markets / feeds
       vector<limit_order_object>         get_limit_orders(asset_id_type a, asset_id_type b, uint32_t limit)const;
@@ -110,6 +123,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       market_volume                      get_24_volume( const string& base, const string& quote )const;
       order_book                         get_order_book( const string& base, const string& quote, unsigned limit = 50 )const;
       vector<market_trade>               get_trade_history( const string& base, const string& quote, fc::time_point_sec start, fc::time_point_sec stop, unsigned limit = 100 )const;
+      vector<market_summary>             get_market_summaries( asset_id_type start_base, asset_id_type start_quote, uint32_t limit )const;
 
       // Witnesses
       vector<optional<witness_object>> get_witnesses(const vector<witness_id_type>& witness_ids)const;
@@ -190,6 +204,7 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
       boost::signals2::scoped_connection                                                                                           _pending_trx_connection;
       map< pair<asset_id_type,asset_id_type>, std::function<void(const variant&)> >      _market_subscriptions;
       graphene::chain::database&                                                                                                            _db;
+      const market_history_plugin*                                                                                                          _market_history = nullptr;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -198,12 +213,13 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
 //                                                                  //
 //////////////////////////////////////////////////////////////////////
 
-database_api::database_api( graphene::chain::database& db )
-   : my( new database_api_impl( db ) ) {}
+database_api::database_api( graphene::chain::database& db, const market_history_plugin* market_history )
+   : my( new database_api_impl( db, market_history ) ) {}
 
 database_api::~database_api() {}
 
-database_api_impl::database_api_impl( graphene::chain::database& db ):_db(db)
+database_api_impl::database_api_impl( graphene::chain::database& db, const market_history_plugin* market_history )
+:_db(db),_market_history(market_history)
 {
    wlog("creating database api ${x}", ("x",int64_t(this)) );
    _change_connection = _db.changed_objects.connect([this](const vector<object_id_type>& ids) {
@@ -428,6 +444,34 @@ dynamic_global_property_object database_api_impl::get_dynamic_global_properties(
    return _db.get(dynamic_global_property_id_type());
 }
 
+database_statistics database_api::get_database_statistics( uint32_t max_samples )const
+{
+   return my->get_database_statistics( max_samples );
+}
+
+database_statistics database_api_impl::get_database_statistics( uint32_t max_samples )const
+{
+   FC_ASSERT( max_samples > 0 && max_samples <= 10000, "max_samples must be between 1 and 10000" );
+   database_statistics result;
+   result.head_block_number = _db.head_block_num();
+   result.indexes = _db.get_index_statistics( max_samples );
+   result.undo = _db._undo_db.get_statistics( max_samples );
+   result.pools = get_memory_pool_statistics();
+   return result;
+}
+
+optional<state_digest_record> database_api::get_state_digest( uint32_t block_num )const
+{
+   return my->get_state_digest( block_num );
+}
+
+optional<state_digest_record> database_api_impl::get_state_digest( uint32_t block_num )const
+{
+   if( block_num == 0 )
+      block_num = _db.head_block_num();
+   return _db.get_block_state_digest( block_num );
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Keys                                                             //
@@ -440,55 +484,26 @@ vector<vector<account_id_type>> database_api::get_key_references( vector<public_
 }
 
 /**
- *  @return all accounts that referr to the key or account id in their owner or active authorities.
+ *  @return all accounts that referr to the key in their owner or active authorities or as memo key.
  */
 vector<vector<account_id_type>> database_api_impl::get_key_references( vector<public_key_type> keys )const
 {
-   wdump( (keys) );
    vector< vector<account_id_type> > final_result;
    final_result.reserve(keys.size());
+   const auto& refs = get_authority_references();
 
    for( auto& key : keys )
    {
-
-      address a1( pts_address(key, false, 56) );
-      address a2( pts_address(key, true, 56) );
-      address a3( pts_address(key, false, 0)  );
-      address a4( pts_address(key, true, 0)  );
-      address a5( key );
-
       subscribe_to_item( key );
-      subscribe_to_item( a1 );
-      subscribe_to_item( a2 );
-      subscribe_to_item( a3 );
-      subscribe_to_item( a4 );
-      subscribe_to_item( a5 );
-
-      const auto& idx = _db.get_index_type<account_index>();
-      const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
-      const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
-      auto itr = refs.account_to_key_memberships.find(key);
-      vector<account_id_type> result;
-
-      for( auto& a : {a1,a2,a3,a4,a5} )
-      {
-          auto itr = refs.account_to_address_memberships.find(a);
-          if( itr != refs.account_to_address_memberships.end() )
-          {
-             result.reserve( itr->second.size() );
-             for( auto item : itr->second )
-             {
-                wdump((a)(item)(item(_db).name));
-                result.push_back(item);
-             }
-          }
-      }
+      for( const address& a : { address( pts_address(key, false, 56) ), address( pts_address(key, true, 56) ),
+                                address( pts_address(key, false, 0) ), address( pts_address(key, true, 0) ),
+                                address( key ) } )
+         subscribe_to_item( a );
 
-      if( itr != refs.account_to_key_memberships.end() )
-      {
-         result.reserve( itr->second.size() );
-         for( auto item : itr->second ) result.push_back(item);
-      }
+      vector<account_id_type> result;
+      for( const authority_reference& ref : refs.find_key_references( key, account_id_type(), std::numeric_limits<uint32_t>::max() ) )
+         if( ref.roles & (owner_reference | active_reference | memo_reference) )
+            result.push_back( ref.account );
       final_result.emplace_back( std::move(result) );
    }
 
@@ -498,6 +513,23 @@ vector<vector<account_id_type>> database_api_impl::get_key_references( vector<pu
    return final_result;
 }
 
+vector<authority_reference> database_api::list_key_references( public_key_type key, account_id_type start, uint32_t limit )const
+{
+   return my->list_key_references( key, start, limit );
+}
+
+vector<authority_reference> database_api_impl::list_key_references( public_key_type key, account_id_type start, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   return get_authority_references().find_key_references( key, start, limit );
+}
+
+const authority_reference_index& database_api_impl::get_authority_references()const
+{
+   const auto& aidx = dynamic_cast<const primary_index<account_index>&>( _db.get_index_type<account_index>() );
+   return aidx.get_secondary_index<graphene::chain::authority_reference_index>();
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Accounts                                                         //
@@ -645,20 +677,24 @@ vector<account_id_type> database_api::get_account_references( account_id_type ac
 
 vector<account_id_type> database_api_impl::get_account_references( account_id_type account_id )const
 {
-   const auto& idx = _db.get_index_type<account_index>();
-   const auto& aidx = dynamic_cast<const primary_index<account_index>&>(idx);
-   const auto& refs = aidx.get_secondary_index<graphene::chain::account_member_index>();
-   auto itr = refs.account_to_account_memberships.find(account_id);
    vector<account_id_type> result;
-
-   if( itr != refs.account_to_account_memberships.end() )
-   {
-      result.reserve( itr->second.size() );
-      for( auto item : itr->second ) result.push_back(item);
-   }
+   for( const authority_reference& ref : get_authority_references().find_account_references( account_id, account_id_type(),
+                                                                                            std::numeric_limits<uint32_t>::max() ) )
+      result.push_back( ref.account );
    return result;
 }
 
+vector<authority_reference> database_api::list_account_references( account_id_type account_id, account_id_type start, uint32_t limit )const
+{
+   return my->list_account_references( account_id, start, limit );
+}
+
+vector<authority_reference> database_api_impl::list_account_references( account_id_type account_id, account_id_type start, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   return get_authority_references().find_account_references( account_id, start, limit );
+}
+
 vector<optional<account_object>> database_api::lookup_account_names(const vector<string>& account_names)const
 {
    return my->lookup_account_names( account_names );
@@ -700,6 +736,50 @@ map<string,account_id_type> database_api_impl::lookup_accounts(const string& low
    return result;
 }
 
+map<string,account_id_type> database_api::lookup_accounts_by_prefix(const string& prefix, const string& after_name, uint32_t limit)const
+{
+   return my->lookup_accounts_by_prefix( prefix, after_name, limit );
+}
+
+map<string,account_id_type> database_api_impl::lookup_accounts_by_prefix(const string& prefix, const string& after_name, uint32_t limit)const
+{
+   FC_ASSERT( limit <= 1000 );
+   // names only have lower case letters
+   const string lower_prefix = boost::algorithm::to_lower_copy( prefix );
+   const auto& accounts_by_name = _db.get_index_type<account_index>().indices().get<by_name>();
+   map<string,account_id_type> result;
+
+   auto itr = accounts_by_name.lower_bound( lower_prefix );
+   if( after_name >= lower_prefix )
+      itr = accounts_by_name.upper_bound( after_name );
+   for( ; limit-- && itr != accounts_by_name.end() && itr->name.compare( 0, lower_prefix.size(), lower_prefix ) == 0; ++itr )
+      result.insert( make_pair( itr->name, itr->get_id() ) );
+
+   return result;
+}
+
+account_name_search_result database_api::search_accounts_by_name(const string& part, account_id_type start, uint32_t limit)const
+{
+   return my->search_accounts_by_name( part, start, limit );
+}
+
+account_name_search_result database_api_impl::search_accounts_by_name(const string& part, account_id_type start, uint32_t limit)const
+{
+   FC_ASSERT( limit <= 1000 );
+   const auto& aidx = dynamic_cast<const primary_index<account_index>&>( _db.get_index_type<account_index>() );
+   const auto* names = aidx.find_secondary_index<graphene::chain::account_name_search_index>();
+   FC_ASSERT( names != nullptr, "Searching account names is not enabled on this node" );
+   account_name_search_result result;
+
+   // bounds the work of one call when the part is in a large share of the names
+   const uint32_t max_scanned = 100 * 1000;
+   for( const account_id_type id : names->find_containing( _db, boost::algorithm::to_lower_copy( part ), start, limit,
+                                                           max_scanned, result.next ) )
+      result.accounts.emplace( id, id(_db).name );
+
+   return result;
+}
+
 uint64_t database_api::get_account_count()const
 {
    return my->get_account_count();
@@ -710,6 +790,23 @@ uint64_t database_api_impl::get_account_count()const
    return _db.get_index_type<account_index>().indices().size();
 }
 
+vector<account_listing_object> database_api::get_account_listings( account_id_type authorizing_account, account_id_type start, uint32_t limit )const
+{
+   return my->get_account_listings( authorizing_account, start, limit );
+}
+
+vector<account_listing_object> database_api_impl::get_account_listings( account_id_type authorizing_account, account_id_type start, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   const auto& listings = _db.get_index_type<account_listing_index>().indices().get<by_authorizing_account>();
+   vector<account_listing_object> result;
+   for( auto itr = listings.lower_bound( boost::make_tuple( authorizing_account, start ) );
+        limit-- && itr != listings.end() && itr->authorizing_account == authorizing_account;
+        ++itr )
+      result.push_back( *itr );
+   return result;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Balances                                                         //
@@ -785,6 +882,37 @@ vector<balance_object> database_api_impl::get_balance_objects( const vector<addr
    FC_CAPTURE_AND_RETHROW( (addrs) )
 }
 
+vector<vector<balance_object>> database_api::get_balance_objects_by_keys( const vector<public_key_type>& keys )const
+{
+   return my->get_balance_objects_by_keys( keys );
+}
+
+vector<vector<balance_object>> database_api_impl::get_balance_objects_by_keys( const vector<public_key_type>& keys )const
+{
+   try
+   {
+      const auto& by_owner_idx = _db.get_index_type<balance_index>().indices().get<by_owner>();
+
+      vector<vector<balance_object>> result;
+      result.reserve( keys.size() );
+
+      for( const public_key_type& key : keys )
+      {
+         result.emplace_back();
+         for( const address& owner : balance_object::owner_addresses( key ) )
+         {
+            auto range = by_owner_idx.equal_range( boost::make_tuple( owner ) );
+            if( range.first == range.second )
+               continue;
+            subscribe_to_item( owner );
+            std::copy( range.first, range.second, std::back_inserter( result.back() ) );
+         }
+      }
+      return result;
+   }
+   FC_CAPTURE_AND_RETHROW( (keys) )
+}
+
 vector<asset> database_api::get_vested_balances( const vector<balance_id_type>& objs )const
 {
    return my->get_vested_balances( objs );
@@ -895,6 +1023,73 @@ vector<optional<asset_object>> database_api_impl::lookup_asset_symbols(const vec
    return result;
 }
 
+vector<optional<asset_metadata>> database_api::get_asset_metadata(const vector<string>& symbols_or_ids)const
+{
+   return my->get_asset_metadata( symbols_or_ids );
+}
+
+vector<optional<asset_metadata>> database_api_impl::get_asset_metadata(const vector<string>& symbols_or_ids)const
+{
+   FC_ASSERT( symbols_or_ids.size() <= 100 );
+   vector<optional<asset_metadata>> result;
+   result.reserve(symbols_or_ids.size());
+   for( const optional<asset_object>& a : lookup_asset_symbols( symbols_or_ids ) )
+   {
+      if( a.valid() )
+         result.push_back( make_asset_metadata( *a ) );
+      else
+         result.emplace_back();
+   }
+   return result;
+}
+
+vector<asset_metadata> database_api::search_assets(const string& symbol_prefix, uint32_t limit)const
+{
+   return my->search_assets( symbol_prefix, limit );
+}
+
+vector<asset_metadata> database_api_impl::search_assets(const string& symbol_prefix, uint32_t limit)const
+{
+   FC_ASSERT( limit <= 100 );
+   // symbols only have upper case letters, so the symbol index serves searches in any case
+   const string prefix = boost::algorithm::to_upper_copy( symbol_prefix );
+   const auto& assets_by_symbol = _db.get_index_type<asset_index>().indices().get<by_symbol>();
+   vector<asset_metadata> result;
+   result.reserve(limit);
+
+   for( auto itr = assets_by_symbol.lower_bound(prefix);
+        limit-- && itr != assets_by_symbol.end() && itr->symbol.compare( 0, prefix.size(), prefix ) == 0;
+        ++itr )
+      result.push_back( make_asset_metadata( *itr ) );
+
+   return result;
+}
+
+asset_metadata database_api_impl::make_asset_metadata(const asset_object& a)const
+{
+   asset_metadata result;
+   result.asset_obj = a;
+   result.dynamic_data = a.dynamic_data(_db);
+   if( a.bitasset_data_id.valid() )
+   {
+      const asset_bitasset_data_object& bitasset = a.bitasset_data(_db);
+      bitasset_feed_summary feed;
+      feed.options = bitasset.options;
+      feed.current_feed = bitasset.current_feed;
+      feed.current_feed_publication_time = bitasset.current_feed_publication_time;
+      feed.feed_is_expired = bitasset.feed_is_expired( _db.head_block_time() );
+      feed.feed_count = bitasset.feeds.size();
+      feed.is_prediction_market = bitasset.is_prediction_market;
+      feed.force_settled_volume = bitasset.force_settled_volume;
+      feed.settlement_price = bitasset.settlement_price;
+      feed.settlement_fund = bitasset.settlement_fund;
+      result.bitasset = feed;
+   }
+   if( a.dividend_data_id.valid() )
+      result.dividend_data = a.dividend_data(_db);
+   return result;
+}
+
 //////////////////////////////////////////////////////////////////////
 //                                                                  //
 // Markets / feeds                                                  //
@@ -1207,51 +1402,122 @@ vector<market_trade> database_api_impl::get_trade_history( const string& base,
    auto base_id = assets[0]->id;
    auto quote_id = assets[1]->id;
 
+   FC_ASSERT( _market_history, "The market_history plugin is not enabled on this node" );
    if( base_id > quote_id ) std::swap( base_id, quote_id );
-   const auto& history_idx = _db.get_index_type<graphene::market_history::history_index>().indices().get<by_key>();
-   history_key hkey;
-   hkey.base = base_id;
-   hkey.quote = quote_id;
-   hkey.sequence = std::numeric_limits<int64_t>::min();
 
    auto price_to_real = [&]( const share_type a, int p ) { return double( a.value ) / pow( 10, p ); };
 
    if ( start.sec_since_epoch() == 0 )
       start = fc::time_point_sec( fc::time_point::now() );
 
-   uint32_t count = 0;
-   auto itr = history_idx.lower_bound( hkey );
-   vector<market_trade> result;
+   // the fills are copied on the plugin's thread, which keeps processing blocks
+   const auto fills = _market_history->read( [&]() -> vector<order_history_object> {
+      const auto& history_idx = _market_history->fill_history().get<by_key>();
+      history_key hkey;
+      hkey.base = base_id;
+      hkey.quote = quote_id;
+      hkey.sequence = std::numeric_limits<int64_t>::min();
+
+      vector<order_history_object> selected;
+      auto itr = history_idx.lower_bound( hkey );
+      while( itr != history_idx.end() && selected.size() < limit && !( itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop ) )
+      {
+         if( itr->time < start )
+            selected.push_back( *itr );
 
-   while( itr != history_idx.end() && count < limit && !( itr->key.base != base_id || itr->key.quote != quote_id || itr->time < stop ) )
+         // Trades are tracked in each direction.
+         ++itr;
+         ++itr;
+      }
+      return selected;
+   });
+
+   vector<market_trade> result;
+   result.reserve( fills.size() );
+   for( const order_history_object& fill : fills )
    {
-      if( itr->time < start )
+      market_trade trade;
+
+      if( assets[0]->id == fill.op.receives.asset_id )
       {
-         market_trade trade;
+         trade.amount = price_to_real( fill.op.pays.amount, assets[1]->precision );
+         trade.value = price_to_real( fill.op.receives.amount, assets[0]->precision );
+      }
+      else
+      {
+         trade.amount = price_to_real( fill.op.receives.amount, assets[1]->precision );
+         trade.value = price_to_real( fill.op.pays.amount, assets[0]->precision );
+      }
 
-         if( assets[0]->id == itr->op.receives.asset_id )
-         {
-            trade.amount = price_to_real( itr->op.pays.amount, assets[1]->precision );
-            trade.value = price_to_real( itr->op.receives.amount, assets[0]->precision );
-         }
-         else
-         {
-            trade.amount = price_to_real( itr->op.receives.amount, assets[1]->precision );
-            trade.value = price_to_real( itr->op.pays.amount, assets[0]->precision );
-         }
+      trade.date = fill.time;
+      trade.price = trade.value / trade.amount;
 
-         trade.date = itr->time;
-         trade.price = trade.value / trade.amount;
+      result.push_back( trade );
+   }
 
-         result.push_back( trade );
-         ++count;
+   return result;
+}
+
+vector<market_summary> database_api::get_market_summaries( asset_id_type start_base, asset_id_type start_quote, uint32_t limit )const
+{
+   return my->get_market_summaries( start_base, start_quote, limit );
+}
+
+vector<market_summary> database_api_impl::get_market_summaries( asset_id_type start_base, asset_id_type start_quote, uint32_t limit )const
+{
+   FC_ASSERT( limit <= 500 );
+   FC_ASSERT( _market_history, "The market_history plugin is not enabled on this node" );
+
+   // the summaries are copied on the plugin's thread, which keeps processing blocks
+   const auto summaries = _market_history->read( [&]() -> vector<market_summary_object> {
+      const auto& by_market_idx = _market_history->market_summaries().get<by_market>();
+      vector<market_summary_object> selected;
+      for( auto itr = by_market_idx.lower_bound( boost::make_tuple( start_base, start_quote ) );
+           itr != by_market_idx.end() && selected.size() < limit; ++itr )
+         selected.push_back( *itr );
+      return selected;
+   });
+   const auto& limit_price_idx = _db.get_index_type<limit_order_index>().indices().get<by_price>();
+   auto asset_to_real = [&]( share_type a, int p ) { return double( a.value ) / pow( 10, p ); };
+
+   vector<market_summary> result;
+   result.reserve( summaries.size() );
+   for( auto itr = summaries.begin(); itr != summaries.end(); ++itr )
+   {
+      const asset_object& base = itr->base( _db );
+      const asset_object& quote = itr->quote( _db );
+      auto price_to_real = [&]( share_type base_amount, share_type quote_amount ) {
+         return asset_to_real( base_amount, base.precision ) / asset_to_real( quote_amount, quote.precision );
+      };
+
+      market_summary summary;
+      summary.base_id = base.id;
+      summary.quote_id = quote.id;
+      summary.base = base.symbol;
+      summary.quote = quote.symbol;
+      summary.last_trade = itr->last_trade;
+      summary.latest = price_to_real( itr->latest_base, itr->latest_quote );
+      summary.base_volume = asset_to_real( itr->base_volume, base.precision );
+      summary.quote_volume = asset_to_real( itr->quote_volume, quote.precision );
+      summary.percent_change = 0;
+      if( !itr->hours.empty() )
+      {
+         const double open = price_to_real( itr->hours.front().open_base, itr->hours.front().open_quote );
+         summary.percent_change = ( summary.latest / open - 1 ) * 100;
       }
 
-      // Trades are tracked in each direction.
-      ++itr;
-      ++itr;
+      // the best orders are the first ones of either side of the book
+      summary.highest_bid = 0;
+      summary.lowest_ask = 0;
+      auto bid = limit_price_idx.lower_bound( price::max( base.id, quote.id ) );
+      if( bid != limit_price_idx.end() && bid->sell_price.base.asset_id == base.id && bid->sell_price.quote.asset_id == quote.id )
+         summary.highest_bid = price_to_real( bid->sell_price.base.amount, bid->sell_price.quote.amount );
+      auto ask = limit_price_idx.lower_bound( price::max( quote.id, base.id ) );
+      if( ask != limit_price_idx.end() && ask->sell_price.base.asset_id == quote.id && ask->sell_price.quote.asset_id == base.id )
+         summary.lowest_ask = price_to_real( ask->sell_price.quote.amount, ask->sell_price.base.amount );
+
+      result.push_back( std::move( summary ) );
    }
-
    return result;
 }
 
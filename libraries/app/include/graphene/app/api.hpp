@@ -31,6 +31,7 @@
 #include <graphene/market_history/market_history_plugin.hpp>
 
 #include <graphene/debug_witness/debug_api.hpp>
+#include <graphene/witness/witness_api.hpp>
 
 #include <graphene/net/node.hpp>
 
@@ -111,6 +112,13 @@ namespace graphene { namespace app {
                                                                         uint32_t start = 0) const;
 
          vector<order_history_object> get_fill_order_history( asset_id_type a, asset_id_type b, uint32_t limit )const;
+         /**
+          * @brief Get OHLCV data of a market
+          * @param bucket_seconds Length of each bucket, any multiple of the smallest of get_market_history_buckets()
+          * @return Up to 200 buckets that opened from start to end, aggregated from the tracked bucket sizes; older
+          *         periods which are only kept in a tracked size that does not divide bucket_seconds are returned as
+          *         buckets of that size, check key.seconds
+          */
          vector<bucket_object> get_market_history( asset_id_type a, asset_id_type b, uint32_t bucket_seconds,
                                                    fc::time_point_sec start, fc::time_point_sec end )const;
          flat_set<uint32_t> get_market_history_buckets()const;
@@ -214,6 +222,82 @@ namespace graphene { namespace app {
          application& _app;
    };
    
+   /** an overview of the state of the node, see node_admin_api::get_health() */
+   struct node_health
+   {
+      uint32_t                 head_block_num = 0;
+      block_id_type            head_block_id;
+      fc::time_point_sec       head_block_time;
+      /** seconds the head block is behind the time of the node */
+      int64_t                  head_block_age = 0;
+      uint32_t                 last_irreversible_block_num = 0;
+      /** whether the node is still catching up with the network */
+      bool                     syncing = true;
+      uint32_t                 peer_count = 0;
+      uint32_t                 pending_transactions = 0;
+      /** the queues of the plugins which process applied blocks on threads of their own */
+      vector<block_event_consumer_statistics> block_event_queues;
+   };
+
+   /**
+    * @brief The node_admin_api class changes the settings of the node which are safe to change while it runs.
+    *
+    * The changes are not written to the configuration, they are lost when the node restarts.  The API is not part
+    * of the public APIs, access has to be granted in the api-access file.
+    */
+   class node_admin_api
+   {
+      public:
+         node_admin_api(application& a);
+
+         /** @brief Return the head block age, sync state, peer count and queue depths of the node */
+         node_health get_health()const;
+
+         /**
+          * @brief Set the level of a logger
+          * @param logger name of the logger, e.g. "default" or "p2p"
+          * @param level one of "all", "debug", "info", "warn", "error" and "off"
+          */
+         void   set_logging_level( const string& logger, const string& level );
+         string get_logging_level( const string& logger )const;
+
+         /**
+          * @brief Set how many peers the node connects to
+          * @param desired the node looks for new peers while it has fewer connections
+          * @param maximum the node refuses connections beyond this number
+          */
+         void set_peer_limits( uint32_t desired, uint32_t maximum );
+         /** @brief Limit the bandwidth of all connections to peers together, in bytes per second */
+         void set_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
+
+         /** @brief Return the permissions of a user of the APIs, "*" for the default permissions */
+         optional<api_access_info> get_api_access( const string& username )const;
+         /** @brief Add or replace the permissions of a user, sessions which already logged in keep their APIs */
+         void set_api_access( const string& username, const api_access_info& permissions );
+         void remove_api_access( const string& username );
+
+         /**
+          * @brief Add checkpoints, blocks up to the last checkpoint are applied without checking their signatures
+          *
+          * A checkpoint at or below the head block must match the block of the chain.
+          */
+         void add_checkpoints( const flat_map<uint32_t,block_id_type>& checkpoints );
+         flat_map<uint32_t,block_id_type> get_checkpoints()const;
+
+         /**
+          * @brief Set the accounts whose history is recorded
+          *
+          * The history of newly tracked accounts is recorded from the next block on.  An empty set, recording
+          * every account, is refused when only some accounts are tracked: the history of the other accounts
+          * would have gaps, so that switch requires restarting the node with --replay-blockchain.
+          */
+         void set_tracked_accounts( const flat_set<account_id_type>& accounts );
+         flat_set<account_id_type> get_tracked_accounts()const;
+
+      private:
+         application& _app;
+   };
+
    class crypto_api
    {
       public:
@@ -285,6 +369,10 @@ namespace graphene { namespace app {
          fc::api<crypto_api> crypto()const;
          /// @brief Retrieve the debug API (if available)
          fc::api<graphene::debug_witness::debug_api> debug()const;
+         /// @brief Retrieve the witness API (if available)
+         fc::api<graphene::witness_plugin::witness_api> witness()const;
+         /// @brief Retrieve the node administration API
+         fc::api<node_admin_api> node_admin()const;
 
       private:
          /// @brief Called to enable an API, not reflected.
@@ -297,12 +385,17 @@ namespace graphene { namespace app {
          optional< fc::api<history_api> >  _history_api;
          optional< fc::api<crypto_api> > _crypto_api;
          optional< fc::api<graphene::debug_witness::debug_api> > _debug_api;
+         optional< fc::api<graphene::witness_plugin::witness_api> > _witness_api;
+         optional< fc::api<node_admin_api> > _node_admin_api;
    };
 
 }}  // graphene::app
 
 FC_REFLECT( graphene::app::network_broadcast_api::transaction_confirmation,
         (id)(block_num)(trx_num)(trx) )
+FC_REFLECT( graphene::app::node_health,
+        (head_block_num)(head_block_id)(head_block_time)(head_block_age)(last_irreversible_block_num)(syncing)
+        (peer_count)(pending_transactions)(block_event_queues) )
 FC_REFLECT( graphene::app::verify_range_result,
         (success)(min_val)(max_val) )
 FC_REFLECT( graphene::app::verify_range_proof_rewind_result,
@@ -330,6 +423,20 @@ FC_API(graphene::app::network_node_api,
        (get_advanced_node_parameters)
        (set_advanced_node_parameters)
      )
+FC_API(graphene::app::node_admin_api,
+       (get_health)
+       (set_logging_level)
+       (get_logging_level)
+       (set_peer_limits)
+       (set_bandwidth_limit)
+       (get_api_access)
+       (set_api_access)
+       (remove_api_access)
+       (add_checkpoints)
+       (get_checkpoints)
+       (set_tracked_accounts)
+       (get_tracked_accounts)
+     )
 FC_API(graphene::app::crypto_api,
        (blind_sign)
        (unblind_signature)
@@ -349,4 +456,6 @@ FC_API(graphene::app::login_api,
        (network_node)
        (crypto)
        (debug)
+       (witness)
+       (node_admin)
      )
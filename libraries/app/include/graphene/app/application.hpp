@@ -78,11 +78,17 @@ namespace graphene { namespace app {
          }
 
          net::node_ptr                    p2p_node();
+         /** what the p2p node asks for the blocks and transactions it serves to peers */
+         net::node_delegate*              p2p_delegate();
          std::shared_ptr<chain::database> chain_database()const;
+         /** the directory startup() opens the chain database in, known once initialize() was called */
+         fc::path                         blockchain_dir()const;
 
          void set_block_production(bool producing_blocks);
          fc::optional< api_access_info > get_api_access_info( const string& username )const;
+         /** replaces the permissions of username, sessions which already logged in keep their APIs */
          void set_api_access_info(const string& username, api_access_info&& permissions);
+         void remove_api_access_info(const string& username);
 
          bool is_finished_syncing()const;
          /// Emitted when syncing finishes (is_finished_syncing will return true)
@@ -29,8 +29,10 @@
 
 #include <graphene/chain/database.hpp>
 
+#include <graphene/chain/account_listing_object.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/authority_reference_index.hpp>
 #include <graphene/chain/balance_object.hpp>
 #include <graphene/chain/chain_property_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
@@ -100,6 +102,14 @@ struct market_volume
    double                     quote_volume;
 };
 
+/** a ticker of a market listed by get_market_summaries, with the ids to continue the listing from */
+struct market_summary : public market_ticker
+{
+   asset_id_type              base_id;
+   asset_id_type              quote_id;
+   fc::time_point_sec         last_trade;
+};
+
 struct market_trade
 {
    fc::time_point_sec         date;
@@ -108,6 +118,46 @@ struct market_trade
    double                     value;
 };
 
+/** the current feed of a market issued asset, without the feeds of every producer */
+struct bitasset_feed_summary
+{
+   bitasset_options           options;
+   price_feed                 current_feed;
+   fc::time_point_sec         current_feed_publication_time;
+   bool                       feed_is_expired = false;
+   uint32_t                   feed_count = 0;
+   bool                       is_prediction_market = false;
+   share_type                 force_settled_volume;
+   price                      settlement_price;
+   share_type                 settlement_fund;
+};
+
+/** an asset together with the objects needed to show it, see get_asset_metadata */
+struct asset_metadata
+{
+   asset_object                           asset_obj;
+   asset_dynamic_data_object              dynamic_data;
+   optional<bitasset_feed_summary>        bitasset;
+   optional<asset_dividend_data_object>   dividend_data;
+};
+
+/** a page of search_accounts_by_name */
+struct account_name_search_result
+{
+   map<account_id_type,string>   accounts;
+   /** where the next page starts, not set when every account was looked at */
+   optional<account_id_type>     next;
+};
+
+struct database_statistics
+{
+   uint32_t                   head_block_number = 0;
+   vector<index_statistics>   indexes;
+   undo_statistics            undo;
+   /** allocations of the per-type memory pools, shared by every database in the process */
+   vector<memory_pool_statistics> pools;
+};
+
 /**
  * @brief The database_api class implements the RPC API for the chain database.
  *
@@ -118,7 +168,8 @@ struct market_trade
 class database_api
 {
    public:
-      database_api(graphene::chain::database& db);
+      /** @param market_history the plugin providing the trade history, when the node runs it */
+      database_api(graphene::chain::database& db, const market_history_plugin* market_history = nullptr);
       ~database_api();
 
       /////////////
@@ -207,12 +258,43 @@ class database_api
        */
       dynamic_global_property_object get_dynamic_global_properties()const;
 
+      /**
+       * @brief Get the object count and approximate memory usage of every index and of the undo history
+       * @param max_samples Maximum number of objects serialized per index and for the undo history to estimate
+       * their packed size, at most 10000
+       *
+       * Only a sample of each index is serialized, but the secondary indexes are walked completely to sum up their
+       * memory, which takes time in the number of objects.  This is an administrative call for diagnosing the
+       * memory of a node, it should not be polled by monitoring.
+       */
+      database_statistics get_database_statistics( uint32_t max_samples = 1000 )const;
+
+      /**
+       * @brief Get the state digest recorded after a block was applied
+       * @param block_num Height of the block, 0 for the head block
+       * @return the digest, or null if the node does not keep it for this block
+       *
+       * The digest is only maintained by nodes started with --state-digest-history.
+       */
+      optional<state_digest_record> get_state_digest( uint32_t block_num )const;
+
       //////////
       // Keys //
       //////////
 
       vector<vector<account_id_type>> get_key_references( vector<public_key_type> key )const;
 
+      /**
+       * @brief Get the accounts referring to a key, with the roles in which they do
+       * @param key The key, references to its address and PTS addresses are included
+       * @param start Return the references of the accounts from this ID on
+       * @param limit Maximum number of references to return -- must not exceed 1000
+       * @return The references in account ID order, see authority_reference_role for the roles
+       *
+       * Unlike @ref get_key_references this covers witness signing keys and does not subscribe to anything.
+       */
+      vector<authority_reference> list_key_references( public_key_type key, account_id_type start, uint32_t limit )const;
+
       //////////////
       // Accounts //
       //////////////
@@ -246,6 +328,15 @@ class database_api
        */
       vector<account_id_type> get_account_references( account_id_type account_id )const;
 
+      /**
+       * @brief Get the accounts referring to an account in their owner or active authorities, with the roles
+       * @param account_id The account referred to
+       * @param start Return the references of the accounts from this ID on
+       * @param limit Maximum number of references to return -- must not exceed 1000
+       * @return The references in account ID order
+       */
+      vector<authority_reference> list_account_references( account_id_type account_id, account_id_type start, uint32_t limit )const;
+
       /**
        * @brief Get a list of accounts by name
        * @param account_names Names of the accounts to retrieve
@@ -263,6 +354,27 @@ class database_api
        */
       map<string,account_id_type> lookup_accounts(const string& lower_bound_name, uint32_t limit)const;
 
+      /**
+       * @brief Get names and IDs of the accounts whose name starts with a prefix
+       * @param prefix Start of the names, in any case
+       * @param after_name Return the names after this one, empty to start with the first name
+       * @param limit Maximum number of results to return -- must not exceed 1000
+       * @return Map of account names to corresponding IDs, exactly limit of them unless there are no more
+       */
+      map<string,account_id_type> lookup_accounts_by_prefix(const string& prefix, const string& after_name, uint32_t limit)const;
+
+      /**
+       * @brief Get IDs and names of the accounts whose name contains a part
+       * @param part Part of the names, in any case and at least three characters long
+       * @param start Return the accounts from this ID on
+       * @param limit Maximum number of results to return -- must not exceed 1000
+       * @return Map of account IDs to names in ID order, and the ID to continue from.  A call looks at a bounded
+       * number of accounts, so a page can have fewer than limit results while next is still set.
+       *
+       * Only available on nodes started with --enable-account-name-search.
+       */
+      account_name_search_result search_accounts_by_name(const string& part, account_id_type start, uint32_t limit)const;
+
       //////////////
       // Balances //
       //////////////
@@ -281,6 +393,15 @@ class database_api
       /** @return all unclaimed balance objects for a set of addresses */
       vector<balance_object> get_balance_objects( const vector<address>& addrs )const;
 
+      /**
+       *  @brief Get the unclaimed balance objects which can be claimed with each of a set of keys
+       *  @param keys public keys of the claimants
+       *  @return for each key, the balances owned by the address of the key or by one of its PTS addresses
+       *
+       *  This saves clients from computing the address forms of the keys themselves, see balance_object::owner_addresses().
+       */
+      vector<vector<balance_object>> get_balance_objects_by_keys( const vector<public_key_type>& keys )const;
+
       vector<asset> get_vested_balances( const vector<balance_id_type>& objs )const;
 
       vector<vesting_balance_object> get_vesting_balances( account_id_type account_id )const;
@@ -290,6 +411,15 @@ class database_api
        */
       uint64_t get_account_count()const;
 
+      /**
+       * @brief Get the accounts which an account has whitelisted or blacklisted
+       * @param authorizing_account The account whose listings to return
+       * @param start Lowest ID of a listed account to return
+       * @param limit Maximum number of results to return -- must not exceed 1000
+       * @return The listings ordered by the ID of the listed account
+       */
+      vector<account_listing_object> get_account_listings( account_id_type authorizing_account, account_id_type start, uint32_t limit )const;
+
       ////////////
       // Assets //
       ////////////
@@ -320,6 +450,21 @@ class database_api
        */
       vector<optional<asset_object>> lookup_asset_symbols(const vector<string>& symbols_or_ids)const;
 
+      /**
+       * @brief Get assets with their supply, feed and dividend data in one call
+       * @param symbols_or_ids Symbols or stringified IDs of the assets to retrieve (must not exceed 100)
+       * @return The metadata of the assets, null for assets which do not exist
+       */
+      vector<optional<asset_metadata>> get_asset_metadata(const vector<string>& symbols_or_ids)const;
+
+      /**
+       * @brief Get the metadata of the assets whose symbol starts with a prefix
+       * @param symbol_prefix Start of the symbols, in any case
+       * @param limit Maximum number of assets to fetch (must not exceed 100)
+       * @return The metadata of the assets found, ordered by symbol
+       */
+      vector<asset_metadata> search_assets(const string& symbol_prefix, uint32_t limit)const;
+
       /////////////////////
       // Markets / feeds //
       /////////////////////
@@ -410,6 +555,15 @@ class database_api
        */
       vector<market_trade> get_trade_history( const string& base, const string& quote, fc::time_point_sec start, fc::time_point_sec stop, unsigned limit = 100 )const;
 
+      /**
+       * @brief Returns the tickers of every market that traded within the last 24 hours
+       * @param start_base Base asset of the first market to return, markets are ordered by base and quote id
+       * @param start_quote Quote asset of the first market to return
+       * @param limit Maximum number of markets to return, capped at 500
+       * @return The tickers, the id of the base asset is always lower than the id of the quote asset
+       */
+      vector<market_summary> get_market_summaries( asset_id_type start_base, asset_id_type start_quote, uint32_t limit )const;
+
 
 
       ///////////////
@@ -588,7 +742,14 @@ FC_REFLECT( graphene::app::order, (price)(quote)(base) );
 FC_REFLECT( graphene::app::order_book, (base)(quote)(bids)(asks) );
 FC_REFLECT( graphene::app::market_ticker, (base)(quote)(latest)(lowest_ask)(highest_bid)(percent_change)(base_volume)(quote_volume) );
 FC_REFLECT( graphene::app::market_volume, (base)(quote)(base_volume)(quote_volume) );
+FC_REFLECT_DERIVED( graphene::app::market_summary, (graphene::app::market_ticker), (base_id)(quote_id)(last_trade) );
 FC_REFLECT( graphene::app::market_trade, (date)(price)(amount)(value) );
+FC_REFLECT( graphene::app::bitasset_feed_summary,
+            (options)(current_feed)(current_feed_publication_time)(feed_is_expired)(feed_count)
+            (is_prediction_market)(force_settled_volume)(settlement_price)(settlement_fund) );
+FC_REFLECT( graphene::app::asset_metadata, (asset_obj)(dynamic_data)(bitasset)(dividend_data) );
+FC_REFLECT( graphene::app::account_name_search_result, (accounts)(next) );
+FC_REFLECT( graphene::app::database_statistics, (head_block_number)(indexes)(undo)(pools) );
 
 FC_API(graphene::app::database_api,
    // Objects
@@ -612,23 +773,31 @@ FC_API(graphene::app::database_api,
    (get_config)
    (get_chain_id)
    (get_dynamic_global_properties)
+   (get_database_statistics)
+   (get_state_digest)
 
    // Keys
    (get_key_references)
+   (list_key_references)
 
    // Accounts
    (get_accounts)
    (get_full_accounts)
    (get_account_by_name)
    (get_account_references)
+   (list_account_references)
    (lookup_account_names)
    (lookup_accounts)
+   (lookup_accounts_by_prefix)
+   (search_accounts_by_name)
    (get_account_count)
+   (get_account_listings)
 
    // Balances
    (get_account_balances)
    (get_named_account_balances)
    (get_balance_objects)
+   (get_balance_objects_by_keys)
    (get_vested_balances)
    (get_vesting_balances)
 
@@ -636,6 +805,8 @@ FC_API(graphene::app::database_api,
    (get_assets)
    (list_assets)
    (lookup_asset_symbols)
+   (get_asset_metadata)
+   (search_assets)
 
    // Markets / feeds
    (get_order_book)
@@ -648,6 +819,7 @@ FC_API(graphene::app::database_api,
    (get_ticker)
    (get_24_volume)
    (get_trade_history)
+   (get_market_summaries)
 
    // Witnesses
    (get_witnesses)
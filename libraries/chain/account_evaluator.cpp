@@ -25,6 +25,7 @@
 #include <fc/smart_ref_impl.hpp>
 
 #include <graphene/chain/account_evaluator.hpp>
+#include <graphene/chain/account_listing_object.hpp>
 #include <graphene/chain/buyback.hpp>
 #include <graphene/chain/buyback_object.hpp>
 #include <graphene/chain/database.hpp>
@@ -336,30 +337,23 @@ void_result account_whitelist_evaluator::do_apply(const account_whitelist_operat
 { try {
    database& d = db();
 
-   d.modify(*listed_account, [&o](account_object& a) {
-      if( o.new_listing & o.white_listed )
-         a.whitelisting_accounts.insert(o.authorizing_account);
-      else
-         a.whitelisting_accounts.erase(o.authorizing_account);
-
-      if( o.new_listing & o.black_listed )
-         a.blacklisting_accounts.insert(o.authorizing_account);
-      else
-         a.blacklisting_accounts.erase(o.authorizing_account);
-   });
-
-   /** for tracking purposes only, this state is not needed to evaluate */
-   d.modify( o.authorizing_account(d), [&]( account_object& a ) {
-     if( o.new_listing & o.white_listed )
-        a.whitelisted_accounts.insert( o.account_to_list );
-     else
-        a.whitelisted_accounts.erase( o.account_to_list );
-
-     if( o.new_listing & o.black_listed )
-        a.blacklisted_accounts.insert( o.account_to_list );
-     else
-        a.blacklisted_accounts.erase( o.account_to_list );
-   });
+   const auto& listings = d.get_index_type<account_listing_index>().indices().get<by_listed_account>();
+   auto itr = listings.find( boost::make_tuple( o.account_to_list, o.authorizing_account ) );
+   if( itr == listings.end() )
+   {
+      if( o.new_listing != o.no_listing )
+         d.create<account_listing_object>( [&o]( account_listing_object& l ) {
+            l.authorizing_account = o.authorizing_account;
+            l.listed_account      = o.account_to_list;
+            l.listing             = o.new_listing;
+         });
+   }
+   else if( o.new_listing == o.no_listing )
+      d.remove( *itr );
+   else if( itr->listing != o.new_listing )
+      d.modify( *itr, [&o]( account_listing_object& l ) {
+         l.listing = o.new_listing;
+      });
 
    return void_result();
 } FC_CAPTURE_AND_RETHROW( (o) ) }
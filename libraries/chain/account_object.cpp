@@ -50,6 +50,8 @@ void account_balance_object::adjust_balance(const asset& delta)
 
 void account_statistics_object::process_fees(const account_object& a, database& d) const
 {
+   // fees paid earlier in the block may not have been added yet
+   d.flush_pending_fees();
    if( pending_fees > 0 || pending_vested_fees > 0 )
    {
       auto pay_out_fees = [&](const account_object& account, share_type core_fee_total, bool require_vesting)
@@ -110,161 +112,129 @@ void account_statistics_object::pay_fee( share_type core_fee, share_type cashbac
       pending_vested_fees += core_fee;
 }
 
-set<account_id_type> account_member_index::get_account_members(const account_object& a)const
+void account_referrer_index::object_inserted( const object& obj )
 {
-   set<account_id_type> result;
-   for( auto auth : a.owner.account_auths )
-      result.insert(auth.first);
-   for( auto auth : a.active.account_auths )
-      result.insert(auth.first);
-   return result;
 }
-set<public_key_type> account_member_index::get_key_members(const account_object& a)const
+void account_referrer_index::object_removed( const object& obj )
 {
-   set<public_key_type> result;
-   for( auto auth : a.owner.key_auths )
-      result.insert(auth.first);
-   for( auto auth : a.active.key_auths )
-      result.insert(auth.first);
-   result.insert( a.options.memo_key );
-   return result;
 }
-set<address> account_member_index::get_address_members(const account_object& a)const
+void account_referrer_index::about_to_modify( const object& before )
 {
-   set<address> result;
-   for( auto auth : a.owner.address_auths )
-      result.insert(auth.first);
-   for( auto auth : a.active.address_auths )
-      result.insert(auth.first);
-   result.insert( a.options.memo_key );
-   return result;
 }
-
-void account_member_index::object_inserted(const object& obj)
+void account_referrer_index::object_modified( const object& after  )
 {
-    assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
-    const account_object& a = static_cast<const account_object&>(obj);
-
-    auto account_members = get_account_members(a);
-    for( auto item : account_members )
-       account_to_account_memberships[item].insert(obj.id);
-
-    auto key_members = get_key_members(a);
-    for( auto item : key_members )
-       account_to_key_memberships[item].insert(obj.id);
-
-    auto address_members = get_address_members(a);
-    for( auto item : address_members )
-       account_to_address_memberships[item].insert(obj.id);
 }
-
-void account_member_index::object_removed(const object& obj)
+uint64_t account_referrer_index::memory_usage()const
 {
-    assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
-    const account_object& a = static_cast<const account_object&>(obj);
-
-    auto key_members = get_key_members(a);
-    for( auto item : key_members )
-       account_to_key_memberships[item].erase( obj.id );
-
-    auto address_members = get_address_members(a);
-    for( auto item : address_members )
-       account_to_address_memberships[item].erase( obj.id );
-
-    auto account_members = get_account_members(a);
-    for( auto item : account_members )
-       account_to_account_memberships[item].erase( obj.id );
+    uint64_t result = approximate_tree_memory( referred_by );
+    for( const auto& item : referred_by )
+       result += approximate_tree_memory( item.second );
+    return result;
 }
 
-void account_member_index::about_to_modify(const object& before)
+uint32_t account_name_search_index::gram( const string& s, size_t pos )
 {
-   before_key_members.clear();
-   before_account_members.clear();
-   assert( dynamic_cast<const account_object*>(&before) ); // for debug only
-   const account_object& a = static_cast<const account_object&>(before);
-   before_key_members     = get_key_members(a);
-   before_address_members = get_address_members(a);
-   before_account_members = get_account_members(a);
+   return ( uint32_t( uint8_t( s[pos] ) ) << 16 ) | ( uint32_t( uint8_t( s[pos+1] ) ) << 8 ) | uint8_t( s[pos+2] );
 }
 
-void account_member_index::object_modified(const object& after)
+void account_name_search_index::add( const string& name, account_id_type id )
 {
-    assert( dynamic_cast<const account_object*>(&after) ); // for debug only
-    const account_object& a = static_cast<const account_object&>(after);
-
-    {
-       set<account_id_type> after_account_members = get_account_members(a);
-       vector<account_id_type> removed; removed.reserve(before_account_members.size());
-       std::set_difference(before_account_members.begin(), before_account_members.end(),
-                           after_account_members.begin(), after_account_members.end(),
-                           std::inserter(removed, removed.end()));
-
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_account_memberships[*itr].erase(after.id);
-
-       vector<object_id_type> added; added.reserve(after_account_members.size());
-       std::set_difference(after_account_members.begin(), after_account_members.end(),
-                           before_account_members.begin(), before_account_members.end(),
-                           std::inserter(added, added.end()));
-
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_account_memberships[*itr].insert(after.id);
-    }
-
-
-    {
-       set<public_key_type> after_key_members = get_key_members(a);
-
-       vector<public_key_type> removed; removed.reserve(before_key_members.size());
-       std::set_difference(before_key_members.begin(), before_key_members.end(),
-                           after_key_members.begin(), after_key_members.end(),
-                           std::inserter(removed, removed.end()));
-
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_key_memberships[*itr].erase(after.id);
-
-       vector<public_key_type> added; added.reserve(after_key_members.size());
-       std::set_difference(after_key_members.begin(), after_key_members.end(),
-                           before_key_members.begin(), before_key_members.end(),
-                           std::inserter(added, added.end()));
-
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_key_memberships[*itr].insert(after.id);
-    }
-
-    {
-       set<address> after_address_members = get_address_members(a);
-
-       vector<address> removed; removed.reserve(before_address_members.size());
-       std::set_difference(before_address_members.begin(), before_address_members.end(),
-                           after_address_members.begin(), after_address_members.end(),
-                           std::inserter(removed, removed.end()));
-
-       for( auto itr = removed.begin(); itr != removed.end(); ++itr )
-          account_to_address_memberships[*itr].erase(after.id);
+   for( size_t pos = 0; pos + gram_size <= name.size(); ++pos )
+   {
+      auto& accounts = _accounts_by_gram[ gram( name, pos ) ];
+      // accounts are created in id order, so this is an append in the common case
+      accounts.insert( accounts.end(), id );
+   }
+}
 
-       vector<address> added; added.reserve(after_address_members.size());
-       std::set_difference(after_address_members.begin(), after_address_members.end(),
-                           before_address_members.begin(), before_address_members.end(),
-                           std::inserter(added, added.end()));
+void account_name_search_index::remove( const string& name, account_id_type id )
+{
+   for( size_t pos = 0; pos + gram_size <= name.size(); ++pos )
+   {
+      auto itr = _accounts_by_gram.find( gram( name, pos ) );
+      if( itr == _accounts_by_gram.end() )
+         continue;
+      itr->second.erase( id );
+      if( itr->second.empty() )
+         _accounts_by_gram.erase( itr );
+   }
+}
 
-       for( auto itr = added.begin(); itr != added.end(); ++itr )
-          account_to_address_memberships[*itr].insert(after.id);
-    }
+void account_name_search_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) );
+   const account_object& a = static_cast<const account_object&>(obj);
+   add( a.name, a.get_id() );
+}
 
+void account_name_search_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) );
+   const account_object& a = static_cast<const account_object&>(obj);
+   remove( a.name, a.get_id() );
 }
 
-void account_referrer_index::object_inserted( const object& obj )
+void account_name_search_index::about_to_modify( const object& before )
 {
+   assert( dynamic_cast<const account_object*>(&before) );
+   _name_before = static_cast<const account_object&>(before).name;
 }
-void account_referrer_index::object_removed( const object& obj )
+
+void account_name_search_index::object_modified( const object& after )
 {
+   assert( dynamic_cast<const account_object*>(&after) );
+   const account_object& a = static_cast<const account_object&>(after);
+   if( a.name == _name_before )
+      return;
+   remove( _name_before, a.get_id() );
+   add( a.name, a.get_id() );
 }
-void account_referrer_index::about_to_modify( const object& before )
+
+uint64_t account_name_search_index::memory_usage()const
 {
+   uint64_t result = _accounts_by_gram.bucket_count() * sizeof(void*)
+                   + _accounts_by_gram.size() * ( sizeof(std::pair<uint32_t, flat_set<account_id_type>>) + sizeof(void*) );
+   for( const auto& item : _accounts_by_gram )
+      result += item.second.capacity() * sizeof(account_id_type);
+   return result;
 }
-void account_referrer_index::object_modified( const object& after  )
+
+vector<account_id_type> account_name_search_index::find_containing( const database& db, const string& part,
+                                                                   account_id_type start, uint32_t limit,
+                                                                   uint32_t max_scanned,
+                                                                   optional<account_id_type>& next )const
 {
+   FC_ASSERT( part.size() >= gram_size, "The part of the name must have at least ${n} characters", ("n", gram_size) );
+   next.reset();
+
+   vector< const flat_set<account_id_type>* > lists;
+   for( size_t pos = 0; pos + gram_size <= part.size(); ++pos )
+   {
+      auto itr = _accounts_by_gram.find( gram( part, pos ) );
+      if( itr == _accounts_by_gram.end() )
+         return {};
+      lists.push_back( &itr->second );
+   }
+   // walk the shortest list and skip the accounts missing from any other before looking at their names
+   std::sort( lists.begin(), lists.end(), []( const flat_set<account_id_type>* a, const flat_set<account_id_type>* b ) {
+      return a->size() < b->size();
+   });
+
+   vector<account_id_type> result;
+   const auto& shortest = *lists.front();
+   uint32_t scanned = 0;
+   auto itr = shortest.lower_bound( start );
+   for( ; itr != shortest.end() && result.size() < limit && scanned < max_scanned; ++itr, ++scanned )
+   {
+      bool candidate = true;
+      for( size_t i = 1; candidate && i < lists.size(); ++i )
+         candidate = lists[i]->find( *itr ) != lists[i]->end();
+      if( candidate && (*itr)(db).name.find( part ) != string::npos )
+         result.push_back( *itr );
+   }
+   if( itr != shortest.end() )
+      next = *itr;
+   return result;
 }
 
 } } // graphene::chain
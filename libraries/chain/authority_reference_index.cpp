@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/authority_reference_index.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/pts_address.hpp>
+#include <graphene/chain/witness_object.hpp>
+
+namespace graphene { namespace chain {
+
+authority_reference_index::account_members authority_reference_index::get_members( const account_object& a )
+{
+   account_members result;
+   for( const auto& auth : a.owner.key_auths )
+      result.keys[auth.first] |= owner_reference;
+   for( const auto& auth : a.active.key_auths )
+      result.keys[auth.first] |= active_reference;
+   result.keys[a.options.memo_key] |= memo_reference;
+   for( const auto& auth : a.owner.address_auths )
+      result.addresses[auth.first] |= owner_reference;
+   for( const auto& auth : a.active.address_auths )
+      result.addresses[auth.first] |= active_reference;
+   for( const auto& auth : a.owner.account_auths )
+      result.accounts[auth.first] |= owner_reference;
+   for( const auto& auth : a.active.account_auths )
+      result.accounts[auth.first] |= active_reference;
+   return result;
+}
+
+template<typename Item>
+void authority_reference_index::add( std::map< Item, references >& refs, const flat_map< Item, uint8_t >& members,
+                                     account_id_type id )
+{
+   for( const auto& member : members )
+      refs[member.first][id] |= member.second;
+}
+
+template<typename Item>
+void authority_reference_index::remove( std::map< Item, references >& refs, const flat_map< Item, uint8_t >& members,
+                                        account_id_type id )
+{
+   for( const auto& member : members )
+   {
+      auto itr = refs.find( member.first );
+      if( itr == refs.end() )
+         continue;
+      auto ref = itr->second.find( id );
+      if( ref == itr->second.end() )
+         continue;
+      // other roles of the same account, such as witness signing, stay
+      ref->second &= ~member.second;
+      if( ref->second == 0 )
+         itr->second.erase( ref );
+      if( itr->second.empty() )
+         refs.erase( itr );
+   }
+}
+
+void authority_reference_index::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(obj);
+   const account_members members = get_members( a );
+   add( _key_references, members.keys, a.get_id() );
+   add( _address_references, members.addresses, a.get_id() );
+   add( _account_references, members.accounts, a.get_id() );
+}
+
+void authority_reference_index::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(obj);
+   const account_members members = get_members( a );
+   remove( _key_references, members.keys, a.get_id() );
+   remove( _address_references, members.addresses, a.get_id() );
+   remove( _account_references, members.accounts, a.get_id() );
+}
+
+void authority_reference_index::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const account_object*>(&before) ); // for debug only
+   _before = get_members( static_cast<const account_object&>(before) );
+}
+
+void authority_reference_index::object_modified( const object& after )
+{
+   assert( dynamic_cast<const account_object*>(&after) ); // for debug only
+   const account_object& a = static_cast<const account_object&>(after);
+   const account_members members = get_members( a );
+   // most modifications of an account leave its authorities alone
+   if( members.keys != _before.keys )
+   {
+      remove( _key_references, _before.keys, a.get_id() );
+      add( _key_references, members.keys, a.get_id() );
+   }
+   if( members.addresses != _before.addresses )
+   {
+      remove( _address_references, _before.addresses, a.get_id() );
+      add( _address_references, members.addresses, a.get_id() );
+   }
+   if( members.accounts != _before.accounts )
+   {
+      remove( _account_references, _before.accounts, a.get_id() );
+      add( _account_references, members.accounts, a.get_id() );
+   }
+}
+
+uint64_t authority_reference_index::memory_usage()const
+{
+   uint64_t result = approximate_tree_memory( _key_references )
+                   + approximate_tree_memory( _address_references )
+                   + approximate_tree_memory( _account_references );
+   for( const auto& item : _key_references )
+      result += approximate_tree_memory( item.second );
+   for( const auto& item : _address_references )
+      result += approximate_tree_memory( item.second );
+   for( const auto& item : _account_references )
+      result += approximate_tree_memory( item.second );
+   return result;
+}
+
+void authority_reference_index::add_witness_key( account_id_type witness_account, const public_key_type& key )
+{
+   _key_references[key][witness_account] |= witness_signing_reference;
+}
+
+void authority_reference_index::remove_witness_key( account_id_type witness_account, const public_key_type& key )
+{
+   flat_map< public_key_type, uint8_t > members;
+   members[key] = witness_signing_reference;
+   remove( _key_references, members, witness_account );
+}
+
+vector<authority_reference> authority_reference_index::find_key_references( const public_key_type& key,
+                                                                            account_id_type start, uint32_t limit )const
+{
+   // every source gives at most limit references, the first limit of them all are the result
+   std::map< account_id_type, uint8_t > merged;
+   auto collect = [&]( const references& refs, uint8_t extra_roles ) {
+      uint32_t count = 0;
+      for( auto itr = refs.lower_bound( start ); itr != refs.end() && count < limit; ++itr, ++count )
+         merged[itr->first] |= itr->second | extra_roles;
+   };
+
+   auto key_itr = _key_references.find( key );
+   if( key_itr != _key_references.end() )
+      collect( key_itr->second, 0 );
+
+   const fc::ecc::public_key pk = key;
+   for( const address& a : { address( key ),
+                             address( pts_address( pk, false, 56 ) ),
+                             address( pts_address( pk, true, 56 ) ),
+                             address( pts_address( pk, false, 0 ) ),
+                             address( pts_address( pk, true, 0 ) ) } )
+   {
+      auto itr = _address_references.find( a );
+      if( itr != _address_references.end() )
+         collect( itr->second, address_reference );
+   }
+
+   vector<authority_reference> result;
+   for( auto itr = merged.begin(); itr != merged.end() && result.size() < limit; ++itr )
+      result.push_back( { itr->first, itr->second } );
+   return result;
+}
+
+vector<authority_reference> authority_reference_index::find_account_references( account_id_type account,
+                                                                                account_id_type start, uint32_t limit )const
+{
+   vector<authority_reference> result;
+   auto refs = _account_references.find( account );
+   if( refs == _account_references.end() )
+      return result;
+   for( auto itr = refs->second.lower_bound( start ); itr != refs->second.end() && result.size() < limit; ++itr )
+      result.push_back( { itr->first, itr->second } );
+   return result;
+}
+
+void witness_reference_observer::object_inserted( const object& obj )
+{
+   assert( dynamic_cast<const witness_object*>(&obj) ); // for debug only
+   const witness_object& w = static_cast<const witness_object&>(obj);
+   _references.add_witness_key( w.witness_account, w.signing_key );
+}
+
+void witness_reference_observer::object_removed( const object& obj )
+{
+   assert( dynamic_cast<const witness_object*>(&obj) ); // for debug only
+   const witness_object& w = static_cast<const witness_object&>(obj);
+   _references.remove_witness_key( w.witness_account, w.signing_key );
+}
+
+void witness_reference_observer::about_to_modify( const object& before )
+{
+   assert( dynamic_cast<const witness_object*>(&before) ); // for debug only
+   _key_before = static_cast<const witness_object&>(before).signing_key;
+}
+
+void witness_reference_observer::object_modified( const object& after )
+{
+   assert( dynamic_cast<const witness_object*>(&after) ); // for debug only
+   const witness_object& w = static_cast<const witness_object&>(after);
+   if( w.signing_key == _key_before )
+      return;
+   _references.remove_witness_key( w.witness_account, _key_before );
+   _references.add_witness_key( w.witness_account, w.signing_key );
+}
+
+} } // graphene::chain
@@ -31,11 +31,7 @@ void_result balance_claim_evaluator::do_evaluate(const balance_claim_operation&
    balance = &op.balance_to_claim(d);
 
    GRAPHENE_ASSERT(
-             op.balance_owner_key == balance->owner ||
-             pts_address(op.balance_owner_key, false, 56) == balance->owner ||
-             pts_address(op.balance_owner_key, true, 56) == balance->owner ||
-             pts_address(op.balance_owner_key, false, 0) == balance->owner ||
-             pts_address(op.balance_owner_key, true, 0) == balance->owner,
+             balance->is_owned_by( op.balance_owner_key ),
              balance_claim_owner_mismatch,
              "Balance owner key was specified as '${op}' but balance's actual owner is '${bal}'",
              ("op", op.balance_owner_key)
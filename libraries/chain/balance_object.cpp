@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/balance_object.hpp>
+
+namespace graphene { namespace chain {
+
+std::array<address,5> balance_object::owner_addresses( const public_key_type& key )
+{
+   const fc::ecc::public_key pk = key;
+   return {{ address( key ),
+             address( pts_address( pk, false, 56 ) ),
+             address( pts_address( pk, true, 56 ) ),
+             address( pts_address( pk, false, 0 ) ),
+             address( pts_address( pk, true, 0 ) ) }};
+}
+
+bool balance_object::is_owned_by( const public_key_type& key )const
+{
+   for( const address& a : owner_addresses( key ) )
+      if( a == owner )
+         return true;
+   return false;
+}
+
+} } // graphene::chain
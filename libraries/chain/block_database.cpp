@@ -22,41 +22,247 @@
  * THE SOFTWARE.
  */
 #include <graphene/chain/block_database.hpp>
+#include <graphene/chain/config.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/datastream.hpp>
+#include <fc/io/fstream.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <zlib.h>
 
 namespace graphene { namespace chain {
 
 struct index_entry
 {
    uint64_t      block_pos = 0;
+   /** the high bit is set for compressed entries */
    uint32_t      block_size = 0;
    block_id_type block_id;
 };
+
+/** the format of a compressed entry in the blocks file */
+struct compressed_block
+{
+   uint32_t      raw_size = 0;
+   vector<char>  data;
+};
  }}
 FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
+FC_REFLECT( graphene::chain::compressed_block, (raw_size)(data) );
 
 namespace graphene { namespace chain {
 
-void block_database::open( const fc::path& dbdir )
+namespace {
+   const uint32_t compressed_entry_flag = 0x80000000;
+   /** the size of the zlib window, longer dictionaries are not used */
+   const size_t   max_dictionary_size = 32 * 1024;
+   /** deflate can not compress better than this, see zlib's technical details */
+   const uint64_t max_compression_ratio = 1032;
+
+   uint32_t block_crc( const char* data, size_t size )
+   {
+      return crc32( crc32( 0L, Z_NULL, 0 ), (const Bytef*)data, size );
+   }
+
+   vector<char> compress( const vector<char>& in, const std::string& dictionary )
+   {
+      z_stream strm;
+      memset( &strm, 0, sizeof(strm) );
+      FC_ASSERT( deflateInit( &strm, Z_BEST_COMPRESSION ) == Z_OK );
+      if( !dictionary.empty() )
+         FC_ASSERT( deflateSetDictionary( &strm, (const Bytef*)dictionary.data(), dictionary.size() ) == Z_OK );
+
+      vector<char> out( deflateBound( &strm, in.size() ) );
+      strm.next_in   = (Bytef*)in.data();
+      strm.avail_in  = in.size();
+      strm.next_out  = (Bytef*)out.data();
+      strm.avail_out = out.size();
+      int result = deflate( &strm, Z_FINISH );
+      out.resize( strm.total_out );
+      deflateEnd( &strm );
+      FC_ASSERT( result == Z_STREAM_END, "zlib compression failed", ("result", result) );
+      return out;
+   }
+
+   vector<char> decompress( const compressed_block& in, const std::string& dictionary )
+   {
+      z_stream strm;
+      memset( &strm, 0, sizeof(strm) );
+      // a corrupt entry must not decide how much is allocated
+      FC_ASSERT( in.raw_size <= GRAPHENE_DEFAULT_MAX_BLOCK_SIZE
+                 && in.raw_size <= uint64_t( in.data.size() ) * max_compression_ratio,
+                 "The size of the compressed block is corrupt", ("raw_size", in.raw_size)("size", in.data.size()) );
+      FC_ASSERT( inflateInit( &strm ) == Z_OK );
+
+      vector<char> out( in.raw_size );
+      strm.next_in   = (Bytef*)in.data.data();
+      strm.avail_in  = in.data.size();
+      strm.next_out  = (Bytef*)out.data();
+      strm.avail_out = out.size();
+      int result = inflate( &strm, Z_FINISH );
+      if( result == Z_NEED_DICT && !dictionary.empty() )
+      {
+         result = inflateSetDictionary( &strm, (const Bytef*)dictionary.data(), dictionary.size() );
+         if( result == Z_OK )
+            result = inflate( &strm, Z_FINISH );
+      }
+      auto total_out = strm.total_out;
+      inflateEnd( &strm );
+      FC_ASSERT( result != Z_NEED_DICT, "Block was compressed with a dictionary that is not available" );
+      FC_ASSERT( result == Z_STREAM_END && total_out == in.raw_size, "zlib decompression failed", ("result", result) );
+      return out;
+   }
+
+   /**
+    *  zlib looks for matches in the dictionary like in previously seen data, preferring the end of it, so
+    *  the packed samples are concatenated oldest first and the most recent data is kept.
+    */
+   std::string build_dictionary( const std::vector< vector<char> >& samples )
+   {
+      std::string dictionary;
+      for( const auto& sample : samples )
+         dictionary.append( sample.begin(), sample.end() );
+      if( dictionary.size() > max_dictionary_size )
+         dictionary.erase( 0, dictionary.size() - max_dictionary_size );
+      return dictionary;
+   }
+
+   uint32_t read_first_block_num( const fc::path& dbdir )
+   {
+      if( !fc::exists( dbdir/"first_block" ) )
+         return 1;
+      std::string first_block;
+      fc::read_file_contents( dbdir/"first_block", first_block );
+      return std::max<uint32_t>( 1, std::stoul( first_block ) );
+   }
+
+   /** what one thread of block_database::verify() found */
+   struct verified_range
+   {
+      vector< std::pair<uint32_t,string> > damaged;
+      uint32_t                             blocks_without_checksum = 0;
+      /** the end of the last block of the range in the blocks file */
+      uint64_t                             blocks_end = 0;
+   };
+
+   /**
+    *  Decodes the entry of the blocks file which starts at data, raw or compressed.  Used to find the blocks in
+    *  a file whose index was lost, so the data may be anything.
+    */
+   optional<index_entry> decode_entry( const char* data, size_t available, uint64_t pos, bool compressed,
+                                       const std::string& dictionary, block_id_type& previous )
+   {
+      try
+      {
+         fc::datastream<const char*> ds( data, available );
+         signed_block b;
+         if( compressed )
+         {
+            compressed_block c;
+            fc::raw::unpack( ds, c );
+            b = fc::raw::unpack<signed_block>( decompress( c, dictionary ) );
+         }
+         else
+            fc::raw::unpack( ds, b );
+         const size_t size = available - ds.remaining();
+         if( size == 0 || size >= compressed_entry_flag || b.block_num() == 0 )
+            return optional<index_entry>();
+
+         index_entry e;
+         e.block_pos  = pos;
+         e.block_size = compressed ? size | compressed_entry_flag : size;
+         e.block_id   = b.id();
+         previous = b.previous;
+         return e;
+      }
+      catch( const fc::exception& )
+      {
+      }
+      catch( const std::exception& )
+      {
+      }
+      return optional<index_entry>();
+   }
+}
+
+void block_database::open( const fc::path& dbdir, bool read_only )
 { try {
-   fc::create_directories(dbdir);
+   _dbdir = dbdir;
+   _read_only = read_only;
    _block_num_to_pos.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+   _trust.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+   _checksums.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
-   if( !fc::exists( dbdir/"index" ) )
+   if( read_only )
    {
-     _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      FC_ASSERT( fc::exists( dbdir/"index" ), "There is no block log in ${d}", ("d", dbdir) );
+      _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in );
+      _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in );
+      if( fc::exists( dbdir/"trust" ) )
+         _trust.open( (dbdir/"trust").generic_string().c_str(), std::fstream::binary | std::fstream::in );
+      if( fc::exists( dbdir/"checksums" ) )
+         _checksums.open( (dbdir/"checksums").generic_string().c_str(), std::fstream::binary | std::fstream::in );
    }
    else
    {
-     _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
-     _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      fc::create_directories(dbdir);
+
+      finish_migration( dbdir );
+
+      // finish or roll back a compaction that was interrupted, see compact()
+      if( fc::exists( dbdir/"index.compacting" ) && !fc::exists( dbdir/"blocks.compacting" ) )
+         fc::rename( dbdir/"index.compacting", dbdir/"index" );
+      fc::remove_all( dbdir/"index.compacting" );
+      fc::remove_all( dbdir/"blocks.compacting" );
+
+      if( !fc::exists( dbdir/"index" ) && fc::exists( dbdir/"blocks" ) && fc::file_size( dbdir/"blocks" ) > 0 )
+      {
+         wlog( "The index of the block log in ${d} is missing, rebuilding it from the blocks file", ("d", dbdir) );
+         rebuild_index( dbdir );
+      }
+
+      if( !fc::exists( dbdir/"index" ) )
+      {
+        _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+        _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      }
+      else
+      {
+        _block_num_to_pos.open( (dbdir/"index").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+        _blocks.open( (dbdir/"blocks").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      }
+      if( !fc::exists( dbdir/"trust" ) )
+        _trust.open( (dbdir/"trust").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      else
+        _trust.open( (dbdir/"trust").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+      if( !fc::exists( dbdir/"checksums" ) )
+        _checksums.open( (dbdir/"checksums").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
+      else
+        _checksums.open( (dbdir/"checksums").generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
    }
+
+   _dictionary.clear();
+   if( fc::exists( dbdir/"blocks.dict" ) )
+      fc::read_file_contents( dbdir/"blocks.dict", _dictionary );
+
+   _first_block_num = read_first_block_num( dbdir );
 } FC_CAPTURE_AND_RETHROW( (dbdir) ) }
 
+void block_database::reopen()
+{
+   const fc::path dbdir = _dbdir;
+   close();
+   open( dbdir, _read_only );
+}
+
 bool block_database::is_open()const
 {
   return _blocks.is_open();
@@ -66,16 +272,26 @@ void block_database::close()
 {
   _blocks.close();
   _block_num_to_pos.close();
+  if( _trust.is_open() )
+     _trust.close();
+  if( _checksums.is_open() )
+     _checksums.close();
 }
 
 void block_database::flush()
 {
   _blocks.flush();
   _block_num_to_pos.flush();
+  if( _trust.is_open() )
+     _trust.flush();
+  if( _checksums.is_open() )
+     _checksums.flush();
 }
 
-void block_database::store( const block_id_type& _id, const signed_block& b )
+void block_database::store( const block_id_type& _id, const signed_block& b, const optional<fc::sha256>& results_digest )
 {
+   if( _read_only )
+      return;
    block_id_type id = _id;
    if( id == block_id_type() )
    {
@@ -90,12 +306,61 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
    e.block_pos  = _blocks.tellp();
    e.block_size = vec.size();
    e.block_id   = id;
+   if( _compress )
+   {
+      compressed_block c;
+      c.raw_size = vec.size();
+      c.data = compress( vec, _dictionary );
+      auto packed = fc::raw::pack( c );
+      if( packed.size() < vec.size() )
+      {
+         vec = std::move( packed );
+         e.block_size = vec.size() | compressed_entry_flag;
+      }
+   }
    _blocks.write( vec.data(), vec.size() );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
+
+   block_checksum c;
+   c.block_id = id;
+   c.crc      = block_crc( vec.data(), vec.size() );
+   _checksums.seekp( sizeof( block_checksum ) * num );
+   _checksums.write( (const char*)&c, sizeof(c) );
+
+   if( results_digest.valid() )
+   {
+      trust_record t;
+      t.block_id       = id;
+      t.block_crc      = c.crc;
+      t.results_digest = *results_digest;
+      _trust.seekp( sizeof( trust_record ) * num );
+      _trust.write( (const char*)&t, sizeof(t) );
+   }
 }
 
+void block_database::store_trust( uint32_t block_num, const fc::sha256& results_digest )
+{ try {
+   if( _read_only )
+      return;
+   index_entry e;
+   FC_ASSERT( read_index_entry( block_num, e ) && e.block_size != 0,
+              "Block ${n} is not contained in block database", ("n", block_num) );
+   vector<char> data( e.block_size & ~compressed_entry_flag );
+   _blocks.seekg( e.block_pos );
+   _blocks.read( data.data(), data.size() );
+
+   trust_record t;
+   t.block_id       = e.block_id;
+   t.block_crc      = block_crc( data.data(), data.size() );
+   t.results_digest = results_digest;
+   _trust.seekp( sizeof( trust_record ) * block_num );
+   _trust.write( (const char*)&t, sizeof(t) );
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
 void block_database::remove( const block_id_type& id )
 { try {
+   if( _read_only )
+      return;
    index_entry e;
    auto index_pos = sizeof(e)*block_header::num_from_id(id);
    _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
@@ -113,6 +378,88 @@ void block_database::remove( const block_id_type& id )
    }
 } FC_CAPTURE_AND_RETHROW( (id) ) }
 
+void block_database::prune( uint32_t first_block_to_keep )
+{ try {
+   if( _read_only )
+      return;
+   optional<block_id_type> last = last_id();
+   if( !last.valid() )
+      return;
+   first_block_to_keep = std::min( first_block_to_keep, block_header::num_from_id( *last ) );
+   if( first_block_to_keep <= _first_block_num )
+      return;
+
+   index_entry e;
+   for( uint32_t num = _first_block_num; num < first_block_to_keep; ++num )
+   {
+      _block_num_to_pos.seekg( sizeof(e) * num );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      if( e.block_size == 0 )
+         continue;
+      e.block_size = 0;
+      _block_num_to_pos.seekp( sizeof(e) * num );
+      _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   }
+   _block_num_to_pos.flush();
+
+   _first_block_num = first_block_to_keep;
+   {
+      std::ofstream out( (_dbdir / "first_block").generic_string(), std::ofstream::trunc );
+      out << _first_block_num;
+   }
+
+   // blocks are appended in the order they are applied, so the position of the first retained block is
+   // about the space taken by the pruned ones
+   _block_num_to_pos.seekg( sizeof(e) * _first_block_num );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   _blocks.seekg( 0, _blocks.end );
+   const uint64_t blocks_size = _blocks.tellg();
+   if( e.block_size != 0 && e.block_pos > blocks_size / 2 )
+      compact();
+} FC_CAPTURE_AND_RETHROW( (first_block_to_keep) ) }
+
+/**
+ *  The new files are written next to the old ones and renamed into place, the blocks file first.  open()
+ *  uses the files which are left over to tell how far an interrupted compaction got.
+ */
+void block_database::compact()
+{ try {
+   ilog( "Compacting block log, blocks below ${n} were pruned", ("n", _first_block_num) );
+   const fc::path blocks_tmp = _dbdir / "blocks.compacting";
+   const fc::path index_tmp  = _dbdir / "index.compacting";
+   {
+      std::ofstream blocks_out( blocks_tmp.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      std::ofstream index_out( index_tmp.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      blocks_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      index_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      const uint64_t count = uint64_t( _block_num_to_pos.tellg() ) / sizeof(index_entry);
+      vector<char> data;
+      for( uint64_t num = 0; num < count; ++num )
+      {
+         index_entry e;
+         _block_num_to_pos.seekg( num * sizeof(e) );
+         _block_num_to_pos.read( (char*)&e, sizeof(e) );
+         if( e.block_size != 0 )
+         {
+            data.resize( e.block_size & ~compressed_entry_flag );
+            _blocks.seekg( e.block_pos );
+            _blocks.read( data.data(), data.size() );
+            e.block_pos = blocks_out.tellp();
+            blocks_out.write( data.data(), data.size() );
+         }
+         index_out.write( (const char*)&e, sizeof(e) );
+      }
+   }
+
+   const fc::path dbdir = _dbdir;
+   close();
+   fc::rename( blocks_tmp, dbdir / "blocks" );
+   fc::rename( index_tmp, dbdir / "index" );
+   open( dbdir );
+} FC_CAPTURE_AND_RETHROW() }
+
 bool block_database::contains( const block_id_type& id )const
 {
    if( id == block_id_type() )
@@ -160,11 +507,7 @@ optional<signed_block> block_database::fetch_optional( const block_id_type& id )
 
       if( e.block_id != id ) return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      if (e.block_size)
-         _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
+      auto result = fc::raw::unpack<signed_block>( read_block( e ) );
       FC_ASSERT( result.id() == e.block_id );
       return result;
    }
@@ -190,10 +533,7 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
       _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
       _block_num_to_pos.read( (char*)&e, sizeof(e) );
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
+      auto result = fc::raw::unpack<signed_block>( read_block( e ) );
       FC_ASSERT( result.id() == e.block_id );
       return result;
    }
@@ -206,6 +546,45 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
+/**
+ *  The crc is taken over the bytes as they are stored, so a compressed block is not decompressed to check it.
+ */
+optional<signed_block> block_database::fetch_for_replay( uint32_t block_num, optional<trust_record>& trust )const
+{
+   trust.reset();
+   try
+   {
+      index_entry e;
+      if( !read_index_entry( block_num, e ) || e.block_size == 0 )
+         return {};
+
+      vector<char> data( e.block_size & ~compressed_entry_flag );
+      _blocks.seekg( e.block_pos );
+      _blocks.read( data.data(), data.size() );
+
+      optional<trust_record> t = read_trust_record( block_num );
+      const bool trusted = t.valid() && t->block_id == e.block_id
+                           && t->block_crc == block_crc( data.data(), data.size() );
+      if( e.block_size & compressed_entry_flag )
+         data = decompress( fc::raw::unpack<compressed_block>( data ), _dictionary );
+
+      auto result = fc::raw::unpack<signed_block>( data );
+      if( trusted )
+         trust = t;
+      else
+         FC_ASSERT( result.id() == e.block_id );
+      return result;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   trust.reset();
+   return optional<signed_block>();
+}
+
 optional<signed_block> block_database::last()const
 {
    try
@@ -229,10 +608,7 @@ optional<signed_block> block_database::last()const
       if( e.block_size == 0 )
          return optional<signed_block>();
 
-      vector<char> data( e.block_size );
-      _blocks.seekg( e.block_pos );
-      _blocks.read( data.data(), e.block_size );
-      auto result = fc::raw::unpack<signed_block>(data);
+      auto result = fc::raw::unpack<signed_block>( read_block( e ) );
       return result;
    }
    catch (const fc::exception&)
@@ -279,4 +655,468 @@ optional<block_id_type> block_database::last_id()const
 }
 
 
+bool block_database::read_index_entry( uint32_t block_num, index_entry& e )const
+{
+   auto index_pos = sizeof(e)*block_num;
+   _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+   if ( _block_num_to_pos.tellg() <= int64_t(index_pos) )
+      return false;
+   _block_num_to_pos.seekg( index_pos );
+   _block_num_to_pos.read( (char*)&e, sizeof(e) );
+   return true;
+}
+
+optional<trust_record> block_database::read_trust_record( uint32_t block_num )const
+{
+   if( !_trust.is_open() )
+      return optional<trust_record>();
+   trust_record t;
+   auto trust_pos = sizeof(t)*block_num;
+   _trust.seekg( 0, _trust.end );
+   if( _trust.tellg() < int64_t(trust_pos + sizeof(t)) )
+      return optional<trust_record>();
+   _trust.seekg( trust_pos );
+   _trust.read( (char*)&t, sizeof(t) );
+   if( t.block_id == block_id_type() )
+      return optional<trust_record>();
+   return t;
+}
+
+optional<block_checksum> block_database::read_checksum( uint32_t block_num )const
+{
+   if( !_checksums.is_open() )
+      return optional<block_checksum>();
+   block_checksum c;
+   auto checksum_pos = sizeof(c)*block_num;
+   _checksums.seekg( 0, _checksums.end );
+   if( _checksums.tellg() < int64_t(checksum_pos + sizeof(c)) )
+      return optional<block_checksum>();
+   _checksums.seekg( checksum_pos );
+   _checksums.read( (char*)&c, sizeof(c) );
+   if( c.block_id == block_id_type() )
+      return optional<block_checksum>();
+   return c;
+}
+
+vector<char> block_database::read_block( const index_entry& e )const
+{
+   vector<char> data( e.block_size & ~compressed_entry_flag );
+   _blocks.seekg( e.block_pos );
+   if( data.size() )
+      _blocks.read( data.data(), data.size() );
+   if( e.block_size & compressed_entry_flag )
+      return decompress( fc::raw::unpack<compressed_block>( data ), _dictionary );
+   return data;
+}
+
+void block_database::migrate( const fc::path& dbdir, bool compress )
+{ try {
+   ilog( "Migrating block log in ${d} to ${f} storage", ("d", dbdir)("f", compress ? "compressed" : "raw") );
+   block_database source;
+   source.open( dbdir );
+   optional<block_id_type> last_id = source.last_id();
+   if( !last_id.valid() )
+   {
+      source.close();
+      return;
+   }
+   const uint32_t last_num = block_header::num_from_id( *last_id );
+
+   std::string dictionary = source._dictionary;
+   if( compress && dictionary.empty() )
+   {
+      std::vector< vector<char> > samples;
+      for( uint32_t num = last_num > 1000 ? last_num - 1000 : 1; num <= last_num; ++num )
+      {
+         auto b = source.fetch_by_number( num );
+         if( b.valid() )
+            samples.push_back( fc::raw::pack( *b ) );
+      }
+      dictionary = build_dictionary( samples );
+   }
+
+   const fc::path tmp_dir( dbdir.generic_string() + ".migrating" );
+   fc::remove_all( tmp_dir );
+   block_database target;
+   target.open( tmp_dir );
+   target._dictionary = compress ? dictionary : std::string();
+   target.set_compression( compress );
+   for( uint32_t num = 1; num <= last_num; ++num )
+   {
+      if( num % 10000 == 0 )
+         ilog( "Migrated ${n} of ${l} blocks", ("n", num)("l", last_num) );
+      auto b = source.fetch_by_number( num );
+      if( b.valid() )
+         target.store( b->id(), *b );
+      else if( num < source._first_block_num )
+      {
+         // keep the ids of pruned blocks
+         index_entry e;
+         source._block_num_to_pos.seekg( sizeof(e) * num );
+         source._block_num_to_pos.read( (char*)&e, sizeof(e) );
+         e.block_pos  = 0;
+         e.block_size = 0;
+         target._block_num_to_pos.seekp( sizeof(e) * num );
+         target._block_num_to_pos.write( (char*)&e, sizeof(e) );
+      }
+   }
+   source.close();
+   target.close();
+
+   if( compress && !dictionary.empty() )
+   {
+      std::ofstream out( (tmp_dir / "blocks.dict").generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      out.write( dictionary.data(), dictionary.size() );
+   }
+   {
+      // from here on the migration is rolled forward by open() if it is interrupted
+      const std::string format = compress ? "compressed" : "raw";
+      std::ofstream out( (tmp_dir / "complete").generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      out.write( format.data(), format.size() );
+   }
+   finish_migration( dbdir );
+   ilog( "Done migrating block log" );
+} FC_CAPTURE_AND_RETHROW( (dbdir)(compress) ) }
+
+/**
+ *  migrate() writes the new log to a directory next to dbdir and marks it complete once everything, including
+ *  the dictionary, is written.  Every step of moving the files into place can be repeated, so a complete
+ *  migration is rolled forward after a crash, and the old log is kept if the migration was not complete.
+ */
+void block_database::finish_migration( const fc::path& dbdir )
+{ try {
+   const fc::path tmp_dir( dbdir.generic_string() + ".migrating" );
+   if( !fc::exists( tmp_dir ) )
+      return;
+   if( !fc::exists( tmp_dir / "complete" ) )
+   {
+      wlog( "Dropping the incomplete migration of the block log in ${d}", ("d", dbdir) );
+      fc::remove_all( tmp_dir );
+      return;
+   }
+
+   std::string format;
+   fc::read_file_contents( tmp_dir / "complete", format );
+   // the dictionary goes first, the compressed blocks can not be read without it
+   if( fc::exists( tmp_dir / "blocks.dict" ) )
+      fc::rename( tmp_dir / "blocks.dict", dbdir / "blocks.dict" );
+   else if( format == "raw" )
+      fc::remove_all( dbdir / "blocks.dict" );
+   for( const char* name : { "blocks", "index", "checksums" } )
+      if( fc::exists( tmp_dir / name ) )
+         fc::rename( tmp_dir / name, dbdir / name );
+   // the crcs of the trust records are taken over the stored bytes, the records are rebuilt by the next replay
+   fc::remove_all( dbdir / "trust" );
+   fc::remove_all( tmp_dir );
+} FC_CAPTURE_AND_RETHROW( (dbdir) ) }
+
+string block_database::check_block( uint32_t block_num, uint64_t blocks_size, uint64_t& block_end,
+                                    bool& has_checksum )const
+{
+   has_checksum = false;
+   try
+   {
+      index_entry e;
+      if( !read_index_entry( block_num, e ) )
+         return "there is no index entry";
+      if( e.block_id == block_id_type() || block_header::num_from_id( e.block_id ) != block_num )
+         return "the index entry holds no id of a block of this number";
+      if( e.block_size == 0 )
+         return "the block was removed";
+      const uint64_t size = e.block_size & ~compressed_entry_flag;
+      if( e.block_pos + size > blocks_size )
+         return "the index entry points past the end of the blocks file";
+      block_end = e.block_pos + size;
+
+      vector<char> data( size );
+      _blocks.seekg( e.block_pos );
+      _blocks.read( data.data(), data.size() );
+      optional<block_checksum> c = read_checksum( block_num );
+      if( c.valid() && c->block_id == e.block_id )
+      {
+         has_checksum = true;
+         if( c->crc != block_crc( data.data(), data.size() ) )
+            return "the checksum does not match";
+      }
+
+      if( e.block_size & compressed_entry_flag )
+         data = decompress( fc::raw::unpack<compressed_block>( data ), _dictionary );
+      const signed_block b = fc::raw::unpack<signed_block>( data );
+      if( b.id() != e.block_id )
+         return "the block does not match the id in the index";
+      index_entry previous;
+      if( block_num > 1 && read_index_entry( block_num - 1, previous ) && previous.block_id != b.previous )
+         return "the block does not link to the previous block";
+   }
+   catch( const fc::exception& e )
+   {
+      return "the block can not be decoded: " + e.to_string();
+   }
+   catch( const std::exception& e )
+   {
+      return string( "the block can not be read: " ) + e.what();
+   }
+   return string();
+}
+
+block_log_verification block_database::verify( const fc::path& dbdir, uint32_t threads )
+{ try {
+   block_log_verification result;
+   uint64_t blocks_size = 0;
+   {
+      block_database log;
+      log.open( dbdir, true );
+      result.first_block_num = log.first_block_num();
+      optional<block_id_type> last = log.last_id();
+      if( last.valid() )
+         result.last_block_num = block_header::num_from_id( *last );
+      log._blocks.seekg( 0, log._blocks.end );
+      blocks_size = log._blocks.tellg();
+      log.close();
+   }
+   if( result.last_block_num < result.first_block_num )
+   {
+      result.unindexed_bytes = blocks_size;
+      return result;
+   }
+
+   const uint32_t count = result.last_block_num - result.first_block_num + 1;
+   if( threads == 0 )
+      threads = std::max<uint32_t>( 1, std::thread::hardware_concurrency() );
+   const uint32_t blocks_per_thread = ( count + std::min( threads, count ) - 1 ) / std::min( threads, count );
+
+   // every thread reads through a log of its own
+   vector< std::unique_ptr<fc::thread> > workers;
+   vector< fc::future<verified_range> > ranges;
+   for( uint64_t first = result.first_block_num; first <= result.last_block_num; first += blocks_per_thread )
+   {
+      const uint32_t last = std::min<uint64_t>( first + blocks_per_thread - 1, result.last_block_num );
+      workers.emplace_back( new fc::thread( "verify_block_log" ) );
+      ranges.push_back( workers.back()->async( [dbdir,first,last,blocks_size]() -> verified_range {
+         verified_range range;
+         block_database log;
+         log.open( dbdir, true );
+         for( uint32_t num = first; num <= last; ++num )
+         {
+            uint64_t block_end = 0;
+            bool has_checksum = false;
+            string reason = log.check_block( num, blocks_size, block_end, has_checksum );
+            if( !reason.empty() )
+               range.damaged.emplace_back( num, reason );
+            else if( !has_checksum )
+               ++range.blocks_without_checksum;
+            range.blocks_end = std::max( range.blocks_end, block_end );
+         }
+         log.close();
+         return range;
+      }, "verify_block_log" ) );
+   }
+
+   uint64_t blocks_end = 0;
+   for( auto& future : ranges )
+   {
+      const verified_range range = future.wait();
+      result.blocks_without_checksum += range.blocks_without_checksum;
+      blocks_end = std::max( blocks_end, range.blocks_end );
+      for( const auto& item : range.damaged )
+      {
+         if( !result.damaged.empty() && result.damaged.back().last_block_num + 1 == item.first )
+         {
+            result.damaged.back().last_block_num = item.first;
+            continue;
+         }
+         block_log_damage damage;
+         damage.first_block_num = item.first;
+         damage.last_block_num  = item.first;
+         damage.reason          = item.second;
+         result.damaged.push_back( damage );
+      }
+   }
+   result.checked_blocks = count;
+   result.unindexed_bytes = blocks_size > blocks_end ? blocks_size - blocks_end : 0;
+   return result;
+} FC_CAPTURE_AND_RETHROW( (dbdir)(threads) ) }
+
+/**
+ *  The entries of the blocks file are not delimited, so the file is decoded from the start.  Where an entry can
+ *  not be decoded the scan moves on byte by byte until it finds the next one.  A block replaces the one already
+ *  found for its number if its checksum record names it, or if it links to the block found for the number
+ *  before, which keeps random data that happens to decode from replacing a block.
+ */
+uint32_t block_database::rebuild_index( const fc::path& dbdir )
+{ try {
+   ilog( "Rebuilding the index of the block log in ${d}", ("d", dbdir) );
+   std::string dictionary;
+   if( fc::exists( dbdir/"blocks.dict" ) )
+      fc::read_file_contents( dbdir/"blocks.dict", dictionary );
+   const uint32_t first_block_num = read_first_block_num( dbdir );
+
+   // the ids of pruned blocks are only in the old index
+   vector<index_entry>   entries( first_block_num );
+   vector<block_id_type> previous( first_block_num );
+   {
+      std::ifstream old_index( (dbdir/"index").generic_string(), std::ifstream::binary );
+      for( uint32_t num = 1; num < first_block_num && old_index; ++num )
+      {
+         old_index.seekg( uint64_t(num) * sizeof(index_entry) );
+         if( !old_index.read( (char*)&entries[num], sizeof(index_entry) ) )
+            entries[num] = index_entry();
+      }
+   }
+
+   std::ifstream checksums( (dbdir/"checksums").generic_string(), std::ifstream::binary );
+   auto read_checksum = [&checksums]( uint32_t num ) -> optional<block_checksum> {
+      block_checksum c;
+      checksums.clear();
+      checksums.seekg( uint64_t(num) * sizeof(c) );
+      if( checksums.read( (char*)&c, sizeof(c) ) && c.block_id != block_id_type() )
+         return c;
+      return optional<block_checksum>();
+   };
+
+   std::ifstream blocks( (dbdir/"blocks").generic_string(), std::ifstream::binary );
+   FC_ASSERT( blocks, "There is no blocks file in ${d}", ("d", dbdir) );
+   const uint64_t blocks_size = fc::file_size( dbdir/"blocks" );
+   // a block is much smaller than half the window
+   const uint64_t window = 64 * 1024 * 1024;
+   vector<char> buffer;
+   uint64_t buffer_pos = 0;
+   uint64_t pos = 0;
+   uint64_t skipped = 0;
+   while( pos < blocks_size )
+   {
+      if( pos + window / 2 > buffer_pos + buffer.size() && buffer_pos + buffer.size() < blocks_size )
+      {
+         buffer_pos = pos;
+         buffer.resize( std::min( window, blocks_size - pos ) );
+         blocks.seekg( pos );
+         blocks.read( buffer.data(), buffer.size() );
+      }
+      const char*  data      = buffer.data() + ( pos - buffer_pos );
+      const size_t available = buffer.size() - ( pos - buffer_pos );
+
+      // raw data passes as compressed only if it is a valid zlib stream, the other way round is more likely
+      block_id_type previous_id;
+      optional<index_entry> e = decode_entry( data, available, pos, true, dictionary, previous_id );
+      if( !e.valid() )
+         e = decode_entry( data, available, pos, false, dictionary, previous_id );
+      if( !e.valid() )
+      {
+         ++pos;
+         ++skipped;
+         continue;
+      }
+      const uint32_t size = e->block_size & ~compressed_entry_flag;
+      pos += size;
+
+      // blocks are stored in the order they are applied, a block is never stored before its previous one
+      const uint32_t num = block_header::num_from_id( e->block_id );
+      if( num < first_block_num || num > entries.size() )
+         continue;
+      optional<block_checksum> c = read_checksum( num );
+      if( c.valid() && c->block_id == e->block_id && c->crc != block_crc( data, size ) )
+      {
+         wlog( "Skipping damaged block ${n} at ${p} in the blocks file", ("n", num)("p", e->block_pos) );
+         continue;
+      }
+      if( num == entries.size() )
+      {
+         entries.push_back( *e );
+         previous.push_back( previous_id );
+      }
+      else if( ( c.valid() && c->block_id == e->block_id ) || previous_id == entries[num - 1].block_id )
+      {
+         entries[num]  = *e;
+         previous[num] = previous_id;
+      }
+   }
+   if( skipped > 0 )
+      wlog( "Skipped ${n} bytes of the blocks file which do not hold a block", ("n", skipped) );
+
+   uint32_t last = first_block_num - 1;
+   for( uint32_t num = first_block_num; num < entries.size(); ++num )
+   {
+      // the previous block of the first retained block is only known if the old index could be read
+      const bool check_link = num > 1 && !( num == first_block_num && entries[num - 1].block_id == block_id_type() );
+      if( check_link && previous[num] != entries[num - 1].block_id )
+         break;
+      last = num;
+   }
+
+   const fc::path index_tmp = dbdir / "index.rebuilding";
+   {
+      std::ofstream index_out( index_tmp.generic_string(), std::ofstream::binary | std::ofstream::trunc );
+      index_out.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+      for( uint32_t num = 0; num <= last; ++num )
+         index_out.write( (const char*)&entries[num], sizeof(index_entry) );
+   }
+   fc::remove_all( dbdir / "index" );
+   fc::rename( index_tmp, dbdir / "index" );
+   ilog( "Rebuilt the index of the block log up to block ${n}", ("n", last) );
+   return last;
+} FC_CAPTURE_AND_RETHROW( (dbdir) ) }
+
+void block_database::truncate( const fc::path& dbdir, uint32_t last_block_num )
+{ try {
+   // blocks of abandoned forks may lie between the retained ones, the file is cut after the last one referenced
+   uint64_t blocks_end = 0;
+   {
+      block_database log;
+      log.open( dbdir, true );
+      index_entry e;
+      for( uint32_t num = log.first_block_num(); num <= last_block_num && log.read_index_entry( num, e ); ++num )
+         if( e.block_size != 0 )
+            blocks_end = std::max( blocks_end, e.block_pos + ( e.block_size & ~compressed_entry_flag ) );
+      log.close();
+   }
+   wlog( "Truncating the block log in ${d} after block ${n}", ("d", dbdir)("n", last_block_num) );
+   const uint64_t index_size = sizeof(index_entry) * ( uint64_t(last_block_num) + 1 );
+   if( fc::file_size( dbdir/"index" ) > index_size )
+      fc::resize_file( dbdir/"index", index_size );
+   if( fc::file_size( dbdir/"blocks" ) > blocks_end )
+      fc::resize_file( dbdir/"blocks", blocks_end );
+} FC_CAPTURE_AND_RETHROW( (dbdir)(last_block_num) ) }
+
+uint32_t block_database::repair( const fc::path& dbdir, uint32_t threads )
+{ try {
+   if( !fc::exists( dbdir / "index" ) )
+      rebuild_index( dbdir );
+   const block_log_verification verification = verify( dbdir, threads );
+   if( verification.damaged.empty() && verification.unindexed_bytes == 0 )
+   {
+      ilog( "The block log in ${d} is intact up to block ${n}", ("d", dbdir)("n", verification.last_block_num) );
+      return verification.last_block_num;
+   }
+   for( const auto& damage : verification.damaged )
+      wlog( "Blocks ${f} to ${l} of the block log are damaged: ${r}",
+            ("f", damage.first_block_num)("l", damage.last_block_num)("r", damage.reason) );
+   uint32_t last_good = verification.damaged.empty() ? verification.last_block_num
+                                                      : verification.damaged.front().first_block_num - 1;
+
+   // only the index may be damaged, or it may have lost its end while the blocks made it to disk
+   const fc::path index_backup = dbdir / "index.damaged";
+   fc::remove_all( index_backup );
+   fc::copy( dbdir / "index", index_backup );
+   rebuild_index( dbdir );
+   const block_log_verification rebuilt = verify( dbdir, threads );
+   const uint32_t rebuilt_good = rebuilt.damaged.empty() ? rebuilt.last_block_num
+                                                         : rebuilt.damaged.front().first_block_num - 1;
+   if( rebuilt_good > last_good )
+   {
+      ilog( "Rebuilding the index recovered blocks ${f} to ${l}", ("f", last_good + 1)("l", rebuilt_good) );
+      last_good = rebuilt_good;
+      fc::remove_all( index_backup );
+   }
+   else
+   {
+      fc::remove_all( dbdir / "index" );
+      fc::rename( index_backup, dbdir / "index" );
+   }
+
+   truncate( dbdir, last_good );
+   return last_good;
+} FC_CAPTURE_AND_RETHROW( (dbdir)(threads) ) }
+
 } }
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_event_pipeline.hpp>
+
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace chain {
+
+block_event_consumer::block_event_consumer( const string& name, uint32_t capacity, bool with_objects,
+                                            handler_type handler )
+   : _name( name ),
+     _capacity( capacity ),
+     _with_objects( with_objects ),
+     _handler( std::move(handler) ),
+     _thread( name ),
+     _handled( 0 ),
+     _failed( 0 )
+{
+   FC_ASSERT( _capacity > 0, "A block event consumer needs room for at least one event" );
+   FC_ASSERT( _handler, "A block event consumer needs a handler" );
+}
+
+block_event_consumer::~block_event_consumer()
+{
+   try
+   {
+      flush();
+      _thread.quit();
+   }
+   catch( const fc::exception& e )
+   {
+      elog( "Failed to stop the block event consumer ${n}: ${e}", ("n", _name)("e", e.to_detail_string()) );
+   }
+}
+
+void block_event_consumer::push( const std::shared_ptr<const applied_block_event>& event )
+{
+   pop_handled();
+   _queue.push_back( _thread.async( [this,event]() {
+      fc::scoped_lock<fc::mutex> lock( _handler_mutex );
+      handle( *event );
+   }, "block_event_consumer::handle" ) );
+}
+
+void block_event_consumer::handle( const applied_block_event& event )
+{
+   // a failing plugin must not stop the ones behind it, nor the chain
+   try
+   {
+      _handler( event );
+   }
+   catch( const fc::exception& e )
+   {
+      ++_failed;
+      elog( "${n} failed to handle block ${b}: ${e}",
+            ("n", _name)("b", event.block_num)("e", e.to_detail_string()) );
+   }
+   catch( const std::exception& e )
+   {
+      ++_failed;
+      elog( "${n} failed to handle block ${b}: ${e}", ("n", _name)("b", event.block_num)("e", e.what()) );
+   }
+   ++_handled;
+}
+
+void block_event_consumer::pop_handled()
+{
+   while( !_queue.empty() && _queue.front().ready() )
+      _queue.pop_front();
+}
+
+void block_event_consumer::wait_for_capacity()
+{
+   pop_handled();
+   if( _queue.size() < _capacity )
+      return;
+   ++_stalls;
+   while( _queue.size() >= _capacity )
+   {
+      _queue.front().wait();
+      _queue.pop_front();
+   }
+}
+
+void block_event_consumer::flush()
+{
+   while( !_queue.empty() )
+   {
+      _queue.front().wait();
+      _queue.pop_front();
+   }
+}
+
+block_event_consumer_statistics block_event_consumer::get_statistics()const
+{
+   block_event_consumer_statistics result;
+   result.name     = _name;
+   result.capacity = _capacity;
+   result.queued   = std::count_if( _queue.begin(), _queue.end(),
+                                    []( const fc::future<void>& f ) { return !f.ready(); } );
+   result.handled  = _handled;
+   result.failed   = _failed;
+   result.stalls   = _stalls;
+   return result;
+}
+
+block_event_pipeline::~block_event_pipeline()
+{
+   flush();
+}
+
+std::shared_ptr<block_event_consumer> block_event_pipeline::subscribe( const string& name, uint32_t capacity,
+                                                                       bool with_objects,
+                                                                       block_event_consumer::handler_type handler )
+{
+   auto consumer = std::make_shared<block_event_consumer>( name, capacity, with_objects, std::move(handler) );
+   _consumers.push_back( consumer );
+   return consumer;
+}
+
+void block_event_pipeline::unsubscribe( const std::shared_ptr<block_event_consumer>& consumer )
+{
+   auto itr = std::find( _consumers.begin(), _consumers.end(), consumer );
+   if( itr == _consumers.end() )
+      return;
+   _consumers.erase( itr );
+   consumer->flush();
+}
+
+bool block_event_pipeline::wants_objects()const
+{
+   return std::any_of( _consumers.begin(), _consumers.end(),
+                       []( const std::shared_ptr<block_event_consumer>& c ) { return c->with_objects(); } );
+}
+
+void block_event_pipeline::publish( const std::shared_ptr<const applied_block_event>& event )
+{
+   for( const auto& consumer : _consumers )
+      consumer->push( event );
+}
+
+void block_event_pipeline::wait_for_consumers()
+{
+   for( const auto& consumer : _consumers )
+      consumer->wait_for_capacity();
+}
+
+void block_event_pipeline::flush()
+{
+   for( const auto& consumer : _consumers )
+      consumer->flush();
+}
+
+vector<block_event_consumer_statistics> block_event_pipeline::get_statistics()const
+{
+   vector<block_event_consumer_statistics> result;
+   result.reserve( _consumers.size() );
+   for( const auto& consumer : _consumers )
+      result.push_back( consumer->get_statistics() );
+   return result;
+}
+
+} } // graphene::chain
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/chain/block_trace.hpp>
+
+#include <map>
+
+namespace graphene { namespace chain {
+
+block_trace make_block_trace( const state_digest_record& record, const vector<operation_history_object>& operations )
+{
+   block_trace result;
+   result.block_num       = record.block_num;
+   result.block_id        = record.block_id;
+   result.digest          = record.digest;
+   result.changed_objects = record.changed_objects;
+   result.operations      = operations;
+   return result;
+}
+
+optional<block_trace_difference> find_first_difference( const vector<block_trace>& a, const vector<block_trace>& b )
+{
+   std::map<uint32_t, const block_trace*> blocks_b;
+   for( const auto& item : b )
+      blocks_b[item.block_num] = &item;
+
+   for( const auto& block_a : a )
+   {
+      auto itr = blocks_b.find( block_a.block_num );
+      if( itr == blocks_b.end() )
+         continue;
+      const block_trace& block_b = *itr->second;
+
+      block_trace_difference result;
+      result.block_num = block_a.block_num;
+
+      std::map< object_id_type, std::pair<optional<fc::uint128>,optional<fc::uint128>> > changed;
+      for( const auto& item : block_a.changed_objects )
+         changed[item.first].first = item.second;
+      for( const auto& item : block_b.changed_objects )
+         changed[item.first].second = item.second;
+      for( const auto& item : changed )
+         if( item.second.first != item.second.second )
+            result.objects.push_back( item.first );
+
+      uint32_t op = 0;
+      while( op < block_a.operations.size() && op < block_b.operations.size()
+             && fc::raw::pack( block_a.operations[op] ) == fc::raw::pack( block_b.operations[op] ) )
+         ++op;
+      if( op < block_a.operations.size() || op < block_b.operations.size() )
+         result.operation = op;
+
+      if( result.objects.empty() && !result.operation.valid() && block_a.digest == block_b.digest
+          && block_a.block_id == block_b.block_id )
+         continue;
+      return result;
+   }
+   return optional<block_trace_difference>();
+}
+
+} } // graphene::chain
@@ -26,6 +26,7 @@
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/fba_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 
@@ -186,4 +187,53 @@ void database::deposit_witness_pay(const witness_object& wit, share_type amount)
    return;
 }
 
+void database::pay_fee( const account_statistics_object& stats, share_type core_fee )
+{
+   const share_type threshold = get_global_properties().parameters.cashback_vesting_threshold;
+   if( !_buffer_fees )
+   {
+      modify( stats, [&]( account_statistics_object& s ) {
+         s.pay_fee( core_fee, threshold );
+      });
+      return;
+   }
+   // same split as account_statistics_object::pay_fee(), the threshold can only change at maintenance
+   fee_delta& delta = _fee_deltas[stats.id];
+   if( core_fee > threshold )
+      delta.pending_fees += core_fee;
+   else
+      delta.pending_vested_fees += core_fee;
+}
+
+void database::pay_fba_fee( const fba_accumulator_object& fba, share_type core_fee )
+{
+   if( !_buffer_fees )
+   {
+      modify( fba, [&]( fba_accumulator_object& _fba ) {
+         _fba.accumulated_fba_fees += core_fee;
+      });
+      return;
+   }
+   _fba_fee_deltas[fba.id] += core_fee;
+}
+
+void database::flush_pending_fees()
+{
+   for( const auto& item : _fee_deltas )
+   {
+      modify( item.first(*this), [&]( account_statistics_object& s ) {
+         s.pending_fees += item.second.pending_fees;
+         s.pending_vested_fees += item.second.pending_vested_fees;
+      });
+   }
+   _fee_deltas.clear();
+   for( const auto& item : _fba_fee_deltas )
+   {
+      modify( item.first(*this), [&]( fba_accumulator_object& _fba ) {
+         _fba.accumulated_fba_fees += item.second;
+      });
+   }
+   _fba_fee_deltas.clear();
+}
+
 } }
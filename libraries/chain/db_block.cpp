@@ -120,16 +120,33 @@ bool database::push_block(const signed_block& new_block, uint32_t skip)
       [&]()
       {
          result = _push_block(new_block);
+         // read-only databases in other processes follow the block log
+         if( _flush_block_log )
+            _block_id_to_block.flush();
+         if( _block_log_retention > 0 )
+            prune_block_log();
       });
    });
+   // the block is in, waiting for plugins which fell behind cannot expose a partially applied state any more
+   _block_events.wait_for_consumers();
    return result;
 }
 
 bool database::_push_block(const signed_block& new_block)
+{ try {
+   FC_ASSERT( !_replay_required, "The object graph is inconsistent, restart the node to replay the blockchain" );
+   if( _push_checkpointed_block( new_block ) )
+      return false;
+   return _push_reversible_block( new_block );
+} FC_CAPTURE_AND_RETHROW( (new_block) ) }
+
+bool database::_push_reversible_block(const signed_block& new_block)
 { try {
    uint32_t skip = get_node_properties().skip_flags;
    if( !(skip&skip_fork_db) )
    {
+      start_fork_db_at_head();
+
       /// TODO: if the block is greater than the head block and before the next maitenance interval
       // verify that the block signer is in the current set of active witnesses.
 
@@ -156,7 +173,7 @@ bool database::_push_block(const signed_block& new_block)
                 try {
                    undo_database::session session = _undo_db.start_undo_session();
                    apply_block( (*ritr)->data, skip );
-                   _block_id_to_block.store( (*ritr)->id, (*ritr)->data );
+                   _block_id_to_block.store( (*ritr)->id, (*ritr)->data, _applied_results_digest );
                    session.commit();
                 }
                 catch ( const fc::exception& e ) { except = e; }
@@ -180,7 +197,7 @@ bool database::_push_block(const signed_block& new_block)
                    {
                       auto session = _undo_db.start_undo_session();
                       apply_block( (*ritr)->data, skip );
-                      _block_id_to_block.store( new_block.id(), (*ritr)->data );
+                      _block_id_to_block.store( (*ritr)->id, (*ritr)->data, _applied_results_digest );
                       session.commit();
                    }
                    throw *except;
@@ -195,7 +212,7 @@ bool database::_push_block(const signed_block& new_block)
    try {
       auto session = _undo_db.start_undo_session();
       apply_block(new_block, skip);
-      _block_id_to_block.store(new_block.id(), new_block);
+      _block_id_to_block.store(new_block.id(), new_block, _applied_results_digest);
       session.commit();
    } catch ( const fc::exception& e ) {
       elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
@@ -206,6 +223,122 @@ bool database::_push_block(const signed_block& new_block)
    return false;
 } FC_CAPTURE_AND_RETHROW( (new_block) ) }
 
+/** blocks applied by _push_irreversible_block() leave the fork database empty */
+void database::start_fork_db_at_head()
+{
+   if( !_fork_db.head() && head_block_num() > 0 )
+   {
+      optional<signed_block> head_block = _block_id_to_block.fetch_optional( head_block_id() );
+      if( head_block.valid() )
+         _fork_db.start_block( *head_block );
+   }
+}
+
+/**
+ * Blocks at or below the last checkpoint which extend the head block are buffered instead of being applied.  The
+ * checkpoint block commits to all of its predecessors through the previous ids, so once it arrives and matches
+ * the checkpoint the buffered blocks are known to be irreversible and are applied by _push_irreversible_block().
+ * Blocks too far below the next checkpoint, and blocks which do not extend the buffer, take the regular path, the
+ * buffered blocks are moved into the fork database then.
+ *
+ * @return true if the block was buffered or applied here
+ */
+bool database::_push_checkpointed_block( const signed_block& new_block )
+{
+   if( !_checkpointed_blocks.empty() && new_block.previous != _checkpointed_blocks.back().id() )
+   {
+      const block_id_type new_id = new_block.id();
+      for( const signed_block& b : _checkpointed_blocks )
+         if( b.id() == new_id )
+            return true;
+
+      // the buffered blocks are not known to be irreversible any more, they compete like any other fork and are
+      // validated if the fork database switches to them
+      if( !(get_node_properties().skip_flags & skip_fork_db) )
+      {
+         start_fork_db_at_head();
+         for( const signed_block& b : _checkpointed_blocks )
+            _fork_db.push_block( b );
+      }
+      else
+      {
+         // without a fork database the buffered chain is the only one, a block after a failing one cannot apply
+         vector<signed_block> blocks;
+         std::swap( blocks, _checkpointed_blocks );
+         for( size_t i = 0; i < blocks.size(); ++i )
+         {
+            try {
+               _push_reversible_block( blocks[i] );
+            } FC_CAPTURE_AND_RETHROW( (blocks[i].block_num())("dropped", blocks.size() - i - 1) )
+         }
+      }
+      _checkpointed_blocks.clear();
+   }
+
+   const uint32_t block_num = new_block.block_num();
+   if( !is_known_irreversible_block( block_num ) )
+      return false;
+   if( _checkpointed_blocks.empty() && new_block.previous != head_block_id() )
+      return false;
+   auto checkpoint = _checkpoints.lower_bound( block_num );
+   if( checkpoint->first - block_num >= GRAPHENE_MAX_UNDO_HISTORY )
+      return false;
+
+   // the block id covers the merkle root but not the transactions, which apply_block() does not check here
+   FC_ASSERT( new_block.calculate_merkle_root() == new_block.transaction_merkle_root,
+              "Block transactions do not match the merkle root", ("block_num", block_num) );
+   if( checkpoint->first == block_num && checkpoint->second != new_block.id() )
+   {
+      _checkpointed_blocks.clear();
+      FC_THROW( "Block did not match checkpoint", ("checkpoint",*checkpoint)("block_id",new_block.id()) );
+   }
+
+   _checkpointed_blocks.push_back( new_block );
+   if( checkpoint->first == block_num )
+   {
+      vector<signed_block> blocks;
+      std::swap( blocks, _checkpointed_blocks );
+      for( const signed_block& b : blocks )
+         _push_irreversible_block( b );
+   }
+   return true;
+}
+
+/**
+ * Applies a block which is known to be irreversible directly on top of the head block.  Such a block can never
+ * be popped, so neither undo state nor a fork database entry is kept for it.  Any remaining undo history is
+ * discarded as well, because it describes states below a block that can no longer be undone.
+ *
+ * Nothing can unwind a block which fails half way, so no more blocks are accepted after a failure and the
+ * application replays the blockchain on the next start, see replay_required().
+ */
+void database::_push_irreversible_block( const signed_block& new_block )
+{ try {
+   uint32_t skip = get_node_properties().skip_flags;
+   bool undo_enabled = _undo_db.enabled();
+
+   _fork_db.reset();
+   _undo_db.discard_history();
+   _undo_db.disable();
+   try
+   {
+      apply_block( new_block, skip );
+   }
+   catch( const fc::exception& e )
+   {
+      if( undo_enabled )
+         _undo_db.enable();
+      _replay_required = true;
+      elog( "Failed to apply irreversible block without undo history, the blockchain has to be replayed:\n${e}",
+            ("e", e.to_detail_string()) );
+      throw;
+   }
+   if( undo_enabled )
+      _undo_db.enable();
+
+   _block_id_to_block.store( new_block.id(), new_block, _applied_results_digest );
+} FC_CAPTURE_AND_RETHROW( (new_block.block_num()) ) }
+
 /**
  * Attempts to push the transaction into the pending queue
  *
@@ -265,6 +398,9 @@ processed_transaction database::push_proposal(const proposal_object& proposal)
    processed_transaction ptrx(proposal.proposed_transaction);
    eval_state._trx = &ptrx;
    size_t old_applied_ops_size = _applied_ops.size();
+   // the fees paid by a failing proposal are undone together with the rest of it
+   const auto old_fee_deltas = _fee_deltas;
+   const auto old_fba_fee_deltas = _fba_fee_deltas;
 
    try {
       auto session = _undo_db.start_undo_session(true);
@@ -273,6 +409,8 @@ processed_transaction database::push_proposal(const proposal_object& proposal)
       remove(proposal);
       session.merge();
    } catch ( const fc::exception& e ) {
+      _fee_deltas = old_fee_deltas;
+      _fba_fee_deltas = old_fba_fee_deltas;
       if( head_block_time() <= HARDFORK_483_TIME )
       {
          for( size_t i=old_applied_ops_size,n=_applied_ops.size(); i<n; i++ )
@@ -331,6 +469,8 @@ signed_block database::_generate_block(
    size_t total_block_size = max_block_header_size;
 
    signed_block pending_block;
+   block_generation_timings timings;
+   fc::time_point step_start = fc::time_point::now();
 
    //
    // The following code throws away existing pending_tx_session and
@@ -384,6 +524,9 @@ signed_block database::_generate_block(
    }
 
    _pending_tx_session.reset();
+   timings.transactions = pending_block.transactions.size();
+   timings.postponed_transactions = postponed_tx_count;
+   timings.reapply_pending = fc::time_point::now() - step_start;
 
    // We have temporarily broken the invariant that
    // _pending_tx_session is the result of applying _pending_tx, as
@@ -393,9 +536,13 @@ signed_block database::_generate_block(
 
    pending_block.previous = head_block_id();
    pending_block.timestamp = when;
+   step_start = fc::time_point::now();
    pending_block.transaction_merkle_root = pending_block.calculate_merkle_root();
+   timings.merkle = fc::time_point::now() - step_start;
    pending_block.witness = witness_id;
 
+   step_start = fc::time_point::now();
+
    // Genesis witnesses start with a default initial secret        
    if( witness_obj.next_secret_hash == secret_hash_type::hash( secret_hash_type() ) )     
        pending_block.previous_secret = secret_hash_type();       
@@ -414,6 +561,7 @@ signed_block database::_generate_block(
 
    if( !(skip & skip_witness_signature) )
       pending_block.sign( block_signing_private_key );
+   timings.sign = fc::time_point::now() - step_start;
 
    // TODO:  Move this to _push_block() so session is restored.
    if( !(skip & skip_block_size_check) )
@@ -421,7 +569,10 @@ signed_block database::_generate_block(
       FC_ASSERT( fc::raw::pack_size(pending_block) <= get_global_properties().parameters.maximum_block_size );
    }
 
+   step_start = fc::time_point::now();
    push_block( pending_block, skip );
+   timings.push = fc::time_point::now() - step_start;
+   _last_generation_timings = timings;
 
    return pending_block;
 } FC_CAPTURE_AND_RETHROW( (witness_id) ) }
@@ -437,6 +588,9 @@ void database::pop_block()
    optional<signed_block> head_block = fetch_block_by_id( head_id );
    GRAPHENE_ASSERT( head_block.valid(), pop_empty_chain, "there are no blocks to pop" );
 
+   // the buffered blocks extend the popped block
+   _checkpointed_blocks.clear();
+
    _fork_db.pop_block();
    _block_id_to_block.remove( head_id );
    pop_undo();
@@ -505,6 +659,8 @@ void database::_apply_block( const signed_block& next_block )
    uint32_t next_block_num = next_block.block_num();
    uint32_t skip = get_node_properties().skip_flags;
    _applied_ops.clear();
+   _applied_results_digest.reset();
+   _current_block_id = _trusted_block_id.valid() ? *_trusted_block_id : next_block.id();
 
    FC_ASSERT( (skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root(), "", ("next_block.transaction_merkle_root",next_block.transaction_merkle_root)("calc",next_block.calculate_merkle_root())("next_block",next_block)("id",next_block.id()) );
 
@@ -516,17 +672,35 @@ void database::_apply_block( const signed_block& next_block )
    _current_block_num    = next_block_num;
    _current_trx_in_block = 0;
 
-   for( const auto& trx : next_block.transactions )
+   // forget the objects touched by pending transactions and popped blocks
+   if( _state_digest_history > 0 )
+      clear_touched_objects();
+
+   // the fees of the transactions are summed per account and added once, see pay_fee()
+   _buffer_fees = true;
+   try
    {
-      /* We do not need to push the undo state for each transaction
-       * because they either all apply and are valid or the
-       * entire block fails to apply.  We only need an "undo" state
-       * for transactions when validating broadcast transactions or
-       * when building a block.
-       */
-      apply_transaction( trx, skip );
-      ++_current_trx_in_block;
+      for( const auto& trx : next_block.transactions )
+      {
+         /* We do not need to push the undo state for each transaction
+          * because they either all apply and are valid or the
+          * entire block fails to apply.  We only need an "undo" state
+          * for transactions when validating broadcast transactions or
+          * when building a block.
+          */
+         apply_transaction( trx, skip );
+         ++_current_trx_in_block;
+      }
+   }
+   catch( ... )
+   {
+      _buffer_fees = false;
+      _fee_deltas.clear();
+      _fba_fee_deltas.clear();
+      throw;
    }
+   _buffer_fees = false;
+   flush_pending_fees();
 
    if (global_props.parameters.witness_schedule_algorithm == GRAPHENE_WITNESS_SCHEDULED_ALGORITHM)
        update_witness_schedule(next_block);
@@ -557,10 +731,19 @@ void database::_apply_block( const signed_block& next_block )
    if( !_node_property_object.debug_updates.empty() )
       apply_debug_updates();
 
+   // only a block that was checked completely may be trusted by a later replay
+   if( _trusted_block_id.valid() || !(skip & skip_merkle_check) )
+      _applied_results_digest = digest_applied_operations();
+
    // notify observers that the block has been applied
    applied_block( next_block ); //emit
+   if( !_block_events.empty() )
+      publish_block_event( next_block );
    _applied_ops.clear();
 
+   if( _state_digest_history > 0 )
+      record_state_digest( next_block );
+
    notify_changed_objects();
 
 } FC_CAPTURE_AND_RETHROW( (next_block.block_num()) )  }
@@ -584,6 +767,29 @@ void database::notify_changed_objects()
    }
 } FC_CAPTURE_AND_RETHROW() }
 
+void database::publish_block_event( const signed_block& b )
+{ try {
+   auto event = std::make_shared<applied_block_event>();
+   event->block = b;
+   event->block_id = _current_block_id;
+   event->block_num = _current_block_num;
+   event->last_irreversible_block_num = get_dynamic_global_properties().last_irreversible_block_num;
+   event->operations = _applied_ops;
+   if( _undo_db.enabled() && _block_events.wants_objects() )
+   {
+      const auto& head_undo = _undo_db.head();
+      event->changed_objects.reserve( head_undo.old_values.size() + head_undo.new_ids.size() );
+      for( const auto& item : head_undo.old_values )
+         event->changed_objects.emplace_back( get_object( item.first ).clone() );
+      for( const auto& id : head_undo.new_ids )
+         event->changed_objects.emplace_back( get_object( id ).clone() );
+      event->removed_objects.reserve( head_undo.removed.size() );
+      for( const auto& item : head_undo.removed )
+         event->removed_objects.emplace_back( item.second->clone() );
+   }
+   _block_events.publish( event );
+} FC_CAPTURE_AND_RETHROW( (b.block_num()) ) }
+
 processed_transaction database::apply_transaction(const signed_transaction& trx, uint32_t skip)
 {
    processed_transaction result;
@@ -598,14 +804,19 @@ processed_transaction database::_apply_transaction(const signed_transaction& trx
 { try {
    uint32_t skip = get_node_properties().skip_flags;
 
-   if( true || !(skip&skip_validate) )   /* issue #505 explains why this skip_flag is disabled */
+   /* issue #505 explains why skip_validate alone does not skip this, a block replayed from a matching trust
+    * record was validated when this node first applied it */
+   if( !(skip&skip_validate) || !_trusted_block_id.valid() )
       trx.validate();
 
    auto& trx_idx = get_mutable_index_type<transaction_index>();
    const chain_id_type& chain_id = get_chain_id();
-   auto trx_id = trx.id();
-   FC_ASSERT( (skip & skip_transaction_dupe_check) ||
-              trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end() );
+   transaction_id_type trx_id;
+   if( !(skip & skip_transaction_dupe_check) )
+   {
+      trx_id = trx.id();
+      FC_ASSERT( trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end() );
+   }
    transaction_evaluation_state eval_state(this);
    const chain_parameters& chain_parameters = get_global_properties().parameters;
    eval_state._trx = &trx;
@@ -712,7 +923,7 @@ void database::create_block_summary(const signed_block& next_block)
 {
    block_summary_id_type sid(next_block.block_num() & 0xffff );
    modify( sid(*this), [&](block_summary_object& p) {
-         p.block_id = next_block.id();
+         p.block_id = _current_block_id;
    });
 }
 
@@ -727,4 +938,73 @@ bool database::before_last_checkpoint()const
    return (_checkpoints.size() > 0) && (_checkpoints.rbegin()->first >= head_block_num());
 }
 
+bool database::is_known_irreversible_block( uint32_t block_num )const
+{
+   return _checkpoints.size() && _checkpoints.rbegin()->second != block_id_type()
+          && _checkpoints.rbegin()->first >= block_num;
+}
+
+void database::set_state_digest_history( uint32_t blocks )
+{
+   if( blocks > 0 && !state_digest_enabled() )
+      enable_state_digest( true );
+   else if( blocks == 0 && state_digest_enabled() )
+      enable_state_digest( false );
+   _state_digest_history = blocks;
+   while( _state_digests.size() > _state_digest_history )
+      _state_digests.pop_front();
+}
+
+optional<state_digest_record> database::get_block_state_digest( uint32_t block_num )const
+{
+   if( _state_digests.empty() || block_num < _state_digests.front().block_num || block_num > _state_digests.back().block_num )
+      return optional<state_digest_record>();
+   const auto& record = _state_digests[ block_num - _state_digests.front().block_num ];
+   assert( record.block_num == block_num );
+   return record;
+}
+
+void database::record_state_digest( const signed_block& b )
+{
+   // drop the records of blocks which were popped, or which are not contiguous with this one
+   while( !_state_digests.empty() && _state_digests.back().block_num >= b.block_num() )
+      _state_digests.pop_back();
+   if( !_state_digests.empty() && _state_digests.back().block_num + 1 != b.block_num() )
+      _state_digests.clear();
+
+   state_digest_record record;
+   record.block_num = b.block_num();
+   record.block_id  = _current_block_id;
+   record.digest    = get_state_digest();
+   record.indexes   = get_index_digests();
+   record.changed_objects.reserve( touched_objects().size() );
+   for( const auto& id : touched_objects() )
+   {
+      const object* obj = find_object( id );
+      record.changed_objects.emplace_back( id, obj ? obj->hash() : fc::uint128() );
+   }
+   std::sort( record.changed_objects.begin(), record.changed_objects.end(),
+              []( const std::pair<object_id_type, fc::uint128>& a, const std::pair<object_id_type, fc::uint128>& b ) {
+                 return a.first < b.first;
+              });
+   clear_touched_objects();
+
+   _state_digests.emplace_back( std::move(record) );
+   while( _state_digests.size() > _state_digest_history )
+      _state_digests.pop_front();
+}
+
+fc::sha256 database::digest_applied_operations()const
+{
+   fc::sha256::encoder enc;
+   for( const auto& op : _applied_ops )
+   {
+      if( !op.valid() )
+         continue;
+      fc::raw::pack( enc, op->op );
+      fc::raw::pack( enc, op->result );
+   }
+   return enc.result();
+}
+
 } }
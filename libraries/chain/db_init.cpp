@@ -25,6 +25,8 @@
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/fba_accumulator_id.hpp>
 
+#include <graphene/chain/account_listing_object.hpp>
+#include <graphene/chain/authority_reference_index.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/balance_object.hpp>
@@ -188,15 +190,18 @@ void database::initialize_indexes()
    _undo_db.set_max_size( GRAPHENE_MIN_UNDO_HISTORY );
 
    //Protocol object indexes
-   add_index< primary_index<asset_index> >();
+   auto asset_idx = add_index< primary_index<asset_index> >();
+   asset_idx->add_secondary_index<authorized_asset_observer>( _authorized_asset_cache );
    add_index< primary_index<force_settlement_index> >();
 
    auto acnt_index = add_index< primary_index<account_index> >();
-   acnt_index->add_secondary_index<account_member_index>();
+   auto references = acnt_index->add_secondary_index<authority_reference_index>();
    acnt_index->add_secondary_index<account_referrer_index>();
+   acnt_index->add_secondary_index<authorized_asset_observer>( _authorized_asset_cache );
 
    add_index< primary_index<committee_member_index> >();
-   add_index< primary_index<witness_index> >();
+   auto wit_index = add_index< primary_index<witness_index> >();
+   wit_index->add_secondary_index<witness_reference_observer>( *references );
    add_index< primary_index<limit_order_index > >();
    add_index< primary_index<call_order_index > >();
 
@@ -234,6 +239,17 @@ void database::initialize_indexes()
    add_index< primary_index< simple_index< fba_accumulator_object       > > >();
    add_index< primary_index<pending_dividend_payout_balance_for_holder_object_index > >();
    add_index< primary_index<total_distributed_dividend_balance_object_index > >();
+   auto listing_idx = add_index< primary_index<account_listing_index      > >();
+   listing_idx->add_secondary_index<authorized_asset_observer>( _authorized_asset_cache );
+}
+
+void database::enable_account_name_search()
+{
+   auto& accounts = dynamic_cast<primary_index<account_index>&>( get_mutable_index<account_object>() );
+   if( accounts.find_secondary_index<account_name_search_index>() != nullptr )
+      return;
+   auto names = accounts.add_secondary_index<account_name_search_index>();
+   accounts.inspect_all_objects( [names]( const object& obj ) { names->object_inserted( obj ); } );
 }
 
 void database::init_genesis(const genesis_state_type& genesis_state)
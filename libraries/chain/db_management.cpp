@@ -23,18 +23,30 @@
  */
 
 #include <graphene/chain/database.hpp>
+#include <graphene/chain/db_with.hpp>
 
 #include <graphene/chain/operation_history_object.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
 #include <fc/io/fstream.hpp>
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
 #include <iostream>
 
 namespace graphene { namespace chain {
 
+namespace {
+   /** blocks in our own block log were validated when they were pushed */
+   const uint32_t replay_skip_flags = database::skip_witness_signature |
+                                      database::skip_transaction_signatures |
+                                      database::skip_transaction_dupe_check |
+                                      database::skip_tapos_check |
+                                      database::skip_witness_schedule_check |
+                                      database::skip_authority_check;
+}
+
 database::database() :
    _random_number_generator(fc::ripemd160().data())
 {
@@ -49,6 +61,20 @@ database::~database()
 
 void database::reindex(fc::path data_dir, const genesis_state_type& initial_allocation)
 { try {
+   {
+      // a pruned block log cannot be replayed from genesis, open() replays it on top of the last state snapshot
+      block_database blocks;
+      blocks.open( data_dir / "database" / "block_num_to_block" );
+      const bool pruned = blocks.first_block_num() > 1;
+      blocks.close();
+      if( pruned )
+      {
+         ilog( "The block log is pruned, replaying it on top of the last state snapshot" );
+         open( data_dir, [&initial_allocation]{return initial_allocation;} );
+         return;
+      }
+   }
+
    ilog( "reindexing blockchain" );
    wipe(data_dir, false);
    open(data_dir, [&initial_allocation]{return initial_allocation;});
@@ -65,46 +91,109 @@ void database::reindex(fc::path data_dir, const genesis_state_type& initial_allo
 
    ilog( "Replaying blocks..." );
    _undo_db.disable();
+   if( !replay_block_log( last_block_num, true ) )
+   {
+      // the state may already be off when the mismatch is noticed, start over without trusting anything
+      wlog( "The block log does not match its trust records or was repaired, replaying it again with full validation" );
+      clear_objects();
+      _undo_db.enable();
+      wipe( data_dir, false );
+      open( data_dir, [&initial_allocation]{return initial_allocation;} );
+      _undo_db.disable();
+      last_block = _block_id_to_block.last();
+      if( last_block.valid() )
+         FC_ASSERT( replay_block_log( last_block->block_num(), false ),
+                    "The block log was damaged again while replaying it" );
+   }
+   _undo_db.enable();
+   auto end = fc::time_point::now();
+   ilog( "Done reindexing, elapsed time: ${t} sec, ${m} bytes of free pool memory released",
+         ("t",double((end-start).count())/1000000.0)("m", graphene::db::release_memory_pools()) );
+} FC_CAPTURE_AND_RETHROW( (data_dir) ) }
+
+/**
+ * A block with a matching trust record was validated by this node when it was first applied, so it is replayed
+ * without validating its transactions and merkle root again.  Every other block is validated as usual and gets a
+ * trust record for the next replay.
+ */
+bool database::replay_block_log( uint32_t last_block_num, bool use_trust_records )
+{
+   optional<trust_record> trust;
    for( uint32_t i = 1; i <= last_block_num; ++i )
    {
       if( i % 2000 == 0 ) std::cerr << "   " << double(i*100)/last_block_num << "%   "<<i << " of " <<last_block_num<<"   \n";
-      fc::optional< signed_block > block = _block_id_to_block.fetch_by_number(i);
+      fc::optional< signed_block > block = _block_id_to_block.fetch_for_replay( i, trust );
       if( !block.valid() )
       {
-         wlog( "Reindexing terminated due to gap:  Block ${i} does not exist!", ("i", i) );
-         uint32_t dropped_count = 0;
-         while( true )
+         // the index may be damaged while the block is intact, otherwise the log is cut before the damage
+         wlog( "Block ${i} is missing from the block log or damaged, repairing the block log", ("i", i) );
+         const fc::path blocks_dir = _block_id_to_block.get_data_dir();
+         _block_id_to_block.close();
+         const uint32_t last_kept = block_database::repair( blocks_dir );
+         _block_id_to_block.open( blocks_dir );
+         if( last_kept + 1 < i )
          {
-            fc::optional< block_id_type > last_id = _block_id_to_block.last_id();
-            // this can trigger if we attempt to e.g. read a file that has block #2 but no block #1
-            if( !last_id.valid() )
-               break;
-            // we've caught up to the gap
-            if( block_header::num_from_id( *last_id ) <= i )
-               break;
-            _block_id_to_block.remove( *last_id );
-            dropped_count++;
+            // blocks which were applied are gone from the log, the state has to be rebuilt from what is left
+            wlog( "The block log was cut after block ${n} although the blocks up to ${i} were replayed",
+                  ("n", last_kept)("i", i - 1) );
+            return false;
          }
-         wlog( "Dropped ${n} blocks from after the gap", ("n", dropped_count) );
-         break;
+         if( last_kept >= i )
+            block = _block_id_to_block.fetch_for_replay( i, trust );
+         if( !block.valid() )
+         {
+            wlog( "Reindexing stopped after block ${n}, the following blocks are fetched from the network again",
+                  ("n", i - 1) );
+            break;
+         }
+      }
+      if( use_trust_records && trust.valid() )
+      {
+         if( !apply_trusted_block( *block, *trust ) )
+            return false;
+      }
+      else
+      {
+         apply_block( *block, replay_skip_flags );
+         if( _applied_results_digest.valid() )
+            _block_id_to_block.store_trust( i, *_applied_results_digest );
       }
-      apply_block(*block, skip_witness_signature |
-                          skip_transaction_signatures |
-                          skip_transaction_dupe_check |
-                          skip_tapos_check |
-                          skip_witness_schedule_check |
-                          skip_authority_check);
+      _block_events.wait_for_consumers();
    }
-   _undo_db.enable();
-   auto end = fc::time_point::now();
-   ilog( "Done reindexing, elapsed time: ${t} sec", ("t",double((end-start).count())/1000000.0 ) );
-} FC_CAPTURE_AND_RETHROW( (data_dir) ) }
+   return true;
+}
+
+bool database::apply_trusted_block( const signed_block& b, const trust_record& trust )
+{
+   _trusted_block_id = trust.block_id;
+   try
+   {
+      apply_block( b, replay_skip_flags | skip_validate | skip_merkle_check );
+   }
+   catch( const fc::exception& e )
+   {
+      _trusted_block_id.reset();
+      wlog( "Failed to replay trusted block ${n}: ${e}", ("n", b.block_num())("e", e.to_detail_string()) );
+      return false;
+   }
+   _trusted_block_id.reset();
+   if( !_applied_results_digest.valid() || *_applied_results_digest != trust.results_digest )
+   {
+      wlog( "Block ${n} gave other results than when it was validated", ("n", b.block_num()) );
+      return false;
+   }
+   return true;
+}
 
 void database::wipe(const fc::path& data_dir, bool include_blocks)
 {
+   FC_ASSERT( !_read_only, "A read-only database can not be wiped" );
    ilog("Wiping database", ("include_blocks", include_blocks));
    close();
    object_database::wipe(data_dir);
+   fc::remove_all( data_dir / "object_database.snapshot" );
+   fc::remove_all( data_dir / "object_database.new" );
+   fc::remove_all( data_dir / "object_database.old" );
    if( include_blocks )
       fc::remove_all( data_dir / "database" );
 }
@@ -115,6 +204,15 @@ void database::open(
 {
    try
    {
+      // finish swapping in a state snapshot that was complete when the node stopped, see save_state_snapshot()
+      if( fc::exists( data_dir / "object_database.new" ) )
+      {
+         fc::remove_all( data_dir / "object_database" );
+         fc::rename( data_dir / "object_database.new", data_dir / "object_database" );
+      }
+      fc::remove_all( data_dir / "object_database.snapshot" );
+      fc::remove_all( data_dir / "object_database.old" );
+
       object_database::open(data_dir);
 
       _block_id_to_block.open(data_dir / "database" / "block_num_to_block");
@@ -125,24 +223,164 @@ void database::open(
       fc::optional<signed_block> last_block = _block_id_to_block.last();
       if( last_block.valid() )
       {
-         _fork_db.start_block( *last_block );
          idump((last_block->id())(last_block->block_num()));
          idump((head_block_id())(head_block_num()));
+         _last_snapshot_block = head_block_num();
+         if( last_block->id() != head_block_id() && _block_id_to_block.first_block_num() > 1 )
+            replay_pruned_block_log( *last_block );
          if( last_block->id() != head_block_id() )
          {
               FC_ASSERT( head_block_num() == 0, "last block ID does not match current chain state",
                          ("last_block->id", last_block->id())("head_block_num",head_block_num()) );
          }
+         open_undo_history( *last_block );
       }
    }
    FC_CAPTURE_LOG_AND_RETHROW( (data_dir) )
 }
 
+void database::open_read_only( const fc::path& data_dir, std::function<genesis_state_type()> genesis_loader,
+                               bool load_state )
+{
+   try
+   {
+      _read_only = true;
+      _block_log_retention = 0;
+      _read_only_dir = data_dir;
+      _read_only_load_state = load_state;
+      _genesis_loader = genesis_loader;
+      if( load_state )
+         object_database::open( data_dir );
+      _block_id_to_block.open( data_dir / "database" / "block_num_to_block", true );
+
+      if( !find(global_property_id_type()) )
+         init_genesis(genesis_loader());
+
+      // the undo history of the saved object graph is not needed, the fork database starts at its head block
+      FC_ASSERT( is_head_in_block_log(), "The saved object graph is not on the chain in the block log",
+                 ("head_block_num", head_block_num())("head_block_id", head_block_id()) );
+      uint32_t applied = sync_from_block_log();
+      ilog( "Opened read-only database at block ${n}, ${a} blocks applied from the block log",
+            ("n", head_block_num())("a", applied) );
+   }
+   FC_CAPTURE_LOG_AND_RETHROW( (data_dir)(load_state) )
+}
+
+bool database::is_head_in_block_log()const
+{
+   if( head_block_num() == 0 )
+      return true;
+   optional<block_id_type> last_id = _block_id_to_block.last_id();
+   return last_id.valid() && block_header::num_from_id( *last_id ) >= head_block_num()
+          && _block_id_to_block.fetch_block_id( head_block_num() ) == head_block_id();
+}
+
+/**
+ * Starts the state of a read-only database over when the other process left the chain below the blocks it can
+ * pop.  The object graph the other process saved is used if it is still on the chain, otherwise the state starts
+ * from genesis, and sync_from_block_log() applies the block log from there.
+ */
+void database::reload_read_only_state()
+{ try {
+   wlog( "The followed node left the chain below block ${n}, reloading the state", ("n", head_block_num()) );
+   clear_pending();
+   _fork_db.reset();
+   _checkpointed_blocks.clear();
+   _undo_db.discard_history();
+   _undo_db.disable();
+   clear_objects();
+   if( _read_only_load_state )
+   {
+      try
+      {
+         object_database::open( _read_only_dir );
+      }
+      catch( const fc::exception& e )
+      {
+         wlog( "Unable to load the saved state: ${e}", ("e", e.to_detail_string()) );
+         clear_objects();
+      }
+      if( find( global_property_id_type() ) && !is_head_in_block_log() )
+         clear_objects();
+   }
+   _undo_db.enable();
+   if( !find( global_property_id_type() ) )
+      init_genesis( _genesis_loader() );
+   ilog( "Reloaded the state at block ${n}", ("n", head_block_num()) );
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * Blocks which are further behind the end of the log than the other process could ever undo are applied without
+ * undo history.  A block that is not completely written yet fails to load and is picked up by the next call.
+ */
+uint32_t database::sync_from_block_log()
+{ try {
+   FC_ASSERT( _read_only, "Only a read-only database follows the block log of another process" );
+   uint32_t applied = 0;
+   optional<block_id_type> last_id = _block_id_to_block.last_id();
+   if( last_id.valid() )
+   {
+      const uint32_t last_num = block_header::num_from_id( *last_id );
+
+      // the other process switched forks or popped blocks, go back to a block which is still in the log
+      while( !is_head_in_block_log() )
+      {
+         // the saved state and blocks applied without undo history can not be popped
+         if( _undo_db.size() == 0 || !fetch_block_by_id( head_block_id() ).valid() )
+         {
+            reload_read_only_state();
+            break;
+         }
+         pop_block();
+      }
+
+      for( uint32_t num = head_block_num() + 1; num <= last_num; ++num )
+      {
+         optional<signed_block> block = _block_id_to_block.fetch_by_number( num );
+         if( !block.valid() )
+            break;
+         if( num + GRAPHENE_MAX_UNDO_HISTORY <= last_num && block->previous == head_block_id() )
+            detail::with_skip_flags( *this, replay_skip_flags, [&]()
+            {
+               _push_irreversible_block( *block );
+            });
+         else
+            push_block( *block, replay_skip_flags );
+         ++applied;
+      }
+   }
+   // clears the state of a failed read and picks up a log which the other process compacted
+   if( applied == 0 )
+      _block_id_to_block.reopen();
+   return applied;
+} FC_CAPTURE_AND_RETHROW() }
+
 void database::close(bool rewind)
 {
    // TODO:  Save pending tx's on close()
    clear_pending();
 
+   // the object graph and the block log belong to another process
+   if( _read_only )
+   {
+      object_database::close();
+      if( _block_id_to_block.is_open() )
+         _block_id_to_block.close();
+      _fork_db.reset();
+      return;
+   }
+
+   // the object graph on disk is older than the block log then, the application replays the blockchain
+   if( _replay_required )
+   {
+      wlog( "Not saving the object graph, it is inconsistent after a failed block" );
+      object_database::close();
+      if( _block_id_to_block.is_open() )
+         _block_id_to_block.close();
+      _fork_db.reset();
+      return;
+   }
+
    // pop all of the blocks that we can given our undo history, this should
    // throw when there is no more undo history to pop
    if( rewind )
@@ -176,7 +414,14 @@ void database::close(bool rewind)
    // DB state (issue #336).
    clear_pending();
 
-   object_database::flush();
+   // the object graph is the only way back from a pruned block log, so it is never overwritten in place
+   if( _block_log_retention > 0 || ( _block_id_to_block.is_open() && _block_id_to_block.first_block_num() > 1 ) )
+      _save_state_snapshot();
+   else
+   {
+      save_undo_history( get_data_dir() / "object_database" );
+      object_database::flush();
+   }
    object_database::close();
 
    if( _block_id_to_block.is_open() )
@@ -185,4 +430,217 @@ void database::close(bool rewind)
    _fork_db.reset();
 }
 
+/**
+ * The undo history is written next to the object graph, tagged with the head block it applies to, so that
+ * it is discarded together with the object graph by wipe() and ignored if it no longer matches on open().
+ */
+void database::save_undo_history( const fc::path& dir )
+{ try {
+   if( get_data_dir() == fc::path() || find( dynamic_global_property_id_type() ) == nullptr )
+      return;
+
+   fc::path undo_file = dir / "undo_history";
+   uint32_t reversible = head_block_num() - get_dynamic_global_properties().last_irreversible_block_num;
+   if( reversible == 0 || _undo_db.size() == 0 )
+   {
+      fc::remove_all( undo_file );
+      return;
+   }
+
+   // written next to the old file and renamed over it, so that a failed write leaves the old history in place
+   fc::create_directories( undo_file.parent_path() );
+   const fc::path tmp_file = undo_file.generic_string() + ".new";
+   {
+      std::ofstream out( tmp_file.generic_string(),
+                         std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out, "Unable to write ${f}", ("f", tmp_file) );
+      fc::raw::pack( out, head_block_id() );
+      fc::raw::pack( out, _undo_db.pack_stack() );
+      out.flush();
+      FC_ASSERT( out, "Unable to write ${f}", ("f", tmp_file) );
+   }
+   fc::rename( tmp_file, undo_file );
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * @return true if the undo history saved in undo_file belongs to the current head block and was restored
+ */
+bool database::load_undo_history( const fc::path& undo_file )
+{
+   if( !fc::exists( undo_file ) )
+      return false;
+   try
+   {
+      std::string data;
+      fc::read_file_contents( undo_file, data );
+      fc::datastream<const char*> ds( data.data(), data.size() );
+
+      block_id_type saved_head;
+      vector<db::packed_undo_state> states;
+      fc::raw::unpack( ds, saved_head );
+      fc::raw::unpack( ds, states );
+
+      if( saved_head == head_block_id() )
+      {
+         _undo_db.unpack_stack( states );
+         return true;
+      }
+      wlog( "Ignoring undo history saved at block ${s}, head block is ${h}",
+            ("s", saved_head)("h", head_block_id()) );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Unable to restore undo history: ${e}", ("e", e.to_detail_string()) );
+      _undo_db.unpack_stack( vector<db::packed_undo_state>() );
+   }
+   return false;
+}
+
+/**
+ * Restores the undo history saved by close() and seeds the fork database with every reversible block it
+ * covers.  If the history is missing or does not match the object graph, only the last block is kept in the
+ * fork database, as if the node had been shut down after rewinding to the last irreversible block.
+ */
+void database::open_undo_history( const signed_block& last_block )
+{
+   _fork_db.reset();
+
+   uint32_t undo_depth = 0;
+   if( last_block.id() == head_block_id() && load_undo_history( get_data_dir() / "object_database" / "undo_history" ) )
+   {
+      uint32_t last_irreversible = get_dynamic_global_properties().last_irreversible_block_num;
+      undo_depth = std::min<uint32_t>( _undo_db.size(), head_block_num() - last_irreversible );
+      // block 0 does not exist, so the fork database can only reach back to block 1
+      undo_depth = std::min<uint32_t>( undo_depth, head_block_num() - 1 );
+   }
+
+   if( undo_depth > 0 )
+   {
+      _undo_db.set_max_size( undo_depth + 1 );
+      _fork_db.set_max_size( undo_depth + 1 );
+
+      uint32_t first_num = head_block_num() - undo_depth;
+      fc::optional<signed_block> first_block = _block_id_to_block.fetch_by_number( first_num );
+      if( first_block.valid() )
+      {
+         _fork_db.start_block( *first_block );
+         for( uint32_t num = first_num + 1; num < head_block_num(); ++num )
+         {
+            fc::optional<signed_block> block = _block_id_to_block.fetch_by_number( num );
+            if( !block.valid() )
+            {
+               wlog( "Reversible block ${n} is missing from the block database", ("n", num) );
+               _fork_db.reset();
+               break;
+            }
+            _fork_db.push_block( *block );
+         }
+         if( _fork_db.head() )
+         {
+            _fork_db.push_block( last_block );
+            ilog( "Restored undo history for ${n} reversible blocks", ("n", undo_depth) );
+            return;
+         }
+      }
+   }
+
+   _fork_db.start_block( last_block );
+}
+
+void database::set_block_log_retention( uint32_t blocks, uint32_t snapshot_interval )
+{
+   _block_log_retention = blocks;
+   _snapshot_interval = snapshot_interval > 0 ? snapshot_interval : std::max<uint32_t>( blocks, 1 );
+}
+
+void database::save_state_snapshot()
+{
+   detail::without_pending_transactions( *this, std::move(_pending_tx), [&]()
+   {
+      _save_state_snapshot();
+   });
+}
+
+/**
+ * The snapshot is written next to the object graph and swapped with it by renaming directories, so that the data
+ * dir holds a complete state at any time.  open() finishes a swap which was interrupted.
+ */
+void database::_save_state_snapshot()
+{ try {
+   const fc::path data_dir = get_data_dir();
+   if( data_dir == fc::path() || find( dynamic_global_property_id_type() ) == nullptr )
+      return;
+
+   const fc::path tmp_dir = data_dir / "object_database.snapshot";
+   const fc::path new_dir = data_dir / "object_database.new";
+   const fc::path old_dir = data_dir / "object_database.old";
+   fc::remove_all( tmp_dir );
+   object_database::flush( tmp_dir );
+   save_undo_history( tmp_dir );
+   // every block the snapshot includes must be on disk before the snapshot can be used
+   if( _block_id_to_block.is_open() )
+      _block_id_to_block.flush();
+
+   fc::rename( tmp_dir, new_dir );
+   if( fc::exists( data_dir / "object_database" ) )
+      fc::rename( data_dir / "object_database", old_dir );
+   fc::rename( new_dir, data_dir / "object_database" );
+   fc::remove_all( old_dir );
+   _last_snapshot_block = head_block_num();
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * Blocks are pruned once they are irreversible, older than the retention window and older than the last state
+ * snapshot, which must remain replayable from the block log.  The ids of pruned blocks are kept.
+ *
+ * Pruning, and compacting the blocks file, only happens when a snapshot is taken, the other blocks pass through
+ * here without touching the block log.
+ */
+void database::prune_block_log()
+{ try {
+   if( head_block_num() < _last_snapshot_block + _snapshot_interval )
+      return;
+   _save_state_snapshot();
+
+   const uint32_t retained = std::min( _block_log_retention, head_block_num() );
+   const uint32_t first_block_to_keep = std::min( { head_block_num() + 1 - retained,
+                                                    get_dynamic_global_properties().last_irreversible_block_num,
+                                                    _last_snapshot_block + 1 } );
+   _block_id_to_block.prune( first_block_to_keep );
+} FC_CAPTURE_AND_RETHROW() }
+
+/**
+ * Brings the state loaded from the last snapshot up to date with a pruned block log.  Blocks which were popped
+ * after the snapshot was taken are undone with the undo history saved along with it.
+ */
+void database::replay_pruned_block_log( const signed_block& last_block )
+{ try {
+   const uint32_t last_block_num = last_block.block_num();
+   auto head_is_in_log = [&]() -> bool {
+      return head_block_num() > 0 && head_block_num() <= last_block_num
+             && head_block_num() + 1 >= _block_id_to_block.first_block_num()
+             && _block_id_to_block.fetch_block_id( head_block_num() ) == head_block_id();
+   };
+
+   if( !head_is_in_log() && load_undo_history( get_data_dir() / "object_database" / "undo_history" ) )
+      while( !head_is_in_log() && _undo_db.size() > 0 )
+         pop_undo();
+   _undo_db.discard_history();
+   FC_ASSERT( head_is_in_log(), "The state snapshot does not connect to the pruned block log, the node has to be resynced",
+              ("head_block_num", head_block_num())("first_block_num", _block_id_to_block.first_block_num()) );
+
+   ilog( "Replaying blocks ${f} to ${l} on top of the state snapshot",
+         ("f", head_block_num() + 1)("l", last_block_num) );
+   _last_snapshot_block = head_block_num();
+   _undo_db.disable();
+   for( uint32_t i = head_block_num() + 1; i <= last_block_num; ++i )
+   {
+      fc::optional< signed_block > block = _block_id_to_block.fetch_by_number( i );
+      FC_ASSERT( block.valid(), "Block ${i} is missing from the pruned block log", ("i", i) );
+      apply_block( *block, replay_skip_flags );
+      _block_events.wait_for_consumers();
+   }
+   _undo_db.enable();
+} FC_CAPTURE_AND_RETHROW( (last_block.block_num()) ) }
+
 } }
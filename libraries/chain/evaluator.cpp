@@ -95,12 +95,7 @@ database& generic_evaluator::db()const { return trx_state->db(); }
    void generic_evaluator::pay_fee()
    { try {
       if( !trx_state->skip_fee ) {
-         database& d = db();
-         /// TODO: db().pay_fee( account_id, core_fee );
-         d.modify(*fee_paying_account_statistics, [&](account_statistics_object& s)
-         {
-            s.pay_fee( core_fee_paid, d.get_global_properties().parameters.cashback_vesting_threshold );
-         });
+         db().pay_fee( *fee_paying_account_statistics, core_fee_paid );
       }
    } FC_CAPTURE_AND_RETHROW() }
 
@@ -113,10 +108,7 @@ database& generic_evaluator::db()const { return trx_state->db(); }
          generic_evaluator::pay_fee();
          return;
       }
-      d.modify( fba, [&]( fba_accumulator_object& _fba )
-      {
-         _fba.accumulated_fba_fees += core_fee_paid;
-      } );
+      d.pay_fba_fee( fba, core_fee_paid );
    }
 
    share_type generic_evaluator::calculate_fee_for_operation(const operation& op) const
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/account.hpp>
+#include <graphene/db/object.hpp>
+#include <graphene/db/generic_index.hpp>
+
+namespace graphene { namespace chain {
+
+/**
+ * @brief Records how one account has listed another, see account_whitelist_operation
+ *
+ * Listings used to be kept as sets on both account_objects, so every modification of an account that lists or is
+ * listed by many others copied those sets into the undo state.  Each listing is its own small object instead, and
+ * is only created, modified or removed by account_whitelist_operation.  Pairs without listing have no object.
+ */
+class account_listing_object : public graphene::db::abstract_object< account_listing_object >
+{
+   public:
+      static const uint8_t space_id = implementation_ids;
+      static const uint8_t type_id  = impl_account_listing_object_type;
+
+      /// The account which specified its opinion of listed_account
+      account_id_type authorizing_account;
+      account_id_type listed_account;
+      /// A combination of account_whitelist_operation::account_listing flags, never no_listing
+      uint8_t         listing = account_whitelist_operation::no_listing;
+
+      bool is_whitelisted()const { return listing & account_whitelist_operation::white_listed; }
+      bool is_blacklisted()const { return listing & account_whitelist_operation::black_listed; }
+};
+
+struct by_listed_account;
+struct by_authorizing_account;
+
+typedef multi_index_container<
+   account_listing_object,
+   indexed_by<
+      ordered_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag<by_listed_account>,
+         composite_key< account_listing_object,
+            member< account_listing_object, account_id_type, &account_listing_object::listed_account >,
+            member< account_listing_object, account_id_type, &account_listing_object::authorizing_account >
+         >
+      >,
+      ordered_unique< tag<by_authorizing_account>,
+         composite_key< account_listing_object,
+            member< account_listing_object, account_id_type, &account_listing_object::authorizing_account >,
+            member< account_listing_object, account_id_type, &account_listing_object::listed_account >
+         >
+      >
+   >
+> account_listing_multi_index_type;
+
+typedef generic_index< account_listing_object, account_listing_multi_index_type > account_listing_index;
+
+} } // graphene::chain
+
+FC_REFLECT_DERIVED( graphene::chain::account_listing_object, (graphene::db::object),
+                    (authorizing_account)(listed_account)(listing) )
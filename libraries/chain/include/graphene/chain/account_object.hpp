@@ -170,37 +170,6 @@ namespace graphene { namespace chain {
          /// ID of that object.
          account_statistics_id_type statistics;
 
-         /**
-          * This is a set of all accounts which have 'whitelisted' this account. Whitelisting is only used in core
-          * validation for the purpose of authorizing accounts to hold and transact in whitelisted assets. This
-          * account cannot update this set, except by transferring ownership of the account, which will clear it. Other
-          * accounts may add or remove their IDs from this set.
-          */
-         flat_set<account_id_type> whitelisting_accounts;
-
-         /**
-          * Optionally track all of the accounts this account has whitelisted or blacklisted, these should
-          * be made Immutable so that when the account object is cloned no deep copy is required.  This state is
-          * tracked for GUI display purposes.
-          *
-          * TODO: move white list tracking to its own multi-index container rather than having 4 fields on an
-          * account.   This will scale better because under the current design if you whitelist 2000 accounts,
-          * then every time someone fetches this account object they will get the full list of 2000 accounts.
-          */
-         ///@{
-         set<account_id_type> whitelisted_accounts;
-         set<account_id_type> blacklisted_accounts;
-         ///@}
-
-
-         /**
-          * This is a set of all accounts which have 'blacklisted' this account. Blacklisting is only used in core
-          * validation for the purpose of forbidding accounts from holding and transacting in whitelisted assets. This
-          * account cannot update this set, and it will be preserved even if the account is transferred. Other accounts
-          * may add or remove their IDs from this set.
-          */
-         flat_set<account_id_type> blacklisting_accounts;
-
          /**
           * Vesting balance which receives cashback_reward deposits.
           */
@@ -263,50 +232,60 @@ namespace graphene { namespace chain {
    };
 
    /**
-    *  @brief This secondary index will allow a reverse lookup of all accounts that a particular key or account
-    *  is an potential signing authority.
+    *  @brief This secondary index will allow a reverse lookup of all accounts that have been referred by
+    *  a particular account.
     */
-   class account_member_index : public secondary_index
+   class account_referrer_index : public secondary_index
    {
       public:
          virtual void object_inserted( const object& obj ) override;
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual uint64_t memory_usage()const override;
 
-
-         /** given an account or key, map it to the set of accounts that reference it in an active or owner authority */
-         map< account_id_type, set<account_id_type> > account_to_account_memberships;
-         map< public_key_type, set<account_id_type> > account_to_key_memberships;
-         /** some accounts use address authorities in the genesis block */
-         map< address, set<account_id_type> >         account_to_address_memberships;
-
-
-      protected:
-         set<account_id_type>  get_account_members( const account_object& a )const;
-         set<public_key_type>  get_key_members( const account_object& a )const;
-         set<address>          get_address_members( const account_object& a )const;
-
-         set<account_id_type>  before_account_members;
-         set<public_key_type>  before_key_members;
-         set<address>          before_address_members;
+         /** maps the referrer to the set of accounts that they have referred */
+         map< account_id_type, set<account_id_type> > referred_by;
    };
 
-
    /**
-    *  @brief This secondary index will allow a reverse lookup of all accounts that have been referred by
-    *  a particular account.
+    *  @brief This secondary index finds the accounts whose name contains a given part.
+    *
+    *  Every sequence of three characters of a name, a trigram, maps to the accounts whose name contains it.
+    *  Operations never rename accounts, so the index is mostly updated when accounts are created.  It is only
+    *  added by database::enable_account_name_search().
     */
-   class account_referrer_index : public secondary_index
+   class account_name_search_index : public secondary_index
    {
       public:
          virtual void object_inserted( const object& obj ) override;
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual uint64_t memory_usage()const override;
 
-         /** maps the referrer to the set of accounts that they have referred */
-         map< account_id_type, set<account_id_type> > referred_by;
+         /** parts shorter than this can not be searched */
+         static const size_t gram_size = 3;
+
+         /**
+          *  Finds at most limit accounts whose name contains part, in id order starting at start.  A call looks at
+          *  no more than max_scanned accounts of the rarest trigram of part, so a part that is in many names
+          *  returns fewer results and a continuation instead of scanning the whole index.
+          *  @param part lower case, at least gram_size characters long
+          *  @param next set to the id the next call should start at, or cleared when no account is left to look at
+          */
+         vector<account_id_type> find_containing( const database& db, const string& part, account_id_type start,
+                                                  uint32_t limit, uint32_t max_scanned,
+                                                  optional<account_id_type>& next )const;
+
+      private:
+         static uint32_t gram( const string& s, size_t pos );
+         void add( const string& name, account_id_type id );
+         void remove( const string& name, account_id_type id );
+
+         string _name_before;
+         /** trigram to the accounts whose name contains it, ordered by id */
+         std::unordered_map< uint32_t, flat_set<account_id_type> > _accounts_by_gram;
    };
    
    /**
@@ -438,8 +417,7 @@ FC_REFLECT_DERIVED( graphene::chain::account_object,
                     (graphene::db::object),
                     (membership_expiration_date)(registrar)(referrer)(lifetime_referrer)
                     (network_fee_percentage)(lifetime_referrer_fee_percentage)(referrer_rewards_percentage)
-                    (name)(owner)(active)(options)(statistics)(whitelisting_accounts)(blacklisting_accounts)
-                    (whitelisted_accounts)(blacklisted_accounts)
+                    (name)(owner)(active)(options)(statistics)
                     (cashback_vb)
                     (owner_special_authority)(active_special_authority)
                     (top_n_control_flags)
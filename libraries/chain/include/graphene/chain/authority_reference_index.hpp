@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/address.hpp>
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/db/index.hpp>
+
+#include <map>
+
+namespace graphene { namespace chain {
+
+class account_object;
+class witness_object;
+
+/** the ways in which an account refers to a key, an address or another account */
+enum authority_reference_role
+{
+   owner_reference           = 0x01, ///< member of the owner authority
+   active_reference          = 0x02, ///< member of the active authority
+   memo_reference            = 0x04, ///< the memo key
+   witness_signing_reference = 0x08, ///< the signing key of the witness of the account
+   address_reference         = 0x10  ///< found through an address form of the key rather than the key itself
+};
+
+/** an account referring to a key, address or account, roles is a combination of authority_reference_role */
+struct authority_reference
+{
+   account_id_type account;
+   uint8_t         roles;
+};
+
+/**
+ *  @brief This secondary index of the account index maps keys, addresses and accounts to the accounts which
+ *  refer to them, and in which roles.
+ *
+ *  Witness signing keys are maintained by a witness_reference_observer registered on the witness index.  The
+ *  accounts referring to each item are kept in id order, so that they can be listed in pages.
+ */
+class authority_reference_index : public graphene::db::secondary_index
+{
+   public:
+      typedef std::map< account_id_type, uint8_t > references;
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after ) override;
+      virtual uint64_t memory_usage()const override;
+
+      /**
+       *  @return at most limit references to key, to the address of the key or to one of its PTS addresses, in
+       *  account order from start on
+       */
+      vector<authority_reference> find_key_references( const public_key_type& key, account_id_type start, uint32_t limit )const;
+      /** @return at most limit references to an account in the owner or active authorities, in account order from start on */
+      vector<authority_reference> find_account_references( account_id_type account, account_id_type start, uint32_t limit )const;
+
+      void add_witness_key( account_id_type witness_account, const public_key_type& key );
+      void remove_witness_key( account_id_type witness_account, const public_key_type& key );
+
+   private:
+      struct account_members
+      {
+         flat_map< public_key_type, uint8_t > keys;
+         flat_map< address, uint8_t >         addresses;
+         flat_map< account_id_type, uint8_t > accounts;
+      };
+      static account_members get_members( const account_object& a );
+
+      template<typename Item>
+      static void add( std::map< Item, references >& refs, const flat_map< Item, uint8_t >& members, account_id_type id );
+      template<typename Item>
+      static void remove( std::map< Item, references >& refs, const flat_map< Item, uint8_t >& members, account_id_type id );
+
+      std::map< public_key_type, references > _key_references;
+      std::map< address, references >         _address_references;
+      std::map< account_id_type, references > _account_references;
+
+      account_members                         _before;
+};
+
+/** keeps the witness signing keys of an authority_reference_index up to date */
+class witness_reference_observer : public graphene::db::secondary_index
+{
+   public:
+      witness_reference_observer( authority_reference_index& references ) : _references( references ) {}
+
+      virtual void object_inserted( const object& obj ) override;
+      virtual void object_removed( const object& obj ) override;
+      virtual void about_to_modify( const object& before ) override;
+      virtual void object_modified( const object& after ) override;
+
+   private:
+      authority_reference_index& _references;
+      public_key_type            _key_before;
+};
+
+} } // graphene::chain
+
+FC_REFLECT_ENUM( graphene::chain::authority_reference_role,
+                 (owner_reference)(active_reference)(memo_reference)(witness_signing_reference)(address_reference) )
+FC_REFLECT( graphene::chain::authority_reference, (account)(roles) )
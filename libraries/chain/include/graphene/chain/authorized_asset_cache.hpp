@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/protocol/types.hpp>
+#include <graphene/db/index.hpp>
+
+#include <unordered_map>
+
+namespace graphene { namespace chain {
+
+class account_object;
+class asset_object;
+class database;
+
+/**
+ *  @brief Remembers whether accounts are authorized to transact in assets
+ *
+ *  A decision depends on the allowed_assets of the account, the flags and authority lists of the asset and the
+ *  whitelist and blacklist listings of the account.  Every change of those objects, including the changes made
+ *  when a block or transaction is undone, reaches the cache through an authorized_asset_observer and makes the
+ *  decisions involving the changed account or asset stale.
+ */
+class authorized_asset_cache
+{
+   public:
+      /**
+       *  @return the remembered decision for acct and asset_obj, which must be stored in d, computing it first if
+       *  there is none or it is stale
+       */
+      bool is_authorized( const database& d, const account_object& acct, const asset_object& asset_obj );
+
+      void account_changed( account_id_type id );
+      void asset_changed( asset_id_type id );
+      void clear();
+
+      size_t size()const { return _decisions.size(); }
+
+      /** all decisions are dropped when there are more than this many */
+      static const size_t max_size = 100000;
+
+   private:
+      struct decision
+      {
+         uint64_t computed_at = 0;
+         bool     after_hardfork_415 = false;
+         bool     authorized = false;
+      };
+      struct key_hash
+      {
+         size_t operator()( const std::pair<uint64_t,uint64_t>& k )const
+         {
+            return std::hash<uint64_t>()( (k.first << 24) ^ k.second );
+         }
+      };
+
+      /** incremented for every decision and change, so that a decision is stale if a change is younger */
+      uint64_t                                                                 _clock = 0;
+      std::unordered_map< uint64_t, uint64_t >                                 _account_changes;
+      std::unordered_map< uint64_t, uint64_t >                                 _asset_changes;
+      std::unordered_map< std::pair<uint64_t,uint64_t>, decision, key_hash >   _decisions;
+};
+
+/** tells an authorized_asset_cache about every change of the accounts, assets or account listings of its index */
+class authorized_asset_observer : public graphene::db::secondary_index
+{
+   public:
+      authorized_asset_observer( authorized_asset_cache& cache ) : _cache( cache ) {}
+
+      virtual void object_inserted( const object& obj ) override { changed( obj ); }
+      virtual void object_removed( const object& obj ) override  { changed( obj ); }
+      virtual void object_modified( const object& after ) override { changed( after ); }
+
+   private:
+      void changed( const object& obj );
+
+      authorized_asset_cache& _cache;
+};
+
+} } // graphene::chain
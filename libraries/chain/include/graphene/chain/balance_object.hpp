@@ -23,8 +23,11 @@
  */
 #pragma once
 
+#include <graphene/chain/pts_address.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
 
+#include <array>
+
 namespace graphene { namespace chain {
 
    class balance_object : public abstract_object<balance_object>
@@ -46,6 +49,14 @@ namespace graphene { namespace chain {
          optional<linear_vesting_policy> vesting_policy;
          time_point_sec last_claim_date;
          asset_id_type asset_type()const { return balance.asset_id; }
+
+         /**
+          *  Genesis balances are owned by the address of a key or by one of the four PTS addresses of the key, so
+          *  these are the owners under which the balances of a key are found in the by_owner index.
+          */
+         static std::array<address,5> owner_addresses( const public_key_type& key );
+         /// @return true if the balance can be claimed with key
+         bool is_owned_by( const public_key_type& key )const;
    };
 
    struct by_owner;
@@ -26,25 +26,168 @@
 #include <graphene/chain/protocol/block.hpp>
 
 namespace graphene { namespace chain {
+   struct index_entry;
+
+   /**
+    *  Written by this node for a block whose transactions and merkle root it validated.  The record matches
+    *  the block in the log when the ids match and the stored bytes still have the same crc, in which case a
+    *  replay does not have to validate the block again, see database::reindex().
+    */
+   struct trust_record
+   {
+      block_id_type block_id;
+      uint32_t      block_crc = 0;
+      /** digest of the operations applied by the block and their results */
+      fc::sha256    results_digest;
+   };
+
+   /** the crc of the stored bytes of a block, kept for every block in the file "checksums" */
+   struct block_checksum
+   {
+      block_id_type block_id;
+      uint32_t      crc = 0;
+   };
+
+   /** consecutive blocks which block_database::verify() found damaged */
+   struct block_log_damage
+   {
+      uint32_t first_block_num = 0;
+      uint32_t last_block_num = 0;
+      /** what is wrong with the first block of the range */
+      string   reason;
+   };
+
+   struct block_log_verification
+   {
+      /** the range of block numbers checked, the blocks below first_block_num were pruned */
+      uint32_t                 first_block_num = 0;
+      uint32_t                 last_block_num = 0;
+      uint32_t                 checked_blocks = 0;
+      /** blocks stored before checksums were kept, these are only decoded and checked against their ids */
+      uint32_t                 blocks_without_checksum = 0;
+      /** bytes at the end of the blocks file which no index entry refers to, normally blocks of abandoned forks */
+      uint64_t                 unindexed_bytes = 0;
+      vector<block_log_damage> damaged;
+   };
+
+   /**
+    *  Blocks may be stored compressed with zlib.  A compressed entry is marked in the index, so a log can
+    *  hold a mix of compressed and raw blocks and reading is transparent to callers.  If the file
+    *  "blocks.dict" exists in the database directory it is used as preset dictionary for compression, and
+    *  must then be kept as long as blocks compressed with it are in the log.
+    *
+    *  A log may be pruned, see prune().  Pruned blocks keep their entry in the index, so their ids can still
+    *  be looked up by number, but their bodies are gone.
+    *
+    *  A log opened read-only can be read while another process appends to it.  store(), remove() and prune()
+    *  do nothing on such a log, the blocks are written by the other process.
+    *
+    *  Trust records are kept in the file "trust" next to the index, one per block number.  The file "checksums"
+    *  holds a block_checksum for every stored block, so that damage is found by verify() before a replay runs into
+    *  it.  Logs written before the checksums were kept are still read, their blocks are checked by decoding them.
+    */
    class block_database 
    {
       public:
-         void open( const fc::path& dbdir );
+         void open( const fc::path& dbdir, bool read_only = false );
+         /** reopens the files, which picks up a log that another process compacted */
+         void reopen();
          bool is_open()const;
+         bool is_read_only()const { return _read_only; }
+         fc::path get_data_dir()const { return _dbdir; }
          void flush();
          void close();
 
-         void store( const block_id_type& id, const signed_block& b );
+         /** store blocks passed to store() compressed, unless compression does not make them smaller */
+         void set_compression( bool compress ) { _compress = compress; }
+         bool compression()const { return _compress; }
+
+         /**
+          *  Rewrites the block log in dbdir so that every block is stored compressed, or every block is stored
+          *  raw.  The log must not be open.  When compressing a log without dictionary, a dictionary is
+          *  built from the most recent blocks first.
+          */
+         static void migrate( const fc::path& dbdir, bool compress );
+
+         /**
+          *  Checks every block of the log in dbdir: its index entry, checksum, encoding, id and link to the previous
+          *  block.  The log is only read, in ranges spread over threads, default one per core.  It may be open in
+          *  another process which appends to it.
+          */
+         static block_log_verification verify( const fc::path& dbdir, uint32_t threads = 0 );
+         /**
+          *  Rewrites the index of the log in dbdir from the blocks file, for when the index was lost or damaged.
+          *  The blocks file is scanned for blocks, and the longest chain of them from the first retained block is
+          *  indexed, preferring the most recently stored block of a number.  The log must not be open.
+          *  @return the number of the last block in the new index, 0 if none was found
+          */
+         static uint32_t rebuild_index( const fc::path& dbdir );
+         /**
+          *  Verifies the log in dbdir and, if it is damaged, rebuilds the index when that recovers more blocks, and
+          *  truncates the log before the first damaged block.  The truncated blocks are fetched from the peers
+          *  again.  The log must not be open.
+          *  @return the number of the last block kept
+          */
+         static uint32_t repair( const fc::path& dbdir, uint32_t threads = 0 );
+
+         /** also writes the trust record of the block when results_digest is given */
+         void store( const block_id_type& id, const signed_block& b,
+                     const optional<fc::sha256>& results_digest = optional<fc::sha256>() );
+         /** writes the trust record of a block which is already in the log */
+         void store_trust( uint32_t block_num, const fc::sha256& results_digest );
          void remove( const block_id_type& id );
 
+         /**
+          *  Drops the bodies of every block below first_block_to_keep, the last block is always kept.
+          *  fetch_block_id() still works for pruned blocks while contains() and the fetch methods treat them
+          *  as missing.  The blocks file is compacted once the pruned blocks take up more space than the
+          *  retained ones.
+          */
+         void     prune( uint32_t first_block_to_keep );
+         /** @return the lowest block number whose body may still be in the log, 1 unless the log was pruned */
+         uint32_t first_block_num()const { return _first_block_num; }
+
          bool                   contains( const block_id_type& id )const;
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /**
+          *  Fetches a block to replay it.  If the trust record of the block matches, trust is set to it and the
+          *  id of the block is not recomputed, otherwise trust is reset and the block is checked like in
+          *  fetch_by_number().
+          */
+         optional<signed_block> fetch_for_replay( uint32_t block_num, optional<trust_record>& trust )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
       private:
+         /** @return the packed block referenced by e, decompressed if necessary */
+         vector<char>          read_block( const index_entry& e )const;
+         /** @return false if block_num is past the end of the index */
+         bool                  read_index_entry( uint32_t block_num, index_entry& e )const;
+         optional<trust_record> read_trust_record( uint32_t block_num )const;
+         optional<block_checksum> read_checksum( uint32_t block_num )const;
+         /** @return the reason why the block is damaged, empty if it is intact */
+         string                check_block( uint32_t block_num, uint64_t blocks_size, uint64_t& block_end,
+                                            bool& has_checksum )const;
+         /** drops every block after last_block_num from the log in dbdir */
+         static void           truncate( const fc::path& dbdir, uint32_t last_block_num );
+         /** rewrites the blocks file without the pruned blocks */
+         void                  compact();
+         /** moves the files of a complete migration into dbdir, or drops an incomplete one, see migrate() */
+         static void           finish_migration( const fc::path& dbdir );
+
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+         mutable std::fstream _trust;
+         mutable std::fstream _checksums;
+         bool                 _compress = false;
+         std::string          _dictionary;
+         fc::path             _dbdir;
+         uint32_t             _first_block_num = 1;
+         bool                 _read_only = false;
    };
 } }
+
+FC_REFLECT( graphene::chain::block_log_damage, (first_block_num)(last_block_num)(reason) )
+FC_REFLECT( graphene::chain::block_log_verification,
+            (first_block_num)(last_block_num)(checked_blocks)(blocks_without_checksum)(unindexed_bytes)(damaged) )
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/protocol/block.hpp>
+#include <graphene/db/object.hpp>
+
+#include <fc/thread/future.hpp>
+#include <fc/thread/mutex.hpp>
+#include <fc/thread/scoped_lock.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace graphene { namespace chain {
+
+using graphene::db::object;
+
+/**
+ *  Everything a block did to the chain, published after the block has been applied.  The objects are copies, so
+ *  the event can be read on any thread while the chain moves on.  They are only filled when a consumer asked for
+ *  them and the block was applied with undo tracking, which is not the case while the block log is replayed.
+ */
+struct applied_block_event
+{
+   signed_block                                   block;
+   block_id_type                                  block_id;
+   uint32_t                                       block_num = 0;
+   /** last irreversible block after the block was applied */
+   uint32_t                                       last_irreversible_block_num = 0;
+   /** the operations and virtual operations of the block with their results, see database::get_applied_operations() */
+   vector< optional< operation_history_object > > operations;
+   /** the new values of the objects the block created or modified */
+   vector< std::shared_ptr<const object> >       changed_objects;
+   /** the objects the block removed, as they were before the block */
+   vector< std::shared_ptr<const object> >       removed_objects;
+};
+
+/** processing statistics of a block_event_consumer */
+struct block_event_consumer_statistics
+{
+   string   name;
+   uint32_t capacity = 0;
+   uint32_t queued = 0;
+   uint64_t handled = 0;
+   uint64_t failed = 0;
+   /** how often the chain had to wait for the consumer to catch up */
+   uint64_t stalls = 0;
+};
+
+/**
+ *  @brief A plugin's queue of applied_block_event, handled in order on a thread of its own.
+ *
+ *  The handler must not touch the chain database, which keeps changing while the queued events are handled;
+ *  everything it needs is in the event.  State the handler maintains must only be read through run(), which
+ *  executes on the consumer's thread after every event queued so far.
+ */
+class block_event_consumer
+{
+   public:
+      typedef std::function<void( const applied_block_event& )> handler_type;
+
+      block_event_consumer( const string& name, uint32_t capacity, bool with_objects, handler_type handler );
+      /** handles the queued events before the thread is stopped */
+      ~block_event_consumer();
+
+      const string& name()const { return _name; }
+      uint32_t      capacity()const { return _capacity; }
+      bool          with_objects()const { return _with_objects; }
+
+      /** queues the event without waiting, even if the queue is full */
+      void push( const std::shared_ptr<const applied_block_event>& event );
+      /** waits until fewer than capacity events are queued */
+      void wait_for_capacity();
+      /** waits until every queued event has been handled */
+      void flush();
+
+      /** runs f on the consumer's thread once the events queued so far have been handled, and returns its result */
+      template<typename Functor>
+      auto run( Functor&& f ) -> decltype( f() )
+      {
+         return _thread.async( [this,&f]() -> decltype( f() ) {
+            fc::scoped_lock<fc::mutex> lock( _handler_mutex );
+            return f();
+         }, "block_event_consumer::run" ).wait();
+      }
+
+      block_event_consumer_statistics get_statistics()const;
+
+   private:
+      void handle( const applied_block_event& event );
+      void pop_handled();
+
+      string                            _name;
+      uint32_t                          _capacity;
+      bool                              _with_objects;
+      handler_type                      _handler;
+      fc::thread                        _thread;
+      /** the events are handled one at a time in queue order even if the handler yields */
+      fc::mutex                         _handler_mutex;
+      std::deque< fc::future<void> >    _queue;
+      /** counted on the consumer's thread */
+      std::atomic<uint64_t>             _handled;
+      std::atomic<uint64_t>             _failed;
+      uint64_t                          _stalls = 0;
+};
+
+/**
+ *  @brief Hands every applied block to the plugins which subscribed, so that their processing runs beside the
+ *  chain instead of within block application.
+ *
+ *  Publishing never blocks.  The database applies backpressure with wait_for_consumers() where waiting is safe,
+ *  after a block has been pushed and between the blocks of a replay, so a consumer which falls behind slows the
+ *  chain down instead of queuing without bound.  The queue of a consumer may grow beyond its capacity by the
+ *  blocks of a single fork switch.
+ *
+ *  Only what has to happen before the next block, and whatever writes to the chain database, stays on the
+ *  synchronous applied_block signal.
+ */
+class block_event_pipeline
+{
+   public:
+      ~block_event_pipeline();
+
+      /**
+       *  @param capacity how many events may be queued for the consumer before the chain waits for it
+       *  @param with_objects whether the events need copies of the changed and removed objects
+       */
+      std::shared_ptr<block_event_consumer> subscribe( const string& name, uint32_t capacity, bool with_objects,
+                                                       block_event_consumer::handler_type handler );
+      /** flushes the consumer and stops handing it events */
+      void unsubscribe( const std::shared_ptr<block_event_consumer>& consumer );
+
+      bool empty()const { return _consumers.empty(); }
+      /** whether any consumer wants the changed and removed objects */
+      bool wants_objects()const;
+
+      void publish( const std::shared_ptr<const applied_block_event>& event );
+      void wait_for_consumers();
+      void flush();
+
+      vector<block_event_consumer_statistics> get_statistics()const;
+
+   private:
+      vector< std::shared_ptr<block_event_consumer> > _consumers;
+};
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::block_event_consumer_statistics, (name)(capacity)(queued)(handled)(failed)(stalls) )
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+
+namespace graphene { namespace chain {
+
+   /**
+    *  @brief what a replay records about one block, so that replays by different builds can be compared
+    *
+    *  The objects are kept as hashes only, the operations with their results in full, so that the first
+    *  differing operation can be printed from either side.
+    */
+   struct block_trace
+   {
+      uint32_t                                              block_num = 0;
+      block_id_type                                         block_id;
+      fc::uint128                                           digest;
+      vector< std::pair<object_id_type, fc::uint128> >      changed_objects;
+      vector<operation_history_object>                      operations;
+   };
+
+   /** the first block two traces disagree on, and what they disagree about */
+   struct block_trace_difference
+   {
+      uint32_t                 block_num = 0;
+      /** the position of the first differing operation, if the operations differ */
+      optional<uint32_t>       operation;
+      /** the objects changed by the block whose hashes differ, a removed object has a zero hash */
+      vector<object_id_type>   objects;
+   };
+
+   block_trace make_block_trace( const state_digest_record& record, const vector<operation_history_object>& operations );
+
+   /**
+    *  Compares the traces of the same blocks block by block, blocks missing from either side are skipped.
+    *  @return the first block whose digest, changed objects or operations differ
+    */
+   optional<block_trace_difference> find_first_difference( const vector<block_trace>& a, const vector<block_trace>& b );
+
+} } // graphene::chain
+
+FC_REFLECT( graphene::chain::block_trace, (block_num)(block_id)(digest)(changed_objects)(operations) )
+FC_REFLECT( graphene::chain::block_trace_difference, (block_num)(operation)(objects) )
@@ -26,6 +26,8 @@
 #include <graphene/chain/node_property_object.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/authorized_asset_cache.hpp>
+#include <graphene/chain/block_event_pipeline.hpp>
 #include <graphene/chain/fork_database.hpp>
 #include <graphene/chain/block_database.hpp>
 #include <graphene/chain/genesis_state.hpp>
@@ -42,6 +44,7 @@
 
 #include <fc/log/logger.hpp>
 
+#include <deque>
 #include <map>
 
 namespace graphene { namespace chain {
@@ -52,6 +55,36 @@ namespace graphene { namespace chain {
 
    struct budget_record;
 
+   /**
+    *  @brief the state digest after a block was applied
+    *
+    *  changed_objects lists the hash of every object created, modified or removed by the block, a removed
+    *  object has a zero hash, so that nodes whose digests diverge can tell which objects differ.
+    */
+   struct state_digest_record
+   {
+      uint32_t                                              block_num = 0;
+      block_id_type                                         block_id;
+      fc::uint128                                           digest;
+      vector<db::index_digest>                              indexes;
+      vector< std::pair<object_id_type, fc::uint128> >      changed_objects;
+   };
+
+   /** how long the steps of the last generate_block() took */
+   struct block_generation_timings
+   {
+      /** re-applying the pending transactions on top of the head block */
+      fc::microseconds  reapply_pending;
+      fc::microseconds  merkle;
+      /** the secret hashes and the signature */
+      fc::microseconds  sign;
+      /** push_block() of the new block */
+      fc::microseconds  push;
+      uint32_t          transactions = 0;
+      /** pending transactions left for a later block because the block was full */
+      uint32_t          postponed_transactions = 0;
+   };
+
    /**
     *   @class database
     *   @brief tracks the blockchain state in an extensible manner
@@ -96,6 +129,22 @@ namespace graphene { namespace chain {
              const fc::path& data_dir,
              std::function<genesis_state_type()> genesis_loader );
 
+         /**
+          * @brief Open the object graph and block log of a node running in another process without writing to them
+          *
+          * The object graph the other node saved in data_dir is loaded if @p load_state is set, otherwise the state
+          * is initialized from genesis_loader.  The blocks after it are then applied from the block log, see
+          * sync_from_block_log().  close() saves nothing, so the state of a read-only database lives in memory.
+          */
+         void open_read_only( const fc::path& data_dir, std::function<genesis_state_type()> genesis_loader,
+                              bool load_state = true );
+         /**
+          * Applies the blocks that the other process appended to the block log of a read-only database since the
+          * last call, following it to another fork if it switched.  @return the number of blocks applied
+          */
+         uint32_t sync_from_block_log();
+         bool is_read_only()const { return _read_only; }
+
          /**
           * @brief Rebuild object graph from block history and open detabase
           *
@@ -111,7 +160,41 @@ namespace graphene { namespace chain {
           * Will close the database before wiping. Database will be closed when this function returns.
           */
          void wipe(const fc::path& data_dir, bool include_blocks);
-         void close(bool rewind = true);
+
+         /**
+          * @brief Flush the object graph to disk and close the database
+          * @param rewind If true, pop all reversible blocks before flushing.  Otherwise the undo history of the
+          * reversible blocks is saved alongside the object graph, so that the next open() can still switch forks
+          * back to the last irreversible block.
+          */
+         void close(bool rewind = false);
+
+         /**
+          * @brief Store new blocks compressed in the block log, see @ref block_database
+          *
+          * Blocks already in the log are left as they are, use block_database::migrate() to convert them.
+          */
+         void set_block_log_compression( bool compress ) { _block_id_to_block.set_compression( compress ); }
+
+         /**
+          * Writes every block through to the block log file as soon as it is pushed, so that read-only databases
+          * of other processes following this data directory see it right away, see sync_from_block_log().
+          */
+         void set_block_log_flush( bool flush ) { _flush_block_log = flush; }
+
+         /**
+          * @brief Keep only the last @p blocks blocks in the block log, 0 keeps every block
+          *
+          * The object graph is saved as a snapshot every @p snapshot_interval blocks (by default every @p blocks
+          * blocks), and after an unclean shutdown the retained blocks are replayed on top of the newest snapshot.
+          * Blocks are only pruned once they are irreversible and covered by a snapshot, and only when a snapshot
+          * is taken, so up to @p blocks + @p snapshot_interval blocks may be kept.
+          */
+         void set_block_log_retention( uint32_t blocks, uint32_t snapshot_interval = 0 );
+         /** @return the lowest block number whose body is still in the block log, 1 unless the log was pruned */
+         uint32_t first_retained_block_num()const { return _block_id_to_block.first_block_num(); }
+         /** saves the object graph and undo history as the snapshot a pruned node replays from */
+         void save_state_snapshot();
 
          //////////////////// db_block.cpp ////////////////////
 
@@ -137,9 +220,33 @@ namespace graphene { namespace chain {
          const flat_map<uint32_t,block_id_type> get_checkpoints()const { return _checkpoints; }
          bool before_last_checkpoint()const;
 
+         /**
+          *  @return true if block_num is covered by a checkpoint.  Such blocks are applied without undo history
+          *  or fork database bookkeeping during sync, once the checkpoint block shows that they are on its chain.
+          */
+         bool is_known_irreversible_block( uint32_t block_num )const;
+
+         /**
+          *  @return true if applying a block without undo history failed, the object graph is inconsistent then
+          *  and no more blocks are accepted until the blockchain is replayed
+          */
+         bool replay_required()const { return _replay_required; }
+
+         /**
+          *  Maintains the state digest and records it after each applied block, keeping the records of the
+          *  last @p blocks blocks.  0 disables tracking, enabling it computes the digest of the current state.
+          */
+         void set_state_digest_history( uint32_t blocks );
+         /** @return the state digest after block_num was applied, if it is still kept */
+         optional<state_digest_record> get_block_state_digest( uint32_t block_num )const;
+
          bool push_block( const signed_block& b, uint32_t skip = skip_nothing );
          processed_transaction push_transaction( const signed_transaction& trx, uint32_t skip = skip_nothing );
          bool _push_block( const signed_block& b );
+         bool _push_reversible_block( const signed_block& b );
+         bool _push_checkpointed_block( const signed_block& b );
+         void start_fork_db_at_head();
+         void _push_irreversible_block( const signed_block& b );
          processed_transaction _push_transaction( const signed_transaction& trx );
 
          ///@throws fc::exception if the proposed transaction fails to apply.
@@ -156,9 +263,11 @@ namespace graphene { namespace chain {
             witness_id_type witness_id,
             const fc::ecc::private_key& block_signing_private_key
             );
+         const block_generation_timings& get_last_block_generation_timings()const { return _last_generation_timings; }
 
          void pop_block();
          void clear_pending();
+         const vector< processed_transaction >& get_pending_transactions()const { return _pending_tx; }
 
          /**
           *  This method is used to track appied operations during the evaluation of a block, these
@@ -202,6 +311,12 @@ namespace graphene { namespace chain {
           */
          fc::signal<void(const vector<const object*>&)>  removed_objects;
 
+         /**
+          *  Plugins which only index what the chain did subscribe here rather than to applied_block, they are
+          *  handed an applied_block_event of every block on a thread of their own.
+          */
+         block_event_pipeline& block_events() { return _block_events; }
+
          //////////////////// db_witness_schedule.cpp ////////////////////
 
          /**
@@ -272,6 +387,11 @@ namespace graphene { namespace chain {
          void initialize_evaluators();
          /// Reset the object graph in-memory
          void initialize_indexes();
+         /**
+          *  Adds the account_name_search_index to the account index and fills it with the existing accounts.  Only
+          *  nodes serving search_accounts_by_name need it, so it is not one of the default indexes.
+          */
+         void enable_account_name_search();
          void init_genesis(const genesis_state_type& genesis_state = genesis_state_type());
 
          template<typename EvaluatorType>
@@ -322,6 +442,21 @@ namespace graphene { namespace chain {
 
          // helper to handle cashback rewards
          void deposit_cashback(const account_object& acct, share_type amount, bool require_vesting = true);
+
+         /**
+          * @brief Adds a fee to the pending fees of an account
+          *
+          * While the transactions of a block are applied, the fees are summed per account and added to the
+          * statistics once by flush_pending_fees() instead of modifying the statistics for every operation.
+          */
+         void pay_fee( const account_statistics_object& stats, share_type core_fee );
+         /// Adds a fee to a fee-backed asset accumulator the same way
+         void pay_fba_fee( const fba_accumulator_object& fba, share_type core_fee );
+         /** adds the fees summed by pay_fee() and pay_fba_fee() to their objects, before they are read */
+         void flush_pending_fees();
+
+         /** decisions of is_authorized_asset(), kept up to date by observers of the account, asset and listing indexes */
+         authorized_asset_cache& get_authorized_asset_cache()const { return _authorized_asset_cache; }
          // helper to handle witness pay
          void deposit_witness_pay(const witness_object& wit, share_type amount);
 
@@ -404,8 +539,26 @@ namespace graphene { namespace chain {
          //Mark pop_undo() as protected -- we do not want outside calling pop_undo(); it should call pop_block() instead
          void pop_undo() { object_database::pop_undo(); }
          void notify_changed_objects();
+         void publish_block_event( const signed_block& b );
 
       private:
+         //////////////////// db_management.cpp ////////////////////
+         void save_undo_history( const fc::path& dir );
+         bool load_undo_history( const fc::path& undo_file );
+         void open_undo_history( const signed_block& last_block );
+         void _save_state_snapshot();
+         void prune_block_log();
+         void replay_pruned_block_log( const signed_block& last_block );
+         /**
+          *  @return false if a block with a trust record did not give the recorded results, or if repairing the
+          *  log dropped blocks which were already replayed
+          */
+         bool replay_block_log( uint32_t last_block_num, bool use_trust_records );
+         /** @return true if the head block is in the block log, which the other process may have rewritten */
+         bool is_head_in_block_log()const;
+         void reload_read_only_state();
+         bool apply_trusted_block( const signed_block& b, const trust_record& trust );
+
          optional<undo_database::session>       _pending_tx_session;
          vector< unique_ptr<op_evaluator> >     _operation_evaluators;
 
@@ -429,6 +582,9 @@ namespace graphene { namespace chain {
          const witness_object& validate_block_header( uint32_t skip, const signed_block& next_block )const;
          const witness_object& _validate_block_header( const signed_block& next_block )const;
          void create_block_summary(const signed_block& next_block);
+         void record_state_digest( const signed_block& b );
+         /** digest of the operations in _applied_ops and their results, see trust_record */
+         fc::sha256 digest_applied_operations()const;
 
          //////////////////// db_update.cpp ////////////////////
          void update_global_dynamic_data( const signed_block& b );
@@ -483,7 +639,12 @@ namespace graphene { namespace chain {
           */
          vector<optional<operation_history_object> >  _applied_ops;
 
+         block_event_pipeline              _block_events;
+         block_generation_timings          _last_generation_timings;
+
          uint32_t                          _current_block_num    = 0;
+         /** id of the block being applied, computed once per block unless it is given by _trusted_block_id */
+         block_id_type                     _current_block_id;
          uint16_t                          _current_trx_in_block = 0;
          uint16_t                          _current_op_in_trx    = 0;
          uint16_t                          _current_virtual_op   = 0;
@@ -494,6 +655,39 @@ namespace graphene { namespace chain {
          uint64_t                          _total_voting_stake;
 
          flat_map<uint32_t,block_id_type>  _checkpoints;
+         /** blocks below a checkpoint extending the head block, applied when the checkpoint block arrives */
+         vector<signed_block>              _checkpointed_blocks;
+         bool                              _replay_required = false;
+
+         uint32_t                          _state_digest_history = 0;
+         std::deque<state_digest_record>   _state_digests;
+
+         uint32_t                          _block_log_retention = 0;
+         uint32_t                          _snapshot_interval   = 1;
+         uint32_t                          _last_snapshot_block = 0;
+
+         /** fees of the transactions of the block being applied, see pay_fee() */
+         struct fee_delta
+         {
+            share_type pending_fees;
+            share_type pending_vested_fees;
+         };
+         bool                                               _buffer_fees = false;
+         std::map<account_statistics_id_type, fee_delta>   _fee_deltas;
+         std::map<fba_accumulator_id_type, share_type>     _fba_fee_deltas;
+
+         mutable authorized_asset_cache    _authorized_asset_cache;
+
+         /** set while replaying a block that matched its trust record */
+         optional<block_id_type>           _trusted_block_id;
+         /** results of the last block applied with its merkle root checked, or replayed from a trust record */
+         optional<fc::sha256>              _applied_results_digest;
+         bool                              _read_only = false;
+         bool                              _flush_block_log = false;
+         /** where open_read_only() found the state, to start over when the other process left the chain */
+         fc::path                          _read_only_dir;
+         bool                              _read_only_load_state = false;
+         std::function<genesis_state_type()> _genesis_loader;
 
          node_property_object              _node_property_object;
          fc::hash_ctr_rng<secret_hash_type, 20> _random_number_generator;
@@ -519,3 +713,7 @@ namespace graphene { namespace chain {
    }
 
 } }
+
+FC_REFLECT( graphene::chain::state_digest_record, (block_num)(block_id)(digest)(indexes)(changed_objects) )
+FC_REFLECT( graphene::chain::block_generation_timings,
+            (reapply_pending)(merkle)(sign)(push)(transactions)(postponed_transactions) )
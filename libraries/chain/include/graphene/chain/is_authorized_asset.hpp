@@ -31,7 +31,10 @@ class database;
 
 namespace detail {
 
+/// computes the decision without the cache of the database
 bool _is_authorized_asset(const database& d, const account_object& acct, const asset_object& asset_obj);
+/// looks the decision up in the authorized_asset_cache of the database
+bool _cached_is_authorized_asset(const database& d, const account_object& acct, const asset_object& asset_obj);
 
 }
 
@@ -48,7 +51,7 @@ inline bool is_authorized_asset(const database& d, const account_object& acct, c
    if( fast_check )
       return true;
 
-   bool slow_check = detail::_is_authorized_asset( d, acct, asset_obj );
+   bool slow_check = detail::_cached_is_authorized_asset( d, acct, asset_obj );
    return slow_check;
 }
 
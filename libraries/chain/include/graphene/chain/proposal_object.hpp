@@ -72,6 +72,7 @@ class required_approval_index : public secondary_index
       virtual void object_removed( const object& obj ) override;
       virtual void about_to_modify( const object& before ) override{};
       virtual void object_modified( const object& after  ) override{};
+      virtual uint64_t memory_usage()const override;
 
       void remove( account_id_type a, proposal_id_type p );
 
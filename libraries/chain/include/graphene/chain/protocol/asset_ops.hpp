@@ -60,9 +60,9 @@ namespace graphene { namespace chain {
       /// is non-empty, then only accounts in whitelist_authorities are allowed to hold, use, or transfer the asset.
       flat_set<account_id_type> whitelist_authorities;
       /// A set of accounts which maintain blacklists to consult for this asset. If flags & white_list is set,
-      /// an account may only send, receive, trade, etc. in this asset if none of these accounts appears in
-      /// its account_object::blacklisting_accounts field. If the account is blacklisted, it may not transact in
-      /// this asset even if it is also whitelisted.
+      /// an account may only send, receive, trade, etc. in this asset if none of these accounts has blacklisted
+      /// it, see account_listing_object. If the account is blacklisted, it may not transact in this asset even if
+      /// it is also whitelisted.
       flat_set<account_id_type> blacklist_authorities;
 
       /** defines the assets that this asset may be traded against in the market */
@@ -162,7 +162,8 @@ namespace graphene { namespace chain {
       impl_fba_accumulator_object_type,
       impl_asset_dividend_data_type,
       impl_pending_dividend_payout_balance_for_holder_object_type,
-      impl_distributed_dividend_balance_data_type
+      impl_distributed_dividend_balance_data_type,
+      impl_account_listing_object_type
    };
 
    //typedef fc::unsigned_int            object_id_type;
@@ -225,6 +226,7 @@ namespace graphene { namespace chain {
    class tournament_details_object;
    class asset_dividend_data_object;
    class pending_dividend_payout_balance_for_holder_object;
+   class account_listing_object;
 
    typedef object_id< implementation_ids, impl_global_property_object_type,  global_property_object>                    global_property_id_type;
    typedef object_id< implementation_ids, impl_dynamic_global_property_object_type,  dynamic_global_property_object>    dynamic_global_property_id_type;
@@ -247,6 +249,7 @@ namespace graphene { namespace chain {
    typedef object_id< implementation_ids, impl_special_authority_object_type, special_authority_object >                special_authority_id_type;
    typedef object_id< implementation_ids, impl_buyback_object_type, buyback_object >                                    buyback_id_type;
    typedef object_id< implementation_ids, impl_fba_accumulator_object_type, fba_accumulator_object >                    fba_accumulator_id_type;
+   typedef object_id< implementation_ids, impl_account_listing_object_type, account_listing_object >                    account_listing_id_type;
 
    typedef fc::array<char, GRAPHENE_MAX_ASSET_SYMBOL_LENGTH>    symbol_type;
    typedef fc::ripemd160                                        block_id_type;
@@ -388,6 +391,7 @@ FC_REFLECT_ENUM( graphene::chain::impl_object_type,
                  (impl_asset_dividend_data_type)
                  (impl_pending_dividend_payout_balance_for_holder_object_type)
                  (impl_distributed_dividend_balance_data_type)
+                 (impl_account_listing_object_type)
                )
 
 FC_REFLECT_TYPENAME( graphene::chain::share_type )
@@ -420,6 +424,7 @@ FC_REFLECT_TYPENAME( graphene::chain::budget_record_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::special_authority_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::buyback_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::fba_accumulator_id_type )
+FC_REFLECT_TYPENAME( graphene::chain::account_listing_id_type )
 FC_REFLECT_TYPENAME( graphene::chain::tournament_details_id_type )
 
 FC_REFLECT( graphene::chain::void_t, )
@@ -219,6 +219,7 @@ namespace graphene { namespace chain {
          virtual void object_removed( const object& obj ) override;
          virtual void about_to_modify( const object& before ) override;
          virtual void object_modified( const object& after  ) override;
+         virtual uint64_t memory_usage()const override;
 
          /** given an account, map it to the set of tournaments in which that account is registered as a player */
          map< account_id_type, flat_set<tournament_id_type> > account_to_joined_tournaments;
@@ -22,6 +22,8 @@
  * THE SOFTWARE.
  */
 
+#include <graphene/chain/account_listing_object.hpp>
+#include <graphene/chain/authorized_asset_cache.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 
@@ -44,9 +46,12 @@ bool _is_authorized_asset(
       // must still pass other checks even if it is in allowed_assets
    }
 
-   for( const auto id : acct.blacklisting_accounts )
+   // the authority lists of an asset are short, so they are looked up in the listings of the account
+   const auto& listings = d.get_index_type<account_listing_index>().indices().get<by_listed_account>();
+   for( const auto id : asset_obj.options.blacklist_authorities )
    {
-      if( asset_obj.options.blacklist_authorities.find(id) != asset_obj.options.blacklist_authorities.end() )
+      auto itr = listings.find( boost::make_tuple( acct.get_id(), id ) );
+      if( itr != listings.end() && itr->is_blacklisted() )
          return false;
    }
 
@@ -56,15 +61,86 @@ bool _is_authorized_asset(
          return true;
    }
 
-   for( const auto id : acct.whitelisting_accounts )
+   for( const auto id : asset_obj.options.whitelist_authorities )
    {
-      if( asset_obj.options.whitelist_authorities.find(id) != asset_obj.options.whitelist_authorities.end() )
+      auto itr = listings.find( boost::make_tuple( acct.get_id(), id ) );
+      if( itr != listings.end() && itr->is_whitelisted() )
          return true;
    }
 
    return false;
 }
 
+bool _cached_is_authorized_asset(
+   const database& d,
+   const account_object& acct,
+   const asset_object& asset_obj)
+{
+   return d.get_authorized_asset_cache().is_authorized( d, acct, asset_obj );
+}
+
 } // detail
 
+bool authorized_asset_cache::is_authorized( const database& d, const account_object& acct, const asset_object& asset_obj )
+{
+   const bool after_hardfork_415 = d.head_block_time() > HARDFORK_415_TIME;
+   const std::pair<uint64_t,uint64_t> key( acct.id.instance(), asset_obj.id.instance() );
+
+   auto itr = _decisions.find( key );
+   if( itr != _decisions.end() && itr->second.after_hardfork_415 == after_hardfork_415 )
+   {
+      auto account_change = _account_changes.find( key.first );
+      auto asset_change = _asset_changes.find( key.second );
+      if( ( account_change == _account_changes.end() || account_change->second < itr->second.computed_at )
+          && ( asset_change == _asset_changes.end() || asset_change->second < itr->second.computed_at ) )
+         return itr->second.authorized;
+   }
+
+   if( _decisions.size() >= max_size || _account_changes.size() + _asset_changes.size() >= max_size )
+   {
+      clear();
+      itr = _decisions.end();
+   }
+
+   decision result;
+   result.computed_at = ++_clock;
+   result.after_hardfork_415 = after_hardfork_415;
+   result.authorized = detail::_is_authorized_asset( d, acct, asset_obj );
+   if( itr == _decisions.end() )
+      _decisions.emplace( key, result );
+   else
+      itr->second = result;
+   return result.authorized;
+}
+
+void authorized_asset_cache::account_changed( account_id_type id )
+{
+   // nothing to invalidate as long as no decision was made
+   if( !_decisions.empty() )
+      _account_changes[ id.instance.value ] = ++_clock;
+}
+
+void authorized_asset_cache::asset_changed( asset_id_type id )
+{
+   if( !_decisions.empty() )
+      _asset_changes[ id.instance.value ] = ++_clock;
+}
+
+void authorized_asset_cache::clear()
+{
+   _decisions.clear();
+   _account_changes.clear();
+   _asset_changes.clear();
+}
+
+void authorized_asset_observer::changed( const object& obj )
+{
+   if( obj.id.is<account_id_type>() )
+      _cache.account_changed( obj.id );
+   else if( obj.id.is<asset_id_type>() )
+      _cache.asset_changed( obj.id );
+   else if( obj.id.is<account_listing_id_type>() )
+      _cache.account_changed( static_cast<const account_listing_object&>( obj ).listed_account );
+}
+
 } } // graphene::chain
@@ -77,6 +77,14 @@ void required_approval_index::remove( account_id_type a, proposal_id_type p )
     }
 }
 
+uint64_t required_approval_index::memory_usage()const
+{
+    uint64_t result = approximate_tree_memory( _account_to_proposals );
+    for( const auto& item : _account_to_proposals )
+       result += approximate_tree_memory( item.second );
+    return result;
+}
+
 void required_approval_index::object_removed( const object& obj )
 {
     assert( dynamic_cast<const proposal_object*>(&obj) );
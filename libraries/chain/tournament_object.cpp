@@ -713,6 +713,14 @@ namespace graphene { namespace chain {
          }
       }
    }
+
+   uint64_t tournament_players_index::memory_usage()const
+   {
+      uint64_t result = approximate_tree_memory(account_to_joined_tournaments);
+      for (const auto& item : account_to_joined_tournaments)
+         result += item.second.capacity() * sizeof(tournament_id_type);
+      return result;
+   }
 } } // graphene::chain
 
 namespace fc { 
@@ -119,6 +119,9 @@ namespace graphene { namespace db {
 
          size_t size()const{ return _objects.size(); }
 
+         /** objects are stored inline in the vector */
+         static size_t node_overhead() { return 0; }
+
          void resize( uint32_t s ) { 
             _objects.resize(s); 
             for( uint32_t i = 0; i < s; ++i )
@@ -23,10 +23,12 @@
  */
 #pragma once
 #include <graphene/db/index.hpp>
+#include <graphene/db/memory_pool.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
+#include <boost/mpl/size.hpp>
 
 namespace graphene { namespace chain {
 
@@ -34,6 +36,23 @@ namespace graphene { namespace chain {
    using namespace boost::multi_index;
 
    struct by_id{};
+
+   /**
+    *  Rebuilds a multi_index_container type so that its nodes are allocated from the memory pools of its
+    *  value type, see graphene::db::pool_allocator.
+    */
+   template<typename MultiIndexType>
+   struct pooled_multi_index
+   {
+#ifdef GRAPHENE_DISABLE_MEMORY_POOLS
+      typedef MultiIndexType type;
+#else
+      typedef multi_index_container< typename MultiIndexType::value_type,
+                                     typename MultiIndexType::index_specifier_type_list,
+                                     graphene::db::pool_allocator< typename MultiIndexType::value_type > > type;
+#endif
+   };
+
    /**
     *  Almost all objects can be tracked and managed via a boost::multi_index container that uses
     *  an unordered_unique key on the object ID.  This template class adapts the generic index interface
@@ -43,8 +62,8 @@ namespace graphene { namespace chain {
    class generic_index : public index
    {
       public:
-         typedef MultiIndexType index_type;
-         typedef ObjectType     object_type;
+         typedef typename pooled_multi_index<MultiIndexType>::type index_type;
+         typedef ObjectType                                         object_type;
 
          virtual const object& insert( object&& obj )override
          {
@@ -95,6 +114,14 @@ namespace graphene { namespace chain {
 
          const index_type& indices()const { return _indices; }
 
+         size_t size()const { return _indices.size(); }
+
+         /** approximate per-object overhead of the multi_index nodes, three pointers per ordered or hashed index */
+         static size_t node_overhead()
+         {
+            return boost::mpl::size<typename index_type::index_type_list>::value * 3 * sizeof(void*);
+         }
+
          virtual fc::uint128 hash()const override {
             fc::uint128 result;
             for( const auto& ptr : _indices )
@@ -49,6 +49,44 @@ namespace graphene { namespace db {
          virtual void on_modify( const object& obj ){}
    };
 
+   /**
+    * @brief approximate object count and memory usage of a primary index
+    *
+    * memory_bytes covers the objects themselves and the container nodes that hold them, while
+    * packed_bytes is extrapolated from a sample of serialized objects and therefore also reflects
+    * heap data owned by the objects' members.
+    */
+   struct index_statistics
+   {
+      uint8_t  space_id = 0;
+      uint8_t  type_id = 0;
+      string   type_name;
+      uint64_t object_count = 0;
+      uint64_t packed_bytes = 0;
+      uint64_t memory_bytes = 0;
+      uint64_t secondary_index_bytes = 0;
+   };
+
+   /**
+    * @brief the state digest of a single index, the sum of the hashes of its objects
+    */
+   struct index_digest
+   {
+      uint8_t     space_id = 0;
+      uint8_t     type_id = 0;
+      fc::uint128 digest;
+   };
+
+   /**
+    *  @return approximate heap usage of a node based container such as std::map or std::set,
+    *  assuming three pointers and a color per tree node
+    */
+   template<typename Container>
+   uint64_t approximate_tree_memory( const Container& c )
+   {
+      return c.size() * ( sizeof(typename Container::value_type) + 4 * sizeof(void*) );
+   }
+
    /**
     *  @class index
     *  @brief abstract base class for accessing objects indexed in various ways.
@@ -78,6 +116,9 @@ namespace graphene { namespace db {
          virtual void           set_next_id( object_id_type id ) = 0;
 
          virtual const object&  load( const std::vector<char>& data ) = 0;
+
+         /** unpacks an object of this index's type without inserting it into the index */
+         virtual unique_ptr<object> unpack_object( const std::vector<char>& data )const = 0;
          /**
           *  Polymorphically insert by moving an object into the index.
           *  this should throw if the object is already in the database.
@@ -128,10 +169,24 @@ namespace graphene { namespace db {
 
          virtual void               inspect_all_objects(std::function<void(const object&)> inspector)const = 0;
          virtual fc::uint128        hash()const = 0;
+
+         /**
+          *  While enabled, the sum of the hashes of all objects is maintained on every create, modify and
+          *  remove, so that it always equals hash() without having to serialize the whole index.  Enabling
+          *  computes the initial value with hash().
+          */
+         virtual void               enable_state_digest( bool enable ) = 0;
+         virtual fc::uint128        state_digest()const = 0;
          virtual void               add_observer( const shared_ptr<index_observer>& ) = 0;
 
          virtual void               object_from_variant( const fc::variant& var, object& obj )const = 0;
          virtual void               object_default( object& obj )const = 0;
+
+         /**
+          *  Packs about max_samples objects, looked up by evenly spaced ids, to estimate the serialized size of
+          *  the index, so that it is cheap enough to be polled periodically.
+          */
+         virtual index_statistics   get_statistics( uint32_t max_samples = 1000 )const = 0;
    };
 
    class secondary_index
@@ -142,6 +197,12 @@ namespace graphene { namespace db {
          virtual void object_removed( const object& obj ){};
          virtual void about_to_modify( const object& before ){};
          virtual void object_modified( const object& after  ){};
+
+         /**
+          *  @return approximate heap usage of the data held by this secondary index, implementations may walk all
+          *  of their data, see primary_index::get_statistics()
+          */
+         virtual uint64_t memory_usage()const { return 0; }
    };
 
    /**
@@ -164,10 +225,18 @@ namespace graphene { namespace db {
          /** called just after obj is modified */
          void on_modify( const object& obj );
 
-         template<typename T>
-         void add_secondary_index()
+         /** adds obj to the state digest, called just after obj is added or modified */
+         void digest_add( const object& obj );
+
+         /** removes obj from the state digest, called just before obj is removed or modified */
+         void digest_remove( const object& obj );
+
+         template<typename T, typename... Args>
+         T* add_secondary_index( Args&&... args )
          {
-            _sindex.emplace_back( new T() );
+            T* result = new T( std::forward<Args>(args)... );
+            _sindex.emplace_back( result );
+            return result;
          }
 
          template<typename T>
@@ -181,9 +250,23 @@ namespace graphene { namespace db {
             FC_THROW_EXCEPTION( fc::assert_exception, "invalid index type" );
          }
 
+         /** @return the secondary index of type T, nullptr when none was added */
+         template<typename T>
+         const T* find_secondary_index()const
+         {
+            for( const auto& item : _sindex )
+            {
+               const T* result = dynamic_cast<const T*>(item.get());
+               if( result != nullptr ) return result;
+            }
+            return nullptr;
+         }
+
       protected:
          vector< shared_ptr<index_observer> >   _observers;
          vector< unique_ptr<secondary_index> >  _sindex;
+         bool                                   _digest_enabled = false;
+         fc::uint128                            _digest;
 
       private:
          object_database& _db;
@@ -263,9 +346,25 @@ namespace graphene { namespace db {
             const auto& result = DerivedIndex::insert( fc::raw::unpack<object_type>( data ) );
             for( const auto& item : _sindex )
                item->object_inserted( result );
+            if( _digest_enabled ) digest_add( result );
             return result;
          }
 
+         /** used by the undo database to put back removed objects, secondary indexes learn about them like on load */
+         virtual const object&  insert( object&& obj )override
+         {
+            const auto& result = DerivedIndex::insert( std::move(obj) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            if( _digest_enabled ) digest_add( result );
+            return result;
+         }
+
+
+         virtual unique_ptr<object> unpack_object( const std::vector<char>& data )const override
+         {
+            return unique_ptr<object>( new object_type( fc::raw::unpack<object_type>( data ) ) );
+         }
 
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
@@ -273,6 +372,7 @@ namespace graphene { namespace db {
             for( const auto& item : _sindex )
                item->object_inserted( result );
             on_add( result );
+            if( _digest_enabled ) digest_add( result );
             return result;
          }
 
@@ -281,6 +381,7 @@ namespace graphene { namespace db {
             for( const auto& item : _sindex )
                item->object_removed( obj );
             on_remove(obj);
+            if( _digest_enabled ) digest_remove( obj );
             DerivedIndex::remove(obj);
          }
 
@@ -289,7 +390,9 @@ namespace graphene { namespace db {
             save_undo( obj );
             for( const auto& item : _sindex )
                item->about_to_modify( obj );
+            if( _digest_enabled ) digest_remove( obj );
             DerivedIndex::modify( obj, m );
+            if( _digest_enabled ) digest_add( obj );
             for( const auto& item : _sindex )
                item->object_modified( obj );
             on_modify( obj );
@@ -318,8 +421,53 @@ namespace graphene { namespace db {
             obj.id = id;
          }
 
+         virtual void enable_state_digest( bool enable )override
+         {
+            _digest = enable ? this->hash() : fc::uint128();
+            _digest_enabled = enable;
+         }
+
+         virtual fc::uint128 state_digest()const override
+         {
+            return _digest;
+         }
+
+         virtual index_statistics get_statistics( uint32_t max_samples = 1000 )const override
+         {
+            index_statistics stats;
+            stats.space_id  = object_type::space_id;
+            stats.type_id   = object_type::type_id;
+            stats.type_name = fc::get_typename<object_type>::name();
+
+            // looks up evenly spaced ids instead of walking the index, removed objects leave gaps in the sample
+            stats.object_count = DerivedIndex::size();
+            const uint64_t next_instance = _next_id.instance();
+            const uint64_t stride = std::max<uint64_t>( 1, next_instance / std::max<uint32_t>( 1, max_samples ) );
+            uint64_t sampled_count = 0;
+            uint64_t sampled_bytes = 0;
+            for( uint64_t instance = 0; instance < next_instance; instance += stride )
+            {
+               const object* o = this->find( object_id_type( object_type::space_id, object_type::type_id, instance ) );
+               if( o != nullptr )
+               {
+                  sampled_bytes += fc::raw::pack_size( static_cast<const object_type&>(*o) );
+                  ++sampled_count;
+               }
+            }
+            if( sampled_count > 0 )
+               stats.packed_bytes = sampled_bytes * stats.object_count / sampled_count;
+            stats.memory_bytes = stats.object_count * ( sizeof(object_type) + DerivedIndex::node_overhead() );
+            for( const auto& item : _sindex )
+               stats.secondary_index_bytes += item->memory_usage();
+            return stats;
+         }
+
       private:
          object_id_type _next_id;
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::index_digest, (space_id)(type_id)(digest) )
+FC_REFLECT( graphene::db::index_statistics,
+            (space_id)(type_id)(type_name)(object_count)(packed_bytes)(memory_bytes)(secondary_index_bytes) )
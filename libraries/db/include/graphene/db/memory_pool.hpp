@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <fc/reflect/reflect.hpp>
+
+#include <boost/core/demangle.hpp>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace graphene { namespace db {
+
+   struct memory_pool_statistics
+   {
+      std::string name;
+      uint64_t    element_size = 0;
+      /** number of elements obtained from the heap, whether in use or not */
+      uint64_t    capacity = 0;
+      uint64_t    in_use = 0;
+      uint64_t    peak_in_use = 0;
+      /** number of allocations served since startup */
+      uint64_t    allocations = 0;
+   };
+
+   /**
+    *  @class memory_pool
+    *  @brief hands out fixed size elements carved from large chunks
+    *
+    *  The nodes of the multi_index containers holding the chain objects are created and destroyed at a
+    *  high rate.  Serving them from one pool per type keeps objects of the same type together and keeps
+    *  them from fragmenting the global heap.
+    *
+    *  Every thread allocates from and frees to a free list of its own without locking, elements move
+    *  between it and the shared free list of the pool in batches.  Freed elements are kept for reuse until
+    *  release_free_chunks() returns the chunks which are entirely free to the heap.
+    */
+   class memory_pool
+   {
+      public:
+         memory_pool( std::string name, size_t element_size, size_t alignment );
+         /** no other thread may still hold elements of the pool in its free list */
+         ~memory_pool();
+
+         void* allocate();
+         void  deallocate( void* p );
+
+         /**
+          *  Returns the chunks whose elements are all on the shared free list, or on the free list of the
+          *  calling thread, to the heap.
+          *  @return the number of bytes released
+          */
+         uint64_t release_free_chunks();
+
+         memory_pool_statistics get_statistics()const;
+
+         struct free_element { free_element* next; };
+         /** the free list of one thread */
+         struct thread_cache
+         {
+            free_element*  head = nullptr;
+            size_t         count = 0;
+         };
+         /** moves all but @p keep elements of a thread's free list to the shared free list */
+         void drain( thread_cache& cache, size_t keep );
+
+      private:
+         thread_cache& local_cache();
+         void refill( thread_cache& cache );
+         void grow();
+
+         /** the position of the pool's free list in the free lists of every thread */
+         const size_t                _slot;
+         mutable std::mutex          _mutex;
+         const std::string           _name;
+         size_t                      _element_size;
+         size_t                      _elements_per_chunk;
+         std::vector<char*>          _chunks;
+         free_element*               _free = nullptr;
+         std::atomic<uint64_t>       _in_use;
+         std::atomic<uint64_t>       _peak_in_use;
+         std::atomic<uint64_t>       _allocations;
+   };
+
+   /** @return the statistics of every pool created so far */
+   std::vector<memory_pool_statistics> get_memory_pool_statistics();
+
+   /**
+    *  Calls memory_pool::release_free_chunks() on every pool created so far.
+    *  @return the number of bytes released
+    */
+   uint64_t release_memory_pools();
+
+   namespace detail {
+      void register_memory_pool( memory_pool* pool );
+
+      template<typename T, typename Tag>
+      std::string memory_pool_name()
+      {
+         std::string name = boost::core::demangle( typeid(Tag).name() );
+         if( !std::is_same<T,Tag>::value )
+            name += " node";
+         return name;
+      }
+   }
+
+   /**
+    *  @return the pool for elements of type T, named after Tag.  Pools are intentionally never destroyed
+    *  so that objects released during static destruction can still be returned to them.
+    */
+   template<typename T, typename Tag = T>
+   memory_pool& get_memory_pool()
+   {
+      static memory_pool* pool = []() {
+         auto result = new memory_pool( detail::memory_pool_name<T,Tag>(), sizeof(T), alignof(T) );
+         detail::register_memory_pool( result );
+         return result;
+      }();
+      return *pool;
+   }
+
+   /**
+    *  @class pool_allocator
+    *  @brief an allocator serving single elements from get_memory_pool<T,Tag>()
+    *
+    *  Containers rebind the allocator to their node types, so a multi_index_container of objects gets one
+    *  pool per node type, all of them reported under the name of Tag.  Requests for more than one element,
+    *  such as the bucket arrays of hashed indices, go to the global heap.
+    */
+   template<typename T, typename Tag = T>
+   class pool_allocator
+   {
+      public:
+         typedef T                 value_type;
+         typedef T*                pointer;
+         typedef const T*          const_pointer;
+         typedef T&                reference;
+         typedef const T&          const_reference;
+         typedef std::size_t       size_type;
+         typedef std::ptrdiff_t    difference_type;
+
+         template<typename U>
+         struct rebind { typedef pool_allocator<U,Tag> other; };
+
+         pool_allocator() {}
+         template<typename U>
+         pool_allocator( const pool_allocator<U,Tag>& ) {}
+
+         pointer allocate( size_type n, const void* = nullptr )
+         {
+            if( n == 1 )
+               return static_cast<pointer>( get_memory_pool<T,Tag>().allocate() );
+            return static_cast<pointer>( ::operator new( n * sizeof(T) ) );
+         }
+
+         void deallocate( pointer p, size_type n )
+         {
+            if( n == 1 )
+               get_memory_pool<T,Tag>().deallocate( p );
+            else
+               ::operator delete( p );
+         }
+
+         template<typename U, typename... Args>
+         void construct( U* p, Args&&... args ) { ::new( (void*)p ) U( std::forward<Args>(args)... ); }
+         template<typename U>
+         void destroy( U* p ) { p->~U(); }
+
+         pointer       address( reference r )const       { return &r; }
+         const_pointer address( const_reference r )const { return &r; }
+         size_type     max_size()const { return size_type(-1) / sizeof(T); }
+
+         template<typename U>
+         bool operator == ( const pool_allocator<U,Tag>& )const { return true; }
+         template<typename U>
+         bool operator != ( const pool_allocator<U,Tag>& )const { return false; }
+   };
+
+} } // graphene::db
+
+FC_REFLECT( graphene::db::memory_pool_statistics,
+            (name)(element_size)(capacity)(in_use)(peak_in_use)(allocations) )
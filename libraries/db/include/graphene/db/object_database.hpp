@@ -50,7 +50,11 @@ namespace graphene { namespace db {
           * Saves the complete state of the object_database to disk, this could take a while
           */
          void flush();
+         /** Saves the complete state into dir instead of the object_database directory of the data dir */
+         void flush( const fc::path& dir );
          void wipe(const fc::path& data_dir); // remove from disk
+         /** removes every object from memory, the indexes and their observers stay registered */
+         void clear_objects();
          void close();
 
          template<typename T, typename F>
@@ -77,6 +81,26 @@ namespace graphene { namespace db {
          const index&  get_index(object_id_type id)const { return get_index(id.space(),id.type()); }
          /// @}
 
+         /**
+          *  @name State digest
+          *  An order independent digest of the whole state, kept up to date by every index on create,
+          *  modify and remove.  Two databases holding the same objects have the same digest regardless of
+          *  the order in which the objects were created.  It is disabled by default because it costs two
+          *  serializations per modification.
+          *  @{
+          */
+         void                   enable_state_digest( bool enable );
+         bool                   state_digest_enabled()const { return _state_digest_enabled; }
+         fc::uint128            get_state_digest()const;
+         vector<index_digest>   get_index_digests()const;
+         /** ids of the objects created, modified or removed since the last call to clear_touched_objects() */
+         const std::unordered_set<object_id_type>& touched_objects()const { return _touched_objects; }
+         void                   clear_touched_objects() { _touched_objects.clear(); }
+         /// @}
+
+         /** @return statistics of every registered index, see index::get_statistics() */
+         vector<index_statistics> get_index_statistics( uint32_t max_samples = 1000 )const;
+
          const object& get_object( object_id_type id )const;
          const object* find_object( object_id_type id )const;
 
@@ -135,6 +159,8 @@ namespace graphene { namespace db {
                 _index[ObjectType::space_id].resize( 255 );
             assert(!_index[ObjectType::space_id][ObjectType::type_id]);
             unique_ptr<index> indexptr( new IndexType(*this) );
+            if( _state_digest_enabled )
+               indexptr->enable_state_digest( true );
             _index[ObjectType::space_id][ObjectType::type_id] = std::move(indexptr);
             return static_cast<IndexType*>(_index[ObjectType::space_id][ObjectType::type_id].get());
          }
@@ -163,9 +189,12 @@ namespace graphene { namespace db {
          void save_undo( const object& obj );
          void save_undo_add( const object& obj );
          void save_undo_remove( const object& obj );
+         void touch_object( object_id_type id ) { _touched_objects.insert( id ); }
 
          fc::path                                                  _data_dir;
          vector< vector< unique_ptr<index> > >                     _index;
+         bool                                                      _state_digest_enabled = false;
+         std::unordered_set<object_id_type>                        _touched_objects;
    };
 
 } } // graphene::db
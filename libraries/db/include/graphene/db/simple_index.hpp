@@ -101,7 +101,8 @@ namespace graphene { namespace db {
          virtual fc::uint128 hash()const override {
             fc::uint128 result;
             for( const auto& ptr : _objects )
-               result += ptr->hash();
+               if( ptr.get() )
+                  result += ptr->hash();
 
             return result;
          }
@@ -142,6 +143,9 @@ namespace graphene { namespace db {
          const_iterator end()const   { return const_iterator(_objects, _objects.end());   }
 
          size_t size()const { return _objects.size(); }
+
+         /** each object is heap allocated and referenced by a slot in the vector */
+         static size_t node_overhead() { return sizeof(unique_ptr<object>); }
       private:
          vector< unique_ptr<object> > _objects;
    };
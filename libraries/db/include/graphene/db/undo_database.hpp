@@ -40,6 +40,33 @@ namespace graphene { namespace db {
       unordered_map<object_id_type, unique_ptr<object> > removed;
    };
 
+   /**
+    * @brief the serialized form of an undo_state
+    *
+    * Objects are kept in their packed form and are unpacked by the index which owns their id, so
+    * that the undo history can be written to disk and restored after a restart.
+    */
+   struct packed_undo_state
+   {
+      vector< std::pair<object_id_type, vector<char> > >  old_values;
+      vector< std::pair<object_id_type, object_id_type> > old_index_next_ids;
+      vector< object_id_type >                            new_ids;
+      vector< std::pair<object_id_type, vector<char> > >  removed;
+   };
+
+   /**
+    * @brief size of the undo history, copied_objects counts the old and removed objects kept for
+    * undoing and packed_bytes their serialized size
+    */
+   struct undo_statistics
+   {
+      uint32_t depth = 0;
+      uint32_t max_depth = 0;
+      uint64_t copied_objects = 0;
+      uint64_t new_objects = 0;
+      uint64_t packed_bytes = 0;
+   };
+
 
    /**
     * @class undo_database
@@ -126,12 +153,34 @@ namespace graphene { namespace db {
           */
          void pop_commit();
 
+         /**
+          *  Drops every state on the undo stack.  Used when changes are about to be applied without
+          *  undo tracking, after which none of the older states can be undone any more.
+          */
+         void discard_history();
+
          std::size_t size()const { return _stack.size(); }
          void set_max_size(size_t new_max_size) { _max_size = new_max_size; }
          size_t max_size()const { return _max_size; }
 
          const undo_state& head()const;
 
+         /** packs one copied object of at most max_samples undo states to estimate the size of the copies */
+         undo_statistics get_statistics( uint32_t max_samples = 1000 )const;
+
+         /**
+          *  Serializes every state on the undo stack, oldest first, so that the history can be
+          *  persisted and later restored with unpack_stack().
+          */
+         vector<packed_undo_state> pack_stack()const;
+
+         /**
+          *  Replaces the undo stack with one produced by pack_stack().  The object database must
+          *  already hold the state that was current when the stack was packed, and there may
+          *  not be any active sessions.
+          */
+         void unpack_stack( const vector<packed_undo_state>& states );
+
       private:
          void undo();
          void merge();
@@ -145,3 +194,6 @@ namespace graphene { namespace db {
    };
 
 } } // graphene::db
+
+FC_REFLECT( graphene::db::packed_undo_state, (old_values)(old_index_next_ids)(new_ids)(removed) )
+FC_REFLECT( graphene::db::undo_statistics, (depth)(max_depth)(copied_objects)(new_objects)(packed_bytes) )
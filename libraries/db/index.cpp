@@ -35,6 +35,18 @@ namespace graphene { namespace db {
       for( auto ob : _observers ) ob->on_add( obj );
    }
 
+   void base_primary_index::digest_add( const object& obj )
+   {
+      _digest += obj.hash();
+      _db.touch_object( obj.id );
+   }
+
+   void base_primary_index::digest_remove( const object& obj )
+   {
+      _digest -= obj.hash();
+      _db.touch_object( obj.id );
+   }
+
    void base_primary_index::on_remove( const object& obj )
    { _db.save_undo_remove( obj ); for( auto ob : _observers ) ob->on_remove( obj ); }
 
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <fc/io/raw.hpp>
+#include <graphene/db/memory_pool.hpp>
+
+#include <algorithm>
+#include <functional>
+
+namespace graphene { namespace db {
+
+   namespace detail {
+      /** elements moved between the free list of a thread and the shared free list at a time */
+      static const size_t batch_size = 64;
+
+      static std::mutex& registry_mutex()
+      {
+         static std::mutex* m = new std::mutex;
+         return *m;
+      }
+      static std::vector<memory_pool*>& registry()
+      {
+         static std::vector<memory_pool*>* pools = new std::vector<memory_pool*>;
+         return *pools;
+      }
+
+      void register_memory_pool( memory_pool* pool )
+      {
+         std::lock_guard<std::mutex> lock( registry_mutex() );
+         registry().push_back( pool );
+      }
+
+      static std::atomic<size_t> next_slot( 0 );
+
+      /** the free lists of one thread, returned to their pools when the thread exits */
+      struct thread_caches
+      {
+         std::vector< std::pair<memory_pool*, memory_pool::thread_cache> > slots;
+
+         ~thread_caches()
+         {
+            for( auto& slot : slots )
+               if( slot.first != nullptr )
+                  slot.first->drain( slot.second, 0 );
+         }
+      };
+      static thread_local thread_caches caches;
+   }
+
+   std::vector<memory_pool_statistics> get_memory_pool_statistics()
+   {
+      std::vector<memory_pool_statistics> result;
+      std::lock_guard<std::mutex> lock( detail::registry_mutex() );
+      result.reserve( detail::registry().size() );
+      for( const auto pool : detail::registry() )
+         result.push_back( pool->get_statistics() );
+      return result;
+   }
+
+   uint64_t release_memory_pools()
+   {
+      uint64_t result = 0;
+      std::lock_guard<std::mutex> lock( detail::registry_mutex() );
+      for( const auto pool : detail::registry() )
+         result += pool->release_free_chunks();
+      return result;
+   }
+
+   memory_pool::memory_pool( std::string name, size_t element_size, size_t alignment )
+   : _slot( detail::next_slot++ ), _name( std::move(name) ), _in_use( 0 ), _peak_in_use( 0 ), _allocations( 0 )
+   {
+      // every element must be able to hold a free list link and keep the next element aligned
+      alignment = std::max( alignment, alignof(free_element) );
+      element_size = std::max( element_size, sizeof(free_element) );
+      _element_size = ( element_size + alignment - 1 ) / alignment * alignment;
+      _elements_per_chunk = std::max<size_t>( 16, ( 64 * 1024 ) / _element_size );
+   }
+
+   memory_pool::~memory_pool()
+   {
+      auto& slots = detail::caches.slots;
+      if( _slot < slots.size() )
+         slots[_slot] = std::make_pair( nullptr, thread_cache() );
+      for( char* chunk : _chunks )
+         ::operator delete( chunk );
+   }
+
+   memory_pool::thread_cache& memory_pool::local_cache()
+   {
+      auto& slots = detail::caches.slots;
+      if( _slot >= slots.size() )
+         slots.resize( _slot + 1, std::make_pair( nullptr, thread_cache() ) );
+      slots[_slot].first = this;
+      return slots[_slot].second;
+   }
+
+   void memory_pool::grow()
+   {
+      char* chunk = static_cast<char*>( ::operator new( _elements_per_chunk * _element_size ) );
+      _chunks.push_back( chunk );
+      for( size_t i = _elements_per_chunk; i > 0; --i )
+      {
+         auto element = reinterpret_cast<free_element*>( chunk + ( i - 1 ) * _element_size );
+         element->next = _free;
+         _free = element;
+      }
+   }
+
+   void memory_pool::refill( thread_cache& cache )
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      while( cache.count < detail::batch_size )
+      {
+         if( _free == nullptr )
+            grow();
+         free_element* element = _free;
+         _free = element->next;
+         element->next = cache.head;
+         cache.head = element;
+         ++cache.count;
+      }
+   }
+
+   void memory_pool::drain( thread_cache& cache, size_t keep )
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      while( cache.count > keep )
+      {
+         free_element* element = cache.head;
+         cache.head = element->next;
+         element->next = _free;
+         _free = element;
+         --cache.count;
+      }
+   }
+
+   void* memory_pool::allocate()
+   {
+      thread_cache& cache = local_cache();
+      if( cache.head == nullptr )
+         refill( cache );
+      free_element* result = cache.head;
+      cache.head = result->next;
+      --cache.count;
+
+      _allocations.fetch_add( 1, std::memory_order_relaxed );
+      const uint64_t in_use = _in_use.fetch_add( 1, std::memory_order_relaxed ) + 1;
+      uint64_t peak = _peak_in_use.load( std::memory_order_relaxed );
+      while( in_use > peak && !_peak_in_use.compare_exchange_weak( peak, in_use, std::memory_order_relaxed ) )
+         ;
+      return result;
+   }
+
+   void memory_pool::deallocate( void* p )
+   {
+      if( p == nullptr )
+         return;
+      thread_cache& cache = local_cache();
+      auto element = static_cast<free_element*>( p );
+      element->next = cache.head;
+      cache.head = element;
+      ++cache.count;
+      _in_use.fetch_sub( 1, std::memory_order_relaxed );
+      // a thread which frees more than it allocates hands the surplus to the others
+      if( cache.count >= 2 * detail::batch_size )
+         drain( cache, detail::batch_size );
+   }
+
+   uint64_t memory_pool::release_free_chunks()
+   {
+      drain( local_cache(), 0 );
+      std::lock_guard<std::mutex> lock( _mutex );
+      if( _chunks.empty() )
+         return 0;
+
+      std::sort( _chunks.begin(), _chunks.end(), std::less<const char*>() );
+      auto chunk_of = [this]( const free_element* e ) -> size_t {
+         auto itr = std::upper_bound( _chunks.begin(), _chunks.end(), reinterpret_cast<const char*>( e ),
+                                      std::less<const char*>() );
+         return ( itr - _chunks.begin() ) - 1;
+      };
+      std::vector<size_t> free_count( _chunks.size(), 0 );
+      for( const free_element* e = _free; e != nullptr; e = e->next )
+         ++free_count[ chunk_of( e ) ];
+
+      // the free list is rebuilt from the elements of the chunks which are kept
+      free_element* kept = nullptr;
+      for( free_element* e = _free; e != nullptr; )
+      {
+         free_element* next = e->next;
+         if( free_count[ chunk_of( e ) ] != _elements_per_chunk )
+         {
+            e->next = kept;
+            kept = e;
+         }
+         e = next;
+      }
+      _free = kept;
+
+      uint64_t released = 0;
+      std::vector<char*> chunks;
+      for( size_t i = 0; i < _chunks.size(); ++i )
+      {
+         if( free_count[i] == _elements_per_chunk )
+         {
+            ::operator delete( _chunks[i] );
+            released += _elements_per_chunk * _element_size;
+         }
+         else
+            chunks.push_back( _chunks[i] );
+      }
+      _chunks.swap( chunks );
+      return released;
+   }
+
+   memory_pool_statistics memory_pool::get_statistics()const
+   {
+      std::lock_guard<std::mutex> lock( _mutex );
+      memory_pool_statistics stats;
+      stats.name         = _name;
+      stats.element_size = _element_size;
+      stats.capacity     = _chunks.size() * _elements_per_chunk;
+      stats.in_use       = _in_use.load( std::memory_order_relaxed );
+      stats.peak_in_use  = _peak_in_use.load( std::memory_order_relaxed );
+      stats.allocations  = _allocations.load( std::memory_order_relaxed );
+      return stats;
+   }
+
+} } // graphene::db
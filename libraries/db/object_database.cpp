@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/db/object_database.hpp>
+#include <graphene/db/memory_pool.hpp>
 
 #include <fc/io/raw.hpp>
 #include <fc/container/flat.hpp>
@@ -70,17 +71,85 @@ index& object_database::get_mutable_index(uint8_t space_id, uint8_t type_id)
 
 void object_database::flush()
 {
-//   ilog("Save object_database in ${d}", ("d", _data_dir));
+   flush( _data_dir / "object_database" );
+}
+
+void object_database::flush( const fc::path& dir )
+{
+//   ilog("Save object_database in ${d}", ("d", dir));
    for( uint32_t space = 0; space < _index.size(); ++space )
    {
-      fc::create_directories( _data_dir / "object_database" / fc::to_string(space) );
+      fc::create_directories( dir / fc::to_string(space) );
       const auto types = _index[space].size();
       for( uint32_t type = 0; type  <  types; ++type )
          if( _index[space][type] )
-            _index[space][type]->save( _data_dir / "object_database" / fc::to_string(space)/fc::to_string(type) );
+            _index[space][type]->save( dir / fc::to_string(space)/fc::to_string(type) );
    }
 }
 
+void object_database::enable_state_digest( bool enable )
+{
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            idx->enable_state_digest( enable );
+   _state_digest_enabled = enable;
+   _touched_objects.clear();
+}
+
+fc::uint128 object_database::get_state_digest()const
+{
+   fc::uint128 result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            result += idx->state_digest();
+   return result;
+}
+
+vector<index_digest> object_database::get_index_digests()const
+{
+   vector<index_digest> result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+         {
+            index_digest item;
+            item.space_id = idx->object_space_id();
+            item.type_id  = idx->object_type_id();
+            item.digest   = idx->state_digest();
+            result.push_back( item );
+         }
+   return result;
+}
+
+vector<index_statistics> object_database::get_index_statistics( uint32_t max_samples )const
+{
+   vector<index_statistics> result;
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+            result.push_back( idx->get_statistics( max_samples ) );
+   return result;
+}
+
+void object_database::clear_objects()
+{
+   FC_ASSERT( !_undo_db.enabled(), "Objects can only be cleared while undo is disabled" );
+   for( const auto& space : _index )
+      for( const auto& idx : space )
+         if( idx )
+         {
+            vector<const object*> objects;
+            idx->inspect_all_objects( [&objects]( const object& obj ) { objects.push_back( &obj ); } );
+            for( const object* obj : objects )
+               idx->remove( *obj );
+            idx->set_next_id( object_id_type( idx->object_space_id(), idx->object_type_id(), 0 ) );
+         }
+   _touched_objects.clear();
+   release_memory_pools();
+}
+
 void object_database::wipe(const fc::path& data_dir)
 {
    close();
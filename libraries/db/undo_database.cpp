@@ -25,6 +25,8 @@
 #include <graphene/db/undo_database.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <algorithm>
+
 namespace graphene { namespace db {
 
 void undo_database::enable()  { _disabled = false; }
@@ -281,10 +283,88 @@ void undo_database::pop_commit()
    }
    enable();
 }
+void undo_database::discard_history()
+{
+   FC_ASSERT( _active_sessions == 0, "cannot discard the undo history while sessions are active" );
+   _stack.clear();
+}
+
 const undo_state& undo_database::head()const
 {
    FC_ASSERT( !_stack.empty() );
    return _stack.back();
 }
 
+undo_statistics undo_database::get_statistics( uint32_t max_samples )const
+{
+   undo_statistics stats;
+   stats.depth = _stack.size();
+   stats.max_depth = _max_size;
+   const uint64_t stride = std::max<uint64_t>( 1, _stack.size() / std::max<uint32_t>( 1, max_samples ) );
+   uint64_t sampled_count = 0;
+   uint64_t sampled_bytes = 0;
+   uint64_t n = 0;
+   for( const auto& state : _stack )
+   {
+      stats.copied_objects += state.old_values.size() + state.removed.size();
+      stats.new_objects += state.new_ids.size();
+      if( n++ % stride != 0 )
+         continue;
+      if( !state.old_values.empty() )
+         sampled_bytes += state.old_values.begin()->second->pack().size();
+      else if( !state.removed.empty() )
+         sampled_bytes += state.removed.begin()->second->pack().size();
+      else
+         continue;
+      ++sampled_count;
+   }
+   if( sampled_count > 0 )
+      stats.packed_bytes = sampled_bytes * stats.copied_objects / sampled_count;
+   return stats;
+}
+
+vector<packed_undo_state> undo_database::pack_stack()const
+{ try {
+   FC_ASSERT( _active_sessions == 0, "cannot pack the undo stack while sessions are active" );
+
+   vector<packed_undo_state> result;
+   result.reserve( _stack.size() );
+   for( const auto& state : _stack )
+   {
+      packed_undo_state packed;
+      packed.old_values.reserve( state.old_values.size() );
+      for( const auto& item : state.old_values )
+         packed.old_values.emplace_back( item.first, item.second->pack() );
+      packed.old_index_next_ids.reserve( state.old_index_next_ids.size() );
+      for( const auto& item : state.old_index_next_ids )
+         packed.old_index_next_ids.emplace_back( item.first, item.second );
+      packed.new_ids.assign( state.new_ids.begin(), state.new_ids.end() );
+      packed.removed.reserve( state.removed.size() );
+      for( const auto& item : state.removed )
+         packed.removed.emplace_back( item.first, item.second->pack() );
+      result.emplace_back( std::move(packed) );
+   }
+   return result;
+} FC_CAPTURE_AND_RETHROW() }
+
+void undo_database::unpack_stack( const vector<packed_undo_state>& states )
+{ try {
+   FC_ASSERT( _active_sessions == 0, "cannot replace the undo stack while sessions are active" );
+
+   std::deque<undo_state> stack;
+   for( const auto& packed : states )
+   {
+      stack.emplace_back();
+      undo_state& state = stack.back();
+      for( const auto& item : packed.old_values )
+         state.old_values[item.first] = _db.get_index( item.first ).unpack_object( item.second );
+      for( const auto& item : packed.old_index_next_ids )
+         state.old_index_next_ids[item.first] = item.second;
+      state.new_ids.insert( packed.new_ids.begin(), packed.new_ids.end() );
+      for( const auto& item : packed.removed )
+         state.removed[item.first] = _db.get_index( item.first ).unpack_object( item.second );
+   }
+   _stack = std::move( stack );
+} FC_CAPTURE_AND_RETHROW() }
+
 } } // graphene::db
@@ -74,6 +74,27 @@ account_history_plugin_impl::~account_history_plugin_impl()
 void account_history_plugin_impl::update_account_histories( const signed_block& b )
 {
    graphene::chain::database& db = database();
+
+   // the statistics of an account are modified once per block, however many of its operations the block contains
+   struct history_head
+   {
+      account_transaction_history_id_type most_recent_op;
+      uint32_t                            total_ops = 0;
+   };
+   std::map< account_id_type, history_head > heads;
+   auto head_of = [&]( account_id_type account_id ) -> history_head& {
+      auto itr = heads.find( account_id );
+      if( itr == heads.end() )
+      {
+         const auto& stats_obj = account_id(db).statistics(db);
+         history_head head;
+         head.most_recent_op = stats_obj.most_recent_op;
+         head.total_ops = stats_obj.total_ops;
+         itr = heads.emplace( account_id, head ).first;
+      }
+      return itr->second;
+   };
+
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
    for( const optional< operation_history_object >& o_op : hist )
    {
@@ -116,17 +137,15 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
             // that indexing now happens in observers' post_evaluate()
 
             // add history
-            const auto& stats_obj = account_id(db).statistics(db);
+            history_head& head = head_of( account_id );
             const auto& ath = db.create<account_transaction_history_object>( [&]( account_transaction_history_object& obj ){
                 obj.operation_id = oho.id;
                 obj.account = account_id;
-                obj.sequence = stats_obj.total_ops+1;
-                obj.next = stats_obj.most_recent_op;
-            });
-            db.modify( stats_obj, [&]( account_statistics_object& obj ){
-                obj.most_recent_op = ath.id;
-                obj.total_ops = ath.sequence;
+                obj.sequence = head.total_ops+1;
+                obj.next = head.most_recent_op;
             });
+            head.most_recent_op = ath.id;
+            head.total_ops = ath.sequence;
          }
       }
       else
@@ -136,18 +155,24 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
             if( impacted.find( account_id ) != impacted.end() )
             {
                // add history
-               const auto& stats_obj = account_id(db).statistics(db);
+               history_head& head = head_of( account_id );
                const auto& ath = db.create<account_transaction_history_object>( [&]( account_transaction_history_object& obj ){
                    obj.operation_id = oho.id;
-                   obj.next = stats_obj.most_recent_op;
-               });
-               db.modify( stats_obj, [&]( account_statistics_object& obj ){
-                   obj.most_recent_op = ath.id;
+                   obj.next = head.most_recent_op;
                });
+               head.most_recent_op = ath.id;
             }
          }
       }
    }
+
+   for( const auto& item : heads )
+   {
+      db.modify( item.first(db).statistics(db), [&]( account_statistics_object& obj ){
+          obj.most_recent_op = item.second.most_recent_op;
+          obj.total_ops = item.second.total_ops;
+      });
+   }
 }
 } // end namespace detail
 
@@ -199,4 +224,14 @@ flat_set<account_id_type> account_history_plugin::tracked_accounts() const
    return my->_tracked_accounts;
 }
 
+void account_history_plugin::set_tracked_accounts( const flat_set<account_id_type>& accounts )
+{
+   // the accounts that were not tracked would have a history with a gap, and sequence numbers that do not count
+   // their operations
+   FC_ASSERT( !accounts.empty() || my->_tracked_accounts.empty(),
+              "Recording every account requires replaying the history, restart the node with --replay-blockchain "
+              "and without tracked-accounts" );
+   my->_tracked_accounts = accounts;
+}
+
 } }
@@ -53,7 +53,9 @@ namespace graphene { namespace account_history {
 enum account_history_object_type
 {
    key_account_object_type = 0,
-   bucket_object_type = 1 ///< used in market_history_plugin
+   bucket_object_type = 1, ///< used in market_history_plugin
+   order_history_object_type = 2, ///< used in market_history_plugin
+   market_summary_object_type = 3 ///< used in market_history_plugin
 };
 
 
@@ -76,6 +78,12 @@ class account_history_plugin : public graphene::app::plugin
       virtual void plugin_startup() override;
 
       flat_set<account_id_type> tracked_accounts()const;
+      /**
+       *  Changes the accounts whose history is recorded.  The change applies from the next block on, the history
+       *  of newly tracked accounts is not filled in retroactively.  Switching to every account, an empty set, is
+       *  refused once only some accounts are tracked, because that needs a replay of the history.
+       */
+      void set_tracked_accounts( const flat_set<account_id_type>& accounts );
 
       friend class detail::account_history_plugin_impl;
       std::unique_ptr<detail::account_history_plugin_impl> my;
@@ -28,6 +28,9 @@
 
 #include <fc/thread/future.hpp>
 
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+
 namespace graphene { namespace market_history {
 using namespace chain;
 
@@ -74,6 +77,28 @@ struct bucket_object : public abstract_object<bucket_object>
    price high()const { return asset( high_base, key.base ) / asset( high_quote, key.quote ); }
    price low()const { return asset( low_base, key.base ) / asset( low_quote, key.quote ); }
 
+   uint32_t           seconds()const { return key.seconds; }
+   fc::time_point_sec open()const { return key.open; }
+
+   /** adds the trades of a bucket of the same market which opened later than this one */
+   void merge( const bucket_object& later )
+   {
+      base_volume  += later.base_volume;
+      quote_volume += later.quote_volume;
+      close_base    = later.close_base;
+      close_quote   = later.close_quote;
+      if( high() < later.high() )
+      {
+         high_base  = later.high_base;
+         high_quote = later.high_quote;
+      }
+      if( low() > later.low() )
+      {
+         low_base  = later.low_base;
+         low_quote = later.low_quote;
+      }
+   }
+
    bucket_key          key;
    share_type          high_base;
    share_type          high_quote;
@@ -101,17 +126,62 @@ struct history_key {
 };
 struct order_history_object : public abstract_object<order_history_object>
 {
+  static const uint8_t space_id = ACCOUNT_HISTORY_SPACE_ID;
+  static const uint8_t type_id  = 2; // market_history_plugin type, referenced from account_history_plugin.hpp
+
   history_key          key; 
   fc::time_point_sec   time;
   fill_order_operation op;
 };
 
+/** the trades of a market within one hour */
+struct market_hour
+{
+   fc::time_point_sec   open;
+   share_type           base_volume;
+   share_type           quote_volume;
+   share_type           open_base;
+   share_type           open_quote;
+};
+
+/**
+ *  Summary of a market that traded within the last 24 hours.  Every fill updates it, the volume is also kept per
+ *  hour so that trades can be subtracted again once they drop out of the window.  The summary is removed when the
+ *  market has not traded for 24 hours.
+ */
+struct market_summary_object : public abstract_object<market_summary_object>
+{
+   static const uint8_t space_id = ACCOUNT_HISTORY_SPACE_ID;
+   static const uint8_t type_id  = 3; // market_history_plugin type, referenced from account_history_plugin.hpp
+
+   asset_id_type        base;
+   asset_id_type        quote;
+   fc::time_point_sec   last_trade;
+   share_type           latest_base;
+   share_type           latest_quote;
+   share_type           base_volume;
+   share_type           quote_volume;
+   /** oldest first */
+   vector<market_hour>  hours;
+
+   /** open of the oldest hour within the window */
+   fc::time_point_sec   window_open()const
+   { return hours.empty() ? fc::time_point_sec::maximum() : hours.front().open; }
+};
+
 struct by_key;
+struct by_open;
 typedef multi_index_container<
    bucket_object,
    indexed_by<
       hashed_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
-      ordered_unique< tag<by_key>, member< bucket_object, bucket_key, &bucket_object::key > >
+      ordered_unique< tag<by_key>, member< bucket_object, bucket_key, &bucket_object::key > >,
+      ordered_non_unique< tag<by_open>,
+         composite_key< bucket_object,
+            const_mem_fun< bucket_object, uint32_t, &bucket_object::seconds >,
+            const_mem_fun< bucket_object, fc::time_point_sec, &bucket_object::open >
+         >
+      >
    >
 > bucket_object_multi_index_type;
 
@@ -123,9 +193,23 @@ typedef multi_index_container<
    >
 > order_history_multi_index_type;
 
-
-typedef generic_index<bucket_object, bucket_object_multi_index_type> bucket_index;
-typedef generic_index<order_history_object, order_history_multi_index_type> history_index;
+struct by_market;
+struct by_window_open;
+typedef multi_index_container<
+   market_summary_object,
+   indexed_by<
+      hashed_unique< tag<by_id>, member< object, object_id_type, &object::id > >,
+      ordered_unique< tag<by_market>,
+         composite_key< market_summary_object,
+            member< market_summary_object, asset_id_type, &market_summary_object::base >,
+            member< market_summary_object, asset_id_type, &market_summary_object::quote >
+         >
+      >,
+      ordered_non_unique< tag<by_window_open>,
+         const_mem_fun< market_summary_object, fc::time_point_sec, &market_summary_object::window_open >
+      >
+   >
+> market_summary_multi_index_type;
 
 
 namespace detail
@@ -135,8 +219,20 @@ namespace detail
 
 /**
  *  The market history plugin can be configured to track any number of intervals via its configuration.  Once per block it
- *  will scan the virtual operations and look for fill_order_operations and then adjust the appropriate bucket objects for
- *  each fill order.
+ *  will scan the virtual operations and look for fill_order_operations and then adjust the bucket of the smallest
+ *  interval, the base bucket, for each fill order.
+ *
+ *  The larger intervals are retention tiers: a bucket that is older than history-per-size buckets of its interval is
+ *  folded into the bucket of the next larger interval, and dropped from the largest one.  Queries aggregate whatever
+ *  tiers divide the requested interval, so history is available for any multiple of the base bucket.
+ *
+ *  Buckets and fills are kept by the plugin rather than in the chain database, so they add nothing to the undo
+ *  history or to the saved object database.  The plugin journals the values each reversible block changed and rolls
+ *  those blocks back itself when the chain switches forks.  Its state is saved next to the object database on
+ *  shutdown.
+ *
+ *  The blocks are processed on a thread of the plugin from the database's block_events(), so the state must be read
+ *  through read() by anything that runs while the chain is moving.
  */
 class market_history_plugin : public graphene::app::plugin
 {
@@ -151,19 +247,63 @@ class market_history_plugin : public graphene::app::plugin
       virtual void plugin_initialize(
          const boost::program_options::variables_map& options) override;
       virtual void plugin_startup() override;
+      virtual void plugin_shutdown() override;
 
       uint32_t                    max_history()const;
       const flat_set<uint32_t>&   tracked_buckets()const;
 
+      /** the smallest tracked interval, every other interval that can be queried is a multiple of it */
+      uint32_t                    base_bucket_seconds()const;
+
+      /**
+       *  @return up to limit buckets of bucket_seconds, which must be a multiple of the base bucket, that opened from
+       *  start to end, aggregated from every retention tier whose interval divides bucket_seconds.  The periods only
+       *  kept by a tier whose interval does not divide bucket_seconds are returned as the buckets of that tier, see
+       *  bucket_key::seconds.
+       */
+      vector<bucket_object>       get_market_history( asset_id_type a, asset_id_type b, uint32_t bucket_seconds,
+                                                      fc::time_point_sec start, fc::time_point_sec end,
+                                                      uint32_t limit )const;
+
+      /**
+       *  Runs f on the plugin's thread after the blocks applied so far have been processed, and returns its result.
+       *  f may read buckets(), fill_history() and market_summaries() but not the chain database, which keeps
+       *  moving in the meantime, so results have to be copied out of the plugin's indexes.
+       */
+      template<typename Functor>
+      auto read( Functor&& f )const -> decltype( f() )
+      {
+         if( !_block_events )
+            return f();
+         return _block_events->run( std::forward<Functor>(f) );
+      }
+
+      /**
+       *  The indexes are only stable while no block is processed, so they are read within read() unless the caller
+       *  applies the blocks itself and has flushed the database's block_events(), as the tests do.
+       */
+      /// @{
+      const bucket_object_multi_index_type&   buckets()const;
+      const order_history_multi_index_type&   fill_history()const;
+      /** a summary of every market that traded within the last 24 hours, base and quote ordered by id */
+      const market_summary_multi_index_type&  market_summaries()const;
+      /// @}
+      /** number of reversible blocks the plugin is able to roll back */
+      uint32_t                                journal_size()const;
+
    private:
       friend class detail::market_history_plugin_impl;
       std::unique_ptr<detail::market_history_plugin_impl> my;
+      std::shared_ptr<block_event_consumer>              _block_events;
 };
 
 } } //graphene::market_history
 
 FC_REFLECT( graphene::market_history::history_key, (base)(quote)(sequence) )
 FC_REFLECT_DERIVED( graphene::market_history::order_history_object, (graphene::db::object), (key)(time)(op) )
+FC_REFLECT( graphene::market_history::market_hour, (open)(base_volume)(quote_volume)(open_base)(open_quote) )
+FC_REFLECT_DERIVED( graphene::market_history::market_summary_object, (graphene::db::object),
+                    (base)(quote)(last_trade)(latest_base)(latest_quote)(base_volume)(quote_volume)(hours) )
 FC_REFLECT( graphene::market_history::bucket_key, (base)(quote)(seconds)(open) )
 FC_REFLECT_DERIVED( graphene::market_history::bucket_object, (graphene::db::object), 
                     (key)
@@ -33,14 +33,159 @@
 #include <graphene/chain/transaction_evaluation_state.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
 
+#include <fc/io/fstream.hpp>
 #include <fc/thread/thread.hpp>
 #include <fc/smart_ref_impl.hpp>
 
+#include <fstream>
+
 namespace graphene { namespace market_history {
 
 namespace detail
 {
 
+/**
+ *  Objects of the plugin, kept outside of the chain database.  For every reversible block the journal holds the value
+ *  each object had before the block first changed it and the ids of the objects the block created, which is all that
+ *  is needed to roll the block back.
+ */
+template<typename ObjectType, typename MultiIndexType>
+class journaled_index
+{
+   public:
+      struct block_changes
+      {
+         object_id_type                         next_id;
+         vector<object_id_type>                 new_ids;
+         std::map<object_id_type, ObjectType>   old_values;
+      };
+
+      journaled_index()
+      :_next_id( ObjectType::space_id, ObjectType::type_id, 0 ) {}
+
+      const MultiIndexType& indices()const { return _indices; }
+      uint32_t              journal_size()const { return _journal.size(); }
+
+      template<typename Constructor>
+      const ObjectType& create( Constructor&& c )
+      {
+         ObjectType obj;
+         obj.id = _next_id;
+         c( obj );
+         auto insert_result = _indices.insert( std::move(obj) );
+         FC_ASSERT( insert_result.second, "Could not create object, most likely a uniqueness constraint was violated" );
+         if( !_journal.empty() )
+            _journal.back().new_ids.push_back( _next_id );
+         ++_next_id.number;
+         return *insert_result.first;
+      }
+
+      template<typename Modifier>
+      void modify( const ObjectType& obj, Modifier&& m )
+      {
+         save_old_value( obj );
+         FC_ASSERT( _indices.modify( _indices.iterator_to( obj ), m ),
+                    "Could not modify object, most likely a uniqueness constraint was violated" );
+      }
+
+      void remove( const ObjectType& obj )
+      {
+         save_old_value( obj );
+         _indices.erase( _indices.iterator_to( obj ) );
+      }
+
+      void begin_block()
+      {
+         _journal.emplace_back();
+         _journal.back().next_id = _next_id;
+      }
+
+      void undo_block()
+      {
+         FC_ASSERT( !_journal.empty() );
+         block_changes& changes = _journal.back();
+         auto& by_id_idx = _indices.template get<by_id>();
+         for( const object_id_type& id : changes.new_ids )
+            by_id_idx.erase( id );
+         // all changed objects are taken out first, so that restoring one can not collide with another one's key
+         for( const auto& item : changes.old_values )
+            by_id_idx.erase( item.first );
+         for( auto& item : changes.old_values )
+            _indices.insert( std::move( item.second ) );
+         _next_id = changes.next_id;
+         _journal.pop_back();
+      }
+
+      void discard_oldest_block()
+      {
+         FC_ASSERT( !_journal.empty() );
+         _journal.pop_front();
+      }
+
+      void clear()
+      {
+         _indices.clear();
+         _journal.clear();
+         _next_id = object_id_type( ObjectType::space_id, ObjectType::type_id, 0 );
+      }
+
+      template<typename Stream>
+      void pack( Stream& s )const
+      {
+         fc::raw::pack( s, _next_id );
+         fc::raw::pack( s, vector<ObjectType>( _indices.begin(), _indices.end() ) );
+         fc::raw::pack( s, uint32_t( _journal.size() ) );
+         for( const block_changes& changes : _journal )
+         {
+            fc::raw::pack( s, changes.next_id );
+            fc::raw::pack( s, changes.new_ids );
+            vector<ObjectType> old_values;
+            old_values.reserve( changes.old_values.size() );
+            for( const auto& item : changes.old_values )
+               old_values.push_back( item.second );
+            fc::raw::pack( s, old_values );
+         }
+      }
+
+      template<typename Stream>
+      void unpack( Stream& s )
+      {
+         clear();
+         fc::raw::unpack( s, _next_id );
+         vector<ObjectType> objects;
+         fc::raw::unpack( s, objects );
+         for( ObjectType& obj : objects )
+            FC_ASSERT( _indices.insert( std::move(obj) ).second );
+         uint32_t journal_size = 0;
+         fc::raw::unpack( s, journal_size );
+         for( uint32_t i = 0; i < journal_size; ++i )
+         {
+            block_changes changes;
+            fc::raw::unpack( s, changes.next_id );
+            fc::raw::unpack( s, changes.new_ids );
+            vector<ObjectType> old_values;
+            fc::raw::unpack( s, old_values );
+            for( ObjectType& obj : old_values )
+               changes.old_values.emplace( obj.id, std::move(obj) );
+            _journal.push_back( std::move(changes) );
+         }
+      }
+
+   private:
+      void save_old_value( const ObjectType& obj )
+      {
+         if( _journal.empty() ) return;
+         block_changes& changes = _journal.back();
+         // an object created by the block is simply removed when the block is rolled back
+         if( obj.id.instance() >= changes.next_id.instance() ) return;
+         changes.old_values.emplace( obj.id, obj );
+      }
+
+      MultiIndexType              _indices;
+      object_id_type              _next_id;
+      std::deque<block_changes>   _journal;
+};
+
 class market_history_plugin_impl
 {
    public:
@@ -48,10 +193,28 @@ class market_history_plugin_impl
       :_self( _plugin ) {}
       virtual ~market_history_plugin_impl();
 
-      /** this method is called as a callback after a block is applied
+      /** this method is called on the plugin's thread for every applied block
        * and will process/index all operations that were applied in the block.
        */
-      void update_market_histories( const signed_block& b );
+      void update_market_histories( const applied_block_event& e );
+
+      uint32_t base_bucket_seconds()const { return *_tracked_buckets.begin(); }
+
+      /** see market_history_plugin::get_market_history(), a is the smaller asset */
+      vector<bucket_object> get_market_history( asset_id_type a, asset_id_type b, uint32_t bucket_seconds,
+                                                fc::time_point_sec start, fc::time_point_sec end,
+                                                uint32_t limit )const;
+
+      /** folds the buckets that are out of their tier's retention into the next tier */
+      void expire_buckets( fc::time_point_sec now );
+      /** subtracts the hours that left the 24 hour window from the market summaries */
+      void expire_market_summaries( fc::time_point_sec now );
+
+      /** rolls back journaled blocks until the state is the one after block_id, or clears it if it can not */
+      void rewind_to( const block_id_type& block_id );
+      void clear();
+      void load();
+      void save();
 
       graphene::chain::database& database()
       {
@@ -61,19 +224,65 @@ class market_history_plugin_impl
       market_history_plugin&     _self;
       flat_set<uint32_t>         _tracked_buckets;
       uint32_t                   _maximum_history_per_bucket_size = 1000;
+
+      journaled_index< bucket_object, bucket_object_multi_index_type >          _buckets;
+      journaled_index< order_history_object, order_history_multi_index_type >  _history;
+      journaled_index< market_summary_object, market_summary_multi_index_type > _summaries;
+      /** the reversible blocks in the journal, oldest first, each with the id of the block it was applied on */
+      std::deque< std::pair<block_id_type, block_id_type> >                     _journal;
+      block_id_type              _head_block_id;
+      bool                       _loaded = false;
+      /** resolved by plugin_initialize(), the handler must not ask the database for its directory */
+      fc::path                   _state_file;
+
+      static const uint32_t      state_format_version = 2;
+      /** blocks which may wait for the plugin before the chain waits for it */
+      static const uint32_t      block_event_capacity = 100;
 };
 
 
 struct operation_process_fill_order
 {
-   market_history_plugin&    _plugin;
-   fc::time_point_sec        _now;
+   market_history_plugin_impl&   _plugin;
+   fc::time_point_sec            _now;
 
-   operation_process_fill_order( market_history_plugin& mhp, fc::time_point_sec n )
+   operation_process_fill_order( market_history_plugin_impl& mhp, fc::time_point_sec n )
    :_plugin(mhp),_now(n) {}
 
    typedef void result_type;
 
+   void update_summary( asset_id_type base, asset_id_type quote, const price& trade_price )const
+   {
+      const fc::time_point_sec hour( (_now.sec_since_epoch() / 3600) * 3600 );
+      const auto update = [&]( market_summary_object& s ) {
+         if( s.hours.empty() || s.hours.back().open != hour )
+         {
+            s.hours.emplace_back();
+            s.hours.back().open       = hour;
+            s.hours.back().open_base  = trade_price.base.amount;
+            s.hours.back().open_quote = trade_price.quote.amount;
+         }
+         s.hours.back().base_volume  += trade_price.base.amount;
+         s.hours.back().quote_volume += trade_price.quote.amount;
+         s.base_volume  += trade_price.base.amount;
+         s.quote_volume += trade_price.quote.amount;
+         s.latest_base  = trade_price.base.amount;
+         s.latest_quote = trade_price.quote.amount;
+         s.last_trade   = _now;
+      };
+
+      const auto& by_market_idx = _plugin._summaries.indices().get<by_market>();
+      auto itr = by_market_idx.find( boost::make_tuple( base, quote ) );
+      if( itr == by_market_idx.end() )
+         _plugin._summaries.create( [&]( market_summary_object& s ) {
+            s.base  = base;
+            s.quote = quote;
+            update( s );
+         });
+      else
+         _plugin._summaries.modify( *itr, update );
+   }
+
    /** do nothing for other operation types */
    template<typename T>
    void operator()( const T& )const{}
@@ -81,12 +290,7 @@ struct operation_process_fill_order
    void operator()( const fill_order_operation& o )const 
    {
       //ilog( "processing ${o}", ("o",o) );
-      const auto& buckets = _plugin.tracked_buckets();
-      auto& db         = _plugin.database();
-      const auto& bucket_idx = db.get_index_type<bucket_index>();
-      const auto& history_idx = db.get_index_type<history_index>().indices().get<by_key>();
-
-      auto time = db.head_block_time();
+      const auto& history_idx = _plugin._history.indices().get<by_key>();
 
       history_key hkey;
       hkey.base = o.pays.asset_id;
@@ -97,14 +301,14 @@ struct operation_process_fill_order
 
       auto itr = history_idx.lower_bound( hkey );
 
-      if( itr->key.base == hkey.base && itr->key.quote == hkey.quote )
+      if( itr != history_idx.end() && itr->key.base == hkey.base && itr->key.quote == hkey.quote )
          hkey.sequence = itr->key.sequence - 1;
       else
          hkey.sequence = 0;
 
-      db.create<order_history_object>( [&]( order_history_object& ho ) {
+      _plugin._history.create( [&]( order_history_object& ho ) {
          ho.key = hkey;
-         ho.time = time;
+         ho.time = _now;
          ho.op = o;
       });
 
@@ -115,97 +319,68 @@ struct operation_process_fill_order
       {
          if( itr->key.base == hkey.base && itr->key.quote == hkey.quote )
          {
-            db.remove( *itr );
+            _plugin._history.remove( *itr );
             itr = history_idx.lower_bound( hkey );
          }
          else break;
       }
 
 
-      auto max_history = _plugin.max_history();
-      for( auto bucket : buckets )
-      {
-          auto cutoff      = (fc::time_point() + fc::seconds( bucket * max_history));
-
-          bucket_key key;
-          key.base    = o.pays.asset_id;
-          key.quote   = o.receives.asset_id;
-
-
-          /** for every matched order there are two fill order operations created, one for
-           * each side.  We can filter the duplicates by only considering the fill operations where
-           * the base > quote
-           */
-          if( key.base > key.quote ) 
-          {
-             //ilog( "     skipping because base > quote" );
-             continue;
-          }
-
-          price trade_price = o.pays / o.receives;
-
-          key.seconds = bucket;
-          key.open    = fc::time_point() + fc::seconds((_now.sec_since_epoch() / key.seconds) * key.seconds);
-
-          const auto& by_key_idx = bucket_idx.indices().get<by_key>();
-          auto itr = by_key_idx.find( key );
-          if( itr == by_key_idx.end() )
-          { // create new bucket
-            /* const auto& obj = */
-            db.create<bucket_object>( [&]( bucket_object& b ){
-                 b.key = key;
-                 b.quote_volume += trade_price.quote.amount;
-                 b.base_volume += trade_price.base.amount;
-                 b.open_base = trade_price.base.amount;
-                 b.open_quote = trade_price.quote.amount;
-                 b.close_base = trade_price.base.amount;
-                 b.close_quote = trade_price.quote.amount;
-                 b.high_base = b.close_base;
-                 b.high_quote = b.close_quote;
-                 b.low_base = b.close_base;
-                 b.low_quote = b.close_quote;
-            });
-            //wlog( "    creating bucket ${b}", ("b",obj) );
-          }
-          else
-          { // update existing bucket
-             //wlog( "    before updating bucket ${b}", ("b",*itr) );
-             db.modify( *itr, [&]( bucket_object& b ){
-                  b.base_volume += trade_price.base.amount;
-                  b.quote_volume += trade_price.quote.amount;
-                  b.close_base = trade_price.base.amount;
-                  b.close_quote = trade_price.quote.amount;
-                  if( b.high() < trade_price ) 
-                  {
-                      b.high_base = b.close_base;
-                      b.high_quote = b.close_quote;
-                  }
-                  if( b.low() > trade_price ) 
-                  {
-                      b.low_base = b.close_base;
-                      b.low_quote = b.close_quote;
-                  }
-             });
-             //wlog( "    after bucket bucket ${b}", ("b",*itr) );
-          }
-
-          if( max_history != 0  )
-          {
-             key.open = fc::time_point_sec();
-             auto itr = by_key_idx.lower_bound( key );
-
-             while( itr != by_key_idx.end() && 
-                    itr->key.base == key.base && 
-                    itr->key.quote == key.quote && 
-                    itr->key.seconds == bucket && 
-                    itr->key.open < cutoff )
-             {
-              //  elog( "    removing old bucket ${b}", ("b", *itr) );
-                auto old_itr = itr;
-                ++itr;
-                db.remove( *old_itr );
-             }
-          }
+      bucket_key key;
+      key.base    = o.pays.asset_id;
+      key.quote   = o.receives.asset_id;
+
+      /** for every matched order there are two fill order operations created, one for
+       * each side.  We can filter the duplicates by only considering the fill operations where
+       * the base > quote
+       */
+      if( key.base > key.quote ) 
+         return;
+
+      price trade_price = o.pays / o.receives;
+
+      update_summary( key.base, key.quote, trade_price );
+
+      // only the base bucket is updated, the coarser ones are filled when base buckets expire
+      key.seconds = _plugin.base_bucket_seconds();
+      key.open    = fc::time_point() + fc::seconds((_now.sec_since_epoch() / key.seconds) * key.seconds);
+
+      const auto& by_key_idx = _plugin._buckets.indices().get<by_key>();
+      auto itr = by_key_idx.find( key );
+      if( itr == by_key_idx.end() )
+      { // create new bucket
+        _plugin._buckets.create( [&]( bucket_object& b ){
+             b.key = key;
+             b.quote_volume += trade_price.quote.amount;
+             b.base_volume += trade_price.base.amount;
+             b.open_base = trade_price.base.amount;
+             b.open_quote = trade_price.quote.amount;
+             b.close_base = trade_price.base.amount;
+             b.close_quote = trade_price.quote.amount;
+             b.high_base = b.close_base;
+             b.high_quote = b.close_quote;
+             b.low_base = b.close_base;
+             b.low_quote = b.close_quote;
+        });
+      }
+      else
+      { // update existing bucket
+         _plugin._buckets.modify( *itr, [&]( bucket_object& b ){
+              b.base_volume += trade_price.base.amount;
+              b.quote_volume += trade_price.quote.amount;
+              b.close_base = trade_price.base.amount;
+              b.close_quote = trade_price.quote.amount;
+              if( b.high() < trade_price ) 
+              {
+                  b.high_base = b.close_base;
+                  b.high_quote = b.close_quote;
+              }
+              if( b.low() > trade_price ) 
+              {
+                  b.low_base = b.close_base;
+                  b.low_quote = b.close_quote;
+              }
+         });
       }
    }
 };
@@ -213,20 +388,239 @@ struct operation_process_fill_order
 market_history_plugin_impl::~market_history_plugin_impl()
 {}
 
-void market_history_plugin_impl::update_market_histories( const signed_block& b )
+void market_history_plugin_impl::update_market_histories( const applied_block_event& e )
 {
    if( _maximum_history_per_bucket_size == 0 ) return;
    if( _tracked_buckets.size() == 0 ) return;
 
-   graphene::chain::database& db = database();
-   const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
-   for( const optional< operation_history_object >& o_op : hist )
+   const signed_block& b = e.block;
+
+   // the chain is replayed from genesis, whatever was saved before does not apply any more
+   if( b.block_num() == 1 )
+      clear();
+   else if( !_loaded )
+      load();
+   rewind_to( b.previous );
+
+   _buckets.begin_block();
+   _history.begin_block();
+   _summaries.begin_block();
+   _journal.emplace_back( e.block_id, b.previous );
+   _head_block_id = e.block_id;
+
+   for( const optional< operation_history_object >& o_op : e.operations )
    {
       if( o_op.valid() )
-         o_op->op.visit( operation_process_fill_order( _self, b.timestamp ) );
+         o_op->op.visit( operation_process_fill_order( *this, b.timestamp ) );
+   }
+
+   expire_buckets( b.timestamp );
+   expire_market_summaries( b.timestamp );
+
+   // irreversible blocks are never rolled back
+   while( !_journal.empty() && block_header::num_from_id( _journal.front().first ) <= e.last_irreversible_block_num )
+   {
+      _buckets.discard_oldest_block();
+      _history.discard_oldest_block();
+      _summaries.discard_oldest_block();
+      _journal.pop_front();
    }
 }
 
+vector<bucket_object> market_history_plugin_impl::get_market_history( asset_id_type a, asset_id_type b,
+                                                                      uint32_t bucket_seconds,
+                                                                      fc::time_point_sec start,
+                                                                      fc::time_point_sec end, uint32_t limit )const
+{
+   const auto& by_key_idx = _buckets.indices().get<by_key>();
+
+   // the tiers hold disjoint periods, older ones in the coarser tiers, so ordering the parts by their open time
+   // merges them in the order of the trades
+   vector<const bucket_object*> parts;
+   for( uint32_t tier : _tracked_buckets )
+   {
+      // the buckets of a tier which does not divide bucket_seconds can not be split, they are returned as they are
+      const uint32_t step = bucket_seconds % tier == 0 ? bucket_seconds : tier;
+      const fc::time_point_sec first_open( (start.sec_since_epoch() / step) * step );
+      auto itr = by_key_idx.lower_bound( bucket_key( a, b, tier, first_open ) );
+      while( itr != by_key_idx.end() && itr->key.base == a && itr->key.quote == b && itr->key.seconds == tier
+             && itr->key.open <= end )
+      {
+         parts.push_back( &*itr );
+         ++itr;
+      }
+   }
+   std::sort( parts.begin(), parts.end(), []( const bucket_object* x, const bucket_object* y ) {
+      return x->key.open < y->key.open;
+   });
+
+   vector<bucket_object> result;
+   for( const bucket_object* part : parts )
+   {
+      const bool whole = bucket_seconds % part->key.seconds != 0;
+      const fc::time_point_sec open( whole ? part->key.open
+                                           : fc::time_point_sec( (part->key.open.sec_since_epoch() / bucket_seconds)
+                                                                 * bucket_seconds ) );
+      if( whole || result.empty() || result.back().key.open != open || result.back().key.seconds != bucket_seconds )
+      {
+         if( result.size() == limit ) break;
+         result.push_back( *part );
+         if( whole ) continue;
+         result.back().key.seconds = bucket_seconds;
+         result.back().key.open    = open;
+      }
+      else
+         result.back().merge( *part );
+   }
+   return result;
+}
+
+void market_history_plugin_impl::expire_buckets( fc::time_point_sec now )
+{
+   const auto& by_open_idx = _buckets.indices().get<by_open>();
+   const auto& by_key_idx = _buckets.indices().get<by_key>();
+   for( auto tier = _tracked_buckets.begin(); tier != _tracked_buckets.end(); ++tier )
+   {
+      const uint32_t seconds = *tier;
+      const uint64_t retention = uint64_t( seconds ) * _maximum_history_per_bucket_size;
+      if( retention >= now.sec_since_epoch() ) continue;
+      const fc::time_point_sec cutoff = now - uint32_t( retention );
+
+      auto next_tier = std::next( tier );
+      auto itr = by_open_idx.lower_bound( boost::make_tuple( seconds ) );
+      while( itr != by_open_idx.end() && itr->key.seconds == seconds && itr->key.open < cutoff )
+      {
+         const bucket_object& expired = *itr;
+         ++itr;
+         if( next_tier != _tracked_buckets.end() )
+         {
+            bucket_key key = expired.key;
+            key.seconds = *next_tier;
+            key.open    = fc::time_point_sec( (expired.key.open.sec_since_epoch() / key.seconds) * key.seconds );
+            auto coarse = by_key_idx.find( key );
+            if( coarse == by_key_idx.end() )
+               _buckets.create( [&]( bucket_object& b ) {
+                  const object_id_type id = b.id;
+                  b = expired;
+                  b.id  = id;
+                  b.key = key;
+               });
+            else
+               _buckets.modify( *coarse, [&]( bucket_object& b ) { b.merge( expired ); } );
+         }
+         _buckets.remove( expired );
+      }
+   }
+}
+
+void market_history_plugin_impl::expire_market_summaries( fc::time_point_sec now )
+{
+   if( now.sec_since_epoch() <= 86400 ) return;
+   const fc::time_point_sec cutoff = now - 86400;
+   const auto& by_window_idx = _summaries.indices().get<by_window_open>();
+   while( !by_window_idx.empty() && by_window_idx.begin()->window_open() <= cutoff )
+   {
+      const market_summary_object& summary = *by_window_idx.begin();
+      if( summary.hours.size() == 1 )
+      {
+         _summaries.remove( summary );
+         continue;
+      }
+      _summaries.modify( summary, []( market_summary_object& s ) {
+         s.base_volume  -= s.hours.front().base_volume;
+         s.quote_volume -= s.hours.front().quote_volume;
+         s.hours.erase( s.hours.begin() );
+      });
+   }
+}
+
+void market_history_plugin_impl::rewind_to( const block_id_type& block_id )
+{
+   while( _head_block_id != block_id && !_journal.empty() )
+   {
+      _buckets.undo_block();
+      _history.undo_block();
+      _summaries.undo_block();
+      _head_block_id = _journal.back().second;
+      _journal.pop_back();
+   }
+   // the saved history ends on another fork or was not updated by every block since, it is not used
+   if( _head_block_id != block_id && _head_block_id != block_id_type() )
+   {
+      wlog( "Discarding the market history recorded up to block ${h}, it does not end at block ${b}",
+            ("h", _head_block_id)("b", block_id) );
+      clear();
+   }
+}
+
+void market_history_plugin_impl::clear()
+{
+   _buckets.clear();
+   _history.clear();
+   _summaries.clear();
+   _journal.clear();
+   _head_block_id = block_id_type();
+   _loaded = true;
+}
+
+void market_history_plugin_impl::load()
+{
+   _loaded = true;
+   const fc::path& file = _state_file;
+   if( !fc::exists( file ) ) return;
+   try
+   {
+      std::string data;
+      fc::read_file_contents( file, data );
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      uint32_t version = 0;
+      fc::raw::unpack( ds, version );
+      FC_ASSERT( version > 0 && version <= state_format_version, "Unsupported format version ${v}", ("v",version) );
+      // the first format recorded every fill in every bucket size, folding its buckets would count volumes twice
+      if( version < 2 )
+      {
+         wlog( "Discarding the market history in ${f}, it was recorded with the old bucket layout", ("f", file) );
+         clear();
+         return;
+      }
+      fc::raw::unpack( ds, _head_block_id );
+      vector< std::pair<block_id_type, block_id_type> > journal;
+      fc::raw::unpack( ds, journal );
+      _journal.assign( journal.begin(), journal.end() );
+      _buckets.unpack( ds );
+      _history.unpack( ds );
+      _summaries.unpack( ds );
+      FC_ASSERT( _buckets.journal_size() == _journal.size() && _history.journal_size() == _journal.size()
+                 && _summaries.journal_size() == _journal.size() );
+   }
+   catch( const fc::exception& e )
+   {
+      wlog( "Unable to load the market history from ${f}, starting without history: ${e}",
+            ("f", file)("e", e.to_detail_string()) );
+      clear();
+   }
+}
+
+void market_history_plugin_impl::save()
+{
+   // a read-only follower must not write into the data directory of the node it follows
+   if( !_loaded || database().is_read_only() ) return;
+   const fc::path& file = _state_file;
+   const fc::path tmp_file = file.generic_string() + ".new";
+   {
+      std::ofstream out( tmp_file.generic_string(), std::ofstream::binary | std::ofstream::out | std::ofstream::trunc );
+      FC_ASSERT( out, "Unable to write ${f}", ("f", tmp_file) );
+      const uint32_t version = state_format_version;
+      fc::raw::pack( out, version );
+      fc::raw::pack( out, _head_block_id );
+      fc::raw::pack( out, vector< std::pair<block_id_type, block_id_type> >( _journal.begin(), _journal.end() ) );
+      _buckets.pack( out );
+      _history.pack( out );
+      _summaries.pack( out );
+   }
+   fc::rename( tmp_file, file );
+}
+
 } // end namespace detail
 
 
@@ -241,6 +635,9 @@ market_history_plugin::market_history_plugin() :
 
 market_history_plugin::~market_history_plugin()
 {
+   // the queued blocks refer to my
+   if( _block_events )
+      _block_events->flush();
 }
 
 std::string market_history_plugin::plugin_name()const
@@ -255,23 +652,36 @@ void market_history_plugin::plugin_set_program_options(
 {
    cli.add_options()
          ("bucket-size", boost::program_options::value<string>()->default_value("[15,60,300,3600,86400]"),
-           "Track market history by grouping orders into buckets of equal size measured in seconds specified as a JSON array of numbers")
+           "Track market history by grouping orders into buckets of equal size measured in seconds specified as a JSON array of numbers. "
+           "Fills are recorded in the smallest size, older buckets move to the larger sizes, any multiple of the smallest size can be queried")
          ("history-per-size", boost::program_options::value<uint32_t>()->default_value(1000), 
-           "How far back in time to track history for each bucket size, measured in the number of buckets (default: 1000)")
+           "How many buckets of each size to keep before they move to the next larger size (default: 1000)")
          ;
    cfg.add(cli);
 }
 
 void market_history_plugin::plugin_initialize(const boost::program_options::variables_map& options)
 { try {
-   database().applied_block.connect( [&]( const signed_block& b){ my->update_market_histories(b); } );
-   database().add_index< primary_index< bucket_index  > >();
-   database().add_index< primary_index< history_index  > >();
+   // the database is opened by application::startup(), unless it was opened before the plugins were initialized
+   const fc::path blockchain_dir = database().get_data_dir().empty() ? app().blockchain_dir() : database().get_data_dir();
+   my->_state_file = blockchain_dir / "market_history";
+
+   _block_events = database().block_events().subscribe( plugin_name(),
+      detail::market_history_plugin_impl::block_event_capacity, false,
+      [this]( const applied_block_event& e ){ my->update_market_histories(e); } );
 
    if( options.count( "bucket-size" ) )
    {
       const std::string& buckets = options["bucket-size"].as<string>(); 
       my->_tracked_buckets = fc::json::from_string(buckets).as<flat_set<uint32_t>>();
+      // old buckets are folded into the next size, which only works if they fit into its buckets exactly
+      uint32_t previous = 0;
+      for( uint32_t size : my->_tracked_buckets )
+      {
+         FC_ASSERT( size > 0 && ( previous == 0 || size % previous == 0 ),
+                    "Every bucket size must be a multiple of the next smaller one", ("bucket-size", buckets) );
+         previous = size;
+      }
    }
    if( options.count( "history-per-size" ) )
       my->_maximum_history_per_bucket_size = options["history-per-size"].as<uint32_t>();
@@ -279,6 +689,18 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
 
 void market_history_plugin::plugin_startup()
 {
+   // blocks applied while the database was opened have loaded the saved history already
+   read( [this]() {
+      if( !my->_loaded )
+         my->load();
+   });
+}
+
+void market_history_plugin::plugin_shutdown()
+{
+   if( _block_events )
+      database().block_events().unsubscribe( _block_events );
+   my->save();
 }
 
 const flat_set<uint32_t>& market_history_plugin::tracked_buckets() const
@@ -291,4 +713,45 @@ uint32_t market_history_plugin::max_history()const
    return my->_maximum_history_per_bucket_size;
 }
 
+uint32_t market_history_plugin::base_bucket_seconds()const
+{
+   FC_ASSERT( !my->_tracked_buckets.empty(), "No buckets are tracked" );
+   return my->base_bucket_seconds();
+}
+
+vector<bucket_object> market_history_plugin::get_market_history( asset_id_type a, asset_id_type b,
+                                                                 uint32_t bucket_seconds,
+                                                                 fc::time_point_sec start, fc::time_point_sec end,
+                                                                 uint32_t limit )const
+{ try {
+   const uint32_t base_seconds = base_bucket_seconds();
+   FC_ASSERT( bucket_seconds >= base_seconds && bucket_seconds % base_seconds == 0,
+              "The interval must be a multiple of ${s} seconds", ("s", base_seconds) );
+   if( a > b ) std::swap(a,b);
+
+   return read( [&]() {
+      return my->get_market_history( a, b, bucket_seconds, start, end, limit );
+   });
+} FC_CAPTURE_AND_RETHROW( (a)(b)(bucket_seconds)(start)(end)(limit) ) }
+
+const bucket_object_multi_index_type& market_history_plugin::buckets()const
+{
+   return my->_buckets.indices();
+}
+
+const order_history_multi_index_type& market_history_plugin::fill_history()const
+{
+   return my->_history.indices();
+}
+
+const market_summary_multi_index_type& market_history_plugin::market_summaries()const
+{
+   return my->_summaries.indices();
+}
+
+uint32_t market_history_plugin::journal_size()const
+{
+   return read( [this]() -> uint32_t { return my->_journal.size(); } );
+}
+
 } }
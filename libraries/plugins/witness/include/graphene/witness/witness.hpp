@@ -28,6 +28,8 @@
 
 #include <fc/thread/future.hpp>
 
+#include <deque>
+
 namespace graphene { namespace witness_plugin {
 
 namespace block_production_condition
@@ -42,10 +44,83 @@ namespace block_production_condition
       low_participation = 5,
       lag = 6,
       consecutive = 7,
-      exception_producing_block = 8
+      exception_producing_block = 8,
+      /** the witness already signed a block for the slot or a later one, e.g. on a fork that was switched away */
+      already_produced = 9
    };
 }
 
+/**
+ *  The witnesses this node produces blocks for and the keys it signs them with.  It is replaced as a whole, so a
+ *  slot sees either the state before or the state after an update.
+ */
+struct producer_state
+{
+   std::set<chain::witness_id_type>                        witnesses;
+   std::map<chain::public_key_type, fc::ecc::private_key>  private_keys;
+};
+
+/**
+ *  A change of the producer_state which is applied in one step, e.g. adding the new signing key of a witness and
+ *  removing its old one.  Removals are applied before additions.
+ */
+struct producer_update
+{
+   std::vector<chain::witness_id_type>  add_witnesses;
+   std::vector<chain::witness_id_type>  remove_witnesses;
+   /** WIF private keys */
+   std::vector<std::string>             add_private_keys;
+   std::vector<chain::public_key_type>  remove_private_keys;
+};
+
+/** the producer_state without the private keys */
+struct producer_summary
+{
+   std::set<chain::witness_id_type>     witnesses;
+   std::set<chain::public_key_type>     signing_keys;
+};
+
+/**
+ *  The last pass of the block production loop in a slot of one of our witnesses, or a pass which failed before
+ *  finding the slot.  A slot in which a block was produced keeps that pass.  The timings of the steps are only
+ *  set when a block was produced.
+ */
+struct block_production_attempt
+{
+   /** increases by one with every recorded attempt */
+   uint64_t                                                   sequence = 0;
+   /** NTP time at which the attempt started */
+   fc::time_point                                             time;
+   block_production_condition::block_production_condition_enum result = block_production_condition::produced;
+   uint32_t                                                   slot = 0;
+   fc::time_point_sec                                         scheduled_time;
+   chain::witness_id_type                                     scheduled_witness;
+   /** of the produced block */
+   uint32_t                                                   block_num = 0;
+   /** how far from the scheduled time the block was generated, negative when early */
+   fc::microseconds                                           slot_offset;
+   chain::block_generation_timings                            timings;
+   /** handing the block to the p2p node, set once the broadcast finished */
+   fc::microseconds                                           broadcast;
+   /** the whole attempt */
+   fc::microseconds                                           total;
+   /** estimated error of the local clock as measured by NTP */
+   fc::microseconds                                           ntp_error;
+   /** the reason of a failure */
+   std::string                                                detail;
+};
+
+/** how often each condition ended a pass of the production loop since the node started */
+struct block_production_summary
+{
+   std::map<block_production_condition::block_production_condition_enum, uint64_t> conditions;
+   uint64_t                                                   produced = 0;
+   /** slots of our witnesses in which no block was produced, each counted once */
+   uint64_t                                                   missed_slots = 0;
+   fc::time_point                                             last_produced;
+   fc::microseconds                                           ntp_error;
+};
+
 class witness_plugin : public graphene::app::plugin {
 public:
    ~witness_plugin() {
@@ -72,10 +147,31 @@ public:
    virtual void plugin_startup() override;
    virtual void plugin_shutdown() override;
 
+   /** @return up to limit of the most recent attempts which reached a slot of our witnesses, latest first */
+   std::vector<block_production_attempt> get_production_history( uint32_t limit )const;
+   block_production_summary              get_production_summary()const;
+
+   /**
+    *  Changes the witnesses and signing keys of this node while it runs.  The update is checked completely before
+    *  anything changes, the slot after it uses the new state.  Production starts if the first witness is added.
+    */
+   void             update_producers( const producer_update& update );
+   producer_summary get_producers()const;
+
+   /**
+    *  One pass of the production loop: produces a block if a slot of one of our witnesses has arrived, and records
+    *  the attempt.  The loop calls it every second.
+    */
+   block_production_condition::block_production_condition_enum produce_block_if_due();
+
 private:
    void schedule_production_loop();
-   block_production_condition::block_production_condition_enum block_production_loop();
-   block_production_condition::block_production_condition_enum maybe_produce_block( fc::mutable_variant_object& capture );
+   void block_production_loop();
+   block_production_condition::block_production_condition_enum maybe_produce_block( const producer_state& producers,
+                                                                                     fc::mutable_variant_object& capture,
+                                                                                     block_production_attempt& attempt );
+   void record_attempt( block_production_attempt&& attempt );
+   void record_broadcast( uint64_t sequence, fc::microseconds duration );
 
    boost::program_options::variables_map _options;
    bool _production_enabled = false;
@@ -83,9 +179,28 @@ private:
    uint32_t _required_witness_participation = 33 * GRAPHENE_1_PERCENT;
    uint32_t _production_skip_flags = graphene::chain::database::skip_nothing;
 
-   std::map<chain::public_key_type, fc::ecc::private_key> _private_keys;
-   std::set<chain::witness_id_type> _witnesses;
+   std::shared_ptr<const producer_state> _producers = std::make_shared<producer_state>();
+   /** the latest slot each witness signed a block for, never signed again even if the block was popped */
+   std::map<chain::witness_id_type, fc::time_point_sec> _last_signed_slot;
+   bool _started = false;
    fc::future<void> _block_production_task;
+
+   uint32_t _production_history_size = 1000;
+   std::deque<block_production_attempt> _production_history;
+   uint64_t _next_attempt_sequence = 0;
+   block_production_summary _production_summary;
 };
 
 } } //graphene::witness_plugin
+
+FC_REFLECT_ENUM( graphene::witness_plugin::block_production_condition::block_production_condition_enum,
+                 (produced)(not_synced)(not_my_turn)(not_time_yet)(no_private_key)(low_participation)(lag)
+                 (consecutive)(exception_producing_block)(already_produced) )
+FC_REFLECT( graphene::witness_plugin::producer_update,
+            (add_witnesses)(remove_witnesses)(add_private_keys)(remove_private_keys) )
+FC_REFLECT( graphene::witness_plugin::producer_summary, (witnesses)(signing_keys) )
+FC_REFLECT( graphene::witness_plugin::block_production_attempt,
+            (sequence)(time)(result)(slot)(scheduled_time)(scheduled_witness)(block_num)(slot_offset)(timings)
+            (broadcast)(total)(ntp_error)(detail) )
+FC_REFLECT( graphene::witness_plugin::block_production_summary,
+            (conditions)(produced)(missed_slots)(last_produced)(ntp_error) )
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+
+#include <graphene/witness/witness.hpp>
+
+#include <fc/api.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace graphene { namespace app {
+class application;
+} }
+
+namespace graphene { namespace witness_plugin {
+
+namespace detail {
+class witness_api_impl;
+}
+
+/**
+ *  Diagnostics and control of the block production of this node.  It is not part of the public APIs, access has to
+ *  be granted in the api-access file.  Since it carries private keys it should only be used over a local or TLS
+ *  connection.
+ */
+class witness_api
+{
+   public:
+      witness_api( graphene::app::application& app );
+
+      /**
+       *  @return up to limit of the most recent production attempts which reached a slot of a witness of this node,
+       *  latest first
+       */
+      std::vector<block_production_attempt> get_production_history( uint32_t limit )const;
+
+      /**
+       *  @return how often each outcome ended a pass of the production loop since the node started and how many
+       *  slots were missed
+       */
+      block_production_summary get_production_summary()const;
+
+      /**
+       *  Changes the witnesses this node produces for and the keys it signs with, without a restart.  The update is
+       *  applied as a whole or not at all, and takes effect from the next production slot.  A witness never signs
+       *  two blocks for the same slot, even if it is removed and added again.
+       */
+      void update_producers( const producer_update& update );
+
+      /** @return the witnesses this node produces for and the public keys it holds private keys of */
+      producer_summary get_producers()const;
+
+      std::shared_ptr< detail::witness_api_impl > my;
+};
+
+} }
+
+FC_API(graphene::witness_plugin::witness_api,
+       (get_production_history)
+       (get_production_summary)
+       (update_producers)
+       (get_producers)
+     )
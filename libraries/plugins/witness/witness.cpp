@@ -63,6 +63,34 @@ void new_chain_banner( const graphene::chain::database& db )
    return;
 }
 
+/** error of the local clock, graphene::time::ntp_error() throws while no NTP time has been received */
+fc::microseconds ntp_clock_error()
+{
+   fc::optional<fc::time_point> ntp_now = graphene::time::ntp_time();
+   if( !ntp_now.valid() )
+      return fc::microseconds();
+   return *ntp_now - fc::time_point::now();
+}
+
+fc::ecc::private_key parse_private_key( const std::string& key_string )
+{
+   fc::optional<fc::ecc::private_key> private_key = graphene::utilities::wif_to_key(key_string);
+   if (!private_key)
+   {
+      // the key isn't in WIF format; see if they are still passing the old native private key format.  This is
+      // just here to ease the transition, can be removed soon
+      try
+      {
+         private_key = fc::variant(key_string).as<fc::ecc::private_key>();
+      }
+      catch (const fc::exception&)
+      {
+         FC_THROW("Invalid WIF-format private key ${key_string}", ("key_string", key_string));
+      }
+   }
+   return *private_key;
+}
+
 void witness_plugin::plugin_set_program_options(
    boost::program_options::options_description& command_line_options,
    boost::program_options::options_description& config_file_options)
@@ -80,6 +108,8 @@ void witness_plugin::plugin_set_program_options(
          ("private-key", bpo::value<vector<string>>()->composing()->multitoken()->
           DEFAULT_VALUE_VECTOR(std::make_pair(chain::public_key_type(default_priv_key.get_public_key()), graphene::utilities::key_to_wif(default_priv_key))),
           "Tuple of [PublicKey, WIF private key] (may specify multiple times)")
+         ("production-history-size", bpo::value<uint32_t>()->default_value(1000),
+          "Number of recent block production attempts kept for the witness API")
          ;
    config_file_options.add(command_line_options);
 }
@@ -93,9 +123,12 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
 { try {
    ilog("witness plugin:  plugin_initialize() begin");
    _options = &options;
-   LOAD_VALUE_SET(options, "witness-id", _witnesses, chain::witness_id_type)
+   auto producers = std::make_shared<producer_state>();
+   LOAD_VALUE_SET(options, "witness-id", producers->witnesses, chain::witness_id_type)
    if (options.count("witness-ids"))
-      boost::insert(_witnesses, fc::json::from_string(options.at("witness-ids").as<string>()).as<vector<chain::witness_id_type>>());
+      boost::insert(producers->witnesses, fc::json::from_string(options.at("witness-ids").as<string>()).as<vector<chain::witness_id_type>>());
+   if( options.count("production-history-size") )
+      _production_history_size = options["production-history-size"].as<uint32_t>();
 
    if( options.count("private-key") )
    {
@@ -103,24 +136,11 @@ void witness_plugin::plugin_initialize(const boost::program_options::variables_m
       for (const std::string& key_id_to_wif_pair_string : key_id_to_wif_pair_strings)
       {
          auto key_id_to_wif_pair = graphene::app::dejsonify<std::pair<chain::public_key_type, std::string> >(key_id_to_wif_pair_string);
-         idump((key_id_to_wif_pair));
-         fc::optional<fc::ecc::private_key> private_key = graphene::utilities::wif_to_key(key_id_to_wif_pair.second);
-         if (!private_key)
-         {
-            // the key isn't in WIF format; see if they are still passing the old native private key format.  This is
-            // just here to ease the transition, can be removed soon
-            try
-            {
-               private_key = fc::variant(key_id_to_wif_pair.second).as<fc::ecc::private_key>();
-            }
-            catch (const fc::exception&)
-            {
-               FC_THROW("Invalid WIF-format private key ${key_string}", ("key_string", key_id_to_wif_pair.second));
-            }
-         }
-         _private_keys[key_id_to_wif_pair.first] = *private_key;
+         idump((key_id_to_wif_pair.first));
+         producers->private_keys[key_id_to_wif_pair.first] = parse_private_key( key_id_to_wif_pair.second );
       }
    }
+   _producers = producers;
    ilog("witness plugin:  plugin_initialize() end");
 } FC_LOG_AND_RETHROW() }
 
@@ -130,20 +150,21 @@ void witness_plugin::plugin_startup()
    chain::database& d = database();
    //Start NTP time client
    graphene::time::now();
+   _started = true;
 
-   if( !_witnesses.empty() )
+   if( _production_enabled )
+   {
+      if( d.head_block_num() == 0 && !_producers->witnesses.empty() )
+         new_chain_banner(d);
+      _production_skip_flags |= graphene::chain::database::skip_undo_history_check;
+   }
+   if( !_producers->witnesses.empty() )
    {
-      ilog("Launching block production for ${n} witnesses.", ("n", _witnesses.size()));
+      ilog("Launching block production for ${n} witnesses.", ("n", _producers->witnesses.size()));
       app().set_block_production(true);
-      if( _production_enabled )
-      {
-         if( d.head_block_num() == 0 )
-            new_chain_banner(d);
-         _production_skip_flags |= graphene::chain::database::skip_undo_history_check;
-      }
       schedule_production_loop();
    } else
-      elog("No witnesses configured! Please add witness IDs and private keys to configuration.");
+      elog("No witnesses configured! Please add witness IDs and private keys to configuration or through the witness API.");
    ilog("witness plugin:  plugin_startup() end");
 } FC_CAPTURE_AND_RETHROW() }
 
@@ -153,6 +174,48 @@ void witness_plugin::plugin_shutdown()
    return;
 }
 
+void witness_plugin::update_producers( const producer_update& update )
+{ try {
+   // everything is parsed before the state changes, a bad key leaves it as it was
+   vector<fc::ecc::private_key> added_keys;
+   added_keys.reserve( update.add_private_keys.size() );
+   for( const std::string& key_string : update.add_private_keys )
+      added_keys.push_back( parse_private_key( key_string ) );
+
+   auto producers = std::make_shared<producer_state>( *_producers );
+   for( const chain::witness_id_type& id : update.remove_witnesses )
+      producers->witnesses.erase( id );
+   for( const chain::public_key_type& key : update.remove_private_keys )
+      producers->private_keys.erase( key );
+   for( const chain::witness_id_type& id : update.add_witnesses )
+   {
+      FC_ASSERT( database().find( id ) != nullptr, "Unknown witness ${w}", ("w", id) );
+      producers->witnesses.insert( id );
+   }
+   for( const fc::ecc::private_key& key : added_keys )
+      producers->private_keys[key.get_public_key()] = key;
+
+   const bool was_producing = !_producers->witnesses.empty();
+   _producers = producers;
+   ilog( "Producing for ${w} with ${k} signing keys", ("w", producers->witnesses)("k", producers->private_keys.size()) );
+
+   if( !was_producing && !producers->witnesses.empty() )
+   {
+      app().set_block_production(true);
+      if( _started && !( _block_production_task.valid() && !_block_production_task.ready() ) )
+         schedule_production_loop();
+   }
+} FC_CAPTURE_AND_RETHROW( (update.add_witnesses)(update.remove_witnesses)(update.remove_private_keys) ) }
+
+producer_summary witness_plugin::get_producers()const
+{
+   producer_summary result;
+   result.witnesses = _producers->witnesses;
+   for( const auto& item : _producers->private_keys )
+      result.signing_keys.insert( item.first );
+   return result;
+}
+
 void witness_plugin::schedule_production_loop()
 {
    //Schedule for the next second's tick regardless of chain state
@@ -170,13 +233,23 @@ void witness_plugin::schedule_production_loop()
                                          next_wakeup, "Witness Block Production");
 }
 
-block_production_condition::block_production_condition_enum witness_plugin::block_production_loop()
+void witness_plugin::block_production_loop()
+{
+   produce_block_if_due();
+   schedule_production_loop();
+}
+
+block_production_condition::block_production_condition_enum witness_plugin::produce_block_if_due()
 {
    block_production_condition::block_production_condition_enum result;
    fc::mutable_variant_object capture;
+   block_production_attempt attempt;
+   attempt.time = graphene::time::now();
+   // an update of the producers while the block is produced takes effect in the next slot
+   std::shared_ptr<const producer_state> producers = _producers;
    try
    {
-      result = maybe_produce_block(capture);
+      result = maybe_produce_block(*producers, capture, attempt);
    }
    catch( const fc::canceled_exception& )
    {
@@ -187,7 +260,11 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
    {
       elog("Got exception while generating block:\n${e}", ("e", e.to_detail_string()));
       result = block_production_condition::exception_producing_block;
+      attempt.detail = e.to_string();
    }
+   attempt.result = result;
+   attempt.total = graphene::time::now() - attempt.time;
+   record_attempt( std::move(attempt) );
 
    switch( result )
    {
@@ -218,13 +295,89 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
       case block_production_condition::exception_producing_block:
          elog( "exception prodcing block" );
          break;
+      case block_production_condition::already_produced:
+         elog("Not producing block because a block was already signed for the slot at ${scheduled_time}", (capture) );
+         break;
    }
 
-   schedule_production_loop();
    return result;
 }
 
-block_production_condition::block_production_condition_enum witness_plugin::maybe_produce_block( fc::mutable_variant_object& capture )
+void witness_plugin::record_attempt( block_production_attempt&& attempt )
+{
+   ++_production_summary.conditions[attempt.result];
+   switch( attempt.result )
+   {
+      // nothing of ours was at stake, these are only counted
+      case block_production_condition::not_synced:
+      case block_production_condition::not_my_turn:
+      case block_production_condition::not_time_yet:
+         return;
+      default:
+         break;
+   }
+
+   // the loop passes through a slot several times, the slot keeps one entry and is missed at most once
+   block_production_attempt* same_slot = nullptr;
+   if( attempt.slot != 0 && !_production_history.empty()
+       && _production_history.back().scheduled_time == attempt.scheduled_time )
+      same_slot = &_production_history.back();
+   if( same_slot != nullptr && same_slot->result == block_production_condition::produced )
+      return;
+
+   if( attempt.result == block_production_condition::produced )
+   {
+      ++_production_summary.produced;
+      _production_summary.last_produced = attempt.time;
+      if( same_slot != nullptr )
+         --_production_summary.missed_slots;
+   }
+   // an exception is only a missed slot if it was ours
+   else if( attempt.result != block_production_condition::already_produced && attempt.slot != 0
+            && same_slot == nullptr )
+      ++_production_summary.missed_slots;
+
+   if( same_slot != nullptr )
+   {
+      attempt.sequence = same_slot->sequence;
+      *same_slot = std::move(attempt);
+      return;
+   }
+   attempt.sequence = _next_attempt_sequence++;
+   _production_history.push_back( std::move(attempt) );
+   while( _production_history.size() > _production_history_size )
+      _production_history.pop_front();
+}
+
+void witness_plugin::record_broadcast( uint64_t sequence, fc::microseconds duration )
+{
+   // the attempt may have dropped out of the history in the meantime
+   if( _production_history.empty() || sequence < _production_history.front().sequence )
+      return;
+   const uint64_t index = sequence - _production_history.front().sequence;
+   if( index < _production_history.size() )
+      _production_history[index].broadcast = duration;
+}
+
+std::vector<block_production_attempt> witness_plugin::get_production_history( uint32_t limit )const
+{
+   std::vector<block_production_attempt> result;
+   result.reserve( std::min<size_t>( limit, _production_history.size() ) );
+   for( auto itr = _production_history.rbegin(); itr != _production_history.rend() && result.size() < limit; ++itr )
+      result.push_back( *itr );
+   return result;
+}
+
+block_production_summary witness_plugin::get_production_summary()const
+{
+   block_production_summary result = _production_summary;
+   result.ntp_error = ntp_clock_error();
+   return result;
+}
+
+block_production_condition::block_production_condition_enum witness_plugin::maybe_produce_block( const producer_state& producers,
+                                                                                                  fc::mutable_variant_object& capture,
+                                                                                                  block_production_attempt& attempt )
 {
    chain::database& db = database();
    fc::time_point now_fine = graphene::time::now();
@@ -260,20 +413,24 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
    graphene::chain::witness_id_type scheduled_witness = db.get_scheduled_witness( slot );
 
    // we must control the witness scheduled to produce the next block.
-   if( _witnesses.find( scheduled_witness ) == _witnesses.end() )
+   if( producers.witnesses.find( scheduled_witness ) == producers.witnesses.end() )
    {
       capture("scheduled_witness", scheduled_witness);
       return block_production_condition::not_my_turn;
    }
 
    fc::time_point_sec scheduled_time = db.get_slot_time( slot );
-   wdump((slot)(scheduled_witness)(scheduled_time)(now));
+   attempt.slot = slot;
+   attempt.scheduled_time = scheduled_time;
+   attempt.scheduled_witness = scheduled_witness;
+   attempt.ntp_error = ntp_clock_error();
    graphene::chain::public_key_type scheduled_key = scheduled_witness( db ).signing_key;
-   auto private_key_itr = _private_keys.find( scheduled_key );
+   auto private_key_itr = producers.private_keys.find( scheduled_key );
 
-   if( private_key_itr == _private_keys.end() )
+   if( private_key_itr == producers.private_keys.end() )
    {
       capture("scheduled_key", scheduled_key);
+      attempt.detail = "no private key for " + std::string( scheduled_key );
       return block_production_condition::no_private_key;
    }
 
@@ -281,6 +438,7 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
    if( prate < _required_witness_participation )
    {
       capture("pct", uint32_t(100*uint64_t(prate) / GRAPHENE_1_PERCENT));
+      attempt.detail = "participation " + fc::to_string( uint64_t(100*uint64_t(prate) / GRAPHENE_1_PERCENT) ) + "%";
       return block_production_condition::low_participation;
    }
 
@@ -293,21 +451,41 @@ block_production_condition::block_production_condition_enum witness_plugin::mayb
    if( llabs((scheduled_time - now).count()) > fc::milliseconds( 500 ).count() )
    {
       capture("scheduled_time", scheduled_time)("now", now);
+      attempt.slot_offset = now_fine - fc::time_point( scheduled_time );
       return block_production_condition::lag;
    }
 
+   // never sign a second block for a slot, e.g. after the witness was removed and added again
+   auto last_signed_itr = _last_signed_slot.find( scheduled_witness );
+   if( last_signed_itr != _last_signed_slot.end() && last_signed_itr->second >= scheduled_time )
+   {
+      capture("scheduled_time", scheduled_time);
+      return block_production_condition::already_produced;
+   }
+
    //if (gpo.parameters.witness_schedule_algorithm == GRAPHENE_WITNESS_SCHEDULED_ALGORITHM)
    ilog("Witness ${id} production slot has arrived; generating a block now...", ("id", scheduled_witness));
 
+   attempt.slot_offset = graphene::time::now() - fc::time_point( scheduled_time );
    auto block = db.generate_block(
       scheduled_time,
       scheduled_witness,
       private_key_itr->second,
       _production_skip_flags
       );
+   _last_signed_slot[scheduled_witness] = scheduled_time;
+   attempt.block_num = block.block_num();
+   attempt.timings = db.get_last_block_generation_timings();
 
    capture("n", block.block_num())("t", block.timestamp)("c", now);
-   fc::async( [this,block](){ p2p_node().broadcast(net::block_message(block)); } );
+   // the attempt is recorded before the broadcast runs, its sequence is the next one
+   const uint64_t sequence = _next_attempt_sequence;
+   if( app().p2p_node() != nullptr )
+      fc::async( [this,block,sequence](){
+         const fc::time_point start = fc::time_point::now();
+         p2p_node().broadcast(net::block_message(block));
+         record_broadcast( sequence, fc::time_point::now() - start );
+      } );
 
    return block_production_condition::produced;
 }
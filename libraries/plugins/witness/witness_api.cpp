@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <graphene/app/application.hpp>
+
+#include <graphene/witness/witness_api.hpp>
+#include <graphene/witness/witness.hpp>
+
+namespace graphene { namespace witness_plugin {
+
+namespace detail {
+
+class witness_api_impl
+{
+   public:
+      witness_api_impl( graphene::app::application& _app );
+
+      std::shared_ptr< witness_plugin > get_plugin()const;
+
+      graphene::app::application& app;
+};
+
+witness_api_impl::witness_api_impl( graphene::app::application& _app ) : app( _app )
+{}
+
+std::shared_ptr< witness_plugin > witness_api_impl::get_plugin()const
+{
+   auto plugin = app.get_plugin< witness_plugin >( "witness" );
+   FC_ASSERT( plugin, "The witness plugin is not enabled on this node" );
+   return plugin;
+}
+
+} // detail
+
+witness_api::witness_api( graphene::app::application& app )
+{
+   my = std::make_shared< detail::witness_api_impl >(app);
+}
+
+std::vector<block_production_attempt> witness_api::get_production_history( uint32_t limit )const
+{
+   FC_ASSERT( limit <= 1000 );
+   return my->get_plugin()->get_production_history( limit );
+}
+
+block_production_summary witness_api::get_production_summary()const
+{
+   return my->get_plugin()->get_production_summary();
+}
+
+void witness_api::update_producers( const producer_update& update )
+{
+   my->get_plugin()->update_producers( update );
+}
+
+producer_summary witness_api::get_producers()const
+{
+   return my->get_plugin()->get_producers();
+}
+
+} } // graphene::witness_plugin
@@ -4205,9 +4205,10 @@ vector< signed_transaction > wallet_api_impl::import_balance( string name_or_id,
    uint32_t max_ops_per_tx = 30;
 
    map< address, private_key_type > keys;  // local index of address -> private key
-   vector< address > addrs;
+   vector< public_key_type > pubs;
+   vector< private_key_type > privs;
    bool has_wildcard = false;
-   addrs.reserve( wif_keys.size() );
+   pubs.reserve( wif_keys.size() );
    for( const string& wif_key : wif_keys )
    {
       if( wif_key == "*" )
@@ -4216,13 +4217,13 @@ vector< signed_transaction > wallet_api_impl::import_balance( string name_or_id,
             continue;
          for( const public_key_type& pub : _wallet.extra_keys[ claimer.id ] )
          {
-            addrs.push_back( pub );
             auto it = _keys.find( pub );
             if( it != _keys.end() )
             {
                fc::optional< fc::ecc::private_key > privkey = wif_to_key( it->second );
                FC_ASSERT( privkey );
-               keys[ addrs.back() ] = *privkey;
+               pubs.push_back( pub );
+               privs.push_back( *privkey );
             }
             else
             {
@@ -4235,24 +4236,24 @@ vector< signed_transaction > wallet_api_impl::import_balance( string name_or_id,
       {
          optional< private_key_type > key = wif_to_key( wif_key );
          FC_ASSERT( key.valid(), "Invalid private key" );
-         fc::ecc::public_key pk = key->get_public_key();
-         addrs.push_back( pk );
-         keys[addrs.back()] = *key;
-         // see chain/balance_evaluator.cpp
-         addrs.push_back( pts_address( pk, false, 56 ) );
-         keys[addrs.back()] = *key;
-         addrs.push_back( pts_address( pk, true, 56 ) );
-         keys[addrs.back()] = *key;
-         addrs.push_back( pts_address( pk, false, 0 ) );
-         keys[addrs.back()] = *key;
-         addrs.push_back( pts_address( pk, true, 0 ) );
-         keys[addrs.back()] = *key;
+         pubs.push_back( key->get_public_key() );
+         privs.push_back( *key );
       }
    }
 
-   vector< balance_object > balances = _remote_db->get_balance_objects( addrs );
+   // the node finds the balances under every address form of the keys, see balance_object::owner_addresses()
+   vector< vector< balance_object > > balances_by_key = _remote_db->get_balance_objects_by_keys( pubs );
+   vector< balance_object > balances;
+   set< balance_id_type > found;  // a key given twice finds its balances twice
+   for( size_t i = 0; i < balances_by_key.size(); ++i )
+      for( const balance_object& b : balances_by_key[i] )
+      {
+         if( !found.insert( b.id ).second )
+            continue;
+         keys[ b.owner ] = privs[i];
+         balances.push_back( b );
+      }
    wdump((balances));
-   addrs.clear();
 
    set<asset_id_type> bal_types;
    for( auto b : balances ) bal_types.insert( b.balance.asset_id );
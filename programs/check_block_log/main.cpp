@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Verifies the block log of a data directory with block_database::verify() and prints the damaged ranges, and
+ *  optionally repairs it.  Verification only reads the log, so it may run while the node is running.  Repairing
+ *  requires the node to be stopped, the blocks cut from the log are fetched from the peers when it starts again.
+ */
+
+#include <graphene/chain/block_database.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/json.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+
+using namespace graphene::chain;
+namespace bpo = boost::program_options;
+
+int main( int argc, char** argv )
+{
+   try {
+      bpo::options_description opts;
+      opts.add_options()
+         ("help,h", "Print this help message and exit.")
+         ("data-dir,d", bpo::value<boost::filesystem::path>(), "Data directory of the node whose block log is checked")
+         ("threads,t", bpo::value<uint32_t>()->default_value(0), "Number of threads verifying the blocks, by default "
+                                                                  "one per core")
+         ("repair", "Rebuild the index from the blocks file if that recovers blocks, and cut the log before the "
+                    "first damaged block")
+         ("rebuild-index", "Rebuild the index from the blocks file before verifying the log")
+         ("json", "Print the result as JSON")
+         ;
+
+      bpo::variables_map options;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), options );
+      if( options.count("help") || !options.count("data-dir") )
+      {
+         std::cout << opts << "\n";
+         return options.count("help") ? 0 : 1;
+      }
+
+      const fc::path blocks_dir = fc::path( options.at("data-dir").as<boost::filesystem::path>() )
+                                  / "blockchain" / "database" / "block_num_to_block";
+      FC_ASSERT( fc::exists( blocks_dir / "blocks" ), "There is no block log in ${d}", ("d", blocks_dir) );
+      const uint32_t threads = options.at("threads").as<uint32_t>();
+
+      if( options.count("rebuild-index") )
+         std::cout << "The rebuilt index ends at block " << block_database::rebuild_index( blocks_dir ) << "\n";
+      if( options.count("repair") )
+         std::cout << "The repaired log ends at block " << block_database::repair( blocks_dir, threads ) << "\n";
+
+      const fc::time_point start = fc::time_point::now();
+      const block_log_verification result = block_database::verify( blocks_dir, threads );
+      const fc::microseconds elapsed = fc::time_point::now() - start;
+
+      if( options.count("json") )
+         std::cout << fc::json::to_pretty_string( result ) << "\n";
+      else
+      {
+         std::cout << "Checked blocks " << result.first_block_num << " to " << result.last_block_num << " in "
+                   << double( elapsed.count() ) / 1000000.0 << " sec\n";
+         if( result.blocks_without_checksum > 0 )
+            std::cout << result.blocks_without_checksum << " blocks were stored without checksum and only decoded\n";
+         if( result.unindexed_bytes > 0 )
+            std::cout << result.unindexed_bytes << " bytes at the end of the blocks file are not indexed\n";
+         for( const auto& damage : result.damaged )
+            std::cout << "Blocks " << damage.first_block_num << " to " << damage.last_block_num << " are damaged: "
+                      << damage.reason << "\n";
+         if( result.damaged.empty() )
+            std::cout << "The block log is intact\n";
+      }
+      return result.damaged.empty() ? 0 : 2;
+   } catch( const fc::exception& e ) {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+}
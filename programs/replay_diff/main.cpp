@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Replays the block log of a data directory through two databases in lockstep, or through one database and
+ *  compares it against a trace written by another build of this tool, and reports the first block after which
+ *  the state digests, the operations or the operation results differ, with the first differing operation and the
+ *  objects whose hashes differ.
+ *
+ *  The block log is only read, but the tool should still be pointed at a copy of the data directory of a node
+ *  which is not running.  The databases are built from genesis in temporary directories.
+ */
+
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/block_trace.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/protocol/fee_schedule.hpp>
+#include <graphene/egenesis/egenesis.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+
+using namespace graphene::chain;
+using namespace std;
+namespace bpo = boost::program_options;
+
+namespace {
+
+/** what is compared at every interval, also the format of the trace file, one JSON object per line */
+struct replay_record
+{
+   uint32_t                    block_num = 0;
+   block_id_type               block_id;
+   fc::uint128                 digest;
+   vector<graphene::db::index_digest> indexes;
+   /** of every operation and its result applied since the previous record */
+   fc::sha256                  operations_digest;
+   /** set if the block could not be applied */
+   string                      error;
+   /** every block applied since the previous record, which locates the first difference within the interval */
+   vector<block_trace>         blocks;
+};
+
+}
+
+FC_REFLECT( replay_record, (block_num)(block_id)(digest)(indexes)(operations_digest)(error)(blocks) )
+
+namespace {
+
+const uint32_t default_skip_flags = database::skip_witness_signature |
+                                    database::skip_transaction_signatures |
+                                    database::skip_transaction_dupe_check |
+                                    database::skip_tapos_check |
+                                    database::skip_witness_schedule_check |
+                                    database::skip_authority_check;
+
+string index_name( uint8_t space_id, uint8_t type_id )
+{
+   return fc::to_string( space_id ) + "." + fc::to_string( type_id );
+}
+
+string index_name( object_id_type id )
+{
+   return index_name( id.space(), id.type() );
+}
+
+string to_json( const fc::variant& v )
+{
+   return fc::json::to_pretty_string( v );
+}
+
+/**
+ *  A database built from genesis in a temporary directory, which traces every block applied since the last
+ *  record so that a difference found at the end of an interval can be narrowed down.
+ */
+class replayer
+{
+   public:
+      replayer( const string& name, const genesis_state_type& genesis, uint32_t skip )
+      : name( name ), _dir( graphene::utilities::temp_directory_path() ), _skip( skip )
+      {
+         db.set_state_digest_history( 1 );
+         db.open( _dir.path(), [&genesis]{ return genesis; } );
+         // every block is final, as during a reindex
+         db._undo_db.disable();
+         db.applied_block.connect( [this]( const signed_block& b ){ on_applied_block( b ); } );
+      }
+
+      void apply( const signed_block& b )
+      {
+         if( !error.empty() )
+            return;
+         try
+         {
+            db.apply_block( b, _skip );
+            auto record = db.get_block_state_digest( b.block_num() );
+            FC_ASSERT( record.valid() );
+            _blocks.push_back( make_block_trace( *record, _operations_of_block ) );
+         }
+         catch( const fc::exception& e )
+         {
+            error = e.to_detail_string();
+         }
+         _operations_of_block.clear();
+      }
+
+      /** @return the record for the head block and starts a new interval */
+      replay_record next_record()
+      {
+         replay_record result;
+         result.block_num = db.head_block_num();
+         result.block_id  = db.head_block_id();
+         result.digest    = db.get_state_digest();
+         result.indexes   = db.get_index_digests();
+         result.operations_digest = _operations.result();
+         result.error     = error;
+         result.blocks    = std::move( _blocks );
+         _operations.reset();
+         _blocks.clear();
+         return result;
+      }
+
+      string                        name;
+      database                      db;
+      string                        error;
+
+   private:
+      void on_applied_block( const signed_block& b )
+      {
+         for( const auto& op : db.get_applied_operations() )
+            if( op.valid() )
+            {
+               fc::raw::pack( _operations, *op );
+               _operations_of_block.push_back( *op );
+            }
+      }
+
+      fc::temp_directory                 _dir;
+      uint32_t                           _skip;
+      fc::sha256::encoder                _operations;
+      /** the state digest of a block is recorded after applied_block is emitted */
+      vector<operation_history_object>   _operations_of_block;
+      vector<block_trace>                _blocks;
+};
+
+set<string> differing_indexes( const replay_record& a, const replay_record& b )
+{
+   map< string, std::pair<fc::uint128,fc::uint128> > digests;
+   for( const auto& item : a.indexes )
+      digests[ index_name( item.space_id, item.type_id ) ].first = item.digest;
+   for( const auto& item : b.indexes )
+      digests[ index_name( item.space_id, item.type_id ) ].second = item.digest;
+   set<string> result;
+   for( const auto& item : digests )
+      if( item.second.first != item.second.second )
+         result.insert( item.first );
+   return result;
+}
+
+bool equal( const replay_record& a, const replay_record& b )
+{
+   return a.block_id == b.block_id && a.digest == b.digest && a.operations_digest == b.operations_digest
+          && a.error.empty() && b.error.empty();
+}
+
+void print_differences( const replay_record& a, const replay_record& b, const string& name_a, const string& name_b )
+{
+   if( !a.error.empty() )
+      std::cout << name_a << " failed to apply a block:\n" << a.error << "\n";
+   if( !b.error.empty() )
+      std::cout << name_b << " failed to apply a block:\n" << b.error << "\n";
+   if( a.operations_digest != b.operations_digest )
+      std::cout << "The operations or their results differ\n";
+   for( const auto& name : differing_indexes( a, b ) )
+      std::cout << "Index " << name << " differs\n";
+}
+
+string object_hash( const block_trace& block, object_id_type id )
+{
+   for( const auto& item : block.changed_objects )
+      if( item.first == id )
+         return item.second == fc::uint128() ? string( "(removed)" ) : "hash " + string( item.second );
+   return "(not changed)";
+}
+
+string describe_object( const block_trace& block, object_id_type id, const database* db, uint32_t last )
+{
+   if( !db )
+      return object_hash( block, id );
+   const object* obj = db->find_object( id );
+   return object_hash( block, id ) + ", as of block " + fc::to_string( last ) + ": "
+          + ( obj ? to_json( obj->to_variant() ) : string( "(removed)" ) );
+}
+
+/**
+ *  Finds the first block of the last interval after which the two sides disagree and prints the first operation
+ *  of that block which differs and the objects changed by that block whose hashes differ.  The objects are
+ *  printed in full from the sides which have a database, a trace only holds their hashes.
+ */
+void report_first_difference( const replay_record& a, const replay_record& b, const string& name_a,
+                              const string& name_b, const database* db_a, const database* db_b,
+                              uint32_t first, uint32_t last )
+{
+   optional<block_trace_difference> difference = find_first_difference( a.blocks, b.blocks );
+   if( !difference.valid() )
+   {
+      std::cout << "The first divergent block is between " << first << " and " << last << "\n";
+      return;
+   }
+
+   const uint32_t num = difference->block_num;
+   auto block_of = []( const replay_record& r, uint32_t num ) -> const block_trace& {
+      return *std::find_if( r.blocks.begin(), r.blocks.end(),
+                            [num]( const block_trace& t ) { return t.block_num == num; } );
+   };
+   const block_trace& block_a = block_of( a, num );
+   const block_trace& block_b = block_of( b, num );
+
+   std::cout << "First divergent block: " << num << "\n";
+   if( difference->operation.valid() )
+   {
+      const uint32_t op = *difference->operation;
+      std::cout << "First differing operation, number " << op << " of the block:\n";
+      std::cout << name_a << ": " << ( op < block_a.operations.size() ? to_json( fc::variant( block_a.operations[op] ) )
+                                                                        : string( "(none)" ) ) << "\n";
+      std::cout << name_b << ": " << ( op < block_b.operations.size() ? to_json( fc::variant( block_b.operations[op] ) )
+                                                                        : string( "(none)" ) ) << "\n";
+   }
+   for( const auto& id : difference->objects )
+   {
+      std::cout << "Object " << string( id ) << ":\n";
+      std::cout << name_a << ": " << describe_object( block_a, id, db_a, last ) << "\n";
+      std::cout << name_b << ": " << describe_object( block_b, id, db_b, last ) << "\n";
+   }
+}
+
+genesis_state_type load_genesis( const bpo::variables_map& options )
+{
+   std::string genesis_str;
+   if( options.count("genesis-json") )
+      fc::read_file_contents( options.at("genesis-json").as<boost::filesystem::path>(), genesis_str );
+   else
+   {
+      graphene::egenesis::compute_egenesis_json( genesis_str );
+      FC_ASSERT( genesis_str != "", "No genesis was compiled in, use --genesis-json" );
+   }
+   genesis_state_type genesis = fc::json::from_string( genesis_str ).as<genesis_state_type>();
+   genesis.initial_chain_id = fc::sha256::hash( genesis_str );
+   return genesis;
+}
+
+}
+
+int main( int argc, char** argv )
+{
+   try {
+      bpo::options_description opts;
+      opts.add_options()
+         ("help,h", "Print this help message and exit.")
+         ("data-dir,d", bpo::value<boost::filesystem::path>(), "Copy of the data directory holding the block log to replay")
+         ("genesis-json", bpo::value<boost::filesystem::path>(), "File to read the genesis state from, by default the "
+                                                                 "built-in genesis is used")
+         ("skip-a", bpo::value<uint32_t>()->default_value(default_skip_flags), "Skip flags of the first replay")
+         ("skip-b", bpo::value<uint32_t>()->default_value(default_skip_flags), "Skip flags of the second replay")
+         ("interval", bpo::value<uint32_t>()->default_value(100), "Number of blocks between comparisons, the first "
+                                                                  "divergent block is searched within the interval")
+         ("to", bpo::value<uint32_t>(), "Last block to replay, by default the last block of the log")
+         ("write-trace", bpo::value<boost::filesystem::path>(), "Replay once with --skip-a and write the records "
+                                                                "compared at every interval to a file, with the "
+                                                                "object hashes and operations of every block")
+         ("compare-trace", bpo::value<boost::filesystem::path>(), "Replay once with --skip-a and compare against a "
+                                                                  "trace written by another build")
+         ;
+
+      bpo::variables_map options;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), options );
+      if( options.count("help") || !options.count("data-dir") )
+      {
+         std::cout << opts << "\n";
+         return options.count("help") ? 0 : 1;
+      }
+
+      const uint32_t interval = std::max<uint32_t>( 1, options.at("interval").as<uint32_t>() );
+      const genesis_state_type genesis = load_genesis( options );
+
+      block_database blocks;
+      blocks.open( fc::path( options.at("data-dir").as<boost::filesystem::path>() ) / "blockchain" / "database" / "block_num_to_block" );
+      FC_ASSERT( blocks.first_block_num() == 1, "The block log is pruned, it can not be replayed from genesis" );
+      optional<block_id_type> last_id = blocks.last_id();
+      FC_ASSERT( last_id.valid(), "The block log is empty" );
+      uint32_t last = block_header::num_from_id( *last_id );
+      if( options.count("to") )
+         last = std::min( last, options.at("to").as<uint32_t>() );
+
+      // the trace of another build is read up front, the records tell at which blocks to compare
+      std::map<uint32_t,replay_record> trace;
+      if( options.count("compare-trace") )
+      {
+         std::ifstream in( options.at("compare-trace").as<boost::filesystem::path>().string() );
+         FC_ASSERT( in, "Unable to read the trace file" );
+         std::string line;
+         while( std::getline( in, line ) )
+            if( !line.empty() )
+            {
+               auto record = fc::json::from_string( line ).as<replay_record>();
+               trace[record.block_num] = record;
+            }
+         FC_ASSERT( !trace.empty(), "The trace file is empty" );
+         last = std::min( last, trace.rbegin()->first );
+      }
+      std::ofstream trace_out;
+      if( options.count("write-trace") )
+      {
+         trace_out.open( options.at("write-trace").as<boost::filesystem::path>().string(), std::ofstream::trunc );
+         FC_ASSERT( trace_out, "Unable to write the trace file" );
+      }
+      const bool lockstep = !options.count("write-trace") && !options.count("compare-trace");
+
+      replayer a( "a", genesis, options.at("skip-a").as<uint32_t>() );
+      unique_ptr<replayer> b;
+      if( lockstep )
+         b.reset( new replayer( "b", genesis, options.at("skip-b").as<uint32_t>() ) );
+
+      uint32_t previous = 0;
+      for( uint32_t num = 1; num <= last; ++num )
+      {
+         if( num % 10000 == 0 )
+            std::cerr << "   " << num << " of " << last << "\n";
+         fc::optional<signed_block> block = blocks.fetch_by_number( num );
+         FC_ASSERT( block.valid(), "Block ${n} is missing from the block log", ("n", num) );
+         a.apply( *block );
+         if( b )
+            b->apply( *block );
+
+         bool compare_now = trace.empty() ? ( num % interval == 0 || num == last ) : trace.count( num ) > 0;
+         if( !compare_now && a.error.empty() && ( !b || b->error.empty() ) )
+            continue;
+
+         replay_record record = a.next_record();
+         if( trace_out.is_open() )
+         {
+            trace_out << fc::json::to_string( record ) << "\n";
+            if( !record.error.empty() )
+            {
+               std::cout << "Block " << num << " could not be applied:\n" << record.error << "\n";
+               return 1;
+            }
+         }
+         else if( b )
+         {
+            replay_record other = b->next_record();
+            if( !equal( record, other ) )
+            {
+               std::cout << "The replays disagree after block " << num << "\n";
+               print_differences( record, other, a.name, b->name );
+               report_first_difference( record, other, a.name, b->name, &a.db, &b->db, previous + 1, num );
+               return 1;
+            }
+         }
+         else
+         {
+            auto itr = trace.find( num );
+            if( itr == trace.end() || !equal( record, itr->second ) )
+            {
+               std::cout << "This build and the trace disagree between blocks " << previous + 1 << " and " << num << "\n";
+               if( itr != trace.end() )
+               {
+                  print_differences( record, itr->second, "this build", "the trace" );
+                  report_first_difference( record, itr->second, "this build", "the trace", &a.db, nullptr,
+                                           previous + 1, num );
+               }
+               else
+                  print_differences( record, replay_record(), "this build", "the trace" );
+               return 1;
+            }
+         }
+         previous = num;
+      }
+
+      std::cout << "The replays agree after block " << last << "\n";
+      return 0;
+   } catch( const fc::exception& e ) {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+}
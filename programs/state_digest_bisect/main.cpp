@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  Finds the first block after which two nodes started with --state-digest-history disagree about the
+ *  state, and the indexes and objects which differ after that block.
+ */
+
+#include <fc/io/json.hpp>
+#include <fc/network/http/websocket.hpp>
+#include <fc/rpc/websocket_api.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <graphene/app/api.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+
+using namespace graphene::app;
+using namespace graphene::chain;
+using namespace std;
+namespace bpo = boost::program_options;
+
+namespace {
+
+struct remote_node
+{
+   remote_node( const string& url, const string& user, const string& password )
+   : url( url )
+   {
+      connection = client.connect( url );
+      apic = std::make_shared<fc::rpc::websocket_api_connection>( *connection );
+      auto login = apic->get_remote_api< login_api >( 1 );
+      FC_ASSERT( login->login( user, password ), "Could not log in to ${u}", ("u", url) );
+      db = login->database();
+   }
+
+   optional<state_digest_record> get( uint32_t block_num )
+   {
+      auto result = db->get_state_digest( block_num );
+      if( result.valid() )
+         FC_ASSERT( block_num == 0 || result->block_num == block_num );
+      return result;
+   }
+
+   string                                             url;
+   fc::http::websocket_client                         client;
+   fc::http::websocket_connection_ptr                 connection;
+   std::shared_ptr<fc::rpc::websocket_api_connection> apic;
+   fc::api<database_api>                              db;
+};
+
+string index_name( uint8_t space_id, uint8_t type_id )
+{
+   return fc::to_string( space_id ) + "." + fc::to_string( type_id );
+}
+
+string index_name( object_id_type id )
+{
+   return index_name( id.space(), id.type() );
+}
+
+string to_string( const fc::uint128& digest )
+{
+   return fc::json::to_string( fc::variant( digest ) );
+}
+
+class digest_comparator
+{
+   public:
+      digest_comparator( const set<string>& ignored ) : _ignored( ignored ) {}
+
+      /** @return the indexes whose digests differ, ignoring the ignored indexes */
+      map< string, std::pair<fc::uint128,fc::uint128> > differing_indexes( const state_digest_record& a,
+                                                                           const state_digest_record& b )const
+      {
+         map< string, std::pair<fc::uint128,fc::uint128> > result;
+         for( const auto& item : a.indexes )
+            result[ index_name( item.space_id, item.type_id ) ].first = item.digest;
+         for( const auto& item : b.indexes )
+            result[ index_name( item.space_id, item.type_id ) ].second = item.digest;
+         for( auto itr = result.begin(); itr != result.end(); )
+         {
+            if( itr->second.first == itr->second.second || _ignored.count( itr->first ) )
+               itr = result.erase( itr );
+            else
+               ++itr;
+         }
+         return result;
+      }
+
+      bool equal( const state_digest_record& a, const state_digest_record& b )const
+      {
+         return a.block_id == b.block_id && differing_indexes( a, b ).empty();
+      }
+
+      /** @return the changed objects whose hashes after the block differ, ignoring the ignored indexes */
+      vector<object_id_type> differing_objects( const state_digest_record& a, const state_digest_record& b )const
+      {
+         map< object_id_type, std::pair<optional<fc::uint128>,optional<fc::uint128>> > objects;
+         for( const auto& item : a.changed_objects )
+            objects[item.first].first = item.second;
+         for( const auto& item : b.changed_objects )
+            objects[item.first].second = item.second;
+         vector<object_id_type> result;
+         for( const auto& item : objects )
+            if( item.second.first != item.second.second && !_ignored.count( index_name( item.first ) ) )
+               result.push_back( item.first );
+         return result;
+      }
+
+   private:
+      set<string> _ignored;
+};
+
+}
+
+int main( int argc, char** argv )
+{
+   try {
+      bpo::options_description opts;
+      opts.add_options()
+         ("help,h", "Print this help message and exit.")
+         ("node-a,a", bpo::value<string>(), "Websocket RPC endpoint of the first node")
+         ("node-b,b", bpo::value<string>(), "Websocket RPC endpoint of the second node")
+         ("rpc-user,u", bpo::value<string>()->default_value(""), "Username for both nodes")
+         ("rpc-password,p", bpo::value<string>()->default_value(""), "Password for both nodes")
+         ("from", bpo::value<uint32_t>(), "A block after which both nodes are known to agree, by default the tool "
+                                          "searches backwards from --to")
+         ("to", bpo::value<uint32_t>(), "A block after which the nodes disagree, by default the lower head block")
+         ("ignore-index", bpo::value<vector<string>>()->composing(), "Index to leave out of the comparison as SPACE.TYPE, "
+                                                                     "for example objects maintained by plugins that are "
+                                                                     "configured differently (may specify multiple times)")
+         ;
+
+      bpo::variables_map options;
+      bpo::store( bpo::parse_command_line( argc, argv, opts ), options );
+      if( options.count("help") || !options.count("node-a") || !options.count("node-b") )
+      {
+         std::cout << opts << "\n";
+         return options.count("help") ? 0 : 1;
+      }
+
+      set<string> ignored;
+      if( options.count("ignore-index") )
+         for( const auto& name : options.at("ignore-index").as<vector<string>>() )
+            ignored.insert( name );
+      digest_comparator compare( ignored );
+
+      const string user = options.at("rpc-user").as<string>();
+      const string password = options.at("rpc-password").as<string>();
+      remote_node node_a( options.at("node-a").as<string>(), user, password );
+      remote_node node_b( options.at("node-b").as<string>(), user, password );
+
+      auto fetch = [&]( remote_node& node, uint32_t block_num ) -> state_digest_record {
+         auto result = node.get( block_num );
+         FC_ASSERT( result.valid(), "${u} does not keep the state digest of block ${n}, is it running with --state-digest-history?",
+                    ("u", node.url)("n", block_num) );
+         return *result;
+      };
+
+      uint32_t high;
+      if( options.count("to") )
+         high = options.at("to").as<uint32_t>();
+      else
+         high = std::min( fetch( node_a, 0 ).block_num, fetch( node_b, 0 ).block_num );
+
+      if( compare.equal( fetch( node_a, high ), fetch( node_b, high ) ) )
+      {
+         std::cout << "The nodes agree after block " << high << "\n";
+         return 0;
+      }
+
+      // search backwards in growing steps for a block after which the nodes agree
+      uint32_t low;
+      if( options.count("from") )
+      {
+         low = options.at("from").as<uint32_t>();
+         FC_ASSERT( low < high );
+         FC_ASSERT( compare.equal( fetch( node_a, low ), fetch( node_b, low ) ),
+                    "The nodes already disagree after block ${n}", ("n", low) );
+      }
+      else
+      {
+         uint32_t step = 1;
+         uint32_t oldest_different = high;
+         while( true )
+         {
+            FC_ASSERT( oldest_different > 1, "The nodes disagree after every block" );
+            uint32_t candidate = oldest_different > step ? oldest_different - step : 1;
+            auto a = node_a.get( candidate );
+            auto b = node_b.get( candidate );
+            if( !a.valid() || !b.valid() )
+            {
+               std::cout << "The nodes already disagree after block " << oldest_different
+                         << ", the oldest block whose state digest is kept by both nodes\n";
+               return 1;
+            }
+            if( compare.equal( *a, *b ) )
+            {
+               low = candidate;
+               break;
+            }
+            oldest_different = candidate;
+            step *= 2;
+         }
+         high = oldest_different;
+      }
+
+      // invariant: the nodes agree after low and disagree after high
+      while( high - low > 1 )
+      {
+         uint32_t middle = low + ( high - low ) / 2;
+         if( compare.equal( fetch( node_a, middle ), fetch( node_b, middle ) ) )
+            low = middle;
+         else
+            high = middle;
+      }
+
+      auto a = fetch( node_a, high );
+      auto b = fetch( node_b, high );
+      std::cout << "First divergent block: " << high << "\n";
+      if( a.block_id != b.block_id )
+      {
+         std::cout << "The nodes are on different forks: " << string( a.block_id ) << " vs " << string( b.block_id ) << "\n";
+         return 1;
+      }
+      std::cout << "Block id: " << string( a.block_id ) << "\n";
+      std::cout << "Differing indexes:\n";
+      for( const auto& item : compare.differing_indexes( a, b ) )
+         std::cout << "   " << item.first << ": " << to_string( item.second.first ) << " vs " << to_string( item.second.second ) << "\n";
+      std::cout << "Objects changed by the block which differ:\n";
+      for( const auto& id : compare.differing_objects( a, b ) )
+      {
+         std::cout << "   " << string( id ) << "\n";
+      }
+      return 1;
+   } catch( const fc::exception& e ) {
+      std::cerr << e.to_detail_string() << "\n";
+      return 1;
+   }
+}
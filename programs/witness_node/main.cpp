@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/app/application.hpp>
+#include <graphene/app/database_api.hpp>
 
 #include <graphene/witness/witness.hpp>
 #include <graphene/account_history/account_history_plugin.hpp>
@@ -30,6 +31,7 @@
 //#include <graphene/generate_uia_sharedrop_genesis/generate_uia_sharedrop_genesis.hpp>
 
 #include <fc/exception/exception.hpp>
+#include <fc/io/json.hpp>
 #include <fc/thread/thread.hpp>
 #include <fc/interprocess/signals.hpp>
 #include <fc/log/console_appender.hpp>
@@ -165,7 +167,18 @@ int main(int argc, char** argv) {
       node->initialize(data_dir, options);
       node->initialize_plugins( options );
 
+      // only opens the database if the statistics are dumped, see application::startup()
       node->startup();
+
+      if( options.count("dump-index-statistics") )
+      {
+         app::database_api db_api( *node->chain_database() );
+         std::cout << fc::json::to_pretty_string( db_api.get_database_statistics() ) << "\n";
+         node->shutdown();
+         delete node;
+         return 0;
+      }
+
       node->startup_plugins();
 
       fc::promise<int>::ptr exit_promise = new fc::promise<int>("UNIX Signal Handler");
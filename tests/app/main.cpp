@@ -32,6 +32,8 @@
 
 #include <graphene/account_history/account_history_plugin.hpp>
 
+#include <graphene/net/exceptions.hpp>
+
 #include <fc/thread/thread.hpp>
 #include <fc/smart_ref_impl.hpp>
 
@@ -152,3 +154,60 @@ BOOST_AUTO_TEST_CASE( two_node_network )
       throw;
    }
 }
+
+BOOST_AUTO_TEST_CASE( pruned_node_serves_retained_blocks )
+{
+   using namespace graphene::chain;
+   using namespace graphene::app;
+   try {
+      fc::temp_directory app_dir( graphene::utilities::temp_directory_path() );
+
+      graphene::app::application app1;
+      boost::program_options::variables_map cfg;
+      cfg.emplace("p2p-endpoint", boost::program_options::variable_value(string("127.0.0.1:3941"), false));
+      cfg.emplace("block-log-retention", boost::program_options::variable_value(uint32_t(5), false));
+      cfg.emplace("state-snapshot-interval", boost::program_options::variable_value(uint32_t(5), false));
+      app1.initialize(app_dir.path(), cfg);
+      app1.startup();
+
+      std::shared_ptr<chain::database> db = app1.chain_database();
+      fc::ecc::private_key committee_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("nathan")));
+      for( int i = 0; i < 40; ++i )
+         db->generate_block( db->get_slot_time(1), db->get_scheduled_witness(1), committee_key, database::skip_nothing );
+      const uint32_t first = db->first_retained_block_num();
+      BOOST_REQUIRE( first > 2 );
+
+      graphene::net::node_delegate* delegate = app1.p2p_delegate();
+      uint32_t remaining = 0;
+
+      BOOST_TEST_MESSAGE( "A peer without blocks can not sync from a pruned node" );
+      BOOST_CHECK_THROW( delegate->get_block_ids( vector<graphene::net::item_hash_t>(), remaining, 100 ),
+                         graphene::net::peer_is_on_an_unreachable_fork );
+
+      BOOST_TEST_MESSAGE( "Neither can a peer which needs a pruned block next" );
+      vector<graphene::net::item_hash_t> synopsis{ db->get_block_id_for_num( first - 2 ) };
+      BOOST_CHECK_THROW( delegate->get_block_ids( synopsis, remaining, 100 ),
+                         graphene::net::peer_is_on_an_unreachable_fork );
+
+      BOOST_TEST_MESSAGE( "A peer which needs the first retained block next gets the rest of the chain" );
+      synopsis = { db->get_block_id_for_num( first - 1 ) };
+      auto ids = delegate->get_block_ids( synopsis, remaining, 100 );
+      BOOST_REQUIRE( !ids.empty() );
+      BOOST_CHECK( ids.back() == db->head_block_id() );
+      BOOST_CHECK_EQUAL( remaining, 0 );
+      ids = delegate->get_block_ids( synopsis, remaining, 2 );
+      BOOST_CHECK_EQUAL( ids.size(), 2 );
+      BOOST_CHECK_EQUAL( remaining, db->head_block_num() - first );
+
+      BOOST_TEST_MESSAGE( "Pruned blocks are not served, retained ones are" );
+      BOOST_CHECK_THROW( delegate->get_item( graphene::net::item_id( graphene::net::block_message_type,
+                                                                     db->get_block_id_for_num( first - 1 ) ) ),
+                         fc::key_not_found_exception );
+      auto item = delegate->get_item( graphene::net::item_id( graphene::net::block_message_type,
+                                                              db->get_block_id_for_num( first ) ) );
+      BOOST_CHECK( item.as<graphene::net::block_message>().block.block_num() == first );
+   } catch( fc::exception& e ) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_listing_object.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/asset_object.hpp>
+#include <graphene/chain/is_authorized_asset.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::chain;
+
+/**
+ *  An issuer whitelists every account of a large genesis for its asset.  Before listings were separate objects,
+ *  each modification of the issuer account copied the whole whitelist into the undo state.
+ */
+BOOST_AUTO_TEST_CASE( account_whitelist_bench )
+{
+   try {
+#ifdef NDEBUG
+      const int account_count = 100000;
+#else
+      const int account_count = 10000;
+#endif
+      const int ops_per_trx = 100;
+      const int updates = 1000;
+
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")));
+      genesis_state_type genesis_state;
+      genesis_state.initial_timestamp = time_point_sec( GRAPHENE_TESTING_GENESIS_TIMESTAMP );
+      genesis_state.initial_active_witnesses = 10;
+      for( int i = 0; i < genesis_state.initial_active_witnesses; ++i )
+      {
+         auto name = "init"+fc::to_string(i);
+         genesis_state.initial_accounts.emplace_back(name,
+                                                     init_account_priv_key.get_public_key(),
+                                                     init_account_priv_key.get_public_key(),
+                                                     true);
+         genesis_state.initial_committee_candidates.push_back({name});
+         genesis_state.initial_witness_candidates.push_back({name, init_account_priv_key.get_public_key()});
+      }
+      for( int i = 0; i < account_count; ++i )
+         genesis_state.initial_accounts.emplace_back("target"+fc::to_string(i),
+                                                     public_key_type(fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key()));
+      genesis_state.initial_parameters.current_fees->zero_all_fees();
+
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      database db;
+      db.open( data_dir.path(), [&]{return genesis_state;} );
+
+      const auto& accounts_by_name = db.get_index_type<account_index>().indices().get<by_name>();
+      const account_id_type issuer_id = accounts_by_name.find( "init0" )->id;
+      std::vector<account_id_type> targets;
+      for( int i = 0; i < account_count; ++i )
+         targets.push_back( accounts_by_name.find( "target"+fc::to_string(i) )->id );
+
+      signed_transaction trx;
+      trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+      asset_create_operation creator;
+      creator.issuer = issuer_id;
+      creator.symbol = "LISTED";
+      creator.precision = 2;
+      creator.common_options.core_exchange_rate = price({asset(1,asset_id_type(1)),asset(1)});
+      creator.common_options.max_supply = GRAPHENE_MAX_SHARE_SUPPLY;
+      creator.common_options.flags = white_list;
+      creator.common_options.issuer_permissions = white_list;
+      creator.common_options.whitelist_authorities.insert( issuer_id );
+      trx.operations.push_back( creator );
+      processed_transaction ptx = db.push_transaction( trx, ~0 );
+      const asset_object& listed_asset = db.get<asset_object>( ptx.operation_results[0].get<object_id_type>() );
+
+      auto start_time = fc::time_point::now();
+      for( int i = 0; i < account_count; i += ops_per_trx )
+      {
+         trx.operations.clear();
+         for( int j = i; j < i + ops_per_trx && j < account_count; ++j )
+         {
+            account_whitelist_operation wop;
+            wop.authorizing_account = issuer_id;
+            wop.account_to_list = targets[j];
+            wop.new_listing = account_whitelist_operation::white_listed;
+            trx.operations.push_back( wop );
+         }
+         trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+         db.push_transaction( trx, ~0 );
+         if( (i / ops_per_trx) % 100 == 99 )
+            db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, ~0 );
+      }
+      db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), init_account_priv_key, ~0 );
+      ilog( "Whitelisted ${c} accounts in ${t} milliseconds.",
+            ("c", account_count)("t", (fc::time_point::now() - start_time).count() / 1000) );
+      BOOST_CHECK_EQUAL( db.get_index_type<account_listing_index>().indices().size(), account_count );
+
+      // each update of the issuer is applied in its own undo session, like a pending transaction
+      start_time = fc::time_point::now();
+      for( int i = 0; i < updates; ++i )
+      {
+         trx.operations.clear();
+         account_update_operation uop;
+         uop.account = issuer_id;
+         uop.new_options = issuer_id(db).options;
+         uop.new_options.memo_key = public_key_type( fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key() );
+         trx.operations.push_back( uop );
+         trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+         db.push_transaction( trx, ~0 );
+      }
+      ilog( "Updated the issuer of a ${c} account whitelist ${u} times in ${t} milliseconds.",
+            ("c", account_count)("u", updates)("t", (fc::time_point::now() - start_time).count() / 1000) );
+
+      start_time = fc::time_point::now();
+      int authorized = 0;
+      for( const account_id_type& target : targets )
+         if( is_authorized_asset( db, target(db), listed_asset ) )
+            ++authorized;
+      ilog( "Checked ${c} whitelisted accounts in ${t} milliseconds.",
+            ("c", account_count)("t", (fc::time_point::now() - start_time).count() / 1000) );
+      BOOST_CHECK_EQUAL( authorized, account_count );
+      BOOST_CHECK( !is_authorized_asset( db, issuer_id(db), listed_asset ) );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/app/database_api.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/balance_object.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::chain;
+
+/**
+ *  A sharedrop genesis with one balance per key, spread over the five address forms of the keys.  Measures
+ *  the genesis load and the discovery of the balances by key against the lookup of every address form.
+ */
+BOOST_AUTO_TEST_CASE( balance_key_lookup_bench )
+{
+   try {
+#ifdef NDEBUG
+      const int balance_count = 500000;
+#else
+      const int balance_count = 20000;
+#endif
+      const int keys_per_query = 100;
+
+      vector<public_key_type> keys;
+      keys.reserve( balance_count );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")));
+      genesis_state_type genesis_state;
+      genesis_state.initial_timestamp = time_point_sec( GRAPHENE_TESTING_GENESIS_TIMESTAMP );
+      genesis_state.initial_active_witnesses = 10;
+      for( int i = 0; i < genesis_state.initial_active_witnesses; ++i )
+      {
+         auto name = "init"+fc::to_string(i);
+         genesis_state.initial_accounts.emplace_back(name,
+                                                     init_account_priv_key.get_public_key(),
+                                                     init_account_priv_key.get_public_key(),
+                                                     true);
+         genesis_state.initial_committee_candidates.push_back({name});
+         genesis_state.initial_witness_candidates.push_back({name, init_account_priv_key.get_public_key()});
+      }
+      for( int i = 0; i < balance_count; ++i )
+      {
+         keys.emplace_back( fc::ecc::private_key::regenerate(fc::digest(i)).get_public_key() );
+         genesis_state.initial_balances.push_back( { balance_object::owner_addresses( keys.back() )[i % 5], GRAPHENE_SYMBOL, 1 } );
+      }
+
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      database db;
+      auto start_time = fc::time_point::now();
+      db.open( data_dir.path(), [&]{return genesis_state;} );
+      ilog( "Loaded a genesis with ${c} balances in ${t} milliseconds.",
+            ("c", balance_count)("t", (fc::time_point::now() - start_time).count() / 1000) );
+
+      graphene::app::database_api db_api( db );
+
+      start_time = fc::time_point::now();
+      size_t found = 0;
+      for( int i = 0; i < balance_count; i += keys_per_query )
+      {
+         vector<public_key_type> query( keys.begin() + i, keys.begin() + std::min( i + keys_per_query, balance_count ) );
+         for( const auto& balances : db_api.get_balance_objects_by_keys( query ) )
+            found += balances.size();
+      }
+      ilog( "Found the balances of ${c} keys in ${t} milliseconds.",
+            ("c", balance_count)("t", (fc::time_point::now() - start_time).count() / 1000) );
+      BOOST_CHECK_EQUAL( found, size_t( balance_count ) );
+
+      // what a client had to do before, expanding every key and asking for all of the addresses
+      start_time = fc::time_point::now();
+      found = 0;
+      for( int i = 0; i < balance_count; i += keys_per_query )
+      {
+         vector<address> query;
+         for( int j = i; j < std::min( i + keys_per_query, balance_count ); ++j )
+            for( const address& a : balance_object::owner_addresses( keys[j] ) )
+               query.push_back( a );
+         found += db_api.get_balance_objects( query ).size();
+      }
+      ilog( "Found the balances of ${c} keys by their address forms in ${t} milliseconds.",
+            ("c", balance_count)("t", (fc::time_point::now() - start_time).count() / 1000) );
+      BOOST_CHECK_EQUAL( found, size_t( balance_count ) );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/block_database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+using namespace graphene::chain;
+
+namespace {
+
+/** blocks resembling a busy chain: transfers between a few accounts, signed by their keys */
+std::vector<signed_block> make_transfer_blocks( uint32_t count, uint32_t transfers_per_block )
+{
+   std::vector<fc::ecc::private_key> keys;
+   for( int i = 0; i < 10; ++i )
+      keys.push_back( fc::ecc::private_key::regenerate( fc::digest(i) ) );
+   chain_id_type chain_id;
+
+   std::vector<signed_block> blocks;
+   signed_block b;
+   b.timestamp = fc::time_point_sec( GRAPHENE_TESTING_GENESIS_TIMESTAMP );
+   for( uint32_t i = 0; i < count; ++i )
+   {
+      if( i > 0 ) b.previous = b.id();
+      b.timestamp += 3;
+      b.witness = witness_id_type( i % 11 + 1 );
+      b.transactions.clear();
+      for( uint32_t j = 0; j < transfers_per_block; ++j )
+      {
+         transfer_operation op;
+         op.fee = asset( 2000000 );
+         op.from = account_id_type( 17 + (i + j) % keys.size() );
+         op.to = account_id_type( 17 + (i + 2*j + 1) % keys.size() );
+         op.amount = asset( (i * transfers_per_block + j) * 10000 );
+         signed_transaction trx;
+         trx.operations.push_back( op );
+         trx.ref_block_num = b.block_num() - 1;
+         trx.expiration = b.timestamp + 30;
+         trx.sign( keys[(i + j) % keys.size()], chain_id );
+         b.transactions.emplace_back( trx );
+      }
+      b.transaction_merkle_root = b.calculate_merkle_root();
+      b.sign( keys[b.witness.instance.value % keys.size()] );
+      blocks.push_back( b );
+   }
+   return blocks;
+}
+
+void report( const string& name, const fc::path& dir, uint32_t count )
+{
+   block_database bdb;
+   bdb.open( dir );
+   auto start_time = fc::time_point::now();
+   for( uint32_t num = 1; num <= count; ++num )
+      FC_ASSERT( bdb.fetch_by_number( num ).valid() );
+   auto elapsed = (fc::time_point::now() - start_time).count() / 1000;
+   bdb.close();
+   ilog( "${n}: ${s} bytes, read ${c} blocks in ${t} milliseconds",
+         ("n", name)("s", fc::file_size( dir / "blocks" ))("c", count)("t", elapsed) );
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( block_log_compression_bench )
+{
+   try {
+#ifdef NDEBUG
+      const uint32_t blocks_to_store = 100000;
+#else
+      const uint32_t blocks_to_store = 5000;
+#endif
+      std::vector<signed_block> blocks = make_transfer_blocks( blocks_to_store, 10 );
+
+      fc::temp_directory raw_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory compressed_dir( graphene::utilities::temp_directory_path() );
+      {
+         block_database raw, compressed;
+         raw.open( raw_dir.path() );
+         compressed.open( compressed_dir.path() );
+         compressed.set_compression( true );
+         for( const auto& b : blocks )
+         {
+            raw.store( b.id(), b );
+            compressed.store( b.id(), b );
+         }
+      }
+      report( "raw", raw_dir.path(), blocks_to_store );
+      report( "compressed", compressed_dir.path(), blocks_to_store );
+
+      auto start_time = fc::time_point::now();
+      block_database::migrate( raw_dir.path(), true );
+      ilog( "Migrated ${c} blocks in ${t} milliseconds", ("c", blocks_to_store)("t", (fc::time_point::now() - start_time).count() / 1000) );
+      report( "compressed with dictionary", raw_dir.path(), blocks_to_store );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
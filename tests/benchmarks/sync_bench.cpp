@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/utilities/tempdir.hpp>
+
+#include <fc/crypto/digest.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/json.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <cstdlib>
+
+using namespace graphene::chain;
+
+namespace {
+
+genesis_state_type make_sync_genesis()
+{
+   genesis_state_type genesis_state;
+   genesis_state.initial_timestamp = time_point_sec( GRAPHENE_TESTING_GENESIS_TIMESTAMP );
+
+   auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")));
+   genesis_state.initial_active_witnesses = 10;
+   for( int i = 0; i < genesis_state.initial_active_witnesses; ++i )
+   {
+      auto name = "init"+fc::to_string(i);
+      genesis_state.initial_accounts.emplace_back(name,
+                                                  init_account_priv_key.get_public_key(),
+                                                  init_account_priv_key.get_public_key(),
+                                                  true);
+      genesis_state.initial_committee_candidates.push_back({name});
+      genesis_state.initial_witness_candidates.push_back({name, init_account_priv_key.get_public_key()});
+   }
+   genesis_state.initial_parameters.current_fees->zero_all_fees();
+   return genesis_state;
+}
+
+uint64_t sync_blocks( const std::vector<signed_block>& blocks, const flat_map<uint32_t,block_id_type>& checkpoints )
+{
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   database db;
+   db.open( data_dir.path(), make_sync_genesis );
+   db.add_checkpoints( checkpoints );
+
+   auto start_time = fc::time_point::now();
+   for( const signed_block& b : blocks )
+      db.push_block( b, database::skip_transaction_signatures );
+   return (fc::time_point::now() - start_time).count() / 1000;
+}
+
+std::vector<signed_block> produce_transfer_blocks( int blocks_to_produce, int transfers_per_block )
+{
+   std::vector<signed_block> blocks;
+   fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+   database db;
+   db.open( data_dir.path(), make_sync_genesis );
+   auto witness_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+   const auto& accounts_by_name = db.get_index_type<account_index>().indices().get<by_name>();
+   std::vector<account_id_type> receivers;
+   for( int i = 0; i < 10; ++i )
+      receivers.push_back( accounts_by_name.find( "init"+fc::to_string(i) )->id );
+
+   for( int i = 0; i < blocks_to_produce; ++i )
+   {
+      for( int j = 0; j < transfers_per_block; ++j )
+      {
+         signed_transaction trx;
+         transfer_operation op;
+         op.from = GRAPHENE_COMMITTEE_ACCOUNT;
+         op.to = receivers[j % receivers.size()];
+         op.amount = asset( i * transfers_per_block + j + 1 );
+         trx.operations.push_back( op );
+         trx.set_expiration( db.head_block_time() + fc::minutes(1) );
+         db.push_transaction( trx, ~0 );
+      }
+      blocks.push_back( db.generate_block( db.get_slot_time( 1 ), db.get_scheduled_witness( 1 ), witness_priv_key, ~0 ) );
+   }
+   return blocks;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE( irreversible_sync_bench )
+{
+   try {
+#ifdef NDEBUG
+      const int blocks_to_produce = 20000;
+#else
+      const int blocks_to_produce = 1000;
+#endif
+      std::vector<signed_block> blocks = produce_transfer_blocks( blocks_to_produce, 20 );
+
+      flat_map<uint32_t,block_id_type> checkpoints;
+      uint64_t with_undo = sync_blocks( blocks, checkpoints );
+      // like the checkpoints which ship, one far ahead; only the blocks within the undo history size of it are
+      // buffered and applied without undo history, the others take the regular path
+      checkpoints[blocks.back().block_num()] = blocks.back().id();
+      uint64_t with_checkpoint = sync_blocks( blocks, checkpoints );
+      const size_t buffered = std::min<size_t>( blocks.size(), GRAPHENE_MAX_UNDO_HISTORY );
+
+      ilog( "Synced ${c} blocks in ${u} milliseconds with undo history, ${n} milliseconds with a checkpoint at the "
+            "last block, of which the last ${b} blocks were applied without undo history.",
+            ("c", blocks.size())("u", with_undo)("n", with_checkpoint)("b", buffered) );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ *  Run once as is and once built with GRAPHENE_DISABLE_MEMORY_POOLS to compare apply throughput; the pool
+ *  statistics show how much memory the index nodes occupy.
+ */
+BOOST_AUTO_TEST_CASE( pooled_allocation_bench )
+{
+   try {
+#ifdef NDEBUG
+      const int blocks_to_produce = 20000;
+#else
+      const int blocks_to_produce = 1000;
+#endif
+      std::vector<signed_block> blocks = produce_transfer_blocks( blocks_to_produce, 20 );
+
+      uint64_t elapsed = sync_blocks( blocks, flat_map<uint32_t,block_id_type>() );
+#ifdef GRAPHENE_DISABLE_MEMORY_POOLS
+      ilog( "Applied ${c} blocks in ${t} milliseconds without memory pools.", ("c", blocks.size())("t", elapsed) );
+#else
+      uint64_t capacity_bytes = 0;
+      uint64_t peak_bytes = 0;
+      for( const auto& pool : graphene::db::get_memory_pool_statistics() )
+      {
+         capacity_bytes += pool.capacity * pool.element_size;
+         peak_bytes += pool.peak_in_use * pool.element_size;
+      }
+      ilog( "Applied ${c} blocks in ${t} milliseconds, memory pools hold ${m} bytes with a peak usage of ${p} bytes.",
+            ("c", blocks.size())("t", elapsed)("m", capacity_bytes)("p", peak_bytes) );
+#endif
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/**
+ *  Replays a real chain, run once as is and once built with GRAPHENE_DISABLE_MEMORY_POOLS.  Point
+ *  GRAPHENE_BENCH_BLOCKCHAIN_DIR at a copy of the blockchain directory of a node, its object graph is replaced,
+ *  and GRAPHENE_BENCH_GENESIS_JSON at the genesis file of the chain.
+ */
+BOOST_AUTO_TEST_CASE( pooled_replay_bench )
+{
+   try {
+      const char* blockchain_dir = std::getenv( "GRAPHENE_BENCH_BLOCKCHAIN_DIR" );
+      const char* genesis_file = std::getenv( "GRAPHENE_BENCH_GENESIS_JSON" );
+      if( blockchain_dir == nullptr || genesis_file == nullptr )
+      {
+         ilog( "Set GRAPHENE_BENCH_BLOCKCHAIN_DIR and GRAPHENE_BENCH_GENESIS_JSON to replay a real chain." );
+         return;
+      }
+      std::string genesis_str;
+      fc::read_file_contents( fc::path( genesis_file ), genesis_str );
+      genesis_state_type genesis = fc::json::from_string( genesis_str ).as<genesis_state_type>();
+      genesis.initial_chain_id = fc::sha256::hash( genesis_str );
+
+      database db;
+      auto start_time = fc::time_point::now();
+      db.reindex( fc::path( blockchain_dir ), genesis );
+      uint64_t elapsed = (fc::time_point::now() - start_time).count() / 1000;
+#ifdef GRAPHENE_DISABLE_MEMORY_POOLS
+      ilog( "Replayed ${c} blocks in ${t} milliseconds without memory pools.", ("c", db.head_block_num())("t", elapsed) );
+#else
+      uint64_t capacity_bytes = 0;
+      uint64_t peak_bytes = 0;
+      for( const auto& pool : graphene::db::get_memory_pool_statistics() )
+      {
+         capacity_bytes += pool.capacity * pool.element_size;
+         peak_bytes += pool.peak_in_use * pool.element_size;
+      }
+      ilog( "Replayed ${c} blocks in ${t} milliseconds, memory pools hold ${m} bytes with a peak usage of ${p} bytes.",
+            ("c", db.head_block_num())("t", elapsed)("m", capacity_bytes)("p", peak_bytes) );
+#endif
+      db.close();
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
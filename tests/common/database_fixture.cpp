@@ -58,7 +58,7 @@ namespace graphene { namespace chain {
 using std::cout;
 using std::cerr;
 
-database_fixture::database_fixture()
+database_fixture::database_fixture( boost::program_options::variables_map options )
    : app(), db( *app.chain_database() )
 {
    try {
@@ -77,7 +77,6 @@ database_fixture::database_fixture()
    auto mhplugin = app.register_plugin<graphene::market_history::market_history_plugin>();
    init_account_pub_key = init_account_priv_key.get_public_key();
 
-   boost::program_options::variables_map options;
 
    genesis_state.initial_timestamp = time_point_sec( GRAPHENE_TESTING_GENESIS_TIMESTAMP );
    genesis_state.initial_timestamp = time_point_sec( (fc::time_point::now().sec_since_epoch() / GRAPHENE_DEFAULT_BLOCK_INTERVAL) * GRAPHENE_DEFAULT_BLOCK_INTERVAL );
@@ -321,6 +320,8 @@ signed_block database_fixture::generate_block(uint32_t skip, const fc::ecc::priv
                             db.get_scheduled_witness(miss_blocks + 1),
                             key, skip);
    db.clear_pending();
+   // plugins process the block on threads of their own, the tests inspect their state right away
+   db.block_events().flush();
    return block;
 }
 
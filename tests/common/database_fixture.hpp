@@ -161,7 +161,8 @@ struct database_fixture {
    bool skip_key_index_test = false;
    uint32_t anon_acct_count;
 
-   database_fixture();
+   /** @param options passed to the plugins, the market history plugin only records buckets with a bucket-size */
+   database_fixture( boost::program_options::variables_map options = boost::program_options::variables_map() );
    ~database_fixture();
 
    static fc::ecc::private_key generate_private_key(string seed);
@@ -24,6 +24,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/chain/block_trace.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 
@@ -34,10 +35,16 @@
 #include <graphene/chain/market_object.hpp>
 #include <graphene/chain/witness_schedule_object.hpp>
 
+#include <graphene/time/time.hpp>
+#include <graphene/utilities/key_conversion.hpp>
 #include <graphene/utilities/tempdir.hpp>
+#include <graphene/witness/witness.hpp>
 
 #include <fc/crypto/digest.hpp>
 
+#include <cstdlib>
+#include <fstream>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -126,6 +133,607 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( block_database_compression_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path blocks_file = data_dir.path() / "blocks";
+
+      vector<signed_block> blocks;
+      signed_block b;
+      for( uint32_t i = 0; i < 20; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i % 3 + 1);
+         b.transactions.clear();
+         for( uint32_t j = 0; j < 5; ++j )
+         {
+            transfer_operation op;
+            op.fee = asset(10);
+            op.from = account_id_type(j+1);
+            op.to = account_id_type(j+2);
+            op.amount = asset(i*5+j);
+            signed_transaction trx;
+            trx.operations.push_back( op );
+            b.transactions.emplace_back( trx );
+         }
+         blocks.push_back( b );
+      }
+
+      auto check_blocks = [&]( const block_database& bdb ) {
+         for( const auto& blk : blocks )
+         {
+            auto fetched = bdb.fetch_by_number( blk.block_num() );
+            BOOST_REQUIRE( fetched.valid() );
+            BOOST_CHECK( fetched->id() == blk.id() );
+            BOOST_CHECK( bdb.fetch_optional( blk.id() ).valid() );
+         }
+         BOOST_CHECK( bdb.last()->id() == blocks.back().id() );
+      };
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      for( uint32_t i = 0; i < 10; ++i )
+         bdb.store( blocks[i].id(), blocks[i] );
+      bdb.flush();
+      auto raw_size = fc::file_size( blocks_file );
+
+      // a log may hold both raw and compressed blocks
+      bdb.set_compression( true );
+      for( uint32_t i = 10; i < 20; ++i )
+         bdb.store( blocks[i].id(), blocks[i] );
+      bdb.flush();
+      BOOST_CHECK( fc::file_size( blocks_file ) - raw_size < raw_size );
+      check_blocks( bdb );
+      bdb.close();
+
+      block_database::migrate( data_dir.path(), true );
+      BOOST_CHECK( fc::exists( data_dir.path() / "blocks.dict" ) );
+      BOOST_CHECK( fc::file_size( blocks_file ) < raw_size );
+      bdb.open( data_dir.path() );
+      check_blocks( bdb );
+      bdb.close();
+
+      block_database::migrate( data_dir.path(), false );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "blocks.dict" ) );
+      BOOST_CHECK( fc::file_size( blocks_file ) == 2 * raw_size );
+      bdb.open( data_dir.path() );
+      check_blocks( bdb );
+      bdb.close();
+
+      // a complete migration which was interrupted while moving its files into place is rolled forward
+      fc::temp_directory raw_dir( graphene::utilities::temp_directory_path() );
+      for( const char* name : { "blocks", "index", "checksums" } )
+         fc::copy( data_dir.path() / name, raw_dir.path() / name );
+      block_database::migrate( data_dir.path(), true );
+      const fc::path migrating_dir( data_dir.path().generic_string() + ".migrating" );
+      fc::create_directories( migrating_dir );
+      for( const char* name : { "index", "checksums" } )
+         fc::copy( raw_dir.path() / name, migrating_dir / name );
+      fc::rename( raw_dir.path() / "blocks", blocks_file );
+      {
+         std::ofstream out( (migrating_dir / "complete").generic_string() );
+         out << "raw";
+      }
+      bdb.open( data_dir.path() );
+      BOOST_CHECK( !fc::exists( migrating_dir ) );
+      BOOST_CHECK( !fc::exists( data_dir.path() / "blocks.dict" ) );
+      check_blocks( bdb );
+      bdb.close();
+
+      // an incomplete one is dropped and the old log is kept
+      fc::create_directories( migrating_dir );
+      {
+         std::ofstream out( (migrating_dir / "blocks").generic_string() );
+         out << "partial";
+      }
+      bdb.open( data_dir.path() );
+      BOOST_CHECK( !fc::exists( migrating_dir ) );
+      check_blocks( bdb );
+      bdb.close();
+
+      // blocks compressed with a dictionary can not be read without it
+      block_database::migrate( data_dir.path(), true );
+      fc::remove( data_dir.path() / "blocks.dict" );
+      bdb.open( data_dir.path() );
+      BOOST_CHECK( !bdb.fetch_by_number( 1 ).valid() );
+      bdb.close();
+
+      // a corrupt uncompressed size is rejected before it is allocated
+      fc::temp_directory corrupt_dir( graphene::utilities::temp_directory_path() );
+      bdb.open( corrupt_dir.path() );
+      bdb.set_compression( true );
+      bdb.store( blocks[0].id(), blocks[0] );
+      bdb.close();
+      {
+         // the first entry starts with its uncompressed size
+         std::fstream out( (corrupt_dir.path() / "blocks").generic_string(),
+                           std::ios::in | std::ios::out | std::ios::binary );
+         const uint32_t raw_size = 0xfffffff0;
+         out.write( (const char*)&raw_size, sizeof(raw_size) );
+      }
+      bdb.open( corrupt_dir.path() );
+      BOOST_CHECK( !bdb.fetch_by_number( 1 ).valid() );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_prune_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path blocks_file = data_dir.path() / "blocks";
+
+      vector<signed_block> blocks;
+      signed_block b;
+      for( uint32_t i = 0; i < 20; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i % 3 + 1);
+         blocks.push_back( b );
+      }
+
+      block_database bdb;
+      bdb.open( data_dir.path() );
+      for( const auto& blk : blocks )
+         bdb.store( blk.id(), blk );
+      bdb.flush();
+      auto full_size = fc::file_size( blocks_file );
+      BOOST_CHECK_EQUAL( bdb.first_block_num(), 1 );
+
+      auto check_pruned = [&]( uint32_t first ) {
+         BOOST_CHECK_EQUAL( bdb.first_block_num(), first );
+         for( const auto& blk : blocks )
+         {
+            // the ids of pruned blocks are kept
+            BOOST_CHECK( bdb.fetch_block_id( blk.block_num() ) == blk.id() );
+            bool retained = blk.block_num() >= first;
+            BOOST_CHECK_EQUAL( bdb.contains( blk.id() ), retained );
+            BOOST_CHECK_EQUAL( bdb.fetch_by_number( blk.block_num() ).valid(), retained );
+            BOOST_CHECK_EQUAL( bdb.fetch_optional( blk.id() ).valid(), retained );
+         }
+         BOOST_CHECK( bdb.last()->id() == blocks.back().id() );
+      };
+
+      // less than half of the log is pruned, the blocks file is left as it is
+      bdb.prune( 6 );
+      check_pruned( 6 );
+      BOOST_CHECK_EQUAL( fc::file_size( blocks_file ), full_size );
+
+      bdb.prune( 16 );
+      check_pruned( 16 );
+      BOOST_CHECK( fc::file_size( blocks_file ) < full_size / 2 );
+
+      // pruning never goes back, and the last block is always kept
+      bdb.prune( 10 );
+      check_pruned( 16 );
+      bdb.prune( 100 );
+      check_pruned( 20 );
+      bdb.close();
+
+      bdb.open( data_dir.path() );
+      check_pruned( 20 );
+
+      // new blocks can be appended to a compacted log
+      b.previous = b.id();
+      blocks.push_back( b );
+      bdb.store( b.id(), b );
+      BOOST_CHECK( bdb.fetch_by_number( 21 ).valid() );
+      BOOST_CHECK( bdb.fetch_by_number( 20 ).valid() );
+      bdb.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( block_database_repair_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path blocks_file = data_dir.path() / "blocks";
+      const fc::path index_file = data_dir.path() / "index";
+
+      vector<signed_block> blocks;
+      signed_block b;
+      for( uint32_t i = 0; i < 20; ++i )
+      {
+         if( i > 0 ) b.previous = b.id();
+         b.witness = witness_id_type(i % 3 + 1);
+         blocks.push_back( b );
+      }
+
+      block_database bdb;
+      auto check_blocks = [&]( uint32_t last ) {
+         bdb.open( data_dir.path() );
+         for( const auto& blk : blocks )
+            BOOST_CHECK_EQUAL( bdb.fetch_by_number( blk.block_num() ).valid(), blk.block_num() <= last );
+         BOOST_CHECK( bdb.last()->id() == blocks[last - 1].id() );
+         bdb.close();
+      };
+      auto overwrite = [&]( const fc::path& file, uint64_t pos, const vector<char>& data ) {
+         std::fstream out( file.generic_string(), std::fstream::binary | std::fstream::in | std::fstream::out );
+         out.seekp( pos );
+         out.write( data.data(), data.size() );
+      };
+
+      bdb.open( data_dir.path() );
+      for( const auto& blk : blocks )
+         bdb.store( blk.id(), blk );
+      bdb.close();
+      const uint64_t entry_size = fc::file_size( index_file ) / 21;
+
+      block_log_verification result = block_database::verify( data_dir.path(), 4 );
+      BOOST_CHECK_EQUAL( result.first_block_num, 1 );
+      BOOST_CHECK_EQUAL( result.last_block_num, 20 );
+      BOOST_CHECK_EQUAL( result.checked_blocks, 20 );
+      BOOST_CHECK_EQUAL( result.blocks_without_checksum, 0 );
+      BOOST_CHECK_EQUAL( result.unindexed_bytes, 0 );
+      BOOST_CHECK( result.damaged.empty() );
+
+      // a lost index is rebuilt from the blocks file when the log is opened
+      fc::remove( index_file );
+      check_blocks( 20 );
+
+      // a damaged index entry is found by the block itself and the next one, which no longer links to it
+      overwrite( index_file, 5 * entry_size, vector<char>( entry_size, 0 ) );
+      result = block_database::verify( data_dir.path(), 3 );
+      BOOST_REQUIRE_EQUAL( result.damaged.size(), 1 );
+      BOOST_CHECK_EQUAL( result.damaged[0].first_block_num, 5 );
+      BOOST_CHECK_EQUAL( result.damaged[0].last_block_num, 6 );
+      BOOST_CHECK_EQUAL( block_database::repair( data_dir.path() ), 20 );
+      check_blocks( 20 );
+
+      // an index which lost its end while the blocks were written
+      fc::resize_file( index_file, 11 * entry_size );
+      result = block_database::verify( data_dir.path() );
+      BOOST_CHECK_EQUAL( result.last_block_num, 10 );
+      BOOST_CHECK( result.damaged.empty() );
+      BOOST_CHECK( result.unindexed_bytes > 0 );
+      BOOST_CHECK_EQUAL( block_database::repair( data_dir.path() ), 20 );
+      check_blocks( 20 );
+
+      // a damaged block is caught by its checksum, the log is cut before it
+      uint64_t pos = 0;
+      for( uint32_t i = 0; i < 11; ++i )
+         pos += fc::raw::pack_size( blocks[i] );
+      overwrite( blocks_file, pos + fc::raw::pack_size( blocks[11] ) / 2, vector<char>( 4, 'x' ) );
+      result = block_database::verify( data_dir.path() );
+      BOOST_REQUIRE_EQUAL( result.damaged.size(), 1 );
+      BOOST_CHECK_EQUAL( result.damaged[0].first_block_num, 12 );
+      BOOST_CHECK_EQUAL( result.damaged[0].last_block_num, 12 );
+      BOOST_CHECK_EQUAL( block_database::repair( data_dir.path() ), 11 );
+      check_blocks( 11 );
+      BOOST_CHECK_EQUAL( fc::file_size( blocks_file ), pos );
+
+      // the cut blocks are stored again
+      bdb.open( data_dir.path() );
+      for( uint32_t i = 11; i < 20; ++i )
+         bdb.store( blocks[i].id(), blocks[i] );
+      bdb.close();
+      result = block_database::verify( data_dir.path() );
+      BOOST_CHECK( result.damaged.empty() );
+      BOOST_CHECK_EQUAL( result.last_block_num, 20 );
+      check_blocks( 20 );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( pruned_block_log_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      vector<signed_block> blocks;
+      block_id_type head_id;
+      {
+         database db;
+         db.set_block_log_retention( 10, 5 );
+         db.open( data_dir.path(), make_genesis );
+         // snapshots are taken at every 5th block, the last two blocks are not covered by one
+         for( uint32_t i = 0; i < 62; ++i )
+            blocks.push_back( db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1),
+                                                 init_account_priv_key, database::skip_nothing ) );
+         head_id = db.head_block_id();
+
+         const uint32_t first = db.first_retained_block_num();
+         BOOST_CHECK( first > 1 );
+         BOOST_CHECK( first <= db.get_dynamic_global_properties().last_irreversible_block_num );
+         BOOST_CHECK( db.head_block_num() + 1 - first >= 10 );
+         BOOST_CHECK( !db.fetch_block_by_number( first - 1 ).valid() );
+         BOOST_CHECK( db.get_block_id_for_num( 1 ) == blocks[0].id() );
+
+         // a node which got the older blocks elsewhere can sync the retained ones from the pruned node
+         database db2;
+         db2.open( data_dir2.path(), make_genesis );
+         for( uint32_t num = 1; num < first; ++num )
+            PUSH_BLOCK( db2, blocks[num - 1] );
+         for( uint32_t num = first; num <= db.head_block_num(); ++num )
+         {
+            auto block = db.fetch_block_by_number( num );
+            BOOST_REQUIRE( block.valid() );
+            PUSH_BLOCK( db2, *block );
+         }
+         BOOST_CHECK( db2.head_block_id() == head_id );
+         db2.close();
+         // db is not closed, as after a crash
+      }
+      {
+         // the blocks after the last snapshot are replayed from the pruned log
+         database db;
+         db.set_block_log_retention( 10, 5 );
+         db.reindex( data_dir.path(), make_genesis() );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         BOOST_CHECK( db.first_retained_block_num() > 1 );
+         db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing );
+         head_id = db.head_block_id();
+         db.close();
+      }
+      {
+         database db;
+         db.open( data_dir.path(), make_genesis );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         db.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( read_only_follower_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      auto generate = [&]( database& db, uint32_t slot ) {
+         return db.generate_block( db.get_slot_time(slot), db.get_scheduled_witness(slot),
+                                   init_account_priv_key, database::skip_nothing );
+      };
+
+      {
+         database primary;
+         primary.open( data_dir.path(), make_genesis );
+         for( uint32_t i = 0; i < 10; ++i )
+            generate( primary, 1 );
+         primary.close();
+      }
+
+      database primary;
+      primary.open( data_dir.path(), make_genesis );
+      primary.set_block_log_flush( true );
+
+      // the follower starts from the state saved by the primary
+      database follower;
+      follower.open_read_only( data_dir.path(), make_genesis );
+      BOOST_CHECK( follower.is_read_only() );
+      BOOST_CHECK( follower.head_block_id() == primary.head_block_id() );
+
+      for( uint32_t i = 0; i < 5; ++i )
+         generate( primary, 1 );
+      BOOST_CHECK_EQUAL( follower.sync_from_block_log(), 5 );
+      BOOST_CHECK( follower.head_block_id() == primary.head_block_id() );
+      BOOST_CHECK_EQUAL( follower.sync_from_block_log(), 0 );
+
+      // the primary replaces its head block, the follower switches with it
+      primary.pop_block();
+      signed_block replaced = generate( primary, 2 );
+      BOOST_CHECK_EQUAL( follower.sync_from_block_log(), 1 );
+      BOOST_CHECK( follower.head_block_id() == replaced.id() );
+
+      // without the saved state the whole log is applied
+      database follower2;
+      follower2.open_read_only( data_dir.path(), make_genesis, false );
+      BOOST_CHECK( follower2.head_block_id() == primary.head_block_id() );
+      GRAPHENE_CHECK_THROW( follower2.wipe( data_dir.path(), true ), fc::exception );
+
+      follower.close();
+      follower2.close();
+      const uint32_t head_num = primary.head_block_num();
+      primary.close();
+
+      // the followers did not write to the data dir
+      database db;
+      db.open( data_dir.path(), make_genesis );
+      BOOST_CHECK_EQUAL( db.head_block_num(), head_num );
+      BOOST_CHECK( db.head_block_id() == replaced.id() );
+      db.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( read_only_follower_reloads_below_its_undo_history )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      auto generate = [&]( database& db, uint32_t slot ) {
+         return db.generate_block( db.get_slot_time(slot), db.get_scheduled_witness(slot),
+                                   init_account_priv_key, database::skip_nothing );
+      };
+
+      {
+         database primary;
+         primary.open( data_dir.path(), make_genesis );
+         for( uint32_t i = 0; i < 20; ++i )
+            generate( primary, 1 );
+         primary.close();
+      }
+
+      database primary;
+      primary.open( data_dir.path(), make_genesis );
+      primary.set_block_log_flush( true );
+
+      // the loaded state has no undo history, the follower can not pop the head block of the primary
+      database follower;
+      follower.open_read_only( data_dir.path(), make_genesis );
+      BOOST_CHECK( follower.head_block_id() == primary.head_block_id() );
+      BOOST_CHECK_EQUAL( follower._undo_db.size(), 0 );
+
+      primary.pop_block();
+      primary.pop_block();
+      for( uint32_t i = 0; i < 3; ++i )
+         generate( primary, 2 );
+
+      // the saved state is not on the chain any more, the follower applies the block log from genesis
+      BOOST_CHECK_EQUAL( follower.sync_from_block_log(), primary.head_block_num() );
+      BOOST_CHECK( follower.head_block_id() == primary.head_block_id() );
+      BOOST_CHECK_EQUAL( follower.sync_from_block_log(), 0 );
+
+      follower.close();
+      primary.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+/** the follower of read_only_follower_process_test, does nothing unless that test started it */
+BOOST_AUTO_TEST_CASE( read_only_follower_child )
+{
+   const char* data_dir = getenv( "GRAPHENE_FOLLOW_DATA_DIR" );
+   const char* result_file = getenv( "GRAPHENE_FOLLOW_RESULT" );
+   if( data_dir == nullptr || result_file == nullptr )
+      return;
+   database follower;
+   follower.open_read_only( fc::path( data_dir ), make_genesis );
+   std::ofstream out( result_file );
+   out << follower.head_block_num() << " " << std::string( follower.head_block_id() );
+   follower.close();
+}
+
+BOOST_AUTO_TEST_CASE( read_only_follower_process_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::temp_directory result_dir( graphene::utilities::temp_directory_path() );
+      const fc::path result_file = result_dir.path() / "follower_head";
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      // runs this test binary again, only the follower test case, on the data directory of the running primary
+      const std::string test_binary = boost::unit_test::framework::master_test_suite().argv[0];
+      auto run_follower = [&]() {
+         fc::remove_all( result_file );
+         setenv( "GRAPHENE_FOLLOW_DATA_DIR", data_dir.path().generic_string().c_str(), 1 );
+         setenv( "GRAPHENE_FOLLOW_RESULT", result_file.generic_string().c_str(), 1 );
+         const std::string command = "\"" + test_binary + "\" --run_test=block_tests/read_only_follower_child";
+         const int status = std::system( command.c_str() );
+         unsetenv( "GRAPHENE_FOLLOW_DATA_DIR" );
+         unsetenv( "GRAPHENE_FOLLOW_RESULT" );
+         BOOST_REQUIRE_EQUAL( status, 0 );
+         std::string head;
+         fc::read_file_contents( result_file, head );
+         return head;
+      };
+
+      database primary;
+      primary.open( data_dir.path(), make_genesis );
+      primary.set_block_log_flush( true );
+      auto expected_head = [&]() {
+         return fc::to_string( primary.head_block_num() ) + " " + std::string( primary.head_block_id() );
+      };
+
+      for( uint32_t i = 0; i < 10; ++i )
+         primary.generate_block( primary.get_slot_time(1), primary.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing );
+      BOOST_CHECK_EQUAL( run_follower(), expected_head() );
+
+      primary.pop_block();
+      for( uint32_t i = 0; i < 5; ++i )
+         primary.generate_block( primary.get_slot_time(2), primary.get_scheduled_witness(2), init_account_priv_key, database::skip_nothing );
+      BOOST_CHECK_EQUAL( run_follower(), expected_head() );
+
+      primary.close();
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( trusted_replay_test )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path blocks_dir = data_dir.path() / "database" / "block_num_to_block";
+      auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      block_id_type head_id;
+      {
+         database db;
+         db.open( data_dir.path(), make_genesis );
+         for( uint32_t i = 0; i < 20; ++i )
+            db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing );
+         head_id = db.head_block_id();
+         db.close();
+      }
+
+      // every block was validated when it was generated
+      optional<trust_record> trust;
+      vector<fc::sha256> digests;
+      {
+         block_database blocks;
+         blocks.open( blocks_dir );
+         for( uint32_t num = 1; num <= 20; ++num )
+         {
+            BOOST_REQUIRE( blocks.fetch_for_replay( num, trust ).valid() );
+            BOOST_REQUIRE( trust.valid() );
+            BOOST_CHECK( trust->block_id == blocks.fetch_block_id( num ) );
+            digests.push_back( trust->results_digest );
+         }
+         blocks.close();
+      }
+
+      {
+         database db;
+         db.reindex( data_dir.path(), make_genesis() );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         db.close();
+      }
+
+      // a record with other results makes the replay start over with full validation, which rewrites it
+      {
+         trust_record record;
+         const size_t digest_offset = (const char*)&record.results_digest - (const char*)&record;
+         std::fstream out( (blocks_dir / "trust").generic_string(), std::fstream::binary | std::fstream::in | std::fstream::out );
+         out.seekp( sizeof(trust_record) * 5 + digest_offset );
+         fc::sha256 bad = fc::sha256::hash( string("bad") );
+         out.write( (const char*)&bad, sizeof(bad) );
+      }
+      {
+         database db;
+         db.reindex( data_dir.path(), make_genesis() );
+         BOOST_CHECK( db.head_block_id() == head_id );
+         db.close();
+      }
+      {
+         block_database blocks;
+         blocks.open( blocks_dir );
+         BOOST_REQUIRE( blocks.fetch_for_replay( 5, trust ).valid() );
+         BOOST_REQUIRE( trust.valid() );
+         BOOST_CHECK( trust->results_digest == digests[4] );
+
+         // a record for a block that is not in the log is ignored
+         signed_block b = *blocks.fetch_by_number( 6 );
+         b.timestamp += 1;
+         blocks.store( b.id(), b );
+         BOOST_REQUIRE( blocks.fetch_for_replay( 6, trust ).valid() );
+         BOOST_CHECK( !trust.valid() );
+         blocks.close();
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -136,13 +744,13 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
       // TODO:  Don't generate this here
       auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
       signed_block cutoff_block;
+      signed_block head_block;
       {
          database db;
          db.open(data_dir.path(), make_genesis );
          b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
 
-         // TODO:  Change this test when we correct #406
-         // n.b. we generate GRAPHENE_MIN_UNDO_HISTORY+1 extra blocks which will be discarded on save
+         // n.b. the reversible blocks after the cutoff are kept on save, together with their undo history
          for( uint32_t i = 1; ; ++i )
          {
             BOOST_CHECK( db.head_block_id() == b.id() );
@@ -158,13 +766,16 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
                break;
             }
          }
+         head_block = b;
+         BOOST_CHECK( head_block.block_num() > cutoff_block.block_num() );
          db.close();
       }
       {
          database db;
          db.open(data_dir.path(), []{return genesis_state_type();});
-         BOOST_CHECK_EQUAL( db.head_block_num(), cutoff_block.block_num() );
-         b = cutoff_block;
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_block.block_num() );
+         BOOST_CHECK_EQUAL( db.get_dynamic_global_properties().last_irreversible_block_num, cutoff_block.block_num() );
+         b = head_block;
          for( uint32_t i = 0; i < 200; ++i )
          {
             BOOST_CHECK( db.head_block_id() == b.id() );
@@ -173,7 +784,18 @@ BOOST_AUTO_TEST_CASE( generate_empty_blocks )
             //BOOST_CHECK( cur_witness != prev_witness );
             b = db.generate_block(db.get_slot_time(1), cur_witness, init_account_priv_key, database::skip_nothing);
          }
-         BOOST_CHECK_EQUAL( db.head_block_num(), cutoff_block.block_num()+200 );
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_block.block_num()+200 );
+      }
+      {
+         database db;
+         db.open(data_dir.path(), []{return genesis_state_type();});
+         BOOST_CHECK_EQUAL( db.head_block_num(), head_block.block_num()+200 );
+         db.close(true);
+      }
+      {
+         database db;
+         db.open(data_dir.path(), []{return genesis_state_type();});
+         BOOST_CHECK_EQUAL( db.head_block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
       }
    } catch (fc::exception& e) {
       edump((e.to_detail_string()));
@@ -293,6 +915,199 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
    }
 }
 
+BOOST_AUTO_TEST_CASE( undo_history_survives_restart )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      std::vector< block_id_type > block_ids;
+      uint32_t last_irreversible;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis);
+         for( uint32_t i = 0; i < 20; ++i )
+         {
+            auto b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            block_ids.push_back( b.id() );
+         }
+         last_irreversible = db.get_dynamic_global_properties().last_irreversible_block_num;
+         BOOST_REQUIRE( last_irreversible < 20 );
+         db.close();
+      }
+      {
+         database db;
+         db.open(data_dir.path(), []{return genesis_state_type();});
+         BOOST_CHECK_EQUAL( db.head_block_num(), 20 );
+         BOOST_CHECK( db.head_block_id() == block_ids.back() );
+
+         // every reversible block can be popped again after the restart
+         while( db.head_block_num() > last_irreversible )
+         {
+            db.pop_block();
+            BOOST_CHECK( db.head_block_id() == block_ids[db.head_block_num()-1] );
+         }
+         GRAPHENE_CHECK_THROW( db.pop_block(), fc::exception );
+         BOOST_CHECK_EQUAL( db.head_block_num(), last_irreversible );
+
+         auto b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         BOOST_CHECK_EQUAL( db.head_block_num(), last_irreversible + 1 );
+      }
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( switch_forks_after_restart )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      std::vector< signed_block > fork_blocks;
+      string db1_tip;
+      {
+         database db1;
+         db1.open(data_dir1.path(), make_genesis);
+         database db2;
+         db2.open(data_dir2.path(), make_genesis);
+
+         for( uint32_t i = 0; i < 10; ++i )
+         {
+            auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+            PUSH_BLOCK( db2, b );
+         }
+         // db1 continues on its own minority fork...
+         for( uint32_t i = 10; i < 13; ++i )
+            db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         db1_tip = db1.head_block_id().str();
+         BOOST_REQUIRE( db1.get_dynamic_global_properties().last_irreversible_block_num <= 10 );
+
+         // ...while db2 builds a longer one
+         uint32_t next_slot = 3;
+         for( uint32_t i = 10; i < 14; ++i )
+         {
+            fork_blocks.push_back( db2.generate_block(db2.get_slot_time(next_slot), db2.get_scheduled_witness(next_slot), init_account_priv_key, database::skip_nothing) );
+            next_slot = 1;
+         }
+         db1.close();
+      }
+
+      database db1;
+      db1.open(data_dir1.path(), []{return genesis_state_type();});
+      BOOST_CHECK_EQUAL( db1.head_block_id().str(), db1_tip );
+      for( const signed_block& b : fork_blocks )
+         PUSH_BLOCK( db1, b );
+      BOOST_CHECK_EQUAL( db1.head_block_num(), 14 );
+      BOOST_CHECK_EQUAL( db1.head_block_id().str(), fork_blocks.back().id().str() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( sync_checkpointed_blocks_without_undo )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+
+      database db1;
+      db1.open(data_dir1.path(), make_genesis);
+      std::vector< signed_block > blocks;
+      for( uint32_t i = 0; i < 20; ++i )
+         blocks.push_back( db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+
+      // a chain which is not the checkpointed one, its blocks are signed correctly but skip a slot each
+      fc::temp_directory data_dir3( graphene::utilities::temp_directory_path() );
+      database db3;
+      db3.open(data_dir3.path(), make_genesis);
+      std::vector< signed_block > fake_blocks;
+      for( uint32_t i = 0; i < 15; ++i )
+         fake_blocks.push_back( db3.generate_block(db3.get_slot_time(2), db3.get_scheduled_witness(2), init_account_priv_key, database::skip_nothing) );
+
+      database db2;
+      db2.open(data_dir2.path(), make_genesis);
+      flat_map<uint32_t,block_id_type> checkpoints;
+      checkpoints[15] = blocks[14].id();
+      db2.add_checkpoints( checkpoints );
+      const block_id_type genesis_head = db2.head_block_id();
+
+      // nothing is applied before the checkpoint block shows which chain is the right one
+      for( uint32_t i = 0; i < 14; ++i )
+      {
+         PUSH_BLOCK( db2, fake_blocks[i] );
+         BOOST_CHECK( db2.head_block_id() == genesis_head );
+      }
+      GRAPHENE_CHECK_THROW( PUSH_BLOCK( db2, fake_blocks[14] ), fc::exception );
+      BOOST_CHECK( db2.head_block_id() == genesis_head );
+      BOOST_CHECK( !db2.replay_required() );
+
+      for( const signed_block& b : blocks )
+      {
+         PUSH_BLOCK( db2, b );
+         if( b.block_num() < 15 )
+            BOOST_CHECK( db2.head_block_id() == genesis_head );
+         else
+            BOOST_CHECK( db2.head_block_id() == b.id() );
+         if( b.block_num() == 15 )
+         {
+            BOOST_CHECK( db2.is_known_irreversible_block( b.block_num() ) );
+            BOOST_CHECK_EQUAL( db2._undo_db.size(), 0 );
+         }
+      }
+      BOOST_CHECK( !db2.is_known_irreversible_block( 16 ) );
+      BOOST_CHECK( db2._undo_db.size() > 0 );
+      BOOST_CHECK( db2.fetch_block_by_number( 10 ).valid() );
+
+      // blocks after the checkpoint are reversible again, the checkpointed ones are not
+      while( db2.head_block_num() > 15 )
+         db2.pop_block();
+      GRAPHENE_CHECK_THROW( db2.pop_block(), fc::exception );
+      BOOST_CHECK( db2.head_block_id() == blocks[14].id() );
+
+      for( uint32_t i = 15; i < 20; ++i )
+         PUSH_BLOCK( db2, blocks[i] );
+      BOOST_CHECK( db2.head_block_id() == db1.head_block_id() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( restart_with_damaged_undo_history )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      block_id_type head_id;
+      {
+         database db;
+         db.open(data_dir.path(), make_genesis);
+         for( uint32_t i = 0; i < 20; ++i )
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+         head_id = db.head_block_id();
+         db.close();
+      }
+
+      // simulate a crash while the undo history was being written
+      fc::path undo_file = data_dir.path() / "object_database" / "undo_history";
+      BOOST_REQUIRE( fc::exists( undo_file ) );
+      fc::resize_file( undo_file, fc::file_size( undo_file ) / 2 );
+
+      database db;
+      db.open(data_dir.path(), []{return genesis_state_type();});
+      BOOST_CHECK( db.head_block_id() == head_id );
+      GRAPHENE_CHECK_THROW( db.pop_block(), fc::exception );
+      db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      BOOST_CHECK_EQUAL( db.head_block_num(), 21 );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
 
 /**
  *  These test has been disabled, out of order blocks should result in the node getting disconnected.
@@ -1301,4 +2116,262 @@ BOOST_FIXTURE_TEST_CASE( miss_many_blocks, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( block_generation_timings, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      generate_block();
+      generate_block();
+      BOOST_CHECK_EQUAL( db.get_last_block_generation_timings().transactions, 0 );
+
+      transfer( committee_account, alice_id, asset(1000) );
+      transfer( committee_account, bob_id, asset(1000) );
+      generate_block();
+      const block_generation_timings& timings = db.get_last_block_generation_timings();
+      BOOST_CHECK_EQUAL( timings.transactions, 2 );
+      BOOST_CHECK_EQUAL( timings.postponed_transactions, 0 );
+      // applying the block includes applying its transactions again
+      BOOST_CHECK( timings.push.count() > 0 );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( witness_producers_update, database_fixture )
+{
+   namespace bpc = graphene::witness_plugin::block_production_condition;
+   try
+   {
+      auto plugin = std::make_shared<graphene::witness_plugin::witness_plugin>();
+      boost::program_options::variables_map options;
+      plugin->plugin_set_app( &app );
+      plugin->plugin_initialize( options );
+
+      // every call runs the production loop at the time of the next slot
+      auto produce = [&]() -> bpc::block_production_condition_enum {
+         graphene::time::start_simulated_time( db.get_slot_time(1) );
+         return plugin->produce_block_if_due();
+      };
+      BOOST_CHECK_EQUAL( produce(), bpc::not_my_turn );
+
+      graphene::witness_plugin::producer_update add_all;
+      for( const witness_id_type& id : db.get_global_properties().active_witnesses )
+         add_all.add_witnesses.push_back( id );
+      add_all.add_private_keys.push_back( graphene::utilities::key_to_wif( init_account_priv_key ) );
+      plugin->update_producers( add_all );
+      BOOST_CHECK_EQUAL( plugin->get_producers().witnesses.size(), 10 );
+      BOOST_CHECK_EQUAL( plugin->get_producers().signing_keys.count( init_account_pub_key ), 1 );
+
+      // a bad key fails the whole update
+      graphene::witness_plugin::producer_update bad_key;
+      bad_key.remove_witnesses = add_all.add_witnesses;
+      bad_key.add_private_keys.push_back( "not a key" );
+      GRAPHENE_REQUIRE_THROW( plugin->update_producers( bad_key ), fc::exception );
+      BOOST_CHECK_EQUAL( plugin->get_producers().witnesses.size(), 10 );
+
+      uint32_t head = db.head_block_num();
+      BOOST_CHECK_EQUAL( produce(), bpc::produced );
+      BOOST_CHECK_EQUAL( db.head_block_num(), head + 1 );
+
+      // the block is popped, removing and adding the witnesses again must not sign its slot a second time
+      const fc::time_point_sec popped_slot = db.head_block_time();
+      db.pop_block();
+      graphene::witness_plugin::producer_update remove_all;
+      remove_all.remove_witnesses = add_all.add_witnesses;
+      remove_all.remove_private_keys.push_back( init_account_pub_key );
+      plugin->update_producers( remove_all );
+      BOOST_CHECK( plugin->get_producers().witnesses.empty() );
+      BOOST_CHECK( plugin->get_producers().signing_keys.empty() );
+      plugin->update_producers( add_all );
+      BOOST_CHECK_EQUAL( db.get_slot_time(1).sec_since_epoch(), popped_slot.sec_since_epoch() );
+      BOOST_CHECK_EQUAL( produce(), bpc::already_produced );
+      BOOST_CHECK_EQUAL( db.head_block_num(), head );
+
+      // move past the slot
+      graphene::time::start_simulated_time( db.get_slot_time(2) );
+      BOOST_CHECK_EQUAL( plugin->produce_block_if_due(), bpc::produced );
+
+      // rotate the signing key of one witness
+      const fc::ecc::private_key new_key = generate_private_key( "new_witness_key" );
+      const witness_id_type rotated_id = *db.get_global_properties().active_witnesses.begin();
+      const witness_object& rotated = rotated_id( db );
+      witness_update_operation op;
+      op.witness = rotated_id;
+      op.witness_account = rotated.witness_account;
+      op.new_signing_key = new_key.get_public_key();
+      trx.operations.push_back( op );
+      trx.validate();
+      sign( trx, init_account_priv_key );
+      PUSH_TX( db, trx, ~0 );
+      trx.clear();
+      generate_block();
+
+      // the node misses the slots of the witness until it has the new key
+      while( db.get_scheduled_witness(1) != rotated_id )
+         BOOST_REQUIRE_EQUAL( produce(), bpc::produced );
+      BOOST_CHECK_EQUAL( produce(), bpc::no_private_key );
+
+      graphene::witness_plugin::producer_update add_key;
+      add_key.add_private_keys.push_back( graphene::utilities::key_to_wif( new_key ) );
+      plugin->update_producers( add_key );
+
+      uint32_t rotated_blocks = 0;
+      for( uint32_t i = 0; i < 20; ++i )
+      {
+         head = db.head_block_num();
+         const fc::time_point_sec previous_time = db.head_block_time();
+         BOOST_REQUIRE_EQUAL( produce(), bpc::produced );
+         BOOST_REQUIRE_EQUAL( db.head_block_num(), head + 1 );
+         optional<signed_block> block = db.fetch_block_by_number( head + 1 );
+         BOOST_REQUIRE( block.valid() );
+         BOOST_CHECK( block->timestamp > previous_time );
+         if( block->witness == rotated_id )
+         {
+            BOOST_CHECK( public_key_type( block->signee() ) == public_key_type( new_key.get_public_key() ) );
+            ++rotated_blocks;
+         }
+      }
+      BOOST_CHECK( rotated_blocks > 0 );
+
+      graphene::time::start_simulated_time( fc::time_point() );
+   }
+   catch (fc::exception& e)
+   {
+      graphene::time::start_simulated_time( fc::time_point() );
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE( state_digest_matches_across_nodes )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+
+      auto check_full_digest = []( const database& db ) {
+         for( const auto& item : db.get_index_digests() )
+            BOOST_CHECK( item.digest == db.get_index( item.space_id, item.type_id ).hash() );
+      };
+
+      database db1;
+      db1.open(data_dir1.path(), make_genesis);
+      db1.set_state_digest_history( 100 );
+      database db2;
+      db2.open(data_dir2.path(), make_genesis);
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      for( uint32_t i = 0; i < 5; ++i )
+         PUSH_BLOCK( db2, db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+
+      // enabling the digest late computes it from the whole state
+      db2.set_state_digest_history( 100 );
+      BOOST_CHECK( db1.get_state_digest() == db2.get_state_digest() );
+      BOOST_CHECK( !db2.get_block_state_digest( 5 ).valid() );
+
+      for( uint32_t i = 5; i < 10; ++i )
+         PUSH_BLOCK( db2, db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+      check_full_digest( db1 );
+      check_full_digest( db2 );
+      for( uint32_t num = 6; num <= 10; ++num )
+      {
+         auto record1 = db1.get_block_state_digest( num );
+         auto record2 = db2.get_block_state_digest( num );
+         BOOST_REQUIRE( record1.valid() && record2.valid() );
+         BOOST_CHECK( record1->digest == record2->digest );
+         BOOST_CHECK( record1->block_id == record2->block_id );
+         BOOST_CHECK( !record1->changed_objects.empty() );
+         BOOST_CHECK( record1->changed_objects == record2->changed_objects );
+      }
+      BOOST_CHECK( db1.get_block_state_digest( 10 )->digest == db1.get_state_digest() );
+
+      // db2 builds a short fork which is undone when db1's longer fork arrives
+      PUSH_BLOCK( db2, db2.generate_block(db2.get_slot_time(2), db2.get_scheduled_witness(2), init_account_priv_key, database::skip_nothing) );
+      BOOST_CHECK( db1.get_state_digest() != db2.get_state_digest() );
+      vector<signed_block> fork;
+      for( uint32_t i = 0; i < 2; ++i )
+         fork.push_back( db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+      for( const auto& b : fork )
+         PUSH_BLOCK( db2, b );
+      BOOST_CHECK_EQUAL( db2.head_block_id().str(), db1.head_block_id().str() );
+      BOOST_CHECK( db1.get_state_digest() == db2.get_state_digest() );
+      check_full_digest( db2 );
+      BOOST_CHECK( db1.get_block_state_digest( 11 )->digest == db2.get_block_state_digest( 11 )->digest );
+      BOOST_CHECK( db1.get_block_state_digest( 12 )->changed_objects == db2.get_block_state_digest( 12 )->changed_objects );
+
+      // only the configured number of blocks is kept
+      db1.set_state_digest_history( 3 );
+      BOOST_CHECK( !db1.get_block_state_digest( 9 ).valid() );
+      BOOST_CHECK( db1.get_block_state_digest( 10 ).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( block_trace_finds_injected_difference, database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) );
+      transfer( account_id_type(), alice_id, asset( 1000 ) );
+      // tx's created by ACTORS() have bogus authority
+      generate_block( database::skip_authority_check );
+
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+      database db2;
+      db2.open( data_dir2.path(), make_genesis );
+      while( db2.head_block_num() < db.head_block_num() )
+         db2.push_block( *db.fetch_block_by_number( db2.head_block_num() + 1 ), database::skip_authority_check );
+      db.set_state_digest_history( 10 );
+      db2.set_state_digest_history( 10 );
+
+      vector<operation_history_object> ops1, ops2;
+      auto collect = []( const database& d, vector<operation_history_object>& ops ) {
+         for( const auto& op : d.get_applied_operations() )
+            if( op.valid() )
+               ops.push_back( *op );
+      };
+      boost::signals2::scoped_connection c1 = db.applied_block.connect( [&]( const signed_block& ){ collect( db, ops1 ); } );
+      boost::signals2::scoped_connection c2 = db2.applied_block.connect( [&]( const signed_block& ){ collect( db2, ops2 ); } );
+
+      // the known difference, alice has one more satoshi on the second node
+      db2.adjust_balance( alice_id, asset( 1 ) );
+      transfer( alice_id, bob_id, asset( 100 ) );
+      signed_block b = db.generate_block( db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                          database::skip_authority_check );
+      db2.push_block( b, database::skip_authority_check );
+
+      vector<block_trace> trace1, trace2;
+      trace1.push_back( make_block_trace( *db.get_block_state_digest( b.block_num() ), ops1 ) );
+      trace2.push_back( make_block_trace( *db2.get_block_state_digest( b.block_num() ), ops2 ) );
+      BOOST_REQUIRE( !trace1.back().operations.empty() );
+      BOOST_CHECK( !find_first_difference( trace1, trace1 ).valid() );
+
+      const auto& balances = db.get_index_type<account_balance_index>().indices().get<by_account_asset>();
+      const object_id_type alice_balance = balances.find( boost::make_tuple( alice_id, asset_id_type() ) )->id;
+      optional<block_trace_difference> difference = find_first_difference( trace1, trace2 );
+      BOOST_REQUIRE( difference.valid() );
+      BOOST_CHECK_EQUAL( difference->block_num, b.block_num() );
+      BOOST_CHECK( !difference->operation.valid() );
+      BOOST_REQUIRE_EQUAL( difference->objects.size(), 1u );
+      BOOST_CHECK( difference->objects[0] == alice_balance );
+
+      // a differing operation is found even where the objects agree
+      vector<block_trace> trace3 = trace1;
+      trace3.back().operations.front().op.get<transfer_operation>().amount.amount += 1;
+      difference = find_first_difference( trace1, trace3 );
+      BOOST_REQUIRE( difference.valid() );
+      BOOST_REQUIRE( difference->operation.valid() );
+      BOOST_CHECK_EQUAL( *difference->operation, 0u );
+      BOOST_CHECK( difference->objects.empty() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
@@ -24,12 +24,21 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/api.hpp>
+#include <graphene/app/database_api.hpp>
 #include <graphene/chain/database.hpp>
 
 #include <graphene/chain/account_object.hpp>
+#include <graphene/chain/block_event_pipeline.hpp>
+#include <graphene/chain/market_object.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+#include <graphene/chain/pts_address.hpp>
+#include <graphene/chain/witness_object.hpp>
 
 #include <fc/crypto/digest.hpp>
 
+#include <thread>
+
 #include "../common/database_fixture.hpp"
 
 using namespace graphene::chain;
@@ -59,3 +68,576 @@ BOOST_AUTO_TEST_CASE( undo_test )
       throw;
    }
 }
+
+BOOST_FIXTURE_TEST_CASE( index_statistics_test, database_fixture )
+{
+   try {
+      auto find_stats = [&]( uint8_t space, uint8_t type ) {
+         for( const auto& stats : db.get_index_statistics() )
+            if( stats.space_id == space && stats.type_id == type )
+               return stats;
+         BOOST_FAIL( "index not found" );
+         return index_statistics();
+      };
+
+      const auto& accounts = db.get_index_type<account_index>().indices();
+      auto before = find_stats( protocol_ids, account_object_type );
+      BOOST_CHECK_EQUAL( before.object_count, accounts.size() );
+      BOOST_CHECK( before.packed_bytes > 0 );
+      BOOST_CHECK( before.memory_bytes >= before.object_count * sizeof(account_object) );
+      BOOST_CHECK( before.secondary_index_bytes > 0 );
+
+      ACTOR( alice );
+      generate_block();
+
+      auto after = find_stats( protocol_ids, account_object_type );
+      BOOST_CHECK_EQUAL( after.object_count, before.object_count + 1 );
+      BOOST_CHECK( after.packed_bytes > before.packed_bytes );
+      BOOST_CHECK( after.secondary_index_bytes > before.secondary_index_bytes );
+
+      // sampling only one object still extrapolates to the whole index
+      auto sampled = db.get_index(protocol_ids, account_object_type).get_statistics( 1 );
+      BOOST_CHECK_EQUAL( sampled.object_count, after.object_count );
+      BOOST_CHECK( sampled.packed_bytes > 0 );
+
+      auto undo = db._undo_db.get_statistics();
+      BOOST_CHECK_EQUAL( undo.depth, db._undo_db.size() );
+      BOOST_CHECK( undo.depth > 0 );
+      BOOST_CHECK( undo.copied_objects > 0 );
+      BOOST_CHECK( undo.packed_bytes > 0 );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( account_name_search_test, database_fixture )
+{
+   try {
+      const account_id_type alice_id = create_account( "alice" ).id;
+      const account_id_type malice_id = create_account( "malice" ).id;
+      const account_id_type alicia_id = create_account( "alicia" ).id;
+      create_account( "alien" );
+      create_account( "bob" );
+      graphene::app::database_api db_api( db );
+
+      auto names = db_api.lookup_accounts_by_prefix( "ALI", "", 1000 );
+      BOOST_REQUIRE_EQUAL( names.size(), 3 );
+      BOOST_CHECK( names.begin()->first == "alice" );
+      BOOST_CHECK( names.rbegin()->first == "alien" );
+      // pages of exactly limit names
+      names = db_api.lookup_accounts_by_prefix( "ali", "", 2 );
+      BOOST_REQUIRE_EQUAL( names.size(), 2 );
+      names = db_api.lookup_accounts_by_prefix( "ali", names.rbegin()->first, 2 );
+      BOOST_REQUIRE_EQUAL( names.size(), 1 );
+      BOOST_CHECK( names.begin()->first == "alien" );
+      BOOST_CHECK( db_api.lookup_accounts_by_prefix( "ali", "alien", 2 ).empty() );
+      BOOST_CHECK( db_api.lookup_accounts_by_prefix( "alz", "", 2 ).empty() );
+
+      // the index is optional, enabling it picks up the existing accounts
+      GRAPHENE_REQUIRE_THROW( db_api.search_accounts_by_name( "lic", account_id_type(), 1000 ), fc::exception );
+      db.enable_account_name_search();
+      db.enable_account_name_search();
+      auto count = [&]( const string& part ) -> size_t {
+         return db_api.search_accounts_by_name( part, account_id_type(), 1000 ).accounts.size();
+      };
+
+      auto found = db_api.search_accounts_by_name( "Lic", account_id_type(), 1000 );
+      BOOST_REQUIRE_EQUAL( found.accounts.size(), 3 );
+      BOOST_CHECK( !found.next.valid() );
+      BOOST_CHECK( found.accounts.begin()->first == alice_id );
+      BOOST_CHECK( found.accounts.rbegin()->first == alicia_id );
+      BOOST_CHECK( found.accounts[malice_id] == "malice" );
+      found = db_api.search_accounts_by_name( "lic", account_id_type(), 1 );
+      BOOST_REQUIRE_EQUAL( found.accounts.size(), 1 );
+      BOOST_REQUIRE( found.next.valid() );
+      BOOST_CHECK( *found.next == malice_id );
+      found = db_api.search_accounts_by_name( "lic", *found.next, 1000 );
+      BOOST_CHECK_EQUAL( found.accounts.size(), 2 );
+      // every trigram of "malicia" is in some name, but no name contains it
+      BOOST_CHECK_EQUAL( count( "malicia" ), 0 );
+      BOOST_CHECK_EQUAL( count( "xyz" ), 0 );
+      GRAPHENE_REQUIRE_THROW( db_api.search_accounts_by_name( "li", account_id_type(), 1000 ), fc::exception );
+
+      // a call stops after looking at max_scanned accounts and tells where to go on
+      const auto& names = dynamic_cast<const primary_index<account_index>&>( db.get_index_type<account_index>() )
+                             .get_secondary_index<account_name_search_index>();
+      optional<account_id_type> next;
+      auto ids = names.find_containing( db, "ali", account_id_type(), 1000, 2, next );
+      BOOST_REQUIRE_EQUAL( ids.size(), 2 );
+      BOOST_REQUIRE( next.valid() );
+      BOOST_CHECK( *next == alicia_id );
+      ids = names.find_containing( db, "ali", *next, 1000, 2, next );
+      BOOST_CHECK_EQUAL( ids.size(), 2 );
+      BOOST_CHECK( !next.valid() );
+
+      {
+         auto session = db._undo_db.start_undo_session();
+         create_account( "policy" );
+         BOOST_CHECK_EQUAL( count( "lic" ), 4 );
+      }
+      BOOST_CHECK_EQUAL( count( "lic" ), 3 );
+
+      db.modify( alicia_id(db), []( account_object& a ) { a.name = "carol"; } );
+      BOOST_CHECK_EQUAL( count( "lic" ), 2 );
+      BOOST_CHECK_EQUAL( count( "aro" ), 1 );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( authority_reference_index_test, database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob)(carol) );
+      graphene::app::database_api db_api( db );
+      auto roles_of = [&]( const vector<authority_reference>& refs, account_id_type id ) -> uint8_t {
+         for( const auto& ref : refs )
+            if( ref.account == id )
+               return ref.roles;
+         return 0;
+      };
+      const uint8_t all_account_roles = owner_reference | active_reference | memo_reference;
+
+      BOOST_TEST_MESSAGE( "Witness signing keys are references of the witness account" );
+      const public_key_type init_key = init_account_priv_key.get_public_key();
+      const witness_object& witness = *db.get_index_type<witness_index>().indices().begin();
+      auto init_refs = db_api.list_key_references( init_key, account_id_type(), 1000 );
+      BOOST_CHECK( roles_of( init_refs, witness.witness_account ) & witness_signing_reference );
+      BOOST_CHECK( roles_of( init_refs, witness.witness_account ) & owner_reference );
+
+      BOOST_TEST_MESSAGE( "Pages of references cover the whole list" );
+      vector<authority_reference> paged;
+      for( account_id_type start; ; )
+      {
+         auto page = db_api.list_key_references( init_key, start, 3 );
+         BOOST_REQUIRE( page.size() <= 3 );
+         if( page.empty() )
+            break;
+         paged.insert( paged.end(), page.begin(), page.end() );
+         start = account_id_type( page.back().account.instance.value + 1 );
+      }
+      BOOST_REQUIRE_EQUAL( paged.size(), init_refs.size() );
+      for( size_t i = 0; i < paged.size(); ++i )
+         BOOST_CHECK( paged[i].account == init_refs[i].account && paged[i].roles == init_refs[i].roles );
+
+      BOOST_TEST_MESSAGE( "Owner, active and memo roles" );
+      auto refs = db_api.list_key_references( alice_public_key, account_id_type(), 1000 );
+      BOOST_REQUIRE_EQUAL( refs.size(), 1 );
+      BOOST_CHECK( refs[0].account == alice_id );
+      BOOST_CHECK_EQUAL( refs[0].roles, all_account_roles );
+
+      db.modify( alice, [&]( account_object& a ) {
+         a.active = authority( 1, bob_public_key, 1 );
+         a.owner.account_auths[bob_id] = 1;
+         a.owner.address_auths[address( pts_address( carol_public_key, false, 56 ) )] = 1;
+      });
+      BOOST_CHECK_EQUAL( roles_of( db_api.list_key_references( alice_public_key, account_id_type(), 1000 ), alice_id ),
+                         owner_reference | memo_reference );
+      refs = db_api.list_key_references( bob_public_key, account_id_type(), 1000 );
+      BOOST_CHECK_EQUAL( roles_of( refs, alice_id ), active_reference );
+      BOOST_CHECK_EQUAL( roles_of( refs, bob_id ), all_account_roles );
+      BOOST_CHECK_EQUAL( roles_of( db_api.list_key_references( carol_public_key, account_id_type(), 1000 ), alice_id ),
+                         owner_reference | address_reference );
+
+      auto account_refs = db_api.list_account_references( bob_id, account_id_type(), 1000 );
+      BOOST_REQUIRE_EQUAL( account_refs.size(), 1 );
+      BOOST_CHECK( account_refs[0].account == alice_id );
+      BOOST_CHECK_EQUAL( account_refs[0].roles, owner_reference );
+      BOOST_CHECK_EQUAL( db_api.get_account_references( bob_id ).size(), 1 );
+      BOOST_CHECK( db_api.list_account_references( bob_id, account_id_type( alice_id.instance.value + 1 ), 1000 ).empty() );
+
+      BOOST_TEST_MESSAGE( "Changing a signing key moves the witness role" );
+      db.modify( witness, [&]( witness_object& w ) { w.signing_key = alice_public_key; } );
+      BOOST_CHECK_EQUAL( roles_of( db_api.list_key_references( alice_public_key, account_id_type(), 1000 ), witness.witness_account ),
+                         witness_signing_reference );
+      BOOST_CHECK( !( roles_of( db_api.list_key_references( init_key, account_id_type(), 1000 ), witness.witness_account )
+                      & witness_signing_reference ) );
+      // the old call only reports authority and memo references
+      auto old_refs = db_api.get_key_references( { alice_public_key } );
+      BOOST_REQUIRE_EQUAL( old_refs.size(), 1 );
+      BOOST_REQUIRE_EQUAL( old_refs[0].size(), 1 );
+      BOOST_CHECK( old_refs[0][0] == alice_id );
+
+      BOOST_TEST_MESSAGE( "Undone accounts are no longer referenced" );
+      {
+         auto session = db._undo_db.start_undo_session();
+         create_account( "dan", carol_public_key );
+         BOOST_CHECK_EQUAL( db_api.list_key_references( carol_public_key, account_id_type(), 1000 ).size(), 3 );
+      }
+      BOOST_CHECK_EQUAL( db_api.list_key_references( carol_public_key, account_id_type(), 1000 ).size(), 2 );
+
+      GRAPHENE_REQUIRE_THROW( db_api.list_key_references( carol_public_key, account_id_type(), 1001 ), fc::exception );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( memory_pool_test )
+{
+   try {
+      graphene::db::memory_pool pool( "test", 3, 1 );
+      auto stats = pool.get_statistics();
+      BOOST_CHECK_EQUAL( stats.element_size, sizeof(void*) );
+      BOOST_CHECK_EQUAL( stats.capacity, 0 );
+
+      std::set<void*> elements;
+      for( int i = 0; i < 100000; ++i )
+         BOOST_CHECK( elements.insert( pool.allocate() ).second );
+      stats = pool.get_statistics();
+      BOOST_CHECK_EQUAL( stats.in_use, elements.size() );
+      BOOST_CHECK( stats.capacity >= elements.size() );
+
+      for( void* p : elements )
+         pool.deallocate( p );
+      // freed elements are reused before the pool grows again
+      auto capacity = stats.capacity;
+      std::vector<void*> reused;
+      for( int i = 0; i < 1000; ++i )
+      {
+         reused.push_back( pool.allocate() );
+         BOOST_CHECK( elements.count( reused.back() ) );
+      }
+      stats = pool.get_statistics();
+      BOOST_CHECK_EQUAL( stats.capacity, capacity );
+      BOOST_CHECK_EQUAL( stats.in_use, 1000 );
+      BOOST_CHECK_EQUAL( stats.peak_in_use, elements.size() );
+      BOOST_CHECK_EQUAL( stats.allocations, elements.size() + 1000 );
+
+      // chunks are returned to the heap once all of their elements are free
+      BOOST_CHECK( pool.release_free_chunks() > 0 );
+      stats = pool.get_statistics();
+      BOOST_CHECK( stats.capacity < capacity );
+      BOOST_CHECK( stats.capacity >= reused.size() );
+      for( void* p : reused )
+         pool.deallocate( p );
+      BOOST_CHECK( pool.release_free_chunks() > 0 );
+      BOOST_CHECK_EQUAL( pool.get_statistics().capacity, 0 );
+      BOOST_CHECK_EQUAL( pool.get_statistics().in_use, 0 );
+
+      // elements freed by another thread are reused
+      std::vector<void*> shared;
+      for( int i = 0; i < 1000; ++i )
+         shared.push_back( pool.allocate() );
+      std::thread other( [&pool, &shared]() {
+         for( void* p : shared )
+            pool.deallocate( p );
+         for( int i = 0; i < 100; ++i )
+            pool.deallocate( pool.allocate() );
+      });
+      other.join();
+      stats = pool.get_statistics();
+      BOOST_CHECK_EQUAL( stats.in_use, 0 );
+      const auto capacity_before = stats.capacity;
+      for( int i = 0; i < 1000; ++i )
+         pool.deallocate( pool.allocate() );
+      BOOST_CHECK_EQUAL( pool.get_statistics().capacity, capacity_before );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+#ifndef GRAPHENE_DISABLE_MEMORY_POOLS
+BOOST_FIXTURE_TEST_CASE( pooled_object_allocation_test, database_fixture )
+{
+   try {
+      auto pool_in_use = []( const string& name ) {
+         for( const auto& stats : graphene::db::get_memory_pool_statistics() )
+            if( stats.name == name )
+               return stats.in_use;
+         return uint64_t(0);
+      };
+      const string node_pool = boost::core::demangle( typeid(account_object).name() ) + " node";
+
+      auto nodes = pool_in_use( node_pool );
+      BOOST_CHECK_EQUAL( nodes, db.get_index_type<account_index>().indices().size() );
+
+      ACTOR( alice );
+      BOOST_CHECK_EQUAL( pool_in_use( node_pool ), nodes + 1 );
+
+      // removed objects return their nodes to the pool, through undo as well
+      {
+         auto session = db._undo_db.start_undo_session();
+         db.remove( alice );
+         BOOST_CHECK_EQUAL( pool_in_use( node_pool ), nodes );
+      }
+      BOOST_CHECK_EQUAL( pool_in_use( node_pool ), nodes + 1 );
+      BOOST_CHECK_EQUAL( alice_id( db ).name, "alice" );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE( state_digest_test, database_fixture )
+{
+   try {
+      db.set_state_digest_history( 10 );
+      auto digest = db.get_state_digest();
+
+      {
+         auto session = db._undo_db.start_undo_session();
+         ACTOR( alice );
+         BOOST_CHECK( db.get_state_digest() != digest );
+      }
+      // undoing restores the digest exactly
+      BOOST_CHECK( db.get_state_digest() == digest );
+
+      // the digest does not depend on the order of the changes
+      ACTOR( bob );
+      ACTOR( carol );
+      auto both = db.get_state_digest();
+      fc::uint128 bob_hash = bob.hash();
+      fc::uint128 carol_hash = carol.hash();
+      db.modify( bob, []( account_object& a ) { a.name = "bob2"; } );
+      db.modify( carol, []( account_object& a ) { a.name = "carol2"; } );
+      db.modify( carol, []( account_object& a ) { a.name = "carol"; } );
+      db.modify( bob, []( account_object& a ) { a.name = "bob"; } );
+      BOOST_CHECK( db.get_state_digest() == both );
+      BOOST_CHECK( bob.hash() == bob_hash && carol.hash() == carol_hash );
+
+      for( const auto& item : db.get_index_digests() )
+         BOOST_CHECK( item.digest == db.get_index( item.space_id, item.type_id ).hash() );
+
+      generate_block();
+      auto record = db.get_block_state_digest( db.head_block_num() );
+      BOOST_REQUIRE( record.valid() );
+      BOOST_CHECK( record->digest == db.get_state_digest() );
+      BOOST_CHECK( std::is_sorted( record->changed_objects.begin(), record->changed_objects.end(),
+                                   []( const std::pair<object_id_type, fc::uint128>& a,
+                                       const std::pair<object_id_type, fc::uint128>& b ) { return a.first < b.first; } ) );
+      BOOST_CHECK( std::any_of( record->changed_objects.begin(), record->changed_objects.end(),
+                                [&]( const std::pair<object_id_type, fc::uint128>& item ) { return item.first == bob_id; } ) );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( block_event_pipeline_test, database_fixture )
+{
+   try {
+      ACTORS( (alice) );
+      const auto& test = create_user_issued_asset( "EVTEST" );
+      const asset_id_type test_id = test.id;
+      generate_block();
+
+      vector<applied_block_event> events;
+      auto consumer = db.block_events().subscribe( "test", 10, true, [&]( const applied_block_event& e ) {
+         events.push_back( e );
+      });
+      const auto has_object = []( const vector< std::shared_ptr<const object> >& objects, object_id_type id ) {
+         return std::any_of( objects.begin(), objects.end(),
+                             [&]( const std::shared_ptr<const object>& o ) { return o->id == id; } );
+      };
+
+      transfer( committee_account, alice_id, asset(1000) );
+      const limit_order_id_type order_id = create_sell_order( alice_id, asset(100), asset(100, test_id) )->id;
+      generate_block();
+      BOOST_REQUIRE_EQUAL( events.size(), 1 );
+      BOOST_CHECK( events[0].block_id == db.head_block_id() );
+      BOOST_CHECK_EQUAL( events[0].block_num, db.head_block_num() );
+      BOOST_CHECK_EQUAL( events[0].last_irreversible_block_num,
+                         db.get_dynamic_global_properties().last_irreversible_block_num );
+      BOOST_CHECK( std::any_of( events[0].operations.begin(), events[0].operations.end(),
+                                []( const optional<operation_history_object>& o ) {
+                                   return o.valid() && o->op.which() == operation::tag<transfer_operation>::value;
+                                } ) );
+      BOOST_CHECK( has_object( events[0].changed_objects, order_id ) );
+      BOOST_CHECK( events[0].removed_objects.empty() );
+
+      BOOST_TEST_MESSAGE( "The objects are copies which stay as they were when the block was applied" );
+      cancel_limit_order( order_id(db) );
+      generate_block();
+      BOOST_REQUIRE_EQUAL( events.size(), 2 );
+      BOOST_CHECK( events[1].block.previous == events[0].block_id );
+      BOOST_CHECK( has_object( events[1].removed_objects, order_id ) );
+      BOOST_CHECK( has_object( events[0].changed_objects, order_id ) );
+      BOOST_CHECK( db.find( order_id ) == nullptr );
+
+      db.block_events().unsubscribe( consumer );
+      generate_block();
+      BOOST_CHECK_EQUAL( events.size(), 2 );
+
+      BOOST_TEST_MESSAGE( "A consumer which falls behind holds the chain back at its capacity" );
+      uint32_t handled = 0;
+      block_event_consumer slow( "slow", 2, false, [&]( const applied_block_event& ) {
+         fc::usleep( fc::milliseconds( 20 ) );
+         ++handled;
+      });
+      auto event = std::make_shared<applied_block_event>( events.back() );
+      for( int i = 0; i < 6; ++i )
+      {
+         slow.push( event );
+         slow.wait_for_capacity();
+         BOOST_CHECK( slow.get_statistics().queued < 2 );
+      }
+      BOOST_CHECK( slow.get_statistics().stalls > 0 );
+      slow.flush();
+      BOOST_CHECK_EQUAL( handled, 6 );
+
+      BOOST_TEST_MESSAGE( "A failing handler does not stop the events behind it" );
+      block_event_consumer failing( "failing", 4, false, []( const applied_block_event& e ) {
+         FC_ASSERT( e.block_num % 2 == 0 );
+      });
+      for( uint32_t i = 1; i <= 4; ++i )
+      {
+         auto numbered = std::make_shared<applied_block_event>();
+         numbered->block_num = i;
+         failing.push( numbered );
+      }
+      failing.flush();
+      BOOST_CHECK_EQUAL( failing.get_statistics().handled, 4 );
+      BOOST_CHECK_EQUAL( failing.get_statistics().failed, 2 );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( node_admin_api_test, database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) );
+      generate_block();
+      graphene::app::node_admin_api admin( app );
+
+      graphene::app::node_health health = admin.get_health();
+      BOOST_CHECK_EQUAL( health.head_block_num, db.head_block_num() );
+      BOOST_CHECK( health.head_block_id == db.head_block_id() );
+      BOOST_CHECK_EQUAL( health.last_irreversible_block_num,
+                         db.get_dynamic_global_properties().last_irreversible_block_num );
+      BOOST_CHECK_EQUAL( health.peer_count, 0 );
+      BOOST_CHECK_EQUAL( health.pending_transactions, 0 );
+      BOOST_REQUIRE_EQUAL( health.block_event_queues.size(), 1 );
+      BOOST_CHECK_EQUAL( health.block_event_queues[0].name, "market_history" );
+
+      // the tests run without p2p node
+      GRAPHENE_REQUIRE_THROW( admin.set_peer_limits( 8, 20 ), fc::exception );
+      GRAPHENE_REQUIRE_THROW( admin.set_bandwidth_limit( 1000000, 1000000 ), fc::exception );
+
+      admin.set_logging_level( "node_admin_test", "debug" );
+      BOOST_CHECK_EQUAL( admin.get_logging_level( "node_admin_test" ), "debug" );
+      GRAPHENE_REQUIRE_THROW( admin.set_logging_level( "node_admin_test", "loud" ), fc::exception );
+
+      BOOST_TEST_MESSAGE( "Access entries are replaced, and apply to the next login" );
+      graphene::app::api_access_info access;
+      access.password_hash_b64 = "*";
+      access.password_salt_b64 = "*";
+      access.allowed_apis = { "database_api", "node_admin_api" };
+      admin.set_api_access( "operator", access );
+      access.allowed_apis = { "database_api" };
+      admin.set_api_access( "operator", access );
+      BOOST_REQUIRE( admin.get_api_access( "operator" ).valid() );
+      BOOST_CHECK( admin.get_api_access( "operator" )->allowed_apis == access.allowed_apis );
+      graphene::app::login_api login( app );
+      BOOST_REQUIRE( login.login( "operator", "password" ) );
+      login.database();
+      GRAPHENE_REQUIRE_THROW( login.node_admin(), fc::exception );
+      admin.remove_api_access( "operator" );
+      BOOST_CHECK( !admin.get_api_access( "operator" ).valid() );
+      BOOST_CHECK( !graphene::app::login_api( app ).login( "operator", "password" ) );
+
+      BOOST_TEST_MESSAGE( "Checkpoints must match the chain" );
+      flat_map<uint32_t,block_id_type> checkpoints;
+      checkpoints[2] = db.get_block_id_for_num( 3 );
+      GRAPHENE_REQUIRE_THROW( admin.add_checkpoints( checkpoints ), fc::exception );
+      block_id_type forged = db.get_block_id_for_num( 2 );
+      forged._hash[4] ^= 1;
+      checkpoints[2] = forged;
+      GRAPHENE_REQUIRE_THROW( admin.add_checkpoints( checkpoints ), fc::exception );
+      BOOST_CHECK( admin.get_checkpoints().empty() );
+      checkpoints[2] = db.get_block_id_for_num( 2 );
+      admin.add_checkpoints( checkpoints );
+      BOOST_CHECK( admin.get_checkpoints() == checkpoints );
+
+      BOOST_TEST_MESSAGE( "Only the history of tracked accounts is recorded" );
+      flat_set<account_id_type> tracked;
+      tracked.insert( alice_id );
+      admin.set_tracked_accounts( tracked );
+      BOOST_CHECK( admin.get_tracked_accounts() == tracked );
+      const auto alice_history = alice_id(db).statistics(db).most_recent_op;
+      const auto bob_history = bob_id(db).statistics(db).most_recent_op;
+      transfer( committee_account, alice_id, asset(1000) );
+      transfer( committee_account, bob_id, asset(1000) );
+      generate_block();
+      BOOST_CHECK( alice_id(db).statistics(db).most_recent_op != alice_history );
+      BOOST_CHECK( bob_id(db).statistics(db).most_recent_op == bob_history );
+      // bob's history has a gap now, recording every account needs a replay
+      GRAPHENE_REQUIRE_THROW( admin.set_tracked_accounts( flat_set<account_id_type>() ), fc::exception );
+      BOOST_CHECK( admin.get_tracked_accounts() == tracked );
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( account_history_heads_test, database_fixture )
+{
+   try {
+      ACTORS( (alice)(bob) );
+      generate_block();
+
+      // the plugin modifies the statistics once per block, the result must be what modifying them for every
+      // operation gives: per account, consecutive sequence numbers linked in creation order
+      auto verify_histories = [&]() {
+         std::map< account_id_type, vector<const account_transaction_history_object*> > histories;
+         for( const auto& ath : db.get_index_type<account_transaction_history_index>().indices().get<by_id>() )
+            histories[ ath.account ].push_back( &ath );
+         for( const auto& item : histories )
+         {
+            const account_statistics_object& stats = item.first(db).statistics(db);
+            account_transaction_history_id_type previous;
+            for( size_t i = 0; i < item.second.size(); ++i )
+            {
+               BOOST_CHECK_EQUAL( item.second[i]->sequence, i + 1 );
+               BOOST_CHECK( item.second[i]->next == previous );
+               previous = item.second[i]->id;
+            }
+            BOOST_CHECK( stats.most_recent_op == previous );
+            BOOST_CHECK_EQUAL( stats.total_ops, item.second.size() );
+            BOOST_CHECK_EQUAL( get_operation_history( item.first ).size(), item.second.size() );
+         }
+      };
+
+      BOOST_TEST_MESSAGE( "Several operations of the same accounts in one block" );
+      transfer( committee_account, alice_id, asset(10000) );
+      transfer( alice_id, bob_id, asset(100) );
+      transfer( bob_id, alice_id, asset(50) );
+      transfer( alice_id, bob_id, asset(25) );
+      generate_block();
+      verify_histories();
+
+      BOOST_TEST_MESSAGE( "An account created and used in the same block" );
+      const account_id_type carol_id = create_account( "carol" ).id;
+      transfer( alice_id, carol_id, asset(100) );
+      transfer( carol_id, bob_id, asset(10) );
+      generate_block();
+      verify_histories();
+
+      BOOST_TEST_MESSAGE( "A popped block and its transactions applied again" );
+      transfer( alice_id, bob_id, asset(1) );
+      transfer( bob_id, carol_id, asset(1) );
+      generate_block();
+      db.pop_block();
+      verify_histories();
+      generate_block();
+      verify_histories();
+   } catch ( const fc::exception& e )
+   {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
@@ -31,6 +31,7 @@
 
 #include <graphene/chain/fba_object.hpp>
 #include <graphene/chain/market_object.hpp>
+#include <graphene/chain/proposal_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
 #include <graphene/chain/exceptions.hpp>
 
@@ -736,6 +737,137 @@ BOOST_AUTO_TEST_CASE( fee_refund_test )
    FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( fees_of_a_block_are_summed_per_account )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      transfer( committee_account, alice_id, asset(1000000) );
+      generate_block();
+
+      auto fees_paid = [&]() {
+         const account_statistics_object& s = alice_id(db).statistics(db);
+         return s.pending_fees + s.pending_vested_fees + s.lifetime_fees_paid;
+      };
+      const share_type fees_before = fees_paid();
+      const share_type balance_before = get_balance( alice_id, asset_id_type() );
+
+      // the statistics of alice are modified once for all transactions of the block
+      for( int i = 1; i <= 3; ++i )
+      {
+         transfer_operation op;
+         op.from = alice_id;
+         op.to = bob_id;
+         op.amount = asset(i);
+         op.fee = asset(100 * i);
+         signed_transaction tx;
+         tx.operations.push_back( op );
+         set_expiration( db, tx );
+         PUSH_TX( db, tx, ~0 );
+      }
+      generate_block();
+
+      BOOST_CHECK_EQUAL( db.fetch_block_by_number( db.head_block_num() )->transactions.size(), 3 );
+      BOOST_CHECK_EQUAL( (fees_paid() - fees_before).value, 600 );
+      BOOST_CHECK_EQUAL( get_balance( alice_id, asset_id_type() ), balance_before.value - 606 );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( fees_of_a_failed_proposal_are_not_summed )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      transfer( committee_account, alice_id, asset(1000000) );
+      generate_block();
+
+      auto fees_paid = [&]() {
+         const account_statistics_object& s = alice_id(db).statistics(db);
+         return s.pending_fees + s.pending_vested_fees + s.lifetime_fees_paid;
+      };
+      const share_type fees_before = fees_paid();
+      const share_type balance_before = get_balance( alice_id, asset_id_type() );
+
+      // the first transfer pays its fee, the second one fails and takes the first one with it
+      transfer_operation paid;
+      paid.from = alice_id;
+      paid.to = bob_id;
+      paid.amount = asset(1);
+      paid.fee = asset(500);
+      transfer_operation failing = paid;
+      failing.amount = asset(100000000);
+      failing.fee = asset(0);
+
+      proposal_create_operation pop;
+      pop.fee_paying_account = alice_id;
+      pop.proposed_ops.emplace_back( paid );
+      pop.proposed_ops.emplace_back( failing );
+      pop.expiration_time = db.head_block_time() + fc::days(1);
+      signed_transaction tx;
+      tx.operations.push_back( pop );
+      set_expiration( db, tx );
+      const proposal_id_type proposal_id = PUSH_TX( db, tx, ~0 ).operation_results.front().get<object_id_type>();
+
+      proposal_update_operation uop;
+      uop.fee_paying_account = alice_id;
+      uop.proposal = proposal_id;
+      uop.active_approvals_to_add.insert( alice_id );
+      uop.fee = asset(7);
+      tx.clear();
+      tx.operations.push_back( uop );
+      set_expiration( db, tx );
+      PUSH_TX( db, tx, ~0 );
+      generate_block();
+
+      BOOST_CHECK( db.find( proposal_id ) != nullptr );
+      BOOST_CHECK_EQUAL( (fees_paid() - fees_before).value, 7 );
+      BOOST_CHECK_EQUAL( get_balance( alice_id, asset_id_type() ), balance_before.value - 7 );
+      verify_asset_supplies( db );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( account_upgrade_processes_fees_of_the_same_block )
+{
+   try
+   {
+      ACTORS((alice)(bob));
+      transfer( committee_account, alice_id, asset(1000000) );
+      generate_block();
+
+      const share_type lifetime_before = alice_id(db).statistics(db).lifetime_fees_paid;
+
+      transfer_operation op;
+      op.from = alice_id;
+      op.to = bob_id;
+      op.amount = asset(1);
+      op.fee = asset(1000);
+      signed_transaction tx;
+      tx.operations.push_back( op );
+      set_expiration( db, tx );
+      PUSH_TX( db, tx, ~0 );
+
+      // the upgrade pays out the pending fees, including the one paid earlier in the block
+      account_upgrade_operation uop;
+      uop.account_to_upgrade = alice_id;
+      uop.upgrade_to_lifetime_member = true;
+      tx.clear();
+      tx.operations.push_back( uop );
+      set_expiration( db, tx );
+      PUSH_TX( db, tx, ~0 );
+      generate_block();
+
+      const account_statistics_object& stats = alice_id(db).statistics(db);
+      BOOST_CHECK( alice_id(db).is_lifetime_member() );
+      BOOST_CHECK_EQUAL( stats.pending_fees.value, 0 );
+      BOOST_CHECK_EQUAL( stats.pending_vested_fees.value, 0 );
+      BOOST_CHECK_EQUAL( (stats.lifetime_fees_paid - lifetime_before).value, 1000 );
+      verify_asset_supplies( db );
+   }
+   FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( stealth_fba_test )
 {
    try
@@ -36,6 +36,7 @@
 #include <graphene/chain/withdraw_permission_object.hpp>
 #include <graphene/chain/witness_object.hpp>
 #include <graphene/account_history/account_history_plugin.hpp>
+#include <graphene/market_history/market_history_plugin.hpp>
 
 #include <fc/crypto/digest.hpp>
 
@@ -44,6 +45,21 @@
 using namespace graphene::chain;
 using namespace graphene::chain::test;
 
+namespace {
+   /** the market history plugin records fills in 15 second buckets which move to hourly buckets */
+   struct market_history_fixture : database_fixture
+   {
+      market_history_fixture() : database_fixture( plugin_options() ) {}
+
+      static boost::program_options::variables_map plugin_options()
+      {
+         boost::program_options::variables_map options;
+         options.insert( std::make_pair( "bucket-size", boost::program_options::variable_value( string("[15,3600]"), false ) ) );
+         return options;
+      }
+   };
+}
+
 BOOST_FIXTURE_TEST_SUITE( operation_tests, database_fixture )
 
 BOOST_AUTO_TEST_CASE( feed_limit_logic_test )
@@ -439,6 +455,162 @@ BOOST_AUTO_TEST_CASE( prediction_market )
 }
 
 
+BOOST_FIXTURE_TEST_CASE( market_history_rolls_back_popped_blocks, market_history_fixture )
+{ try {
+      ACTORS((buyer)(seller));
+
+      const auto& test = create_user_issued_asset( "MHTEST" );
+      const asset_id_type test_id = test.id;
+      issue_uia( seller, test.amount(10000) );
+      transfer( committee_account, buyer_id, asset(10000) );
+      generate_block();
+
+      auto mh = app.get_plugin<graphene::market_history::market_history_plugin>( "market_history" );
+      const size_t fills_before = mh->fill_history().size();
+      const size_t buckets_before = mh->buckets().size();
+
+      create_sell_order( seller_id, asset(100, test_id), asset(100) );
+      create_sell_order( buyer_id, asset(100), asset(100, test_id) );
+      generate_block();
+      BOOST_CHECK_EQUAL( mh->fill_history().size(), fills_before + 2 );
+      BOOST_CHECK_EQUAL( mh->buckets().size(), buckets_before + mh->tracked_buckets().size() );
+      BOOST_CHECK( mh->journal_size() > 0 );
+
+      const auto packed_buckets = [&]() {
+         return fc::raw::pack( vector<graphene::market_history::bucket_object>( mh->buckets().begin(), mh->buckets().end() ) );
+      };
+      const auto buckets_after_first_trade = packed_buckets();
+
+      BOOST_TEST_MESSAGE( "A second trade updates the buckets of the first one" );
+      create_sell_order( seller_id, asset(200, test_id), asset(300) );
+      create_sell_order( buyer_id, asset(300), asset(200, test_id) );
+      generate_block();
+      BOOST_CHECK_EQUAL( mh->fill_history().size(), fills_before + 4 );
+      BOOST_CHECK( packed_buckets() != buckets_after_first_trade );
+
+      BOOST_TEST_MESSAGE( "Replacing the block of the second trade rolls the trade back" );
+      db.pop_block();
+      generate_block();
+      BOOST_CHECK_EQUAL( mh->fill_history().size(), fills_before + 2 );
+      BOOST_CHECK( packed_buckets() == buckets_after_first_trade );
+
+   } catch( const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( market_history_aggregates_base_buckets, market_history_fixture )
+{ try {
+      using graphene::market_history::bucket_object;
+      ACTORS((buyer)(seller));
+
+      const auto& test = create_user_issued_asset( "MHTEST" );
+      const asset_id_type test_id = test.id;
+      issue_uia( seller, test.amount(10000) );
+      transfer( committee_account, buyer_id, asset(10000) );
+      generate_block();
+
+      auto mh = app.get_plugin<graphene::market_history::market_history_plugin>( "market_history" );
+      BOOST_REQUIRE_EQUAL( mh->base_bucket_seconds(), 15 );
+
+      for( int i = 1; i <= 3; ++i )
+      {
+         create_sell_order( seller_id, asset(100 * i, test_id), asset(100 * i) );
+         create_sell_order( buyer_id, asset(100 * i), asset(100 * i, test_id) );
+         generate_blocks( db.head_block_time() + 20 );
+      }
+
+      const auto base_volume = []( const vector<bucket_object>& buckets ) {
+         share_type volume;
+         for( const bucket_object& b : buckets )
+            volume += b.base_volume;
+         return volume;
+      };
+      const auto history = [&]( uint32_t seconds ) {
+         return mh->get_market_history( test_id, asset_id_type(), seconds, fc::time_point_sec(), db.head_block_time(), 200 );
+      };
+
+      BOOST_CHECK_EQUAL( history( 15 ).size(), 3 );
+      BOOST_CHECK_EQUAL( base_volume( history( 15 ) ).value, 600 );
+      BOOST_CHECK_EQUAL( base_volume( history( 60 ) ).value, 600 );
+      BOOST_CHECK( history( 60 ).size() <= 2 );
+      BOOST_CHECK_EQUAL( base_volume( history( 4 * 3600 ) ).value, 600 );
+      BOOST_CHECK( history( 4 * 3600 ).front().key.seconds == 4 * 3600 );
+      GRAPHENE_REQUIRE_THROW( history( 20 ), fc::exception );
+
+      BOOST_TEST_MESSAGE( "Base buckets past their retention move to the hourly buckets" );
+      generate_blocks( db.head_block_time() + 15 * mh->max_history() + 3600 );
+      BOOST_CHECK( history( 15 ).empty() );
+      BOOST_CHECK_EQUAL( base_volume( history( 3600 ) ).value, 600 );
+      BOOST_CHECK_EQUAL( base_volume( history( 7 * 86400 ) ).value, 600 );
+      // the hourly bucket can not be split into minutes, it is returned as it is
+      BOOST_REQUIRE_EQUAL( history( 60 ).size(), 1 );
+      BOOST_CHECK_EQUAL( history( 60 ).front().key.seconds, 3600 );
+      BOOST_CHECK_EQUAL( base_volume( history( 60 ) ).value, 600 );
+      BOOST_CHECK_EQUAL( base_volume( history( 45 * 60 ) ).value, 600 );
+
+   } catch( const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_FIXTURE_TEST_CASE( market_summaries_cover_the_last_day, market_history_fixture )
+{ try {
+      using namespace graphene::market_history;
+      ACTORS((buyer)(seller));
+
+      const auto& test = create_user_issued_asset( "MHTEST" );
+      const asset_id_type test_id = test.id;
+      issue_uia( seller, test.amount(10000) );
+      transfer( committee_account, buyer_id, asset(10000) );
+      generate_block();
+
+      auto mh = app.get_plugin<market_history_plugin>( "market_history" );
+      const auto& summaries = mh->market_summaries().get<by_market>();
+      BOOST_CHECK( summaries.find( boost::make_tuple( asset_id_type(), test_id ) ) == summaries.end() );
+
+      create_sell_order( seller_id, asset(100, test_id), asset(100) );
+      create_sell_order( buyer_id, asset(100), asset(100, test_id) );
+      generate_block();
+
+      auto itr = summaries.find( boost::make_tuple( asset_id_type(), test_id ) );
+      BOOST_REQUIRE( itr != summaries.end() );
+      BOOST_CHECK_EQUAL( itr->base_volume.value, 100 );
+      BOOST_CHECK_EQUAL( itr->quote_volume.value, 100 );
+      BOOST_CHECK_EQUAL( itr->hours.size(), 1 );
+
+      BOOST_TEST_MESSAGE( "A trade in a later hour adds to the volume and moves the latest price" );
+      generate_blocks( db.head_block_time() + 3600 );
+      create_sell_order( seller_id, asset(100, test_id), asset(200) );
+      create_sell_order( buyer_id, asset(200), asset(100, test_id) );
+      generate_block();
+      itr = summaries.find( boost::make_tuple( asset_id_type(), test_id ) );
+      BOOST_REQUIRE( itr != summaries.end() );
+      BOOST_CHECK_EQUAL( itr->base_volume.value, 300 );
+      BOOST_CHECK_EQUAL( itr->latest_base.value, 200 );
+      BOOST_CHECK_EQUAL( itr->hours.size(), 2 );
+
+      BOOST_TEST_MESSAGE( "The first trade leaves the window after a day" );
+      generate_blocks( itr->hours.front().open + 86400 );
+      generate_block();
+      itr = summaries.find( boost::make_tuple( asset_id_type(), test_id ) );
+      BOOST_REQUIRE( itr != summaries.end() );
+      BOOST_CHECK_EQUAL( itr->base_volume.value, 200 );
+      BOOST_CHECK_EQUAL( itr->hours.size(), 1 );
+
+      BOOST_TEST_MESSAGE( "A market without trades for a day is no longer summarized" );
+      generate_blocks( db.head_block_time() + 86400 );
+      generate_block();
+      BOOST_CHECK( summaries.find( boost::make_tuple( asset_id_type(), test_id ) ) == summaries.end() );
+
+   } catch( const fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_CASE( create_account_test )
 {
    try {
@@ -24,6 +24,8 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/database_api.hpp>
+
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
@@ -1226,6 +1228,57 @@ BOOST_AUTO_TEST_CASE( balance_object_test )
    BOOST_CHECK_EQUAL(db.get_balance(op.deposit_to_account, asset_id_type()).amount.value, 901);
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE( balance_objects_by_key )
+{ try {
+   database db;
+   fc::temp_directory td( graphene::utilities::temp_directory_path() );
+   auto n_key = generate_private_key("n");
+   auto p_key = generate_private_key("p");
+   auto z_key = generate_private_key("z");
+   const fc::ecc::public_key p_pub = p_key.get_public_key();
+   // balances of p under three of its five address forms
+   genesis_state.initial_balances.push_back({n_key.get_public_key(), GRAPHENE_SYMBOL, 1});
+   genesis_state.initial_balances.push_back({pts_address(p_pub, false, 56), GRAPHENE_SYMBOL, 2});
+   genesis_state.initial_balances.push_back({pts_address(p_pub, true, 0), GRAPHENE_SYMBOL, 3});
+   genesis_state.initial_balances.push_back({p_pub, GRAPHENE_SYMBOL, 4});
+   genesis_state.initial_accounts.emplace_back("n", n_key.get_public_key());
+   db.open(td.path(), [this]{return genesis_state;});
+
+   BOOST_CHECK( balance_id_type(1)(db).is_owned_by( p_key.get_public_key() ) );
+   BOOST_CHECK( balance_id_type(2)(db).is_owned_by( p_key.get_public_key() ) );
+   BOOST_CHECK( !balance_id_type(2)(db).is_owned_by( n_key.get_public_key() ) );
+
+   graphene::app::database_api db_api( db );
+   auto balances = db_api.get_balance_objects_by_keys( { n_key.get_public_key(), p_key.get_public_key(), z_key.get_public_key() } );
+   BOOST_REQUIRE_EQUAL( balances.size(), 3 );
+   BOOST_REQUIRE_EQUAL( balances[0].size(), 1 );
+   BOOST_CHECK( balances[0][0].id == balance_id_type() );
+   BOOST_CHECK_EQUAL( balances[1].size(), 3 );
+   share_type total = 0;
+   for( const balance_object& b : balances[1] )
+      total += b.balance.amount;
+   BOOST_CHECK_EQUAL( total.value, 9 );
+   BOOST_CHECK( balances[2].empty() );
+
+   // the same balances are found by their addresses
+   const auto p_addresses = balance_object::owner_addresses( p_key.get_public_key() );
+   auto by_address = db_api.get_balance_objects( vector<address>( p_addresses.begin(), p_addresses.end() ) );
+   BOOST_CHECK_EQUAL( by_address.size(), 3 );
+
+   // and a pts address balance is claimed with the key
+   balance_claim_operation op;
+   op.deposit_to_account = db.get_index_type<account_index>().indices().get<by_name>().find("n")->get_id();
+   op.total_claimed = asset(3);
+   op.balance_to_claim = balance_id_type(2);
+   op.balance_owner_key = p_key.get_public_key();
+   trx.operations = {op};
+   trx.sign( n_key, db.get_chain_id() );
+   trx.sign( p_key, db.get_chain_id() );
+   db.push_transaction(trx);
+   BOOST_CHECK_EQUAL( db.get_balance(op.deposit_to_account, asset_id_type()).amount.value, 3 );
+   BOOST_CHECK_EQUAL( db_api.get_balance_objects_by_keys( { p_key.get_public_key() } )[0].size(), 2 );
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(transfer_with_memo) {
    try {
       ACTOR(alice);
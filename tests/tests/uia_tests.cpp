@@ -24,11 +24,14 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <graphene/app/database_api.hpp>
+
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
 #include <graphene/chain/is_authorized_asset.hpp>
 
+#include <graphene/chain/account_listing_object.hpp>
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 
@@ -355,6 +358,238 @@ BOOST_AUTO_TEST_CASE( transfer_whitelist_uia )
    }
 }
 
+BOOST_AUTO_TEST_CASE( account_listing_objects )
+{
+   try {
+      INVOKE(issue_whitelist_uia);
+      const asset_id_type uia_id = get_asset("ADVANCED").id;
+      const account_id_type izzy_id = get_account("izzy").id;
+      const account_id_type nathan_id = get_account("nathan").id;
+      const account_id_type vikram_id = get_account("vikram").id;
+      const auto& listings = db.get_index_type<account_listing_index>().indices().get<by_listed_account>();
+      const auto& by_authorizing = db.get_index_type<account_listing_index>().indices().get<by_authorizing_account>();
+
+      // izzy listed vikram and nathan
+      BOOST_CHECK_EQUAL( by_authorizing.count( izzy_id ), 2 );
+      auto itr = listings.find( boost::make_tuple( nathan_id, izzy_id ) );
+      BOOST_REQUIRE( itr != listings.end() );
+      BOOST_CHECK( itr->is_whitelisted() );
+      BOOST_CHECK( !itr->is_blacklisted() );
+      const account_listing_id_type listing_id = itr->id;
+
+      account_whitelist_operation wop;
+      wop.authorizing_account = izzy_id;
+      wop.account_to_list = nathan_id;
+      wop.new_listing = account_whitelist_operation::white_and_black_listed;
+      trx.operations.clear();
+      trx.operations.push_back( wop );
+      PUSH_TX( db, trx, ~0 );
+      BOOST_CHECK( listing_id(db).is_whitelisted() );
+      BOOST_CHECK( listing_id(db).is_blacklisted() );
+
+      // the listing is not copied when the listed account is modified
+      db.modify( nathan_id(db), []( account_object& a ) { a.options.memo_key = public_key_type(); } );
+      BOOST_CHECK( listing_id(db).listing == account_whitelist_operation::white_and_black_listed );
+
+      // without listing there is no object, and nathan is no longer authorized
+      wop.new_listing = account_whitelist_operation::no_listing;
+      trx.operations.back() = wop;
+      PUSH_TX( db, trx, ~0 );
+      BOOST_CHECK( listings.find( boost::make_tuple( nathan_id, izzy_id ) ) == listings.end() );
+      BOOST_CHECK( db.find( listing_id ) == nullptr );
+      BOOST_CHECK( !is_authorized_asset( db, nathan_id(db), uia_id(db) ) );
+      BOOST_CHECK_EQUAL( by_authorizing.count( izzy_id ), 1 );
+      BOOST_CHECK( by_authorizing.lower_bound( izzy_id )->listed_account == vikram_id );
+
+      // removing a listing that does not exist changes nothing
+      PUSH_TX( db, trx, ~0 );
+      BOOST_CHECK_EQUAL( by_authorizing.count( izzy_id ), 1 );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( authorized_asset_cache_invalidation )
+{
+   try {
+      INVOKE(issue_whitelist_uia);
+      const asset_id_type uia_id = get_asset("ADVANCED").id;
+      const account_id_type izzy_id = get_account("izzy").id;
+      const account_id_type nathan_id = get_account("nathan").id;
+
+      // the cached decision must always be the one computed from scratch
+      auto authorized = [&]( account_id_type id ) -> bool {
+         bool cached = is_authorized_asset( db, id(db), uia_id(db) );
+         BOOST_CHECK_EQUAL( cached, detail::_is_authorized_asset( db, id(db), uia_id(db) ) );
+         return cached;
+      };
+      auto list_nathan = [&]( uint8_t listing ) {
+         account_whitelist_operation wop;
+         wop.authorizing_account = izzy_id;
+         wop.account_to_list = nathan_id;
+         wop.new_listing = listing;
+         trx.operations.clear();
+         trx.operations.push_back( wop );
+         PUSH_TX( db, trx, ~0 );
+      };
+      auto update_options = [&]( std::function<void(asset_options&)> f ) {
+         asset_update_operation uop;
+         uop.issuer = izzy_id;
+         uop.asset_to_update = uia_id;
+         uop.new_options = uia_id(db).options;
+         f( uop.new_options );
+         trx.operations.clear();
+         trx.operations.push_back( uop );
+         PUSH_TX( db, trx, ~0 );
+      };
+
+      BOOST_CHECK( authorized( nathan_id ) );
+      BOOST_CHECK( authorized( nathan_id ) );
+      BOOST_CHECK( db.get_authorized_asset_cache().size() > 0 );
+
+      BOOST_TEST_MESSAGE( "Blacklist authority added to the asset" );
+      update_options( [&]( asset_options& o ) { o.blacklist_authorities.insert( izzy_id ); } );
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Listing modified" );
+      list_nathan( account_whitelist_operation::white_and_black_listed );
+      BOOST_CHECK( !authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Listing removed" );
+      list_nathan( account_whitelist_operation::no_listing );
+      BOOST_CHECK( !authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Listing created" );
+      list_nathan( account_whitelist_operation::white_listed );
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Allowed assets of the account changed" );
+      db.modify( nathan_id(db), []( account_object& a ) { a.allowed_assets = flat_set<asset_id_type>(); } );
+      BOOST_CHECK( !authorized( nathan_id ) );
+      db.modify( nathan_id(db), [&]( account_object& a ) { a.allowed_assets->insert( uia_id ); } );
+      BOOST_CHECK( authorized( nathan_id ) );
+      db.modify( nathan_id(db), []( account_object& a ) { a.allowed_assets.reset(); } );
+
+      BOOST_TEST_MESSAGE( "Whitelist authorities of the asset changed" );
+      generate_block();
+      set_expiration( db, trx );
+      list_nathan( account_whitelist_operation::no_listing );
+      BOOST_CHECK( !authorized( nathan_id ) );
+      update_options( [&]( asset_options& o ) { o.whitelist_authorities.clear(); } );
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Changes undone by an undo session" );
+      {
+         auto session = db._undo_db.start_undo_session();
+         db.create<account_listing_object>( [&]( account_listing_object& l ) {
+            l.authorizing_account = izzy_id;
+            l.listed_account = nathan_id;
+            l.listing = account_whitelist_operation::black_listed;
+         });
+         BOOST_CHECK( !authorized( nathan_id ) );
+         session.undo();
+      }
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Changes undone by popping a block" );
+      generate_block();
+      set_expiration( db, trx );
+      update_options( [&]( asset_options& o ) { o.whitelist_authorities.insert( izzy_id ); } );
+      generate_block();
+      BOOST_CHECK( !authorized( nathan_id ) );
+      db.pop_block();
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Removed listing re-inserted by an undo session" );
+      set_expiration( db, trx );
+      list_nathan( account_whitelist_operation::black_listed );
+      BOOST_CHECK( !authorized( nathan_id ) );
+      {
+         auto session = db._undo_db.start_undo_session();
+         const auto& listings = db.get_index_type<account_listing_index>().indices().get<by_listed_account>();
+         auto itr = listings.find( boost::make_tuple( nathan_id, izzy_id ) );
+         BOOST_REQUIRE( itr != listings.end() );
+         db.remove( *itr );
+         BOOST_CHECK( authorized( nathan_id ) );
+         session.undo();
+      }
+      BOOST_CHECK( !authorized( nathan_id ) );
+      list_nathan( account_whitelist_operation::no_listing );
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Asset flags and authorities modified directly" );
+      db.modify( uia_id(db), []( asset_object& a ) { a.options.flags ^= white_list; } );
+      BOOST_CHECK( authorized( nathan_id ) );
+      db.modify( uia_id(db), [&]( asset_object& a ) {
+         a.options.flags ^= white_list;
+         a.options.whitelist_authorities.insert( izzy_id );
+      });
+      BOOST_CHECK( !authorized( nathan_id ) );
+      db.modify( uia_id(db), []( asset_object& a ) { a.options.whitelist_authorities.clear(); } );
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      BOOST_TEST_MESSAGE( "Decisions made on the other side of hardfork 415" );
+      {
+         // moving the head time does not touch any observed index, only the hardfork flag of a decision
+         // tells that it was made under the other rule for an asset without whitelist authorities
+         auto session = db._undo_db.start_undo_session();
+         db.modify( db.get_dynamic_global_properties(), []( dynamic_global_property_object& p ) {
+            p.time = HARDFORK_415_TIME;
+         });
+         BOOST_CHECK( !authorized( nathan_id ) );
+         session.undo();
+      }
+      BOOST_CHECK( authorized( nathan_id ) );
+
+      db.get_authorized_asset_cache().clear();
+      BOOST_CHECK_EQUAL( db.get_authorized_asset_cache().size(), 0 );
+      BOOST_CHECK( authorized( nathan_id ) );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( asset_metadata_and_symbol_search )
+{
+   try {
+      const asset_id_type uia_id = create_user_issued_asset( "ADVANCED" ).id;
+      create_user_issued_asset( "ADVB" );
+      create_user_issued_asset( "ADX" );
+      const asset_id_type usd_id = create_bitasset( "USDBIT" ).id;
+      issue_uia( account_id_type(), asset( 1000, uia_id ) );
+      graphene::app::database_api db_api( db );
+
+      auto metadata = db_api.get_asset_metadata( { "ADVANCED", std::string( object_id_type( usd_id ) ), "NOPE" } );
+      BOOST_REQUIRE_EQUAL( metadata.size(), 3 );
+      BOOST_REQUIRE( metadata[0].valid() );
+      BOOST_CHECK( metadata[0]->asset_obj.id == uia_id );
+      BOOST_CHECK_EQUAL( metadata[0]->dynamic_data.current_supply.value, 1000 );
+      BOOST_CHECK( !metadata[0]->bitasset.valid() );
+      BOOST_REQUIRE( metadata[1].valid() );
+      BOOST_CHECK_EQUAL( metadata[1]->asset_obj.symbol, "USDBIT" );
+      BOOST_REQUIRE( metadata[1]->bitasset.valid() );
+      BOOST_CHECK_EQUAL( metadata[1]->bitasset->feed_count, 0 );
+      BOOST_CHECK( !metadata[1]->bitasset->is_prediction_market );
+      BOOST_CHECK( !metadata[2].valid() );
+      BOOST_CHECK( db_api.get_asset_metadata( { GRAPHENE_SYMBOL } )[0]->dynamic_data.current_supply > 0 );
+
+      auto found = db_api.search_assets( "adv", 100 );
+      BOOST_REQUIRE_EQUAL( found.size(), 2 );
+      BOOST_CHECK_EQUAL( found[0].asset_obj.symbol, "ADVANCED" );
+      BOOST_CHECK_EQUAL( found[1].asset_obj.symbol, "ADVB" );
+      BOOST_CHECK_EQUAL( db_api.search_assets( "Ad", 100 ).size(), 3 );
+      BOOST_CHECK_EQUAL( db_api.search_assets( "ad", 1 ).size(), 1 );
+      BOOST_CHECK( db_api.search_assets( "advz", 100 ).empty() );
+      BOOST_CHECK( db_api.search_assets( "", 100 ).size() >= 5 );
+      GRAPHENE_REQUIRE_THROW( db_api.search_assets( "ad", 101 ), fc::exception );
+   } catch(fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 /**
  * verify that issuers can halt transfers
  */
@@ -30,6 +30,7 @@
 #include <graphene/chain/game_object.hpp>
 #include "../common/database_fixture.hpp"
 #include <graphene/utilities/tempdir.hpp>
+#include <graphene/chain/account_listing_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/is_authorized_asset.hpp>
 
@@ -1577,7 +1578,8 @@ BOOST_FIXTURE_TEST_CASE( player_account_is_not_whitelisted, database_fixture )
             trx.operations.push_back(wop);
             db.push_transaction( trx, ~0 );
             trx.operations.clear();
-            BOOST_CHECK(nathan_id(db).whitelisting_accounts.find(nathan_id) != nathan_id(db).whitelisting_accounts.end());
+            BOOST_CHECK(db.get_index_type<account_listing_index>().indices().get<by_listed_account>()
+                          .find(boost::make_tuple(nathan_id, nathan_id))->is_whitelisted());
 
             issue_uia(nathan_id, asset(GRAPHENE_MAX_SHARE_SUPPLY/3, new_id));
 
@@ -1655,7 +1657,8 @@ BOOST_FIXTURE_TEST_CASE( payer_account_is_not_whitelisted, database_fixture )
             trx.operations.push_back(wop);
             db.push_transaction( trx, ~0 );
             trx.operations.clear();
-            BOOST_CHECK(nathan_id(db).whitelisting_accounts.find(nathan_id) != nathan_id(db).whitelisting_accounts.end());
+            BOOST_CHECK(db.get_index_type<account_listing_index>().indices().get<by_listed_account>()
+                          .find(boost::make_tuple(nathan_id, nathan_id))->is_whitelisted());
 
             issue_uia(nathan_id, asset(GRAPHENE_MAX_SHARE_SUPPLY/3, new_id));
 